@@ -0,0 +1,116 @@
+/***********************************************************************************
+ * @author Brian Ibeling
+ * ibelingb@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file archiveWriter.h
+ * @brief frame archive thread with rolling segments
+ *
+ * writeTask copies each annotated frame into a bounded queue and returns; a
+ * SCHED_OTHER thread owns the archive. It delta encodes the frame (when enabled),
+ * whose zlib cost depends on the frame contents, appends it to the current
+ * segment and rolls to the next one (prefix_000.farc, prefix_001.farc, ...) every
+ * segmentFrames frames. Segments are prepared ahead of time and retired by the
+ * retention thread, so a roll normally just swaps mappings.
+ *
+ ************************************************************************************
+ */
+#ifndef ARCHIVE_WRITER_H
+#define ARCHIVE_WRITER_H
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "frameArchive.h"
+#include "deltaCodec.h"
+#include "retention.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define ARCHIVE_QUEUE_LEN             (8)
+#define ARCHIVE_PREPARE_WAIT_MS       (5)     /* poll period while the next segment is created */
+
+typedef struct {
+  uint8_t *pData;                             /* pixel buffer */
+  uint8_t *pHint;                             /* tile change bitmap */
+  uint8_t hasHint;
+  int elemSize;
+  archiveIndexEntry_t entry;                  /* codec, offset and size filled in on append */
+} archiveFrame_t;
+
+typedef struct {
+  pthread_t thread;
+  char prefix[64];                            /* segment filename prefix */
+  archiveFrame_t *pSlots;                     /* preallocated frame slots */
+  size_t slotLen;
+  size_t hintLen;
+  unsigned int *pFreeStack;                   /* indices of free slots */
+  unsigned int freeCnt;
+  unsigned int *pPending;                     /* FIFO of queued slot indices */
+  unsigned int pendingHead;
+  unsigned int pendingCnt;
+  pthread_mutex_t mutex;
+  pthread_cond_t workCond;
+  uint8_t running;
+  uint8_t started;
+  frameArchive_t archive;                     /* current segment, owned by the thread once started */
+  uint8_t segmentOpen;
+  uint8_t useDelta;
+  deltaEncoder_t deltaEnc;
+  uint32_t segmentFrames;                     /* frames per segment */
+  uint64_t segmentCap;                        /* bytes preallocated per segment */
+  retentionMgr_t *pRetention;                 /* prepares and retires segments, may be NULL */
+  unsigned long archivedCnt;                  /* frames appended */
+  unsigned long failedCnt;                    /* no segment to append to */
+  unsigned long droppedCnt;                   /* queue full at submit */
+  unsigned int segment;                       /* number of the current segment */
+} archiveWriter_t;
+
+/*---------------------------------------------------------------------------------*/
+
+/**
+ * @brief allocate the queue, create the first segment and start the archive thread
+ *
+ * @param pWriter - writer to initialize
+ * @param prefix - segment filename prefix (e.g. "./frames_filt0_hough0")
+ * @param slotLen - largest frame to be queued (bytes)
+ * @param hintLen - tile change bitmap length (bytes)
+ * @param segmentFrames - frames per segment
+ * @param useDelta - delta encode frames instead of archiving them raw
+ * @param pCpuSet - cores the thread may run on (NULL for no restriction)
+ * @param pRetention - retention manager for segments (NULL for none)
+ * @return 0 on success, -1 on error
+ */
+int archive_writer_start(archiveWriter_t *pWriter, const char *prefix, size_t slotLen, size_t hintLen,
+                         uint32_t segmentFrames, uint8_t useDelta, const cpu_set_t *pCpuSet,
+                         retentionMgr_t *pRetention);
+
+/**
+ * @brief queue a copy of a frame without blocking
+ *
+ * @param pWriter - running writer
+ * @param pEntry - frameNum, frameTime, type, rows, cols and isColor of the frame
+ * @param pData - continuous 8-bit pixel data
+ * @param elemSize - bytes per pixel
+ * @param pHint - tile change bitmap from the diff stage, NULL if none
+ * @return 0 on success, -1 if the queue is full (frame dropped)
+ */
+int archive_writer_submit(archiveWriter_t *pWriter, const archiveIndexEntry_t *pEntry, const uint8_t *pData,
+                          int elemSize, const uint8_t *pHint);
+
+/**
+ * @brief archive everything queued, retire the last segment and stop the thread
+ *
+ * @param pWriter - writer
+ */
+void archive_writer_stop(archiveWriter_t *pWriter);
+
+#endif
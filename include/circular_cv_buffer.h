@@ -24,20 +24,34 @@
 /*---------------------------------------------------------------------------------*/
 /* INCLUDES */
 #include <memory>
+#include <stdint.h>
 #include <opencv2/core.hpp>
 
 class circular_cv_buffer {
 public:
 	explicit circular_cv_buffer(size_t size) :
 		buf_(std::unique_ptr<cv::Mat[]>(new cv::Mat[size])),
+		stamps_(std::unique_ptr<uint64_t[]>(new uint64_t[size * 2]())),
 		max_size_(size)
 	{
 
 	}
 
-	int put(const cv::Mat &item)
+	/* backs every entry with caller owned storage (e.g. locked memory) that put copies into */
+	void attach(uint8_t * const *ppData, int rows, int cols, int type)
 	{
-		buf_[head_] = item.clone();
+		for(size_t ind = 0; ind < max_size_; ++ind) {
+			buf_[ind] = cv::Mat(rows, cols, type, ppData[ind]);
+		}
+	}
+
+	/* captureNs / putNs are optional timestamps handed back by get() */
+	int put(const cv::Mat &item, uint64_t captureNs = 0, uint64_t putNs = 0)
+	{
+		/* reuses the entry's storage when the size matches */
+		item.copyTo(buf_[head_]);
+		stamps_[head_ * 2] = captureNs;
+		stamps_[(head_ * 2) + 1] = putNs;
 
 		if(full_)
 		{
@@ -48,14 +62,21 @@ public:
     return 0;
 	}
 
-	int get(cv::Mat &img)
+	/* copies into img, reusing its storage when the size matches (keep img across calls) */
+	int get(cv::Mat &img, uint64_t *pCaptureNs = NULL, uint64_t *pPutNs = NULL)
 	{
 		if(empty()) {
 			return -1;
 		}
 
 		// Read data and advance the tail (we now have a free space)
-		img = buf_[tail_].clone();
+		buf_[tail_].copyTo(img);
+		if(pCaptureNs != NULL) {
+			*pCaptureNs = stamps_[tail_ * 2];
+		}
+		if(pPutNs != NULL) {
+			*pPutNs = stamps_[(tail_ * 2) + 1];
+		}
 		full_ = false;
 		tail_ = (tail_ + 1) % max_size_;
 
@@ -69,7 +90,7 @@ public:
 		}
 
 		// Read data and DO NOT advance the tail
-		img = buf_[tail_].clone();
+		buf_[tail_].copyTo(img);
 		return 0;
 	}
 
@@ -112,6 +133,7 @@ public:
 
 private:
 	std::unique_ptr<cv::Mat[]> buf_;
+	std::unique_ptr<uint64_t[]> stamps_;
 	size_t head_ = 0;
 	size_t tail_ = 0;
 	const size_t max_size_;
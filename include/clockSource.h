@@ -0,0 +1,105 @@
+/***********************************************************************************
+ * @author Brian Ibeling
+ * ibelingb@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file clockSource.h
+ * @brief time source of the sequencer and services: the real clocks or a virtual clock
+ *
+ * By default every call reads the real clock. In virtual mode (-V) time only moves
+ * when the sequencer advances it: it sets the clock to a tick's release time,
+ * releases the services due, and moves on to the next tick once each released job
+ * (and any job it triggered downstream) has gone back to waiting. A replay then
+ * runs as fast as the jobs execute, with the same release pattern, frame stamps and
+ * selection decisions as a real-time run in which every job met its deadline.
+ *
+ * Job completion is tracked per release eventfd: service_event_signal counts the
+ * releases written, service_loop_wait the releases a service has consumed and
+ * finished, so nothing in the services themselves changes.
+ *
+ ************************************************************************************
+ */
+#ifndef CLOCK_SOURCE_H
+#define CLOCK_SOURCE_H
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdint.h>
+#include <signal.h>
+#include <time.h>
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define CLOCK_SOURCE_MAX_SERVICES     (32)
+#define CLOCK_SOURCE_STALL_MS         (2000)  /* real time a tick may wait on its jobs before moving on */
+
+/*---------------------------------------------------------------------------------*/
+
+/**
+ * @brief switch to the virtual clock; it starts at the current real time
+ *
+ * @param pReleaseFds - release eventfd of each service whose jobs a tick waits for
+ * @param numServices - number of fds
+ * @return 0 on success, -1 on error
+ */
+int clock_source_virtual(const int *pReleaseFds, unsigned int numServices);
+
+/**
+ * @brief is the virtual clock in use
+ *
+ * @return 1 if virtual, 0 if real
+ */
+uint8_t clock_source_is_virtual(void);
+
+/**
+ * @brief CLOCK_MONOTONIC time (virtual in virtual mode)
+ *
+ * @return nsec
+ */
+uint64_t clock_source_now_ns(void);
+
+/**
+ * @brief clock_gettime; CLOCK_MONOTONIC and CLOCK_REALTIME are virtual in virtual mode
+ *
+ * @param clk - clock id
+ * @param pTime - time read
+ * @return 0 on success, -1 on error
+ */
+int clock_source_gettime(clockid_t clk, struct timespec *pTime);
+
+/**
+ * @brief move the virtual clock forward (never back) to a CLOCK_MONOTONIC time
+ *
+ * @param nowNs - new time, nsec
+ */
+void clock_source_advance(uint64_t nowNs);
+
+/**
+ * @brief a release was written to fd (called by service_event_signal)
+ *
+ * @param fd - eventfd written
+ */
+void clock_source_released(int fd);
+
+/**
+ * @brief a service is back to waiting with releasesDone consumed (called by service_loop_wait)
+ *
+ * @param releaseFd - release eventfd of the service
+ * @param releasesDone - releases it has consumed since it started
+ */
+void clock_source_idle(int releaseFd, unsigned long long releasesDone);
+
+/**
+ * @brief wait until every released job is done (virtual mode)
+ *
+ * @param pRunning - gives up once this reads 0
+ * @return 0 when idle, -1 if stopped or stalled for CLOCK_SOURCE_STALL_MS
+ */
+int clock_source_wait_idle(volatile sig_atomic_t *pRunning);
+
+#endif
@@ -0,0 +1,109 @@
+/***********************************************************************************
+ * @author Joshua Malburg
+ * joshua.malburg@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file cpuTopology.h
+ * @brief core placement of the services from the CPU topology
+ *
+ * At startup the online CPUs, the ones this process may run on (cpuset / taskset
+ * affinity), the isolated ones (isolcpus=) and which CPUs are SMT siblings of one
+ * physical core are read from sysfs. One allowed, non-isolated CPU becomes the
+ * housekeeping core for the non-RT helpers (encoder pool, retention, metrics,
+ * trace writer). The RT services are placed on the isolated CPUs if there are
+ * any we may use, else on the remaining allowed ones: services with a core set (-S) keep it
+ * if it is usable, the rest go highest priority first to the least loaded CPU,
+ * preferring a physical core nobody uses over an SMT sibling of a busy one. Each
+ * thread is then pinned to exactly that CPU.
+ *
+ * isolcpus= CPUs are left out of every process's default affinity, so they are
+ * only used if our affinity names them, or if it is that default and our cpuset
+ * still lets a thread be pinned there (checked by trying). An affinity narrowed
+ * with taskset that leaves them out keeps us off them.
+ *
+ * The layout is logged and printed, with every CPU that ends up hosting more than
+ * one service (and RT CPUs shared with housekeeping) reported as contention. The
+ * CPUs left over once every service and the housekeeping helpers are placed are
+ * the default cores of the task executor (taskExecutor.h).
+ *
+ ************************************************************************************
+ */
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdint.h>
+#include <sched.h>
+
+/* project headers */
+#include "serviceRegistry.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define CPU_CORE_AUTO                 (-1)    /* serviceDef_t.cpuCore: placed by cpu_topology_place */
+#define CPU_TOPO_MAX_CPUS             (64)
+#define CPU_HOUSEKEEPING_DEFAULT      (0)     /* before / without cpu_topology_read */
+
+typedef struct {
+  unsigned int numCpus;                       /* highest online CPU + 1 */
+  cpu_set_t online;
+  cpu_set_t allowed;                          /* online and in our affinity (cpuset / taskset) */
+  cpu_set_t isolated;                         /* online, isolcpus= and usable by us */
+  int physCore[CPU_TOPO_MAX_CPUS];            /* SMT siblings share it */
+  int housekeeping;                           /* CPU of the non-RT helper threads */
+} cpuTopology_t;
+
+/*---------------------------------------------------------------------------------*/
+
+/**
+ * @brief read the topology of the machine and choose the housekeeping CPU
+ *
+ * @param pTopo - topology read
+ * @return 0 on success, -1 if no CPU is usable
+ */
+int cpu_topology_read(cpuTopology_t *pTopo);
+
+/**
+ * @brief choose the CPU of each service (sets cpuCore), log and print the layout
+ *
+ * @param pTopo - topology
+ * @param ppSvcs - services to place
+ * @param numSvcs - number of services
+ * @return number of CPUs with contention (shared by services or with housekeeping)
+ */
+unsigned int cpu_topology_place(const cpuTopology_t *pTopo, serviceDef_t **ppSvcs, unsigned int numSvcs);
+
+/**
+ * @brief allowed CPUs neither the given services nor the housekeeping helpers use
+ *
+ * @param pTopo - topology
+ * @param ppSvcs - services keeping their CPU to themselves (placed)
+ * @param numSvcs - number of services
+ * @param pSet - spare CPUs, empty if there are none
+ * @return number of spare CPUs
+ */
+int cpu_topology_spare(const cpuTopology_t *pTopo, serviceDef_t * const *ppSvcs, unsigned int numSvcs, cpu_set_t *pSet);
+
+/**
+ * @brief parse a CPU list ("0-3,6,8-9"); an empty string is an empty set
+ *
+ * @param pList - list
+ * @param pSet - CPUs listed (below CPU_TOPO_MAX_CPUS)
+ * @return 0 on success, -1 if malformed
+ */
+int cpu_list_parse(const char *pList, cpu_set_t *pSet);
+
+/**
+ * @brief CPU for the non-RT helper threads
+ *
+ * @return CPU chosen by cpu_topology_read, CPU_HOUSEKEEPING_DEFAULT before it
+ */
+int cpu_housekeeping_core(void);
+
+#endif
@@ -0,0 +1,81 @@
+/***********************************************************************************
+ * @author Joshua Malburg
+ * joshua.malburg@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file deadlineSched.h
+ * @brief run service threads under SCHED_DEADLINE (EDF + constant bandwidth server)
+ *
+ * pthread attributes can't select SCHED_DEADLINE, so deadline_thread_create starts
+ * the thread with the usual FIFO/RR attributes and the thread switches itself with
+ * sched_setattr before running the service. The kernel's admission control
+ * (sum of runtime/period within the root domain) is applied at that point; the
+ * result is handed back to the creator so main can fall back to the FIFO layout
+ * for every service if any one is refused.
+ *
+ * The kernel only admits deadline tasks whose affinity spans the whole root domain,
+ * so before switching the thread widens its affinity from its service core to every
+ * CPU its cpuset allows; services then run under global EDF. If the switch is
+ * refused the thread goes back to its service core.
+ *
+ * The kernel refuses clone() from a deadline task unless it resets on fork, so the
+ * switch sets SCHED_FLAG_RESET_ON_FORK: threads a service starts itself (write's
+ * video encoder) begin as SCHED_OTHER and set their own policy as usual.
+ *
+ ************************************************************************************
+ */
+#ifndef DEADLINE_SCHED_H
+#define DEADLINE_SCHED_H
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <pthread.h>
+#include <stdint.h>
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE                (6)
+#endif
+#ifndef SCHED_FLAG_RESET_ON_FORK
+#define SCHED_FLAG_RESET_ON_FORK      (0x01)
+#endif
+#define DEADLINE_MIN_RUNTIME_NS       (1024)  /* kernel granularity */
+
+typedef struct {
+  uint64_t runtimeNs;                         /* CPU budget per period */
+  uint64_t deadlineNs;                        /* relative deadline */
+  uint64_t periodNs;
+} deadlineParams_t;
+
+/*---------------------------------------------------------------------------------*/
+
+/**
+ * @brief switch the calling thread to SCHED_DEADLINE
+ *
+ * @param pParams - runtime <= deadline <= period
+ * @return 0 on success, -1 on error (errno set; EBUSY = admission refused,
+ *         EPERM = privileges / affinity, ENOSYS / EINVAL = not supported)
+ */
+int deadline_set_self(const deadlineParams_t *pParams);
+
+/**
+ * @brief create a thread that runs entry(arg) under SCHED_DEADLINE
+ *
+ * @param pThread - created thread
+ * @param pAttr - attributes used to create the thread (incl. affinity), kept if the switch is refused
+ * @param entry - service entry point
+ * @param arg - service argument
+ * @param pParams - deadline parameters
+ * @return 0 if running under SCHED_DEADLINE, 1 if running with pAttr's policy,
+ *         -1 if the thread couldn't be created
+ */
+int deadline_thread_create(pthread_t *pThread, const pthread_attr_t *pAttr, void *(*entry)(void *), void *arg,
+                           const deadlineParams_t *pParams);
+
+#endif
@@ -0,0 +1,152 @@
+/***********************************************************************************
+ * @author Joshua Malburg
+ * joshua.malburg@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file deltaCodec.h
+ * @brief lossless temporal (keyframe + residual) frame compression
+ *
+ * Every DELTA_KEYFRAME_INTERVAL frames a keyframe is stored zlib compressed. The
+ * frames in between are split into DELTA_TILE_SIZE tiles; only tiles that differ
+ * from the keyframe are coded, as a byte-wise residual (frame - key, mod 256),
+ * and the residuals are zlib compressed. Between ticks the clock only changes
+ * where the hands moved, so most tiles are skipped entirely.
+ *
+ * The diff stage supplies a tile change bitmap (where it saw motion) with each
+ * selected frame. Tiles flagged since the last keyframe are coded directly; the
+ * rest are compared against the keyframe and coded only if they differ, so the
+ * hint never costs losslessness.
+ *
+ * Delta payload layout: [deltaHeader_t][coded tile bitmap][zlib(residuals)]
+ *
+ ************************************************************************************
+ */
+#ifndef DELTA_CODEC_H
+#define DELTA_CODEC_H
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdint.h>
+#include <stddef.h>
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define DELTA_TILE_SIZE               (16)    /* tile edge in pixels */
+#define DELTA_KEYFRAME_INTERVAL       (30)    /* frames per keyframe */
+#define DELTA_ZLIB_LEVEL              (1)     /* fastest; residuals are mostly zero */
+
+#define DELTA_TILES(pixels)           (((pixels) + DELTA_TILE_SIZE - 1) / DELTA_TILE_SIZE)
+#define DELTA_BITMAP_BYTES(rows, cols) (((DELTA_TILES(rows) * DELTA_TILES(cols)) + 7) / 8)
+
+typedef struct {
+  uint32_t keyFrameNum;                       /* frame number of reference keyframe */
+  uint32_t residualLen;                       /* uncompressed residual bytes */
+  uint16_t tilesX;
+  uint16_t tilesY;
+  uint8_t  tileSize;
+  uint8_t  reserved[3];
+} deltaHeader_t;
+
+typedef struct {
+  uint8_t *pKey;                              /* current keyframe pixels */
+  uint8_t *pResidual;                         /* residual scratch buffer */
+  uint8_t *pOut;                              /* encoded output buffer */
+  uint8_t *pDirty;                            /* hint tiles accumulated since keyframe */
+  size_t maxFrameLen;
+  size_t outCap;
+  int rows;                                   /* geometry of current keyframe */
+  int cols;
+  int elemSize;
+  uint32_t keyFrameNum;
+  unsigned int keyInterval;
+  unsigned int sinceKey;                      /* frames since keyframe, 0 = need key */
+  unsigned long long rawBytes;                /* statistics */
+  unsigned long long codedBytes;
+} deltaEncoder_t;
+
+/*---------------------------------------------------------------------------------*/
+
+/**
+ * @brief allocate encoder buffers
+ *
+ * @param pEnc - encoder to initialize
+ * @param maxFrameLen - largest frame to be encoded (bytes)
+ * @param keyInterval - frames per keyframe
+ * @return 0 on success, -1 on error
+ */
+int delta_encoder_init(deltaEncoder_t *pEnc, size_t maxFrameLen, unsigned int keyInterval);
+
+/**
+ * @brief compress a frame as either a keyframe or a residual
+ *
+ * @param pEnc - encoder
+ * @param frameNum - frame number (recorded as keyFrameNum for keyframes)
+ * @param pFrame - continuous 8-bit pixel data
+ * @param rows, cols, elemSize - frame geometry
+ * @param pHint - tile change bitmap from the diff stage, NULL if none
+ * @param ppOut - returns encoded data (valid until the next call)
+ * @param pLen - returns encoded length
+ * @return ARCHIVE_CODEC_ZLIB for a keyframe, ARCHIVE_CODEC_DELTA for a residual, -1 on error
+ */
+int delta_encode(deltaEncoder_t *pEnc, uint32_t frameNum, const uint8_t *pFrame, int rows, int cols, int elemSize,
+                 const uint8_t *pHint, const uint8_t **ppOut, uint32_t *pLen);
+
+/**
+ * @brief make the next frame a keyframe (e.g. when starting a new archive segment)
+ */
+void delta_encoder_force_key(deltaEncoder_t *pEnc);
+
+/**
+ * @brief release encoder buffers
+ */
+void delta_encoder_free(deltaEncoder_t *pEnc);
+
+/**
+ * @brief decompress a keyframe
+ *
+ * @param pPayload - ARCHIVE_CODEC_ZLIB payload
+ * @param len - payload length
+ * @param pOut - output pixels
+ * @param outLen - expected frame size (bytes)
+ * @return 0 on success, -1 on error
+ */
+int delta_decode_key(const uint8_t *pPayload, uint32_t len, uint8_t *pOut, size_t outLen);
+
+/**
+ * @brief rebuild a frame from its keyframe and residual
+ *
+ * @param pPayload - ARCHIVE_CODEC_DELTA payload
+ * @param len - payload length
+ * @param pKey - decoded keyframe pixels
+ * @param rows, cols, elemSize - frame geometry
+ * @param pOut - output pixels (may not alias pKey)
+ * @return 0 on success, -1 on error
+ */
+int delta_decode(const uint8_t *pPayload, uint32_t len, const uint8_t *pKey, int rows, int cols, int elemSize, uint8_t *pOut);
+
+/**
+ * @brief keyframe number a residual payload refers to
+ *
+ * @param pPayload - ARCHIVE_CODEC_DELTA payload
+ * @param len - payload length
+ * @param pKeyFrameNum - returns keyframe number
+ * @return 0 on success, -1 on error
+ */
+int delta_key_frame(const uint8_t *pPayload, uint32_t len, uint32_t *pKeyFrameNum);
+
+/**
+ * @brief build a tile change bitmap from a binary difference mask
+ *
+ * @param pMask - 8-bit mask, nonzero where pixels changed
+ * @param rows, cols - mask size
+ * @param step - bytes per mask row
+ * @param pBitmap - output, DELTA_BITMAP_BYTES(rows, cols) bytes
+ */
+void delta_tile_bitmap(const uint8_t *pMask, int rows, int cols, size_t step, uint8_t *pBitmap);
+
+#endif
@@ -0,0 +1,125 @@
+/***********************************************************************************
+ * @author Brian Ibeling
+ * ibelingb@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file encoderPool.h
+ * @brief pool of non-RT worker threads that encode and save still images
+ *
+ * writeTask copies each annotated frame into a free slot and submits it; a worker
+ * (SCHED_OTHER, pinned to the non-RT cores) encodes it as PPM/PGM/PNG/JPEG and
+ * returns the slot to the pool. Acquiring a slot never blocks so the write
+ * service keeps its deadline even when encoding falls behind - the still image
+ * is dropped instead.
+ *
+ ************************************************************************************
+ */
+#ifndef ENCODER_POOL_H
+#define ENCODER_POOL_H
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "retention.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define ENCODER_PNG_COMPRESSION       (3)     /* zlib level; favour speed over size */
+
+typedef enum {
+  ENCODE_PPM = 0,                             /* binary PPM (PGM for grayscale frames) */
+  ENCODE_PGM,                                 /* binary PGM, color frames converted */
+  ENCODE_PNG,
+  ENCODE_JPEG,
+  ENCODE_CODEC_END
+} EncodeCodec_e;
+
+typedef struct {
+  uint8_t *pData;                             /* slot pixel buffer */
+  int type;                                   /* OpenCV Mat type */
+  int rows;
+  int cols;
+  char basename[80];                          /* output path without extension */
+} encodeJob_t;
+
+typedef struct {
+  pthread_t *pThreads;                        /* worker threads */
+  unsigned int numWorkers;
+  EncodeCodec_e codec;                        /* output format */
+  int quality;                                /* JPEG quality (0-100) */
+  encodeJob_t *pSlots;                        /* job slots / frame buffers */
+  unsigned int numSlots;
+  size_t slotLen;                             /* size of each slot pixel buffer */
+  unsigned int *pFreeStack;                   /* indices of free slots */
+  unsigned int freeCnt;
+  unsigned int *pPending;                     /* FIFO of submitted slot indices */
+  unsigned int pendingHead;
+  unsigned int pendingCnt;
+  pthread_mutex_t mutex;
+  pthread_cond_t workCond;                    /* signalled on submit / shutdown */
+  uint8_t running;
+  retentionMgr_t *pRetention;                 /* saved images are handed here, may be NULL */
+  unsigned long encodedCnt;                   /* images written */
+  unsigned long failedCnt;                    /* imwrite failures */
+  unsigned long droppedCnt;                   /* no free slot at acquire */
+} encoderPool_t;
+
+/*---------------------------------------------------------------------------------*/
+
+/**
+ * @brief allocate slots and start the worker threads
+ *
+ * @param pPool - pool to initialize
+ * @param numWorkers - number of encoder threads
+ * @param numSlots - number of frame buffers
+ * @param slotLen - size of each frame buffer (bytes)
+ * @param codec - output format
+ * @param quality - JPEG quality (0-100)
+ * @param pCpuSet - cores the workers may run on (NULL for no restriction)
+ * @param pRetention - retention manager for the saved images (NULL for none)
+ * @return 0 on success, -1 on error
+ */
+int encoder_pool_create(encoderPool_t *pPool, unsigned int numWorkers, unsigned int numSlots, size_t slotLen,
+                        EncodeCodec_e codec, int quality, const cpu_set_t *pCpuSet, retentionMgr_t *pRetention);
+
+/**
+ * @brief take a free slot without blocking
+ *
+ * @param pPool - pool
+ * @return slot to fill, or NULL if every slot is waiting to be encoded
+ */
+encodeJob_t *encoder_pool_acquire(encoderPool_t *pPool);
+
+/**
+ * @brief hand a filled slot to the workers; the slot returns to the pool once saved
+ *
+ * @param pPool - pool
+ * @param pJob - slot from encoder_pool_acquire
+ * @return 0 on success, -1 on error
+ */
+int encoder_pool_submit(encoderPool_t *pPool, encodeJob_t *pJob);
+
+/**
+ * @brief finish all submitted jobs, stop the workers and free the slots
+ *
+ * @param pPool - pool
+ */
+void encoder_pool_destroy(encoderPool_t *pPool);
+
+/**
+ * @brief parse a codec name (ppm, pgm, png, jpg/jpeg)
+ *
+ * @param name - codec name
+ * @return codec, or ENCODE_CODEC_END if unknown
+ */
+EncodeCodec_e encoder_codec_from_name(const char *name);
+
+#endif
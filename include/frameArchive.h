@@ -0,0 +1,162 @@
+/***********************************************************************************
+ * @author Joshua Malburg
+ * joshua.malburg@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file frameArchive.h
+ * @brief append-only, memory-mapped frame archive
+ *
+ * Preallocated segment files replace the per-frame PPM output. Each has the layout:
+ *
+ *   [archiveHeader_t][archiveIndexEntry_t x maxFrames][frame data ...]
+ *
+ * Frame data is appended sequentially (raw frames page aligned, compressed frames
+ * packed) and the index records frame number, timestamp, offset and size of each
+ * frame. Frame numbers run on across segments, so a frame's slot is its offset
+ * from the segment's first frame and it is located in O(1) without scanning the
+ * file (by bisection if frames were dropped). The header frame count is only
+ * advanced after the frame data and index entry are in place, so a crashed run
+ * still leaves a consistent (if shorter) archive behind.
+ *
+ * This header intentionally has no OpenCV dependency so the reader tool can be
+ * built and run on a host without it.
+ *
+ ************************************************************************************
+ */
+#ifndef FRAME_ARCHIVE_H
+#define FRAME_ARCHIVE_H
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdint.h>
+#include <stddef.h>
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define ARCHIVE_MAGIC                 (0x43524146) /* "FARC" little-endian */
+#define ARCHIVE_VERSION               (1)
+#define ARCHIVE_DATA_ALIGN            (4096)
+#define ARCHIVE_PACKED_ALIGN          (8)     /* compressed payloads are packed, not page aligned */
+
+typedef enum {
+  ARCHIVE_CODEC_RAW = 0,                      /* uncompressed Mat pixel data */
+  ARCHIVE_CODEC_ZLIB,                         /* zlib compressed pixel data (delta keyframe) */
+  ARCHIVE_CODEC_DELTA,                        /* residual against a keyframe, see deltaCodec.h */
+  ARCHIVE_CODEC_END
+} ArchiveCodec_e;
+
+typedef struct {
+  uint32_t magic;                             /* ARCHIVE_MAGIC */
+  uint32_t version;                           /* ARCHIVE_VERSION */
+  uint32_t maxFrames;                         /* number of index slots */
+  uint32_t frameCount;                        /* number of valid index entries */
+  uint64_t capacity;                          /* preallocated file size in bytes */
+  uint64_t dataOffset;                        /* offset of first frame */
+  uint64_t writeOffset;                       /* offset of next frame */
+  uint8_t  reserved[24];
+} archiveHeader_t;
+
+typedef struct {
+  uint32_t frameNum;                          /* diffFrameNum of frame */
+  float    frameTime;                         /* diffFrameTime of frame (msec) */
+  uint64_t offset;                            /* byte offset of frame in file */
+  uint32_t size;                              /* stored size in bytes */
+  int32_t  type;                              /* OpenCV Mat type */
+  uint16_t rows;
+  uint16_t cols;
+  uint8_t  codec;                             /* ArchiveCodec_e */
+  uint8_t  isColor;
+  uint8_t  reserved[6];
+} archiveIndexEntry_t;
+
+typedef struct {
+  int fd;                                     /* archive file descriptor */
+  uint8_t *pBase;                             /* base of mapping */
+  size_t mapLen;                              /* length of mapping */
+  archiveHeader_t *pHdr;                      /* header (start of mapping) */
+  archiveIndexEntry_t *pIndex;                /* index (follows header) */
+  uint8_t writable;                           /* opened for append */
+} frameArchive_t;
+
+/*---------------------------------------------------------------------------------*/
+
+/**
+ * @brief create and preallocate a new archive, replacing any existing file (its blocks are reused)
+ *
+ * @param pArchive - archive handle to initialize
+ * @param filename - path of archive file
+ * @param maxFrames - number of index slots to reserve
+ * @param capacity - total file size to preallocate (bytes)
+ * @return 0 on success, -1 on error
+ */
+int archive_create(frameArchive_t *pArchive, const char *filename, uint32_t maxFrames, uint64_t capacity);
+
+/**
+ * @brief file size needed to hold maxFrames frames of at most maxFrameLen bytes
+ *
+ * @param maxFrames - number of index slots
+ * @param maxFrameLen - largest frame to be appended (bytes)
+ * @return capacity to pass to archive_create
+ */
+uint64_t archive_capacity_for(uint32_t maxFrames, size_t maxFrameLen);
+
+/**
+ * @brief open an existing archive read-only
+ *
+ * @param pArchive - archive handle to initialize
+ * @param filename - path of archive file
+ * @return 0 on success, -1 on error
+ */
+int archive_open(frameArchive_t *pArchive, const char *filename);
+
+/**
+ * @brief append a frame to the archive
+ *
+ * @param pArchive - archive opened with archive_create
+ * @param pEntry - frame description; offset and size are filled in by the archive
+ * @param pData - frame data
+ * @param len - length of frame data (bytes)
+ * @return 0 on success, -1 if the archive is full or invalid
+ */
+int archive_append(frameArchive_t *pArchive, const archiveIndexEntry_t *pEntry, const uint8_t *pData, uint32_t len);
+
+/**
+ * @brief look up a frame by its position in the archive
+ *
+ * @param pArchive - open archive
+ * @param idx - index slot (0 .. frameCount-1)
+ * @param ppData - returns pointer to frame data within the mapping
+ * @return pointer to index entry, NULL if out of range
+ */
+const archiveIndexEntry_t *archive_get_index(const frameArchive_t *pArchive, uint32_t idx, const uint8_t **ppData);
+
+/**
+ * @brief look up a frame by diffFrameNum (O(1), O(log n) if frames were dropped)
+ *
+ * @param pArchive - open archive
+ * @param frameNum - frame number to find
+ * @param ppData - returns pointer to frame data within the mapping
+ * @return pointer to index entry, NULL if not found
+ */
+const archiveIndexEntry_t *archive_find_frame(const frameArchive_t *pArchive, uint32_t frameNum, const uint8_t **ppData);
+
+/**
+ * @brief number of frames stored in the archive
+ */
+uint32_t archive_frame_count(const frameArchive_t *pArchive);
+
+/**
+ * @brief flush and close the archive; writable archives are trimmed to the
+ * amount of data actually written
+ *
+ * @param pArchive - archive to close
+ * @return 0 on success, -1 on error
+ */
+int archive_close(frameArchive_t *pArchive);
+
+#endif
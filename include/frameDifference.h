@@ -18,7 +18,7 @@
 
 /*---------------------------------------------------------------------------------*/
 /* INCLUDES */
-
+#include <opencv2/core.hpp>     // Basic OpenCV structures (cv::Mat, Scalar)
 
 /*---------------------------------------------------------------------------------*/
 
@@ -31,4 +31,18 @@
  */
 void *differenceTask(void *arg);
 
+/**
+ * @brief difference of a new frame against the previous one (gray conversion,
+ *        subtraction and threshold); the outputs are reused between calls
+ *
+ * @param prevGray - previous frame, gray
+ * @param frame - new frame, RGB
+ * @param nextGray - new frame converted to gray
+ * @param diffFrame - nextGray - prevGray
+ * @param bw - thresholded difference
+ * @return number of changed pixels
+ */
+unsigned int frame_difference(const cv::Mat &prevGray, const cv::Mat &frame, cv::Mat &nextGray, cv::Mat &diffFrame,
+                              cv::Mat &bw);
+
 #endif
\ No newline at end of file
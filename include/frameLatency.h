@@ -0,0 +1,127 @@
+/***********************************************************************************
+ * @author Joshua Malburg
+ * joshua.malburg@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file frameLatency.h
+ * @brief per-frame stage latency histograms
+ *
+ * Every selected frame carries a CLOCK_MONOTONIC stamp for each point it passes
+ * (FrameStamp_e): capture, into / out of the circular buffer, into / out of the
+ * select queue, into / out of the write queue and saved. When the frame is saved
+ * the time between consecutive stamps is recorded per stage, plus capture to
+ * saved end to end.
+ *
+ * The histograms are HDR style (log-linear): each power of 2 is split into
+ * LATENCY_SUB_BUCKETS linear buckets, so any value from 1 ns to ~18 minutes is
+ * kept to within ~3% in a fixed LATENCY_BUCKETS counters, with no allocation or
+ * locking when recording. Counters are relaxed atomics so percentiles can be read
+ * live from another thread while the write service records.
+ *
+ ************************************************************************************
+ */
+#ifndef FRAME_LATENCY_H
+#define FRAME_LATENCY_H
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdint.h>
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define LATENCY_SUB_BITS              (5)
+#define LATENCY_SUB_BUCKETS           (1 << LATENCY_SUB_BITS)
+#define LATENCY_MAX_MSB               (39)    /* values >= 2^40 ns land in the last bucket */
+#define LATENCY_BUCKETS               ((LATENCY_MAX_MSB - LATENCY_SUB_BITS + 2) << LATENCY_SUB_BITS)
+
+typedef enum {
+  FRAME_STAMP_CAPTURE = 0,                    /* frame read from the camera */
+  FRAME_STAMP_RING_IN,                        /* put in the circular buffer */
+  FRAME_STAMP_RING_OUT,                       /* taken by the difference service */
+  FRAME_STAMP_SELECT_IN,                      /* sent to the select queue */
+  FRAME_STAMP_SELECT_OUT,                     /* received by the processing service */
+  FRAME_STAMP_WRITE_IN,                       /* sent to the write queue */
+  FRAME_STAMP_WRITE_OUT,                      /* received by the write service */
+  FRAME_STAMP_SAVED,                          /* written out */
+  FRAME_STAMP_END
+} FrameStamp_e;
+
+/* stage n is stamp n to stamp n + 1; the last one is capture to saved */
+typedef enum {
+  LATENCY_STAGE_ACQ = 0,
+  LATENCY_STAGE_RING,
+  LATENCY_STAGE_DIFF,
+  LATENCY_STAGE_SELECT_QUEUE,
+  LATENCY_STAGE_PROC,
+  LATENCY_STAGE_WRITE_QUEUE,
+  LATENCY_STAGE_WRITE,
+  LATENCY_STAGE_END_TO_END,
+  LATENCY_STAGE_END
+} LatencyStage_e;
+
+typedef struct {
+  uint64_t count;
+  uint64_t maxNs;
+  uint64_t buckets[LATENCY_BUCKETS];
+} latencyHist_t;
+
+typedef struct {
+  latencyHist_t stages[LATENCY_STAGE_END];
+} frameLatency_t;
+
+/*---------------------------------------------------------------------------------*/
+
+/**
+ * @brief clear all histograms
+ *
+ * @param pLat - histograms
+ */
+void latency_init(frameLatency_t *pLat);
+
+/**
+ * @brief add a value to a histogram
+ *
+ * @param pHist - histogram
+ * @param valueNs - latency
+ */
+void latency_hist_record(latencyHist_t *pHist, uint64_t valueNs);
+
+/**
+ * @brief value at a percentile (upper edge of its bucket, capped at the max)
+ *
+ * @param pHist - histogram
+ * @param percentile - 0 to 100
+ * @return nanoseconds, 0 if the histogram is empty
+ */
+uint64_t latency_hist_percentile(const latencyHist_t *pHist, double percentile);
+
+/**
+ * @brief record every stage of a saved frame; stages missing a stamp (0) are skipped
+ *
+ * @param pLat - histograms (NULL is ignored)
+ * @param pStampNs - FRAME_STAMP_END stamps
+ */
+void latency_record_frame(frameLatency_t *pLat, const uint64_t *pStampNs);
+
+/**
+ * @brief syslog count / p50 / p99 / p99.9 / max of every stage
+ *
+ * @param pLat - histograms
+ * @param when - label, e.g. "live" or "final"
+ */
+void latency_report(const frameLatency_t *pLat, const char *when);
+
+/**
+ * @brief short name of a stage
+ *
+ * @param stage - LatencyStage_e
+ * @return name, "?" if out of range
+ */
+const char *latency_stage_name(unsigned int stage);
+
+#endif
@@ -0,0 +1,121 @@
+/***********************************************************************************
+ * @author Brian Ibeling
+ * ibelingb@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file frameOverlay.h
+ * @brief pre-rendered annotation overlays
+ *
+ * Text and shapes are rasterised once into 8-bit alpha bitmaps and then blended
+ * onto each frame, instead of calling uname()/format()/putText() per frame:
+ *  - static text (uname) is a single cached bitmap
+ *  - the timestamp is composed from a glyph atlas of the characters it can contain
+ *  - Hough circles are blitted from outline stamps: the anti-aliased outline of
+ *    a (radius, thickness) is rasterised once and kept as a list of covered
+ *    pixels, so a hit only touches the outline, like cv::circle, without
+ *    rasterising it again. The clock face is found at nearly the same radius
+ *    every frame, so a few stamps cover it.
+ *  - Hough lines are drawn directly: the hands move between frames, so a line
+ *    is never drawn twice with the same geometry
+ *
+ ************************************************************************************
+ */
+#ifndef FRAME_OVERLAY_H
+#define FRAME_OVERLAY_H
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdint.h>
+#include <vector>
+#include <opencv2/core.hpp>     // Basic OpenCV structures (cv::Mat, Scalar)
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define OVERLAY_FONT_SCALE            (0.5)
+#define OVERLAY_TEXT_X                (0)
+#define OVERLAY_TIMESTAMP_Y           (15)    /* baseline of "Frame time" line */
+#define OVERLAY_STATIC_Y              (30)    /* baseline of "uname" line */
+#define OVERLAY_GLYPHS                "0123456789.-"
+#define OVERLAY_GLYPH_COUNT           (sizeof(OVERLAY_GLYPHS) - 1)
+#define OVERLAY_STAMP_COUNT           (8)     /* circle outlines kept, least recently used replaced */
+
+typedef struct {
+  cv::Mat alpha;                              /* 8-bit coverage, 0 = transparent */
+  int originX;                                /* pen position within bitmap */
+  int originY;                                /* baseline / center within bitmap */
+  int advance;                                /* pen advance after drawing (text only) */
+} overlayBitmap_t;
+
+typedef struct {
+  int16_t dx;                                 /* offset from the circle center */
+  int16_t dy;
+  uint8_t alpha;                              /* coverage, 1..255 */
+} overlayStampPoint_t;
+
+typedef struct {
+  int radius;                                 /* -1 = unused */
+  int thickness;
+  unsigned long lastUse;
+  std::vector<overlayStampPoint_t> points;    /* covered pixels of the outline */
+} overlayStamp_t;
+
+typedef struct {
+  overlayBitmap_t unameText;                  /* "uname: <sysname>" */
+  overlayBitmap_t timePrefix;                 /* "Frame time: " */
+  overlayBitmap_t timeSuffix;                 /* " ms" */
+  overlayBitmap_t glyphs[OVERLAY_GLYPH_COUNT];/* atlas for the dynamic field */
+  overlayStamp_t stamps[OVERLAY_STAMP_COUNT]; /* circle outlines */
+  unsigned long stampClock;                   /* use counter for replacement */
+  unsigned long stampMisses;
+  cv::Mat stampScratch;                       /* outline is rasterised here on a miss */
+} frameOverlay_t;
+
+/*---------------------------------------------------------------------------------*/
+
+/**
+ * @brief render the static text and glyph atlas; call once per thread at startup
+ *
+ * @param pOverlay - overlay engine to initialize
+ * @return 0 on success, -1 on error
+ */
+int overlay_init(frameOverlay_t *pOverlay);
+
+/**
+ * @brief draw "Frame time: <msec> ms" and the uname line onto the frame
+ *
+ * @param pOverlay - initialized overlay engine
+ * @param img - 8-bit gray or color frame
+ * @param timeMsec - timestamp to print
+ */
+void overlay_draw_text(frameOverlay_t *pOverlay, cv::Mat &img, float timeMsec);
+
+/**
+ * @brief draw Hough line segments onto the frame
+ *
+ * @param pOverlay - overlay engine
+ * @param img - 8-bit gray or color frame
+ * @param lines - segments from HoughLinesP
+ * @param color - line color
+ * @param thickness - line thickness
+ */
+void overlay_draw_lines(frameOverlay_t *pOverlay, cv::Mat &img, const std::vector<cv::Vec4i> &lines,
+                        const cv::Scalar &color, int thickness);
+
+/**
+ * @brief draw Hough circles (outline plus center mark) onto the frame from cached stamps
+ *
+ * @param pOverlay - overlay engine (stamps are added on a miss)
+ * @param img - 8-bit gray or color frame
+ * @param circles - circles from HoughCircles
+ * @param color - circle color
+ * @param thickness - outline thickness
+ */
+void overlay_draw_circles(frameOverlay_t *pOverlay, cv::Mat &img, const std::vector<cv::Vec3f> &circles,
+                          const cv::Scalar &color, int thickness);
+
+#endif
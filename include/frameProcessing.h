@@ -18,6 +18,10 @@
 
 /*---------------------------------------------------------------------------------*/
 /* INCLUDES */
+#include <stdint.h>
+#include <opencv2/core.hpp>     // Basic OpenCV structures (cv::Mat, Scalar)
+#include "frameOverlay.h"
+#include "taskExecutor.h"
 
 /*---------------------------------------------------------------------------------*/
 /* MACROS / TYPES / CONST */
@@ -33,4 +37,23 @@
  */
 void *processingTask(void *arg);
 
+/**
+ * @brief edge enhancement (Canny) and line / circle detection (Hough) of a
+ *        selected frame; detections are drawn onto it
+ *
+ * The circle detection runs as an executor task while the caller finds the lines,
+ * then both are drawn by the caller (the overlay is not shared with the workers).
+ *
+ * @param pOverlay - overlay engine
+ * @param img - selected frame, annotated in place
+ * @param procImg - work image (gray), reused between calls
+ * @param grayImg - work image of the circle search, reused between calls
+ * @param isColor - img is RGB (else gray)
+ * @param filterEnable - run Canny
+ * @param houghEnable - run the Hough transforms and draw the results
+ * @param pExecutor - runs the circle detection, NULL to run everything in the caller
+ */
+void frame_process(frameOverlay_t *pOverlay, cv::Mat &img, cv::Mat &procImg, cv::Mat &grayImg, uint8_t isColor,
+                   uint8_t filterEnable, uint8_t houghEnable, taskExecutor_t *pExecutor);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,144 @@
+/***********************************************************************************
+ * @author Joshua Malburg
+ * joshua.malburg@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file metrics.h
+ * @brief live pipeline metrics in a shared memory block
+ *
+ * One pipelineMetrics_t lives in POSIX shared memory (METRICS_SHM_NAME). It holds
+ * the service monitors and frame latency histograms themselves, so job timing is
+ * published with no extra work, plus counters / gauges the stages bump as they go:
+ * circular buffer depth, messages in / out of both queues (the reader derives the
+ * queue depths), send and release timeouts and dropped outputs, and which stages
+ * have exited (the shutdown drain waits on those). Every field has a single writer
+ * and is updated with relaxed atomics (the exit flags with release / acquire);
+ * readers (projectstat, the optional Unix socket) only ever load, so they can poll
+ * at any rate without taking a lock or making a syscall on an RT thread.
+ *
+ * If the shared memory can't be created the block is allocated privately and only
+ * the end of run reports and the socket see it.
+ *
+ ************************************************************************************
+ */
+#ifndef METRICS_H
+#define METRICS_H
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stddef.h>
+#include <stdint.h>
+#include <sched.h>
+
+/* project headers */
+#include "serviceRegistry.h"
+#include "serviceMonitor.h"
+#include "frameLatency.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define METRICS_SHM_NAME              "/project_metrics"
+#define METRICS_MAGIC                 "PMET"
+#define METRICS_VERSION               (3)
+#define METRICS_TEXT_LEN              (32 * 1024)
+
+typedef struct {
+  char magic[4];                              /* METRICS_MAGIC */
+  uint32_t version;
+  uint32_t size;                              /* sizeof(pipelineMetrics_t) */
+  int32_t pid;
+  uint64_t startNs;                           /* CLOCK_MONOTONIC */
+  uint32_t numServices;
+  uint32_t ringCapacity;
+
+  uint64_t ringDepth;                         /* frames in the circular buffer */
+  uint64_t framesAcquired;
+  uint64_t framesDiffed;                      /* frames the difference service compared */
+  uint64_t selectSent;                        /* select queue */
+  uint64_t selectReceived;
+  uint64_t selectSendTimeouts;
+  uint64_t writeSent;                         /* write queue */
+  uint64_t writeReceived;
+  uint64_t writeSendTimeouts;
+  uint64_t framesSaved;
+  uint64_t stillsDropped;                     /* no encoder slot */
+  uint64_t videoDropped;                      /* video encoder queue full */
+  uint64_t archiveDropped;                    /* archive writer queue full */
+  uint64_t releaseTimeouts[SERVICE_MAX];      /* by service index */
+  uint64_t replayDoneNs;                      /* replay fully through the pipeline, 0 = not yet */
+  uint64_t shutdownNs;                        /* shutdown requested (real CLOCK_MONOTONIC), 0 = running */
+  uint64_t serviceExited[SERVICE_MAX];        /* by service index, 1 once its loop is done (release store) */
+
+  serviceMonitor_t monitors[SERVICE_MAX];     /* by service index */
+  frameLatency_t latency;
+} pipelineMetrics_t;
+
+/* block of this process, NULL until metrics_create */
+extern pipelineMetrics_t *pMetrics;
+
+#define METRICS_ADD(field, n)         do { if(pMetrics != NULL) { \
+                                        __atomic_fetch_add(&pMetrics->field, (n), __ATOMIC_RELAXED); } } while(0)
+#define METRICS_SET(field, val)       do { if(pMetrics != NULL) { \
+                                        __atomic_store_n(&pMetrics->field, (val), __ATOMIC_RELAXED); } } while(0)
+#define METRICS_LOAD(field)           ((pMetrics != NULL) ? __atomic_load_n(&pMetrics->field, __ATOMIC_RELAXED) : 0)
+
+/* for the one flag another thread acts on (serviceExited): orders the stage's last sends before it */
+#define METRICS_RELEASE(field, val)   do { if(pMetrics != NULL) { \
+                                        __atomic_store_n(&pMetrics->field, (val), __ATOMIC_RELEASE); } } while(0)
+#define METRICS_ACQUIRE(field)        ((pMetrics != NULL) ? __atomic_load_n(&pMetrics->field, __ATOMIC_ACQUIRE) : 0)
+
+/*---------------------------------------------------------------------------------*/
+
+/**
+ * @brief create the (zeroed) metrics block, lock it in memory and publish it in
+ *        shared memory
+ *
+ * @return block (also in pMetrics), NULL if it couldn't even be allocated
+ */
+pipelineMetrics_t *metrics_create(void);
+
+/**
+ * @brief stop the socket server and remove the block
+ */
+void metrics_destroy(void);
+
+/**
+ * @brief map a running pipeline's block read only (projectstat)
+ *
+ * @return block, NULL if no pipeline is publishing one
+ */
+const pipelineMetrics_t *metrics_attach(void);
+
+/**
+ * @brief unmap a block from metrics_attach
+ *
+ * @param pBlock - block
+ */
+void metrics_detach(const pipelineMetrics_t *pBlock);
+
+/**
+ * @brief text exposition of a block, one "name{labels} value" per line
+ *
+ * @param pBlock - block
+ * @param pBuf - output
+ * @param len - size of pBuf
+ * @return characters written (truncated to len - 1)
+ */
+size_t metrics_format(const pipelineMetrics_t *pBlock, char *pBuf, size_t len);
+
+/**
+ * @brief serve metrics_format on a Unix socket (SOCK_STREAM, one snapshot per
+ *        connection) from a SCHED_OTHER thread
+ *
+ * @param path - socket path (replaced if it exists)
+ * @param pCpuSet - cores the thread may run on (NULL for no restriction)
+ * @return 0 on success, -1 on error
+ */
+int metrics_serve(const char *path, const cpu_set_t *pCpuSet);
+
+#endif
@@ -0,0 +1,104 @@
+/***********************************************************************************
+ * @author Brian Ibeling
+ * ibelingb@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file perfCounters.h
+ * @brief optional per-service hardware counters (perf_event_open)
+ *
+ * When enabled (perf_enable), each service thread opens one perf event group on
+ * itself: cycles, instructions, cache references / misses, branch misses and
+ * context switches. The group is read (a single read()) at the start and end of
+ * every job, so the counts cover the job body only. Per job deltas are summed
+ * into the service's perfStats_t along with the worst job for each counter; its
+ * job number matches TRACE_JOB_START / TRACE_JOB_END in the binary trace, which
+ * ties it back to the frame the service was working on.
+ *
+ * Counters the kernel or PMU refuses are left out (e.g. no hardware counters in
+ * a VM); jobs the group wasn't scheduled on the PMU for the whole time are
+ * counted but not added, so the averages are never multiplexing estimates.
+ *
+ ************************************************************************************
+ */
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdint.h>
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+typedef enum {
+  PERF_CYCLES = 0,
+  PERF_INSTRUCTIONS,
+  PERF_CACHE_REFS,
+  PERF_CACHE_MISSES,
+  PERF_BRANCH_MISSES,
+  PERF_CONTEXT_SWITCHES,
+  PERF_COUNTER_END
+} PerfCounter_e;
+
+typedef struct {
+  uint32_t available;                         /* bit per PerfCounter_e counted */
+  uint64_t jobs;                              /* jobs measured */
+  uint64_t unscheduled;                       /* jobs not fully on the PMU, not added */
+  uint64_t sum[PERF_COUNTER_END];
+  uint64_t max[PERF_COUNTER_END];             /* worst job */
+  uint64_t maxJob[PERF_COUNTER_END];          /* job # of the worst job */
+} perfStats_t;
+
+/*---------------------------------------------------------------------------------*/
+
+/**
+ * @brief turn the counters on for threads that call perf_open afterwards
+ */
+void perf_enable(void);
+
+/**
+ * @brief open the counter group of the calling thread (no-op unless enabled)
+ *
+ * @param pStats - where the thread's jobs are accumulated
+ * @return 0 on success or if disabled, -1 if no counter could be opened
+ */
+int perf_open(perfStats_t *pStats);
+
+/**
+ * @brief close the counter group of the calling thread
+ */
+void perf_close(void);
+
+/**
+ * @brief read the counters at the start of a job (no-op without perf_open)
+ */
+void perf_job_start(void);
+
+/**
+ * @brief read the counters at the end of a job and accumulate the deltas
+ *
+ * @param job - job number (monitor job count)
+ */
+void perf_job_end(uint64_t job);
+
+/**
+ * @brief syslog the per job averages / worst jobs
+ *
+ * @param pStats - statistics
+ * @param name - service name
+ */
+void perf_report(const perfStats_t *pStats, const char *name);
+
+/**
+ * @brief name of a counter (metrics / reports)
+ *
+ * @param counter - PerfCounter_e
+ * @return name, "?" if out of range
+ */
+const char *perf_counter_name(unsigned int counter);
+
+#endif
@@ -22,17 +22,33 @@
 #include <opencv2/core.hpp>     // Basic OpenCV structures (cv::Mat, Scalar)
 #include "circular_buffer.h"
 #include "circular_cv_buffer.h"
+#include "encoderPool.h"
+#include "deltaCodec.h"
+#include "sequencer.h"
+#include "serviceRegistry.h"
+#include "cpuTopology.h"
+#include "serviceRuntime.h"
+#include "clockSource.h"
+#include "rtMemory.h"
+#include "taskExecutor.h"
+#include "traceRing.h"
+#include "frameLatency.h"
+#include "metrics.h"
 
 /*---------------------------------------------------------------------------------*/
 /* MACROS / TYPES / CONST */
 
 /* Define types of logging data captured - print raw timestamp and/or delta time from app start */
 /* Uncomment which logging type is desired */
-#define TIMESTAMP_SYSLOG_OUTPUT /* Used for jitter/drift data measurements */
+#define TRACE_OUTPUT /* Used for jitter/drift data measurements, binary trace (traceRing.h) */
+//#define TIMESTAMP_SYSLOG_OUTPUT /* Same timestamps as syslog text (if TRACE_OUTPUT is off) */
 //#define DT_SYSLOG_OUTPUT /* Used for application debugging */
 
+#define TRACE_FILE_NAME               "./project.trace"
+
 //#define DISPLAY_FRAMES
 #define OUTPUT_VIDEO
+#define OUTPUT_ARCHIVE /* segmented frame archive instead of a PPM per frame */
 
 #define MAX_IMG_ROWS                  (480)
 #define MAX_IMG_COLS                  (640)
@@ -44,14 +60,14 @@
 
 #define TIMESPEC_TO_MSEC(time)	      ((float)((((float)time.tv_sec) * 1.0e3) + (((float)time.tv_nsec) * 1.0e-6)))
 #define CALC_DT_MSEC(newest, oldest)  (TIMESPEC_TO_MSEC(newest) - TIMESPEC_TO_MSEC(oldest))
+#define TIMESPEC_ADD_MSEC(time, msec) do { uint64_t nsec_ = (time).tv_nsec + ((uint64_t)(msec) * 1000000ULL); \
+                                        (time).tv_sec += nsec_ / 1000000000ULL; \
+                                        (time).tv_nsec = nsec_ % 1000000000ULL; } while(0)
 
 #define TRUE                          (1)
 #define FALSE                         (0)
 
 #define SIGNAL_KILL_SEQ               (SIGRTMIN + 1)
-#define SIGNAL_KILL_ACQ               (SIGRTMIN + 2)
-#define SIGNAL_KILL_DIFF              (SIGRTMIN + 3)
-#define SIGNAL_KILL_PROC              (SIGRTMIN + 4)
 
 /* for queues */
 typedef struct {
@@ -63,19 +79,51 @@ typedef struct {
   unsigned int diffFrameNum;
   float diffFrameTime;
   uint8_t isColor;
+  uint8_t changeTiles[DELTA_BITMAP_BYTES(MAX_IMG_ROWS, MAX_IMG_COLS)]; /* tiles diff saw change in */
+  uint64_t stampNs[FRAME_STAMP_END];          /* CLOCK_MONOTONIC, see frameLatency.h */
 } imgDef_t;
 
 #define SELECT_QUEUE_MSG_SIZE         (sizeof(imgDef_t))
 #define SELECT_QUEUE_LENGTH           (30)
-#define WRITE_QUEUE_MSG_SIZE          (sizeof(cv::Mat))
+#define WRITE_QUEUE_MSG_SIZE          (sizeof(imgDef_t))
 #define WRITE_QUEUE_LENGTH            (50)
 #define CIRCULAR_BUFF_LEN             (50)
 
-/* for synchronization */
-#define ACQ_THREAD_SEMA_TIMEOUT       (50e6)
-#define DIFF_THREAD_SEMA_TIMEOUT      (500e6)
-#define PROC_THREAD_SEMA_TIMEOUT      (1000e6)
-#define WRITE_THREAD_SEMA_TIMEOUT     (1000e6)
+/* locked frame storage: every ring entry and queued message, plus frames between them */
+#define FRAME_ARENA_SPARE             (4)
+#define FRAME_ARENA_SLOTS             (CIRCULAR_BUFF_LEN + SELECT_QUEUE_LENGTH + WRITE_QUEUE_LENGTH + FRAME_ARENA_SPARE)
+
+/* frames per archive segment; full segments are handed to the retention manager */
+#define ARCHIVE_SEGMENT_FRAMES        (300)
+
+/* for still image encoding (used when a codec is selected with -c) */
+#define ENCODER_POOL_WORKERS          (2)
+#define ENCODER_POOL_SLOTS            (8)
+#define ENCODER_DEFAULT_QUALITY       (90)
+
+/* saved frames between live latency reports */
+#define LATENCY_LIVE_REPORT_FRAMES    (100)
+
+/* for synchronization; longest a service waits for a release before logging it */
+#define ACQ_THREAD_WAKE_TIMEOUT_MS    (50)
+#define DIFF_THREAD_WAKE_TIMEOUT_MS   (500)
+#define PROC_THREAD_WAKE_TIMEOUT_MS   (1000)
+#define WRITE_THREAD_WAKE_TIMEOUT_MS  (1000)
+
+/* free running mode (-R): stages pace each other instead of dropping frames */
+#define FREE_RUN_RING_HIGH            (CIRCULAR_BUFF_LEN / 2) /* acquisition waits for diff above this depth */
+#define FREE_RUN_SEND_TIMEOUT_MS      (1000)  /* queue sends block up to this long for room */
+
+/* end of a replay: the pipeline is drained once it has been idle for a few polls */
+#define REPLAY_DRAIN_POLL_MS          (50)
+#define REPLAY_DRAIN_IDLE_POLLS       (4)
+
+/* shutdown: each stage is released until its input is empty, it stops moving or its time is up,
+   then waited on to exit; the whole drain ends by SHUTDOWN_TOTAL_MS whatever is left */
+#define SHUTDOWN_TOTAL_MS             (500)
+#define SHUTDOWN_STAGE_MS             (150)
+#define SHUTDOWN_POLL_MS              (5)
+#define SHUTDOWN_IDLE_POLLS           (4)
 
 /* Clock Types */
 #define SEMA_CLOCK_TYPE (CLOCK_REALTIME)
@@ -101,7 +149,9 @@ typedef enum {
 
 typedef struct {
   int cameraIdx;                              /* index of camera */
-  sem_t *pSema;                               /* semaphore */
+  const char *replayPath;                     /* video / image sequence read instead of the camera, NULL for camera */
+  int releaseFd;                              /* release eventfd (see serviceRuntime.h) */
+  int shutdownFd;                             /* shutdown eventfd */
   char selectQueueName[64];                   /* message queue */
   char writeQueueName[64];                    /* message queue */
   pthread_mutex_t *pMutex;	                  /* CB mutex */
@@ -112,17 +162,25 @@ typedef struct {
   SaveType_e save_type;                       /* type of frame to pass through the pipeline */
   struct timespec programStartTime;           /* start time to make times more reasonable */
   pthread_t *pTidSeqThread;                   /* TID of sequencer thread to allow signal tx */
+  encoderPool_t *pEncoderPool;                /* still image encoders, NULL to use archive/PPM */
+  uint8_t delta_enable;                       /* delta compress archived frames */
+  retentionMgr_t *pRetention;                 /* output disk budget and archive segment I/O */
+  serviceMonitor_t *pMonitor;                 /* job timing / deadline monitor */
+  const serviceDef_t *pNext;                  /* downstream stage woken when data is ready, NULL if periodic */
+  uint8_t event_driven;                       /* released by the upstream stage, timeouts just mean no data */
+  const serviceDef_t *pPrev;                  /* upstream stage woken when there's room again (free run) */
+  uint8_t free_run;                           /* no sequencer: run as fast as the input allows, block instead of drop */
+  frameLatency_t *pLatency;                   /* stage latency of saved frames (write service) */
+  frameArena_t *pFrameArena;                  /* pixel buffers of the queued frames */
+  taskExecutor_t *pExecutor;                  /* non-RT sub-tasks of processing, NULL for none */
+  double videoFps;                            /* video timebase: the fastest frames can be selected at */
 } threadParams_t;
 
 typedef struct {
-  sem_t *pAcqSema;                            /* Acquire Frame semaphore */
-  sem_t *pDiffSema;                           /* Frame Difference semaphore */
-  sem_t *pProcSema;                           /* Frame Processing semaphore */
-  sem_t *pWriteSema;                          /* Frame Write semaphore */
-  pthread_t tidAcqThread;                     /* Thread ID for Frame Acquire Service */
-  pthread_t tidDiffThread;                    /* Thread ID for Frame Diff Service */
-  pthread_t tidProcThread;                    /* Thread ID for Frame Proc Service */
-  pthread_t tidWriteThread;                   /* Thread ID for Frame Write Service */
+  serviceRegistry_t *pRegistry;               /* services released / stopped by the sequencer */
+  unsigned int baseRateHz;                    /* sequencer base rate */
+  SeqTimerMode_e timerMode;                   /* how the base rate is kept */
+  uint8_t freeRun;                            /* release nothing, only start acquisition and wait for shutdown */
 } seqThreadParams_t;
 
 #endif
@@ -0,0 +1,189 @@
+/***********************************************************************************
+ * @author Joshua Malburg
+ * joshua.malburg@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file retention.h
+ * @brief disk space bounded retention of output files
+ *
+ * Every finished output (archive segment, still image, video segment) is handed
+ * to the manager, which keeps them in a ring, oldest first. A SCHED_OTHER thread
+ * deletes the oldest files, one at a time, whenever the outputs exceed the byte
+ * or file budget or the filesystem has less than the minimum free space left.
+ * Outputs of earlier runs already in the directory at start are adopted (by mtime)
+ * so restarts stay within budget too; only files carrying the application's own
+ * output names are adopted, never other files that happen to be there.
+ *
+ * The thread also takes the archive segment I/O off the write service: it creates,
+ * preallocates and maps the next segment while the current one fills, and it
+ * syncs, trims and closes each full segment handed back to it before tracking it.
+ * A segment roll in the write service is then just a swap of handles. Tracking
+ * and segment requests only take the manager mutex briefly.
+ *
+ * With no byte budget (maxBytes 0) nothing is adopted or deleted; the thread only
+ * does the segment I/O.
+ *
+ ************************************************************************************
+ */
+#ifndef RETENTION_H
+#define RETENTION_H
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+
+/* project headers */
+#include "frameArchive.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define RETENTION_BUDGET_MB           (2048)  /* default output byte budget */
+#define RETENTION_MAX_FILES           (4096)  /* default output file budget */
+#define RETENTION_MIN_FREE_MB         (256)   /* keep this much of the filesystem free */
+#define RETENTION_TRACK_SLACK         (64)    /* files that may be tracked ahead of the thread */
+#define RETENTION_POLL_MSEC           (1000)  /* free space check interval */
+#define RETENTION_PATH_LEN            (96)
+#define RETENTION_RETIRE_LEN          (2)     /* full segments waiting to be closed */
+
+typedef enum {
+  SEGMENT_NONE = 0,                           /* no next segment requested */
+  SEGMENT_PENDING,                            /* requested, not started */
+  SEGMENT_BUILDING,                           /* being created by the thread */
+  SEGMENT_CANCELLED,                          /* cancelled while being created */
+  SEGMENT_READY                               /* mapped, waiting to be taken */
+} SegmentState_e;
+
+typedef struct {
+  char path[RETENTION_PATH_LEN];              /* empty once claimed for reuse */
+  uint64_t size;                              /* bytes, valid once stat'd */
+  struct timespec mtime;                      /* mtime when stat'd */
+} retentionFile_t;
+
+typedef struct {
+  frameArchive_t archive;
+  char path[RETENTION_PATH_LEN];
+} retentionSegment_t;
+
+typedef struct {
+  pthread_t thread;
+  char dir[64];                               /* output directory */
+  uint64_t maxBytes;
+  unsigned int maxFiles;
+  uint64_t minFreeBytes;
+  retentionFile_t *pFiles;                    /* ring of outputs, oldest first */
+  unsigned int ringLen;
+  unsigned int head;
+  unsigned int count;                         /* entries in ring (incl. claimed) */
+  unsigned int sizedCnt;                      /* entries from head already stat'd */
+  unsigned int liveCnt;                       /* entries not claimed */
+  uint64_t totalBytes;                        /* size of stat'd live entries */
+  retentionSegment_t next;                    /* next archive segment */
+  uint32_t nextFrames;
+  uint64_t nextLen;
+  uint8_t nextState;                          /* SegmentState_e */
+  retentionSegment_t retire[RETENTION_RETIRE_LEN];  /* full segments to close, oldest first */
+  unsigned int retireCnt;
+  pthread_mutex_t mutex;
+  pthread_cond_t workCond;                    /* signalled on track / segment request / stop */
+  uint8_t running;
+  uint8_t started;
+  unsigned long deletedCnt;                   /* statistics */
+  unsigned long long deletedBytes;
+  unsigned long untrackedCnt;                 /* ring full at track */
+  unsigned long preparedCnt;
+  unsigned long prepareFailCnt;
+  unsigned long retiredCnt;
+  unsigned long retireSyncCnt;                /* closed by the caller, queue full */
+} retentionMgr_t;
+
+/*---------------------------------------------------------------------------------*/
+
+/**
+ * @brief adopt existing outputs in dir and start the retention thread
+ *
+ * @param pMgr - manager to initialize
+ * @param dir - output directory
+ * @param maxBytes - byte budget for all outputs, 0 to keep everything
+ * @param maxFiles - file budget for all outputs
+ * @param minFreeBytes - free space to keep on the filesystem
+ * @param pCpuSet - cores the thread may run on (NULL for no restriction)
+ * @return 0 on success, -1 on error
+ */
+int retention_start(retentionMgr_t *pMgr, const char *dir, uint64_t maxBytes, unsigned int maxFiles,
+                    uint64_t minFreeBytes, const cpu_set_t *pCpuSet);
+
+/**
+ * @brief hand a finished output file to the manager
+ *
+ * @param pMgr - running manager (NULL is ignored)
+ * @param path - path of the file
+ * @return 0 on success, -1 if not tracked
+ */
+int retention_track(retentionMgr_t *pMgr, const char *path);
+
+/**
+ * @brief stop managing a path that is about to be rewritten in place
+ *
+ * @param pMgr - running manager (NULL is ignored)
+ * @param path - path of the file
+ */
+void retention_claim(retentionMgr_t *pMgr, const char *path);
+
+/**
+ * @brief have the thread create and map the next archive segment ahead of time
+ *
+ * @param pMgr - running manager
+ * @param path - path of the segment (replaces any pending request)
+ * @param maxFrames - index slots of the segment
+ * @param capacity - bytes to preallocate
+ * @return 0 on success, -1 on error
+ */
+int retention_prepare_segment(retentionMgr_t *pMgr, const char *path, uint32_t maxFrames, uint64_t capacity);
+
+/**
+ * @brief take the segment prepared by retention_prepare_segment, without blocking
+ *
+ * @param pMgr - running manager (NULL is "not requested")
+ * @param path - path passed to retention_prepare_segment
+ * @param pArchive - receives the open, writable segment
+ * @return 0 if taken, 1 if still being created (try again later), -1 if not requested
+ *         or creating it failed (the caller has to create it itself)
+ */
+int retention_take_segment(retentionMgr_t *pMgr, const char *path, frameArchive_t *pArchive);
+
+/**
+ * @brief drop a requested or prepared segment that will not be used
+ *
+ * @param pMgr - running manager (NULL is ignored)
+ * @param path - path passed to retention_prepare_segment
+ */
+void retention_cancel_segment(retentionMgr_t *pMgr, const char *path);
+
+/**
+ * @brief hand a full segment to the thread to sync, trim, close and track
+ *
+ * Closed by the caller instead if there is no manager or too many are waiting.
+ *
+ * @param pMgr - running manager, may be NULL
+ * @param pArchive - open segment; closed (or owned by the manager) on return
+ * @param path - path of the segment
+ */
+void retention_retire_segment(retentionMgr_t *pMgr, frameArchive_t *pArchive, const char *path);
+
+/**
+ * @brief close the retired segments, enforce the budget one last time and stop the thread
+ *
+ * @param pMgr - manager
+ */
+void retention_stop(retentionMgr_t *pMgr);
+
+#endif
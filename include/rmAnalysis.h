@@ -0,0 +1,98 @@
+/***********************************************************************************
+ * @author Brian Ibeling
+ * ibelingb@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file rmAnalysis.h
+ * @brief rate monotonic feasibility of the service schedule before threads start
+ *
+ * Services are grouped by the core they are assigned to. On each core the worst
+ * case response time of every service is found by response time analysis
+ *   R = C + sum over higher priority services j of ceil(R / Tj) * Cj
+ * using the configured FIFO/RR priorities (equal priorities count as
+ * interference), and the core's utilization is checked against the RM least
+ * upper bound n(2^(1/n) - 1). Slack is the deadline minus the response time.
+ *
+ * WCETs come from a profile of measured execution times (the per-service maximum
+ * from serviceMonitor, saved at shutdown and merged across runs) or, for services
+ * not in the profile, from the declared runtime budget.
+ *
+ * The task executor's workers run aperiodic work with no period or WCET, so they
+ * are only admitted below every service on the CPUs they share: they then add no
+ * interference and get what the services leave idle. A circle search proc waits
+ * for is part of proc's measured execution time.
+ *
+ ************************************************************************************
+ */
+#ifndef RM_ANALYSIS_H
+#define RM_ANALYSIS_H
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdint.h>
+#include <sched.h>
+#include "serviceRegistry.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+typedef struct {
+  uint64_t wcetNs;                            /* C, 0 if unknown (not analyzed) */
+  uint64_t periodNs;                          /* T */
+  uint64_t deadlineNs;                        /* D */
+  uint64_t responseNs;                        /* worst case R, > D if infeasible */
+  int64_t slackNs;                            /* D - R */
+  double utilization;                         /* C / T */
+  uint8_t feasible;
+} rmResult_t;
+
+/*---------------------------------------------------------------------------------*/
+
+/**
+ * @brief load measured WCETs ("name wcet_usec" per line)
+ *
+ * @param pReg - built registry
+ * @param filename - profile
+ * @param pWcetNs - WCET per service index, entries not in the file are left unchanged
+ * @return number of services loaded, -1 on error
+ */
+int rm_load_wcet(const serviceRegistry_t *pReg, const char *filename, uint64_t *pWcetNs);
+
+/**
+ * @brief save the larger of the loaded and this run's measured WCET of each service
+ *
+ * @param pReg - registry with monitors attached
+ * @param filename - profile
+ * @param pWcetNs - WCETs loaded at start (per service index)
+ * @return 0 on success, -1 on error
+ */
+int rm_save_wcet(const serviceRegistry_t *pReg, const char *filename, const uint64_t *pWcetNs);
+
+/**
+ * @brief response time analysis and RM least upper bound test per core
+ *
+ * @param pReg - built registry
+ * @param pWcetNs - WCET per service index (0 = use the runtime budget)
+ * @param pResults - result per service index
+ * @return number of infeasible services, -1 on error
+ */
+int rm_analyze(const serviceRegistry_t *pReg, const uint64_t *pWcetNs, rmResult_t *pResults);
+
+/**
+ * @brief check the task executor's workers against the services on their CPUs
+ *
+ * @param pReg - built registry
+ * @param pResults - results of rm_analyze (utilization per service index)
+ * @param pCpus - CPUs the workers run on
+ * @param priority - SCHED_FIFO priority of the workers
+ * @param housekeeping - CPU of the SCHED_OTHER helpers
+ * @return number of services the workers can delay, -1 on error
+ */
+int rm_analyze_executor(const serviceRegistry_t *pReg, const rmResult_t *pResults, const cpu_set_t *pCpus, int priority,
+                        int housekeeping);
+
+#endif
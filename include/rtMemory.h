@@ -0,0 +1,116 @@
+/***********************************************************************************
+ * @author Joshua Malburg
+ * joshua.malburg@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file rtMemory.h
+ * @brief memory that can't page fault during the RT run
+ *
+ * Before the services start, rt_memory_lock locks every page the process has
+ * (mlockall(MCL_CURRENT)) and stops malloc from handing memory back to the kernel or
+ * serving large blocks with their own mmap, so heap pages OpenCV touched once stay
+ * resident and are reused. Later mappings are not locked wholesale (MCL_FUTURE would
+ * populate and pin each ~276 MB archive segment as it is mapped); what the services
+ * need is locked explicitly instead: each service prefaults and locks the top of
+ * its stack when it starts, and the frame arena and the metrics block (metrics.h)
+ * lock themselves.
+ *
+ * Frame pixel buffers come from a frame arena: one mapping, hugepage backed if asked
+ * for and available (else transparent hugepages are requested for it), locked and
+ * written once at startup, cut into MAX_IMG_ROWS x MAX_IMG_COLS x 3 slots. There is a
+ * slot for every ring entry and every message either queue can hold, plus a few for
+ * frames in flight between them. Allocations the arena can't serve fall back to
+ * malloc and are counted.
+ *
+ ************************************************************************************
+ */
+#ifndef RT_MEMORY_H
+#define RT_MEMORY_H
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define RT_STACK_SIZE                 (2 * 1024 * 1024)   /* stack of each service thread */
+#define RT_STACK_PREFAULT             (256 * 1024)        /* touched by rt_stack_prefault */
+#define RT_HUGEPAGE_SIZE              (2 * 1024 * 1024)
+
+typedef struct {
+  uint8_t *pBase;                             /* NULL if not created */
+  size_t mapLen;
+  size_t slotLen;
+  unsigned int numSlots;
+  uint8_t hugePages;                          /* backed by MAP_HUGETLB pages */
+  pthread_mutex_t lock;
+  unsigned int *pFree;                        /* stack of free slot indices */
+  unsigned int numFree;
+  unsigned int minFree;                       /* low water mark */
+  unsigned long long overflows;               /* allocations served by malloc */
+} frameArena_t;
+
+/*---------------------------------------------------------------------------------*/
+
+/**
+ * @brief lock the current pages of the process and keep the heap from shrinking or mmapping
+ *
+ * @return 0 on success, -1 if the pages couldn't be locked (no privileges / RLIMIT_MEMLOCK)
+ */
+int rt_memory_lock(void);
+
+/**
+ * @brief touch and lock RT_STACK_PREFAULT bytes of the calling thread's stack
+ */
+void rt_stack_prefault(void);
+
+/**
+ * @brief map, lock and prefault the frame arena
+ *
+ * @param pArena - arena to create
+ * @param slotLen - bytes per frame
+ * @param numSlots - number of frames
+ * @param hugePages - try MAP_HUGETLB first
+ * @return 0 on success, -1 on error
+ */
+int frame_arena_create(frameArena_t *pArena, size_t slotLen, unsigned int numSlots, uint8_t hugePages);
+
+/**
+ * @brief a frame buffer; from malloc if the arena is full, too small or NULL
+ *
+ * @param pArena - arena
+ * @param len - bytes needed
+ * @return buffer, NULL if out of memory
+ */
+void *frame_arena_alloc(frameArena_t *pArena, size_t len);
+
+/**
+ * @brief give back a buffer from frame_arena_alloc
+ *
+ * @param pArena - arena it came from
+ * @param p - buffer, may be NULL
+ */
+void frame_arena_free(frameArena_t *pArena, void *p);
+
+/**
+ * @brief log the arena use (low water mark, malloc fallbacks)
+ *
+ * @param pArena - arena
+ */
+void frame_arena_report(frameArena_t *pArena);
+
+/**
+ * @brief unmap the arena; every buffer must have been given back
+ *
+ * @param pArena - arena
+ */
+void frame_arena_destroy(frameArena_t *pArena);
+
+#endif
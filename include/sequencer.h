@@ -1,7 +1,7 @@
 /***********************************************************************************
  * @author Brian Ibeling
  * ibelingb@colorado.edu
- * 
+ *
  * Real-time Embedded Systems
  * ECEN5623 - Sam Siewert
  * @date 25Jul2020
@@ -9,8 +9,12 @@
  ************************************************************************************
  *
  * @file sequencer.h
- * @brief 
- * TODO
+ * @brief Sequencer service that releases all other services at sub-rates of a base rate
+ *
+ * The base rate is kept by the sequencer thread itself on CLOCK_MONOTONIC, either
+ * with absolute clock_nanosleep or a timerfd, so it is immune to wall-clock jumps
+ * and signal delivery. The original SIGALRM / CLOCK_REALTIME timer is kept as a
+ * mode for jitter comparisons.
  *
  ************************************************************************************
  */
@@ -19,18 +23,46 @@
 
 /*---------------------------------------------------------------------------------*/
 /* INCLUDES */
+#include <stdint.h>
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define SEQ_DEFAULT_RATE_HZ           (120)   /* base rate */
+#define SEQ_MAX_RATE_HZ               (10000)
+#define SEQ_DEADLINE_RUNTIME_US       (200)   /* SCHED_DEADLINE budget per base rate tick (-D) */
+
+typedef enum {
+  SEQ_TIMER_NANOSLEEP = 0,                    /* absolute clock_nanosleep (default) */
+  SEQ_TIMER_TIMERFD,                          /* periodic timerfd, expirations = overruns */
+  SEQ_TIMER_SIGALRM,                          /* legacy POSIX timer + SIGALRM handler */
+  SEQ_TIMER_END
+} SeqTimerMode_e;
 
+typedef struct {
+  unsigned long long ticks;                   /* base rate cycles executed */
+  unsigned long long overruns;                /* base rate cycles missed */
+  int64_t minLateNs;                          /* wake-up latency after each release */
+  int64_t maxLateNs;
+  double sumLateNs;
+  double sumSqLateNs;
+} seqJitterStats_t;
 
 /*---------------------------------------------------------------------------------*/
 
 /**
- * @brief
- * TODO
- * 
- * @param
- * @param
- * @return
+ * @brief Sequencer service; releases the other services until shutdown
+ *
+ * @param arg - seqThreadParams_t
+ * @return NULL
  */
 void *sequencerTask(void *arg);
 
-#endif
\ No newline at end of file
+/**
+ * @brief parse a timer mode name (nanosleep, timerfd, sigalrm)
+ *
+ * @param name - mode name
+ * @return mode, or SEQ_TIMER_END if unknown
+ */
+SeqTimerMode_e seq_timer_mode_from_name(const char *name);
+
+#endif
@@ -0,0 +1,176 @@
+/***********************************************************************************
+ * @author Brian Ibeling
+ * ibelingb@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file serviceMonitor.h
+ * @brief per-service execution time / deadline monitor
+ *
+ * The sequencer stamps each release (CLOCK_MONOTONIC) into the service's monitor
+ * and the service brackets its job with monitor_job_start / monitor_job_end, so
+ * every job yields an execution time (start to completion) and a response time
+ * (release to completion), plus the wake-up latency (release to start). Running
+ * min/avg/max of all three, deadline misses and budget (WCET) overruns are kept
+ * per service and reported at shutdown.
+ *
+ * Each monitor has a single writer per field (the sequencer writes the release
+ * stamp, the service everything else) and all fields are accessed with relaxed
+ * atomics, so monitors can be read from any thread without locks. On a miss or
+ * overrun the configured action is taken: count only, log it, or skip the
+ * service's next job so it can catch up. Job start / end are also traced (if
+ * the service registered a trace ring) for offline analysis. The page faults of
+ * the service thread are split into those of its first MONITOR_WARMUP_JOBS jobs and
+ * any after, which with locked memory (rtMemory.h) should stay 0.
+ *
+ ************************************************************************************
+ */
+#ifndef SERVICE_MONITOR_H
+#define SERVICE_MONITOR_H
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdint.h>
+
+/* project headers */
+#include "perfCounters.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define MONITOR_NAME_LEN              (16)
+#define MONITOR_RUN_JOB               (0)     /* monitor_job_start: run this job */
+#define MONITOR_SKIP_JOB              (1)     /* monitor_job_start: skip this job */
+#define MONITOR_WARMUP_JOBS           (10)    /* page faults up to here are warm-up */
+
+typedef enum {
+  MONITOR_ACTION_COUNT = 0,                   /* only count misses / overruns */
+  MONITOR_ACTION_LOG,                         /* count and syslog each one */
+  MONITOR_ACTION_SKIP,                        /* count and skip the next job */
+  MONITOR_ACTION_END
+} MonitorAction_e;
+
+typedef struct {
+  char name[MONITOR_NAME_LEN];
+  uint64_t budgetNs;                          /* execution time budget, 0 = none */
+  uint64_t deadlineNs;                        /* relative deadline */
+  MonitorAction_e action;
+
+  uint64_t releaseNs;                         /* written by the sequencer */
+
+  /* written by the service */
+  uint64_t lastReleaseNs;                     /* release of the current job */
+  uint64_t startNs;
+  uint8_t jobActive;
+  uint8_t skipNext;
+  uint64_t jobs;
+  uint64_t minExecNs;
+  uint64_t maxExecNs;
+  uint64_t sumExecNs;
+  uint64_t minRespNs;
+  uint64_t maxRespNs;
+  uint64_t sumRespNs;
+  uint64_t minWakeNs;
+  uint64_t maxWakeNs;
+  uint64_t sumWakeNs;
+  uint64_t deadlineMisses;
+  uint64_t budgetOverruns;
+  uint64_t skippedJobs;
+  perfStats_t perf;                           /* hardware counters of the job bodies */
+  uint64_t threadCpuNs;                       /* CPU time of the service thread, at exit */
+  uint64_t warmupMinorFaults;                 /* page faults of the thread during warm-up */
+  uint64_t warmupMajorFaults;
+  uint64_t minorFaults;                       /* page faults since, expected to stay 0 */
+  uint64_t majorFaults;
+} serviceMonitor_t;
+
+/*---------------------------------------------------------------------------------*/
+
+/**
+ * @brief initialize a monitor
+ *
+ * @param pMon - monitor
+ * @param name - service name
+ * @param budgetNs - execution time budget (0 for none)
+ * @param deadlineNs - relative deadline
+ * @param action - what to do on a miss / overrun
+ */
+void monitor_init(serviceMonitor_t *pMon, const char *name, uint64_t budgetNs, uint64_t deadlineNs,
+                  MonitorAction_e action);
+
+/**
+ * @brief open the hardware counters of the calling service thread (no-op unless
+ *        perf_enable was called)
+ *
+ * @param pMon - monitor (NULL is ignored)
+ */
+void monitor_counters_open(serviceMonitor_t *pMon);
+
+/**
+ * @brief close the hardware counters and record the CPU time of the calling
+ *        service thread (at thread exit)
+ *
+ * @param pMon - monitor (NULL is ignored)
+ */
+void monitor_counters_close(serviceMonitor_t *pMon);
+
+/**
+ * @brief stamp a release (sequencer)
+ *
+ * @param pMon - monitor (NULL is ignored)
+ * @param releaseNs - CLOCK_MONOTONIC release time
+ */
+void monitor_release(serviceMonitor_t *pMon, uint64_t releaseNs);
+
+/**
+ * @brief stamp a data driven release unless one is already pending, so the
+ *        response time is measured from the first trigger of a burst
+ *
+ * @param pMon - monitor (NULL is ignored)
+ * @param releaseNs - CLOCK_MONOTONIC release time
+ */
+void monitor_trigger(serviceMonitor_t *pMon, uint64_t releaseNs);
+
+/**
+ * @brief start of a job (service, after waking up)
+ *
+ * Wake-ups without a new release are not measured.
+ *
+ * @param pMon - monitor (NULL is ignored)
+ * @return MONITOR_SKIP_JOB if the job should be skipped, else MONITOR_RUN_JOB
+ */
+int monitor_job_start(serviceMonitor_t *pMon);
+
+/**
+ * @brief completion of a job (service)
+ *
+ * @param pMon - monitor (NULL is ignored)
+ */
+void monitor_job_end(serviceMonitor_t *pMon);
+
+/**
+ * @brief syslog the statistics
+ *
+ * @param pMon - monitor
+ */
+void monitor_report(const serviceMonitor_t *pMon);
+
+/**
+ * @brief parse an action name (count, log, skip)
+ *
+ * @param name - action name
+ * @return action, or MONITOR_ACTION_END if unknown
+ */
+MonitorAction_e monitor_action_from_name(const char *name);
+
+/**
+ * @brief current CLOCK_MONOTONIC time (virtual under the virtual clock, see clockSource.h)
+ *
+ * @return nanoseconds
+ */
+uint64_t monitor_now_ns(void);
+
+#endif
@@ -0,0 +1,159 @@
+/***********************************************************************************
+ * @author Joshua Malburg
+ * joshua.malburg@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file serviceRegistry.h
+ * @brief table of sequenced services and their precomputed release schedule
+ *
+ * Every service released by the sequencer is described by a serviceDef_t: its
+ * rate, phase offset (in base rate ticks), scheduling policy / priority, core and
+ * the release / shutdown eventfds of its service loop (serviceRuntime.h). main
+ * registers the defaults, which can then be retuned at run time from a config file
+ * (-f) or the command line (-S), e.g.
+ *   proc 10          # release frame processing at 10 Hz instead of 1 Hz
+ *   write 1 60       # 1 Hz, offset half a second at a 120 Hz base rate
+ *   diff 2 0 3 2 80000 250000   # ... SCHED_DEADLINE runtime 80 ms, deadline 250 ms
+ *
+ * registry_build converts rates to periods in base rate ticks and precomputes a
+ * dispatch table covering one hyperperiod (LCM of all periods): entry t holds a
+ * bitmask of the services released at tick t, so each sequencer cycle is a
+ * single table lookup no matter how many services are registered.
+ *
+ * A service marked triggered is left out of the dispatch table: it is released by
+ * its upstream stage with registry_trigger as soon as there is data for it (event
+ * driven pipeline, -e). Its period still bounds its deadline and is what the RM
+ * analysis uses.
+ *
+ ************************************************************************************
+ */
+#ifndef SERVICE_REGISTRY_H
+#define SERVICE_REGISTRY_H
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdint.h>
+#include "serviceMonitor.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define SERVICE_MAX                   (32)    /* one bit per service in the dispatch mask */
+#define SERVICE_NAME_LEN              (16)
+#define SERVICE_MAX_HYPERPERIOD       (1000000) /* ticks; bounds the dispatch table */
+
+typedef struct {
+  char name[SERVICE_NAME_LEN];                /* used by config file / -S */
+  double rateHz;                              /* release rate */
+  unsigned int phaseTicks;                    /* release offset within the period */
+  int policy;                                 /* SCHED_FIFO / SCHED_RR */
+  uint8_t priorityOffset;                     /* below sched_get_priority_max(policy) */
+  int cpuCore;                                /* core the service is pinned to */
+  int releaseFd;                              /* eventfd signalled at each release */
+  int shutdownFd;                             /* eventfd signalled to stop the service */
+  void *(*pEntry)(void *);                    /* service thread */
+  void *pArg;                                 /* argument of pEntry */
+  unsigned int runtimeUs;                     /* SCHED_DEADLINE budget per period (-D) */
+  unsigned int deadlineUs;                    /* SCHED_DEADLINE relative deadline, 0 = period */
+  unsigned int periodTicks;                   /* set by registry_build */
+  serviceMonitor_t *pMonitor;                 /* release stamps / job timing, NULL if unmonitored */
+  uint8_t triggered;                          /* released by registry_trigger, not the sequencer */
+} serviceDef_t;
+
+typedef struct {
+  serviceDef_t services[SERVICE_MAX];
+  unsigned int numServices;
+  unsigned int baseRateHz;                    /* set by registry_build */
+  unsigned int hyperperiodTicks;
+  uint32_t *pDispatch;                        /* release mask for each tick of the hyperperiod */
+} serviceRegistry_t;
+
+/*---------------------------------------------------------------------------------*/
+
+/**
+ * @brief period of a service in a built registry
+ *
+ * @param pReg - built registry
+ * @param ind - service index
+ * @return period in nanoseconds
+ */
+static inline uint64_t registry_period_ns(const serviceRegistry_t *pReg, unsigned int ind)
+{
+  return ((uint64_t)pReg->services[ind].periodTicks * 1000000000ULL) / pReg->baseRateHz;
+}
+
+/**
+ * @brief add a service
+ *
+ * @param pReg - registry
+ * @param pDef - service description (periodTicks is ignored)
+ * @return service index (bit in the dispatch mask), -1 on error
+ */
+int registry_add(serviceRegistry_t *pReg, const serviceDef_t *pDef);
+
+/**
+ * @brief look up a service by name
+ *
+ * @param pReg - registry
+ * @param name - service name
+ * @return service, NULL if not registered
+ */
+serviceDef_t *registry_find(serviceRegistry_t *pReg, const char *name);
+
+/**
+ * @brief retune one service: "name rate [phase [priority_offset [core [runtime_us [deadline_us]]]]]"
+ *        ('=' and ',' are accepted as separators, e.g. proc=10,0)
+ *
+ * @param pReg - registry
+ * @param spec - service spec
+ * @return 0 on success, -1 on error
+ */
+int registry_set(serviceRegistry_t *pReg, const char *spec);
+
+/**
+ * @brief retune services from a config file, one registry_set spec per line ('#' comments)
+ *
+ * @param pReg - registry
+ * @param filename - config file
+ * @return 0 on success, -1 on error
+ */
+int registry_load(serviceRegistry_t *pReg, const char *filename);
+
+/**
+ * @brief compute periods and the hyperperiod dispatch table for a base rate
+ *
+ * @param pReg - registry
+ * @param baseRateHz - sequencer base rate
+ * @return 0 on success, -1 on error
+ */
+int registry_build(serviceRegistry_t *pReg, unsigned int baseRateHz);
+
+/**
+ * @brief services released in base rate ticks [firstTick, lastTick]
+ *
+ * @param pReg - built registry
+ * @param firstTick, lastTick - tick range (normally a single tick)
+ * @return release mask (bit n = services[n])
+ */
+uint32_t registry_released(const serviceRegistry_t *pReg, unsigned long long firstTick, unsigned long long lastTick);
+
+/**
+ * @brief release a triggered service now (no-op if it is already released and
+ *        hasn't started yet, so a burst of data wakes it once)
+ *
+ * @param pSvc - service to release (NULL is ignored)
+ */
+void registry_trigger(const serviceDef_t *pSvc);
+
+/**
+ * @brief free the dispatch table
+ *
+ * @param pReg - registry
+ */
+void registry_free(serviceRegistry_t *pReg);
+
+#endif
@@ -0,0 +1,106 @@
+/***********************************************************************************
+ * @author Joshua Malburg
+ * joshua.malburg@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file serviceRuntime.h
+ * @brief common wait loop of the RT services (epoll over eventfds)
+ *
+ * Each service owns two eventfds: a release eventfd written by the sequencer (or
+ * the upstream stage in event driven mode) and a shutdown eventfd. The service
+ * thread blocks in epoll_wait on both (plus any other fd it adds, e.g. a message
+ * queue) with its watchdog timeout and gets back why it woke up. A release read
+ * from the eventfd returns every release since the last one, so bursts collapse
+ * into one job and are counted. The shutdown eventfd is never read, so once
+ * written it stays readable and the service sees it on every wait; writing it is
+ * async-signal-safe, which replaces the per-service kill signals and their
+ * non-atomic run flags.
+ *
+ ************************************************************************************
+ */
+#ifndef SERVICE_RUNTIME_H
+#define SERVICE_RUNTIME_H
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdint.h>
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define SERVICE_LOOP_MAX_FDS          (4)
+#define SERVICE_LOOP_NAME_LEN         (24)
+
+/* service_loop_wait results (bitmask); 0 = timed out */
+#define SERVICE_WAKE_RELEASE          (0x1)
+#define SERVICE_WAKE_DATA             (0x2)   /* an fd added with service_loop_add_fd */
+#define SERVICE_WAKE_SHUTDOWN         (0x4)
+
+typedef struct {
+  char name[SERVICE_LOOP_NAME_LEN];
+  int epollFd;
+  int releaseFd;
+  int shutdownFd;
+  unsigned long long wakeups;                 /* statistics */
+  unsigned long long releases;
+  unsigned long long coalesced;               /* releases folded into an earlier wake-up */
+  unsigned long long timeouts;
+} serviceLoop_t;
+
+/*---------------------------------------------------------------------------------*/
+
+/**
+ * @brief create the epoll set for a service
+ *
+ * @param pLoop - loop to initialize
+ * @param name - service name for logging
+ * @param releaseFd - release eventfd
+ * @param shutdownFd - shutdown eventfd
+ * @return 0 on success, -1 on error
+ */
+int service_loop_init(serviceLoop_t *pLoop, const char *name, int releaseFd, int shutdownFd);
+
+/**
+ * @brief also wake up when fd is readable (e.g. a message queue descriptor)
+ *
+ * @param pLoop - loop
+ * @param fd - file descriptor
+ * @return 0 on success, -1 on error
+ */
+int service_loop_add_fd(serviceLoop_t *pLoop, int fd);
+
+/**
+ * @brief wait for a release, data, shutdown or the timeout
+ *
+ * @param pLoop - loop
+ * @param timeoutMsec - watchdog timeout (none under the virtual clock)
+ * @return SERVICE_WAKE_* bitmask (0 on timeout), -1 on error
+ */
+int service_loop_wait(serviceLoop_t *pLoop, int timeoutMsec);
+
+/**
+ * @brief log the statistics and close the epoll set (not the eventfds)
+ *
+ * @param pLoop - loop
+ */
+void service_loop_close(serviceLoop_t *pLoop);
+
+/**
+ * @brief create a non-blocking eventfd for releases / shutdown
+ *
+ * @return fd, -1 on error
+ */
+int service_event_create(void);
+
+/**
+ * @brief signal an eventfd (async-signal-safe)
+ *
+ * @param fd - eventfd (negative is ignored)
+ */
+void service_event_signal(int fd);
+
+#endif
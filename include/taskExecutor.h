@@ -0,0 +1,147 @@
+/***********************************************************************************
+ * @author Brian Ibeling
+ * ibelingb@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file taskExecutor.h
+ * @brief work-stealing executor for the sub-tasks of processing
+ *
+ * A fixed set of worker threads, each pinned to one CPU of a configurable core set
+ * and running SCHED_OTHER or SCHED_FIFO at a configurable priority, each with its
+ * own bounded deque of tasks. A task submitted from outside goes to the bottom of
+ * the deques in turn; one submitted from inside a task goes to its own worker's
+ * deque. A worker takes from the bottom of its own deque (newest first) and, when
+ * that is empty, steals from the top (oldest first) of the others, so a burst lands
+ * on whichever cores are idle. Idle workers sleep until something is submitted.
+ *
+ * Tasks can be tracked with a task group to wait for all of them. Processing, an RT
+ * service, finishes its Hough sub-task with task_group_finish: if no worker has
+ * started it yet it runs in processing itself, so processing only ever waits on a
+ * task already running on a worker. In the pipeline the workers run SCHED_FIFO below
+ * every service on CPUs no service uses (see main and rm_analyze_executor). With no
+ * executor, or every deque full, a task simply runs in the caller.
+ *
+ * Only processing submits here; still encodes keep the encoder pool's own SCHED_OTHER
+ * workers, so they never run ahead of an RT service.
+ *
+ ************************************************************************************
+ */
+#ifndef TASK_EXECUTOR_H
+#define TASK_EXECUTOR_H
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define TASK_EXECUTOR_MAX_WORKERS     (16)
+#define TASK_DEQUE_LEN                (64)    /* per worker, power of 2 */
+
+typedef void (*taskFn_t)(void *pArg);
+
+typedef struct {
+  pthread_mutex_t mutex;
+  pthread_cond_t doneCond;
+  unsigned int pending;                       /* submitted and not finished */
+} taskGroup_t;
+
+typedef struct {
+  taskFn_t pFn;
+  void *pArg;
+  taskGroup_t *pGroup;                        /* may be NULL */
+} task_t;
+
+typedef struct {
+  void *pExec;                                /* owning executor */
+  unsigned int index;                         /* of its worker */
+  pthread_mutex_t mutex;
+  task_t tasks[TASK_DEQUE_LEN];
+  unsigned int top;                           /* stolen from here */
+  unsigned int bottom;                        /* owner pushes / pops here */
+  unsigned long long executed;                /* tasks the worker ran */
+  unsigned long long stolen;                  /* of those, taken from another deque */
+} taskDeque_t;
+
+typedef struct {
+  pthread_t threads[TASK_EXECUTOR_MAX_WORKERS];
+  taskDeque_t deques[TASK_EXECUTOR_MAX_WORKERS];
+  unsigned int numWorkers;
+  unsigned int nextDeque;                     /* round robin for outside submissions */
+  int queued;                                 /* tasks in all deques */
+  pthread_mutex_t idleMutex;
+  pthread_cond_t idleCond;                    /* signalled on submit / shutdown */
+  uint8_t running;
+  unsigned long long inlineCnt;               /* ran in the caller, every deque full */
+  unsigned long long reclaimedCnt;            /* run by task_group_finish before any worker took them */
+} taskExecutor_t;
+
+/*---------------------------------------------------------------------------------*/
+
+/**
+ * @brief start the workers
+ *
+ * @param pExec - executor to initialize
+ * @param numWorkers - number of worker threads (at most TASK_EXECUTOR_MAX_WORKERS)
+ * @param priority - SCHED_FIFO priority of the workers, 0 for SCHED_OTHER
+ * @param pCpuSet - cores; worker n is pinned to the n-th one (round robin), NULL for no restriction
+ * @return 0 on success, -1 on error
+ */
+int task_executor_create(taskExecutor_t *pExec, unsigned int numWorkers, int priority, const cpu_set_t *pCpuSet);
+
+/**
+ * @brief run pFn(pArg) on a worker
+ *
+ * @param pExec - executor, NULL to run in the caller
+ * @param pFn - task
+ * @param pArg - task argument
+ * @param pGroup - group the task is counted in until it finishes, may be NULL
+ * @return 0 if queued, 1 if it ran in the caller
+ */
+int task_executor_submit(taskExecutor_t *pExec, taskFn_t pFn, void *pArg, taskGroup_t *pGroup);
+
+/**
+ * @brief run the tasks still queued, stop the workers and log what each ran
+ *
+ * @param pExec - executor
+ */
+void task_executor_destroy(taskExecutor_t *pExec);
+
+/**
+ * @brief initialize an empty task group
+ *
+ * @param pGroup - group
+ */
+void task_group_init(taskGroup_t *pGroup);
+
+/**
+ * @brief wait until every task of the group has finished; not from inside a task
+ *
+ * @param pGroup - group
+ */
+void task_group_wait(taskGroup_t *pGroup);
+
+/**
+ * @brief run the tasks of the group no worker has started yet in the caller, then wait
+ *        for the ones already running; not from inside a task
+ *
+ * @param pExec - executor the tasks were submitted to, NULL if none
+ * @param pGroup - group
+ */
+void task_group_finish(taskExecutor_t *pExec, taskGroup_t *pGroup);
+
+/**
+ * @brief free a task group with nothing pending
+ *
+ * @param pGroup - group
+ */
+void task_group_destroy(taskGroup_t *pGroup);
+
+#endif
@@ -0,0 +1,64 @@
+/***********************************************************************************
+ * @author Joshua Malburg
+ * joshua.malburg@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file throughput.h
+ * @brief stage / end to end throughput and core utilisation of a run
+ *
+ * Meant for the free running mode (-R), where every stage runs as fast as its
+ * input allows: for each stage the frames it handled, its achieved FPS, the CPU
+ * time of its thread and the FPS it could sustain with a core to itself
+ * (frames / CPU time), i.e. its headroom; plus end to end FPS and the
+ * utilisation of each core (/proc/stat) over the run.
+ *
+ ************************************************************************************
+ */
+#ifndef THROUGHPUT_H
+#define THROUGHPUT_H
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdint.h>
+
+/* project headers */
+#include "metrics.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define THROUGHPUT_MAX_CPUS           (16)
+
+typedef struct {
+  uint64_t startNs;                           /* CLOCK_MONOTONIC */
+  unsigned int numCpus;                       /* highest cpu id seen + 1 */
+  uint64_t busyTicks[THROUGHPUT_MAX_CPUS];    /* /proc/stat at the start, by cpu id */
+  uint64_t totalTicks[THROUGHPUT_MAX_CPUS];   /* 0 = cpu not listed (offline) */
+} throughputRun_t;
+
+/*---------------------------------------------------------------------------------*/
+
+/**
+ * @brief mark the start of a run
+ *
+ * @param pRun - run
+ */
+void throughput_start(throughputRun_t *pRun);
+
+/**
+ * @brief syslog and print the throughput of a finished run
+ *
+ * @param pRun - run
+ * @param pBlock - metrics of the run (monitors hold each service's CPU time)
+ * @param pStageFrames - frames handled by each service, by service index
+ * @param inputFrames - frames that entered the pipeline
+ * @param endNs - end of the run (CLOCK_MONOTONIC)
+ */
+void throughput_report(const throughputRun_t *pRun, const pipelineMetrics_t *pBlock, const uint64_t *pStageFrames,
+                       uint64_t inputFrames, uint64_t endNs);
+
+#endif
@@ -0,0 +1,155 @@
+/***********************************************************************************
+ * @author Brian Ibeling
+ * ibelingb@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file traceRing.h
+ * @brief lock-free binary trace of the pipeline's timing events
+ *
+ * Every thread that traces registers once and gets its own single producer /
+ * single consumer ring of fixed size events (time, event id, frame number,
+ * argument). Events are stamped from the clock source, so under -V they carry
+ * virtual time like the release / execution times in their arguments; the header
+ * records which clock a trace was taken with. Recording an event is a clock read
+ * and a few stores, with no lock, syscall or formatting, so it doesn't disturb the
+ * timing being measured the way a syslog() per frame does. When a ring is full the
+ * event is dropped and counted; the producer never waits.
+ *
+ * A SCHED_OTHER thread on the non-RT core drains the rings into a compact binary
+ * file (traceFileHeader_t followed by traceEvent_t records) and drains them one
+ * last time at trace_stop. The cost of one event is measured at trace_start and
+ * logged / stored in the header.
+ *
+ ************************************************************************************
+ */
+#ifndef TRACE_RING_H
+#define TRACE_RING_H
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+/* project headers */
+#include "clockSource.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define TRACE_MAX_THREADS             (8)
+#define TRACE_RING_EVENTS             (8192)  /* per thread, power of 2 */
+#define TRACE_FLUSH_MSEC              (100)
+#define TRACE_FILE_MAGIC              "PTRC"
+#define TRACE_FILE_VERSION            (2)
+#define TRACE_CACHE_LINE              (64)
+#define TRACE_FLAG_VIRTUAL_CLOCK      (0x1)   /* taken with the virtual clock (-V) */
+
+typedef enum {
+  TRACE_SEQ_RELEASE = 0,                      /* frame = base rate tick, arg = release mask */
+  TRACE_FRAME_START,                          /* a service starts on a frame */
+  TRACE_ACQ_INSERTED,                         /* frame = acquired frame # */
+  TRACE_DIFF_PIXELS,                          /* arg = changed pixel count */
+  TRACE_DIFF_SELECTED,                        /* frame = selected frame #, into select queue */
+  TRACE_PROC_QUEUED,                          /* frame = selected frame #, into write queue */
+  TRACE_WRITE_SAVED,                          /* frame = selected frame #, saved */
+  TRACE_JOB_START,                            /* frame = job #, arg = release time (ns) */
+  TRACE_JOB_END,                              /* frame = job #, arg = execution time (ns) */
+  TRACE_EVENT_END
+} TraceEvent_e;
+
+typedef struct {
+  uint64_t timeNs;                            /* clock_source_now_ns */
+  uint32_t frameNum;
+  uint16_t eventId;                           /* TraceEvent_e */
+  uint8_t thread;                             /* id given to trace_register */
+  uint8_t reserved;
+  uint64_t arg;
+} traceEvent_t;
+
+typedef struct {
+  char magic[4];                              /* TRACE_FILE_MAGIC */
+  uint32_t version;
+  uint32_t eventSize;                         /* sizeof(traceEvent_t) */
+  uint32_t overheadNs;                        /* measured cost of one event */
+  uint64_t startNs;                           /* clock_source_now_ns at trace_start */
+  uint32_t flags;                             /* TRACE_FLAG_ */
+  uint32_t reserved;
+} traceFileHeader_t;
+
+typedef struct {
+  uint32_t head __attribute__((aligned(TRACE_CACHE_LINE)));   /* written by the producer */
+  uint64_t dropped;
+  uint32_t tail __attribute__((aligned(TRACE_CACHE_LINE)));   /* written by the flusher */
+  uint8_t thread;
+  traceEvent_t events[TRACE_RING_EVENTS] __attribute__((aligned(TRACE_CACHE_LINE)));
+} traceRing_t;
+
+/* ring of the calling thread, NULL until trace_register */
+extern __thread traceRing_t *pTraceRing;
+
+/*---------------------------------------------------------------------------------*/
+
+/**
+ * @brief append an event to a ring (producer side, lock-free)
+ */
+static inline void trace_ring_push(traceRing_t *pRing, uint16_t eventId, uint32_t frameNum, uint64_t arg)
+{
+  uint32_t head = pRing->head;
+
+  if((head - __atomic_load_n(&pRing->tail, __ATOMIC_ACQUIRE)) >= TRACE_RING_EVENTS) {
+    __atomic_store_n(&pRing->dropped, pRing->dropped + 1, __ATOMIC_RELAXED);
+    return;
+  }
+  traceEvent_t *pEvent = &pRing->events[head & (TRACE_RING_EVENTS - 1)];
+  pEvent->timeNs = clock_source_now_ns();
+  pEvent->frameNum = frameNum;
+  pEvent->eventId = eventId;
+  pEvent->thread = pRing->thread;
+  pEvent->arg = arg;
+  __atomic_store_n(&pRing->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief record an event from the calling thread (ignored if not registered)
+ *
+ * @param eventId - TraceEvent_e
+ * @param frameNum - frame number the event refers to
+ * @param arg - event specific argument
+ */
+static inline void trace_event(uint16_t eventId, uint32_t frameNum, uint64_t arg)
+{
+  if(pTraceRing != NULL) {
+    trace_ring_push(pTraceRing, eventId, frameNum, arg);
+  }
+}
+
+/**
+ * @brief open the trace file, measure the event cost and start the flush thread
+ *
+ * @param filename - output file
+ * @param pCpuSet - cores the flush thread may run on (NULL for no restriction)
+ * @return 0 on success, -1 on error
+ */
+int trace_start(const char *filename, const cpu_set_t *pCpuSet);
+
+/**
+ * @brief give the calling thread a ring
+ *
+ * @param thread - id stored in its events (e.g. Thread_e)
+ * @return 0 on success, -1 if tracing isn't started or no ring is left
+ */
+int trace_register(uint8_t thread);
+
+/**
+ * @brief stop the flush thread, drain every ring and close the file
+ */
+void trace_stop(void);
+
+#endif
@@ -0,0 +1,113 @@
+/***********************************************************************************
+ * @author Brian Ibeling
+ * ibelingb@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file videoEncoder.h
+ * @brief video encoding thread with rolling segments
+ *
+ * writeTask copies each annotated frame into a bounded queue and returns; a
+ * SCHED_OTHER thread encodes the frames into MJPG segments (video_000.avi,
+ * video_001.avi, ...). A segment is closed once it covers VIDEO_SEGMENT_SEC of
+ * capture time or grows past VIDEO_SEGMENT_MB, so a crash loses at most the
+ * segment being written.
+ *
+ * The container runs at the fastest rate frames can be selected at (set by the
+ * caller from the acquisition rate) and each frame is placed at the slot given by
+ * its diffFrameTime (the previous frame is repeated to fill gaps), so playback
+ * speed matches capture instead of a hardcoded frame rate. Frames never arrive
+ * faster than the timebase, so a frame only moves to the next free slot on timing
+ * jitter and playback doesn't drift from capture.
+ *
+ ************************************************************************************
+ */
+#ifndef VIDEO_ENCODER_H
+#define VIDEO_ENCODER_H
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "retention.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define VIDEO_QUEUE_LEN               (8)
+#define VIDEO_TIMEBASE_FPS            (2.0)   /* container rate if the caller gives none */
+#define VIDEO_SEGMENT_SEC             (300)   /* roll after this much capture time */
+#define VIDEO_SEGMENT_MB              (64)    /* ... or once the segment is this large */
+#define VIDEO_MAX_REPEAT_SEC          (10)    /* longer gaps are not filled with repeats */
+
+typedef struct {
+  uint8_t *pData;                             /* pixel buffer */
+  int type;                                   /* OpenCV Mat type */
+  int rows;
+  int cols;
+  float frameTime;                            /* diffFrameTime (msec) */
+} videoFrame_t;
+
+typedef struct {
+  pthread_t thread;
+  char prefix[64];                            /* segment filename prefix */
+  videoFrame_t *pSlots;                       /* preallocated frame slots */
+  size_t slotLen;
+  unsigned int *pFreeStack;                   /* indices of free slots */
+  unsigned int freeCnt;
+  unsigned int *pPending;                     /* FIFO of queued slot indices */
+  unsigned int pendingHead;
+  unsigned int pendingCnt;
+  pthread_mutex_t mutex;
+  pthread_cond_t workCond;
+  uint8_t running;
+  uint8_t started;
+  double fps;                                 /* container rate; sets timestamp resolution */
+  retentionMgr_t *pRetention;                 /* closed segments are handed here, may be NULL */
+  unsigned long encodedCnt;                   /* frames submitted to the container */
+  unsigned long repeatCnt;                    /* extra copies written to keep timing */
+  unsigned long droppedCnt;                   /* queue full at submit */
+  unsigned int segmentCnt;
+} videoEncoder_t;
+
+/*---------------------------------------------------------------------------------*/
+
+/**
+ * @brief allocate the queue and start the encoder thread
+ *
+ * @param pEncoder - encoder to initialize
+ * @param prefix - segment filename prefix (e.g. "./video")
+ * @param slotLen - largest frame to be queued (bytes)
+ * @param pCpuSet - cores the thread may run on (NULL for no restriction)
+ * @param pRetention - retention manager for closed segments (NULL for none)
+ * @param fps - container rate, the fastest frames are submitted at (0 for VIDEO_TIMEBASE_FPS)
+ * @return 0 on success, -1 on error
+ */
+int video_encoder_start(videoEncoder_t *pEncoder, const char *prefix, size_t slotLen, const cpu_set_t *pCpuSet,
+                        retentionMgr_t *pRetention, double fps);
+
+/**
+ * @brief queue a copy of a frame without blocking
+ *
+ * @param pEncoder - running encoder
+ * @param pData - 8-bit gray or color pixels
+ * @param type - OpenCV Mat type
+ * @param rows, cols - frame size
+ * @param frameTime - diffFrameTime (msec)
+ * @return 0 on success, -1 if the queue is full (frame dropped)
+ */
+int video_encoder_submit(videoEncoder_t *pEncoder, const uint8_t *pData, int type, int rows, int cols, float frameTime);
+
+/**
+ * @brief encode everything queued, close the last segment and stop the thread
+ *
+ * @param pEncoder - encoder
+ */
+void video_encoder_stop(videoEncoder_t *pEncoder);
+
+#endif
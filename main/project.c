@@ -46,6 +46,10 @@ using namespace std;
 #include "frameProcessing.h"
 #include "frameWrite.h"
 #include "sequencer.h"
+#include "deadlineSched.h"
+#include "rmAnalysis.h"
+#include "throughput.h"
+#include "cpuTopology.h"
 #include "project.h"
 #include "circular_buffer.h"
 #include "circular_cv_buffer.h"
@@ -53,13 +57,15 @@ using namespace std;
 /*---------------------------------------------------------------------------------*/
 /* MACROS / TYPES / CONST */
 #define ERROR   (-1)
-#define NUM_CPU_CORES (4)
 
 /*---------------------------------------------------------------------------------*/
 /* PRIVATE FUNCTIONS */
 
 int set_attr_policy(pthread_attr_t *attr, cpu_set_t *cpuSet, int policy, uint8_t priorityOffset, int cpuCore);
 int set_main_policy(int policy, uint8_t priorityOffset);
+int create_service(pthread_t *pThread, pthread_attr_t *attr, const serviceDef_t *pSvc, const deadlineParams_t *pDeadline,
+                   uint8_t *pUseDeadline, pthread_t *pStarted, const serviceDef_t *pStartedDefs, unsigned int numStarted);
+unsigned int free_queued_frames(mqd_t queue, frameArena_t *pArena);
 void print_scheduler(void);
 void usage(void);
 
@@ -74,7 +80,6 @@ const char *writeQueueName = "/write_mq";
 int main(int argc, char *argv[])
 {
   pthread_t threads[TOTAL_THREADS];
-  int i;
 
   /* starting logging; use cat /var/log/syslog | grep project
    * to view messages */
@@ -141,11 +146,439 @@ int main(int argc, char *argv[])
   /* todo: get from CLI */
   threadParams[Thread_e::ACQ_THREAD].cameraIdx = 0;
 
+  /* release and shutdown events of each service */
+  int releaseFds[TOTAL_RT_THREADS];
+  int shutdownFds[TOTAL_RT_THREADS];
+  for(uint8_t ind = 0; ind < TOTAL_RT_THREADS; ++ind) {
+    releaseFds[ind] = service_event_create();
+    shutdownFds[ind] = service_event_create();
+    if((releaseFds[ind] < 0) || (shutdownFds[ind] < 0)) {
+      syslog(LOG_ERR, "couldn't create service events");
+      return -1;
+    }
+  }
+
+  /* default service schedule; registered in Thread_e order so index == thread. Cores are
+   * placed from the CPU topology at startup unless set with -S / -f */
+  serviceRegistry_t registry;
+  memset(&registry, 0, sizeof(serviceRegistry_t));
+  const serviceDef_t defaultServices[TOTAL_RT_THREADS] = {
+    {"acq",   24.0, 0, SCHED_FIFO, 2, CPU_CORE_AUTO, releaseFds[Thread_e::ACQ_THREAD],   shutdownFds[Thread_e::ACQ_THREAD],   acquisitionTask, &threadParams[Thread_e::ACQ_THREAD],   10000,  0, 0},
+    {"diff",   2.0, 0, SCHED_FIFO, 3, CPU_CORE_AUTO, releaseFds[Thread_e::DIFF_THREAD],  shutdownFds[Thread_e::DIFF_THREAD],  differenceTask,  &threadParams[Thread_e::DIFF_THREAD],  100000, 0, 0},
+    {"proc",   1.0, 0, SCHED_FIFO, 4, CPU_CORE_AUTO, releaseFds[Thread_e::PROC_THREAD],  shutdownFds[Thread_e::PROC_THREAD],  processingTask,  &threadParams[Thread_e::PROC_THREAD],  300000, 0, 0},
+    {"write",  1.0, 0, SCHED_RR,   5, CPU_CORE_AUTO, releaseFds[Thread_e::WRITE_THREAD], shutdownFds[Thread_e::WRITE_THREAD], writeTask,       &threadParams[Thread_e::WRITE_THREAD], 200000, 0, 0},
+  };
+  serviceDef_t seqService = {"seq", 0.0, 0, SCHED_FIFO, 1, CPU_CORE_AUTO, -1, -1, sequencerTask, &seqThreadParams, SEQ_DEADLINE_RUNTIME_US, 0, 0};
+  for(uint8_t ind = 0; ind < TOTAL_RT_THREADS; ++ind) {
+    registry_add(&registry, &defaultServices[ind]);
+  }
+
+  /* optional settings */
+  EncodeCodec_e stillCodec = EncodeCodec_e::ENCODE_CODEC_END;
+  int stillQuality = ENCODER_DEFAULT_QUALITY;
+  long budgetMB = RETENTION_BUDGET_MB;
+  long budgetFiles = RETENTION_MAX_FILES;
+  uint8_t useDeadline = FALSE;
+  MonitorAction_e monitorAction = MonitorAction_e::MONITOR_ACTION_COUNT;
+  const char *wcetProfile = NULL;
+  const char *metricsSocket = NULL;
+  uint8_t refuseInfeasible = FALSE;
+  uint8_t eventDriven = FALSE;
+  uint8_t freeRun = FALSE;
+  uint8_t virtualClock = FALSE;
+  uint8_t hugePages = FALSE;
+  const char *executorSpec = NULL;
+  memset(&seqThreadParams, 0, sizeof(seqThreadParams_t));
+  seqThreadParams.baseRateHz = SEQ_DEFAULT_RATE_HZ;
+  seqThreadParams.timerMode = SeqTimerMode_e::SEQ_TIMER_NANOSLEEP;
+  int opt;
+  optind = argIndex + 1;
+  while((opt = getopt(argc, argv, "c:q:zb:n:r:s:f:S:Dm:w:Feu:Pp:RVHx:")) != -1) {
+    switch(opt) {
+    case 'c':
+      stillCodec = encoder_codec_from_name(optarg);
+      if(stillCodec == EncodeCodec_e::ENCODE_CODEC_END) {
+        syslog(LOG_ERR, "invalid codec provided");
+        cout  << "invalid '-c' codec provided\n\n";
+        usage();
+        return -1;
+      }
+      break;
+    case 'q':
+      stillQuality = atoi(optarg);
+      if((stillQuality < 0) || (stillQuality > 100)) {
+        syslog(LOG_ERR, "invalid quality provided");
+        cout  << "invalid '-q' quality provided\n\n";
+        usage();
+        return -1;
+      }
+      break;
+    case 'z':
+      threadParams[Thread_e::WRITE_THREAD].delta_enable = TRUE;
+      break;
+    case 'b':
+      budgetMB = atol(optarg);
+      if(budgetMB < 0) {
+        syslog(LOG_ERR, "invalid disk budget provided");
+        cout  << "invalid '-b' budget provided\n\n";
+        usage();
+        return -1;
+      }
+      break;
+    case 'n':
+      budgetFiles = atol(optarg);
+      if(budgetFiles <= 0) {
+        syslog(LOG_ERR, "invalid file budget provided");
+        cout  << "invalid '-n' file count provided\n\n";
+        usage();
+        return -1;
+      }
+      break;
+    case 'r':
+      seqThreadParams.baseRateHz = atoi(optarg);
+      if((seqThreadParams.baseRateHz == 0) || (seqThreadParams.baseRateHz > SEQ_MAX_RATE_HZ)) {
+        syslog(LOG_ERR, "invalid base rate provided");
+        cout  << "invalid '-r' base rate provided\n\n";
+        usage();
+        return -1;
+      }
+      break;
+    case 's':
+      seqThreadParams.timerMode = seq_timer_mode_from_name(optarg);
+      if(seqThreadParams.timerMode == SeqTimerMode_e::SEQ_TIMER_END) {
+        syslog(LOG_ERR, "invalid timer mode provided");
+        cout  << "invalid '-s' timer mode provided\n\n";
+        usage();
+        return -1;
+      }
+      break;
+    case 'f':
+      if(registry_load(&registry, optarg) != 0) {
+        cout  << "invalid '-f' service config provided\n\n";
+        usage();
+        return -1;
+      }
+      break;
+    case 'S':
+      if(registry_set(&registry, optarg) != 0) {
+        cout  << "invalid '-S' service spec provided\n\n";
+        usage();
+        return -1;
+      }
+      break;
+    case 'D':
+      useDeadline = TRUE;
+      break;
+    case 'm':
+      monitorAction = monitor_action_from_name(optarg);
+      if(monitorAction == MonitorAction_e::MONITOR_ACTION_END) {
+        syslog(LOG_ERR, "invalid monitor action provided");
+        cout  << "invalid '-m' monitor action provided\n\n";
+        usage();
+        return -1;
+      }
+      break;
+    case 'w':
+      wcetProfile = optarg;
+      break;
+    case 'F':
+      refuseInfeasible = TRUE;
+      break;
+    case 'e':
+      eventDriven = TRUE;
+      break;
+    case 'u':
+      metricsSocket = optarg;
+      break;
+    case 'P':
+      perf_enable();
+      syslog(LOG_INFO, "hardware counters enabled");
+      break;
+    case 'p':
+      threadParams[Thread_e::ACQ_THREAD].replayPath = optarg;
+      break;
+    case 'R':
+      freeRun = TRUE;
+      break;
+    case 'V':
+      virtualClock = TRUE;
+      break;
+    case 'H':
+      hugePages = TRUE;
+      break;
+    case 'x':
+      executorSpec = optarg;
+      break;
+    default:
+      usage();
+      return -1;
+    }
+  }
+
   syslog(LOG_INFO, "hough_enable: %d", threadParams[Thread_e::PROC_THREAD].hough_enable);
   syslog(LOG_INFO, "filter_enable: %d", threadParams[Thread_e::PROC_THREAD].filter_enable);
   syslog(LOG_INFO, "save_type: %d",  threadParams[Thread_e::DIFF_THREAD].save_type);
   syslog(LOG_INFO, "cam_index: %d", threadParams[Thread_e::ACQ_THREAD].cameraIdx);
-  
+  if(threadParams[Thread_e::ACQ_THREAD].replayPath != NULL) {
+    syslog(LOG_INFO, "replay: %s", threadParams[Thread_e::ACQ_THREAD].replayPath);
+  }
+  syslog(LOG_INFO, "still_codec: %d, quality: %d", stillCodec, stillQuality);
+  syslog(LOG_INFO, "delta_enable: %d", threadParams[Thread_e::WRITE_THREAD].delta_enable);
+  syslog(LOG_INFO, "disk budget: %ld MB, %ld files", budgetMB, budgetFiles);
+  syslog(LOG_INFO, "sequencer: %u Hz, timer mode %d", seqThreadParams.baseRateHz, seqThreadParams.timerMode);
+  syslog(LOG_INFO, "deadline_enable: %d", useDeadline);
+  syslog(LOG_INFO, "event_driven: %d", eventDriven);
+  syslog(LOG_INFO, "free_run: %d", freeRun);
+  syslog(LOG_INFO, "virtual_clock: %d", virtualClock);
+  syslog(LOG_INFO, "hugepages: %d", hugePages);
+
+  /* free running needs an input that ends, and paces itself with back-pressure */
+  if(freeRun && (threadParams[Thread_e::ACQ_THREAD].replayPath == NULL)) {
+    syslog(LOG_ERR, "free run without a replay");
+    cout  << "-R needs a recording to replay (-p)\n\n";
+    usage();
+    return -1;
+  }
+  if(virtualClock && ((threadParams[Thread_e::ACQ_THREAD].replayPath == NULL) || freeRun)) {
+    syslog(LOG_ERR, "virtual clock without a replay or with free run");
+    cout  << "-V needs a recording to replay (-p) and can't be combined with -R\n\n";
+    usage();
+    return -1;
+  }
+
+  /* virtual clock: time (and the program start every frame time is relative to) only
+   * moves when the sequencer advances it */
+  if(virtualClock) {
+    if(clock_source_virtual(releaseFds, TOTAL_RT_THREADS) != 0) {
+      return -1;
+    }
+    clock_source_gettime(SYSLOG_CLOCK_TYPE, &startTime);
+    for(int ind = 0; ind < TOTAL_THREADS - 1; ++ind) {
+      threadParams[ind].programStartTime = startTime;
+    }
+  }
+  if(freeRun) {
+    eventDriven = TRUE;
+    registry.services[Thread_e::ACQ_THREAD].triggered = TRUE;
+    threadParams[Thread_e::DIFF_THREAD].pPrev = &registry.services[Thread_e::ACQ_THREAD];
+    for(uint8_t ind = 0; ind < TOTAL_RT_THREADS; ++ind) {
+      threadParams[ind].free_run = TRUE;
+    }
+    seqThreadParams.freeRun = TRUE;
+  }
+
+  /* event driven: only acquisition is periodic, each stage releases the next when it has data */
+  if(eventDriven) {
+    for(uint8_t ind = Thread_e::DIFF_THREAD; ind < TOTAL_RT_THREADS; ++ind) {
+      registry.services[ind].triggered = TRUE;
+      threadParams[ind].event_driven = TRUE;
+      threadParams[ind - 1].pNext = &registry.services[ind];
+    }
+  }
+  if(registry_build(&registry, seqThreadParams.baseRateHz) != 0) {
+    syslog(LOG_ERR, "invalid service schedule");
+    cout  << "invalid service schedule for a " << seqThreadParams.baseRateHz << " Hz base rate\n\n";
+    return -1;
+  }
+
+  /* a selected frame is followed by FRAMES_TO_SKIP skipped ones, so frames reach the video
+   * at most at this rate; it is the video timebase so each gets its own slot */
+  threadParams[Thread_e::WRITE_THREAD].videoFps = registry.services[Thread_e::ACQ_THREAD].rateHz / (FRAMES_TO_SKIP + 1);
+
+  /* one CPU per service from the topology (isolcpus / cpuset aware), helpers on housekeeping */
+  cpuTopology_t topology;
+  if(cpu_topology_read(&topology) != 0) {
+    registry_free(&registry);
+    return -1;
+  }
+  serviceDef_t *placed[SERVICE_MAX + 1];
+  unsigned int numPlaced = 0;
+  placed[numPlaced++] = &seqService;
+  for(uint8_t ind = 0; ind < registry.numServices; ++ind) {
+    placed[numPlaced++] = &registry.services[ind];
+  }
+  if(cpu_topology_place(&topology, placed, numPlaced) != 0) {
+    cout  << "core placement: some services share a CPU (see above)\n";
+  }
+
+  /* executor for proc's circle search (-x workers[,priority[,cpus]]): by default one worker
+   * per CPU that no service nor the housekeeping helpers use, SCHED_FIFO below every
+   * service, so the workers only take time the services leave idle and never starve
+   * the SCHED_OTHER helpers */
+  cpu_set_t executorCpu;
+  long executorWorkers = 0;
+  long executorPriority = 0;
+  if(executorSpec != NULL) {
+    int lowestPriority = sched_get_priority_max(SCHED_FIFO);
+    for(unsigned int ind = 0; ind < numPlaced; ++ind) {
+      if((placed[ind]->policy == SCHED_FIFO) || (placed[ind]->policy == SCHED_RR)) {
+        int priority = sched_get_priority_max(placed[ind]->policy) - placed[ind]->priorityOffset;
+        lowestPriority = (priority < lowestPriority) ? priority : lowestPriority;
+      }
+    }
+    cpu_topology_spare(&topology, placed, numPlaced, &executorCpu);
+    char *pNext = NULL;
+    uint8_t cpusGiven = FALSE;
+    executorWorkers = strtol(executorSpec, &pNext, 10);
+    executorPriority = lowestPriority - 1;
+    if(*pNext == ',') {
+      executorPriority = strtol(pNext + 1, &pNext, 10);
+    }
+    if(*pNext == ',') {
+      cpusGiven = TRUE;
+      if((cpu_list_parse(pNext + 1, &executorCpu) != 0) || (CPU_COUNT(&executorCpu) == 0)) {
+        pNext = NULL;
+      }
+    }
+    if((pNext == NULL) || ((*pNext != ',') && (*pNext != '\0')) || (executorWorkers < 0) ||
+       (executorPriority < 1) || (executorPriority >= lowestPriority)) {
+      syslog(LOG_ERR, "invalid executor spec provided, priority must be 1 - %d", lowestPriority - 1);
+      cout  << "invalid '-x' executor spec provided\n\n";
+      usage();
+      registry_free(&registry);
+      return -1;
+    }
+    if(!cpusGiven && (CPU_COUNT(&executorCpu) == 0)) {
+      syslog(LOG_WARNING, "no CPU free of the services and helpers, no task executor");
+      cout  << "no CPU left for the task executor, proc runs its circle search itself\n";
+      executorSpec = NULL;
+    }
+  }
+
+  /* what is mapped now stays resident; frame storage, the metrics block and service stacks
+   * lock themselves */
+  if(rt_memory_lock() != 0) {
+    cout  << "couldn't lock memory (run as root or raise RLIMIT_MEMLOCK), services may page fault\n";
+  }
+  frameArena_t frameArena;
+  if(frame_arena_create(&frameArena, MAX_IMG_ROWS * MAX_IMG_COLS * 3, FRAME_ARENA_SLOTS, hugePages) != 0) {
+    cout  << "couldn't create the frame arena, frames come from the heap\n";
+  }
+  for(uint8_t ind = 0; ind < TOTAL_RT_THREADS; ++ind) {
+    threadParams[ind].pFrameArena = &frameArena;
+  }
+
+  /* live metrics (projectstat); the monitors and latency histograms live in the block */
+  if(metrics_create() == NULL) {
+    syslog(LOG_ERR, "couldn't allocate metrics");
+    registry_free(&registry);
+    return -1;
+  }
+  pMetrics->numServices = registry.numServices;
+  pMetrics->ringCapacity = CIRCULAR_BUFF_LEN;
+
+  /* job timing of each service; the runtime doubles as its execution time budget */
+  serviceMonitor_t *monitors = pMetrics->monitors;
+  for(uint8_t ind = 0; ind < registry.numServices; ++ind) {
+    serviceDef_t *pSvc = &registry.services[ind];
+    uint64_t periodNs = registry_period_ns(&registry, ind);
+    monitor_init(&monitors[ind], pSvc->name, (uint64_t)pSvc->runtimeUs * 1000,
+                 (pSvc->deadlineUs != 0) ? (uint64_t)pSvc->deadlineUs * 1000 : periodNs, monitorAction);
+    pSvc->pMonitor = &monitors[ind];
+  }
+  syslog(LOG_INFO, "monitor action: %d", monitorAction);
+
+  /* latency of each saved frame through every stage */
+  threadParams[Thread_e::WRITE_THREAD].pLatency = &pMetrics->latency;
+
+  /* check the schedule is feasible with the measured (or declared) WCETs */
+  uint64_t wcetNs[SERVICE_MAX];
+  rmResult_t rmResults[SERVICE_MAX];
+  memset(wcetNs, 0, sizeof(wcetNs));
+  if(wcetProfile != NULL) {
+    rm_load_wcet(&registry, wcetProfile, wcetNs);
+  }
+  int infeasibleCnt = rm_analyze(&registry, wcetNs, rmResults);
+  if(executorSpec != NULL) {
+    int delayedCnt = rm_analyze_executor(&registry, rmResults, &executorCpu, (int)executorPriority,
+                                         cpu_housekeeping_core());
+    infeasibleCnt += (delayedCnt > 0) ? delayedCnt : 0;
+  }
+  if(infeasibleCnt != 0) {
+    cout  << "RM analysis: " << infeasibleCnt << " service(s) can miss their deadline\n";
+    if(refuseInfeasible) {
+      syslog(LOG_ERR, "infeasible service schedule refused");
+      metrics_destroy();
+      registry_free(&registry);
+      return -1;
+    }
+  }
+
+  /*---------------------------------------*/
+  /* setup output retention */
+  /*---------------------------------------*/
+  /* always running: it also does the archive segment I/O; -b 0 only stops deletes */
+  retentionMgr_t retention;
+  memset(&retention, 0, sizeof(retentionMgr_t));
+  cpu_set_t retentionCpu;
+  CPU_ZERO(&retentionCpu);
+  CPU_SET(cpu_housekeeping_core(), &retentionCpu);
+  if(retention_start(&retention, ".", (uint64_t)budgetMB << 20, budgetFiles, (uint64_t)RETENTION_MIN_FREE_MB << 20,
+                     &retentionCpu) != 0) {
+    syslog(LOG_ERR, "couldn't start retention manager");
+    metrics_destroy();
+    return -1;
+  }
+  threadParams[Thread_e::WRITE_THREAD].pRetention = &retention;
+
+  /*---------------------------------------*/
+  /* setup task executor */
+  /*---------------------------------------*/
+  taskExecutor_t executor;
+  memset(&executor, 0, sizeof(taskExecutor_t));
+  if(executorSpec != NULL) {
+    if(executorWorkers == 0) {
+      executorWorkers = CPU_COUNT(&executorCpu);
+    }
+    if(task_executor_create(&executor, (unsigned int)executorWorkers, (int)executorPriority, &executorCpu) != 0) {
+      cout  << "couldn't start the task executor, running without it\n";
+    } else {
+      threadParams[Thread_e::PROC_THREAD].pExecutor = &executor;
+    }
+  }
+
+  /*---------------------------------------*/
+  /* setup still image encoder pool */
+  /*---------------------------------------*/
+  encoderPool_t encoderPool;
+  memset(&encoderPool, 0, sizeof(encoderPool_t));
+  if(stillCodec != EncodeCodec_e::ENCODE_CODEC_END) {
+    cpu_set_t encoderCpu;
+    CPU_ZERO(&encoderCpu);
+    CPU_SET(cpu_housekeeping_core(), &encoderCpu);
+    if(encoder_pool_create(&encoderPool, ENCODER_POOL_WORKERS, ENCODER_POOL_SLOTS, MAX_IMG_ROWS * MAX_IMG_COLS * 3,
+                           stillCodec, stillQuality, &encoderCpu, threadParams[Thread_e::WRITE_THREAD].pRetention) != 0) {
+      syslog(LOG_ERR, "couldn't create encoder pool");
+      task_executor_destroy(&executor);
+      retention_stop(&retention);
+      metrics_destroy();
+      return -1;
+    }
+    threadParams[Thread_e::WRITE_THREAD].pEncoderPool = &encoderPool;
+  }
+
+  /* optional text exposition of the metrics on a Unix socket */
+  if(metricsSocket != NULL) {
+    cpu_set_t metricsCpu;
+    CPU_ZERO(&metricsCpu);
+    CPU_SET(cpu_housekeeping_core(), &metricsCpu);
+    if(metrics_serve(metricsSocket, &metricsCpu) != 0) {
+      syslog(LOG_ERR, "couldn't serve metrics on %s", metricsSocket);
+    }
+  }
+
+#if defined(TRACE_OUTPUT)
+  /*---------------------------------------*/
+  /* setup binary trace */
+  /*---------------------------------------*/
+  cpu_set_t traceCpu;
+  CPU_ZERO(&traceCpu);
+  CPU_SET(cpu_housekeeping_core(), &traceCpu);
+  if(trace_start(TRACE_FILE_NAME, &traceCpu) != 0) {
+    syslog(LOG_ERR, "couldn't start trace, running without it");
+  }
+#endif
+
   /*---------------------------------------*/
   /* setup select message queue */
   /*---------------------------------------*/
@@ -198,6 +631,11 @@ int main(int argc, char *argv[])
   /*---------------------------------------*/
   circular_buffer<cv::Mat> imgBuff(CIRCULAR_BUFF_LEN);
   circular_cv_buffer imgBuff2(CIRCULAR_BUFF_LEN);
+  uint8_t *ringFrames[CIRCULAR_BUFF_LEN];
+  for(uint8_t ind = 0; ind < CIRCULAR_BUFF_LEN; ++ind) {
+    ringFrames[ind] = (uint8_t *)frame_arena_alloc(&frameArena, MAX_IMG_ROWS * MAX_IMG_COLS * 3);
+  }
+  imgBuff2.attach(ringFrames, MAX_IMG_ROWS, MAX_IMG_COLS, CV_8UC3);
   threadParams[Thread_e::DIFF_THREAD].pCBuff = &imgBuff;
   threadParams[Thread_e::ACQ_THREAD].pCBuff = &imgBuff;
   threadParams[Thread_e::DIFF_THREAD].pCBuffcv = &imgBuff2;
@@ -206,16 +644,9 @@ int main(int argc, char *argv[])
   /*---------------------------------------*/
   /* create synchronization mechanizisms */
   /*---------------------------------------*/
-  sem_t semas[TOTAL_RT_THREADS];
-  for(uint8_t ind = 0; ind < TOTAL_RT_THREADS; ++ind) {
-    if (sem_init(&semas[ind], 0, 0)) {
-      syslog(LOG_ERR, "couldn't create semaphore");
-      return -1;
-    }
-
-    /* Set sequencer threadid */
-    threadParams[Thread_e::WRITE_THREAD].pTidSeqThread = &threads[Thread_e::SEQ_THREAD];
-  }
+  /* Set sequencer threadid */
+  threadParams[Thread_e::WRITE_THREAD].pTidSeqThread = &threads[Thread_e::SEQ_THREAD];
+  threadParams[Thread_e::ACQ_THREAD].pTidSeqThread = &threads[Thread_e::SEQ_THREAD];
 
   pthread_mutex_t cb_mutex;
   pthread_mutex_init(&cb_mutex, NULL);
@@ -233,14 +664,9 @@ int main(int argc, char *argv[])
   /*---------------------------------------*/
   /* Setup CPU Affinity for threads */
   /*---------------------------------------*/
+  /* filled by set_attr_policy with the one CPU of each thread */
   cpu_set_t threadCpu;
 
-  /* Clear CPUs set */
-  CPU_ZERO(&threadCpu);
-  for (i = 0; i < NUM_CPU_CORES; i++) {
-    CPU_SET(i, &threadCpu);
-  }
-
   /*---------------------------------------*/
   /* create threads */
   /*---------------------------------------*/
@@ -249,42 +675,35 @@ int main(int argc, char *argv[])
   strcpy(threadParams[Thread_e::PROC_THREAD].writeQueueName, writeQueueName);
   strcpy(threadParams[Thread_e::WRITE_THREAD].writeQueueName, writeQueueName);
 
-  set_attr_policy(&thread_attr, &threadCpu, SCHED_FIFO, 2, 3);
-  threadParams[Thread_e::ACQ_THREAD].pSema = &semas[Thread_e::ACQ_THREAD];
-  if(pthread_create(&threads[Thread_e::ACQ_THREAD], &thread_attr, acquisitionTask, (void *)&threadParams[Thread_e::ACQ_THREAD]) != 0) {
-    syslog(LOG_ERR, "couldn't create thread#%d", Thread_e::ACQ_THREAD);
-  }
-
-  set_attr_policy(&thread_attr, &threadCpu, SCHED_FIFO, 3, 2);
-  threadParams[Thread_e::DIFF_THREAD].pSema = &semas[Thread_e::DIFF_THREAD];
-  if(pthread_create(&threads[Thread_e::DIFF_THREAD], &thread_attr, differenceTask, (void *)&threadParams[Thread_e::DIFF_THREAD]) != 0) {
-    syslog(LOG_ERR, "couldn't create thread#%d", Thread_e::DIFF_THREAD);
-  }
-
-  set_attr_policy(&thread_attr, &threadCpu, SCHED_FIFO, 4, 2);
-  threadParams[Thread_e::PROC_THREAD].pSema = &semas[Thread_e::PROC_THREAD];
-  if(pthread_create(&threads[Thread_e::PROC_THREAD], &thread_attr, processingTask, (void *)&threadParams[Thread_e::PROC_THREAD]) != 0) {
-    syslog(LOG_ERR, "couldn't create thread#%d", Thread_e::PROC_THREAD);
-  }
-
-  set_attr_policy(&thread_attr, &threadCpu, SCHED_RR, 5, 1);
-  threadParams[Thread_e::WRITE_THREAD].pSema = &semas[Thread_e::WRITE_THREAD];
-  if(pthread_create(&threads[Thread_e::WRITE_THREAD], &thread_attr, writeTask, (void *)&threadParams[Thread_e::WRITE_THREAD]) != 0) {
-    syslog(LOG_ERR, "couldn't create thread#%d", Thread_e::WRITE_THREAD);
+  throughputRun_t throughputRun;
+  throughput_start(&throughputRun);
+
+  deadlineParams_t deadline;
+  for(uint8_t ind = 0; ind < registry.numServices; ++ind) {
+    const serviceDef_t *pSvc = &registry.services[ind];
+    set_attr_policy(&thread_attr, &threadCpu, pSvc->policy, pSvc->priorityOffset, pSvc->cpuCore);
+    ((threadParams_t *)pSvc->pArg)->releaseFd = pSvc->releaseFd;
+    ((threadParams_t *)pSvc->pArg)->shutdownFd = pSvc->shutdownFd;
+    ((threadParams_t *)pSvc->pArg)->pMonitor = pSvc->pMonitor;
+    deadline.periodNs = registry_period_ns(&registry, ind);
+    deadline.deadlineNs = (pSvc->deadlineUs != 0) ? (uint64_t)pSvc->deadlineUs * 1000 : deadline.periodNs;
+    deadline.runtimeNs = (uint64_t)pSvc->runtimeUs * 1000;
+    if(create_service(&threads[ind], &thread_attr, pSvc, &deadline, &useDeadline, threads, registry.services, ind) != 0) {
+      syslog(LOG_ERR, "couldn't create thread#%d (%s)", ind, pSvc->name);
+    }
   }
 
-  set_attr_policy(&thread_attr, &threadCpu, SCHED_FIFO, 1, 4);
-  seqThreadParams.pAcqSema       = &semas[Thread_e::ACQ_THREAD];
-  seqThreadParams.pDiffSema      = &semas[Thread_e::DIFF_THREAD];
-  seqThreadParams.pProcSema      = &semas[Thread_e::PROC_THREAD];
-  seqThreadParams.pWriteSema     = &semas[Thread_e::WRITE_THREAD];
-  seqThreadParams.tidAcqThread   = threads[Thread_e::ACQ_THREAD];
-  seqThreadParams.tidDiffThread  = threads[Thread_e::DIFF_THREAD];
-  seqThreadParams.tidProcThread  = threads[Thread_e::PROC_THREAD];
-  seqThreadParams.tidWriteThread = threads[Thread_e::WRITE_THREAD];
-  if(pthread_create(&threads[SEQ_THREAD], &thread_attr, sequencerTask, (void *)&seqThreadParams) != 0) {
+  /* the sequencer gets a small budget every base rate tick so deadline services can't starve it */
+  set_attr_policy(&thread_attr, &threadCpu, seqService.policy, seqService.priorityOffset, seqService.cpuCore);
+  seqThreadParams.pRegistry      = &registry;
+  deadline.periodNs = 1000000000ULL / seqThreadParams.baseRateHz;
+  deadline.deadlineNs = deadline.periodNs;
+  deadline.runtimeNs = (uint64_t)seqService.runtimeUs * 1000;
+  if(create_service(&threads[SEQ_THREAD], &thread_attr, &seqService, &deadline, &useDeadline, threads,
+                    registry.services, registry.numServices) != 0) {
     syslog(LOG_ERR, "couldn't create thread#%d", Thread_e::SEQ_THREAD);
   }
+  syslog(LOG_INFO, "%s services running under %s", __func__, useDeadline ? "SCHED_DEADLINE" : "SCHED_FIFO/SCHED_RR");
 
   /*----------------------------------------------*/
   /* exiting */
@@ -293,6 +712,53 @@ int main(int argc, char *argv[])
   for(uint8_t ind = 0; ind < TOTAL_THREADS; ++ind) {
     pthread_join(threads[ind], NULL);
   }
+  uint64_t shutdownNs = pMetrics->shutdownNs;
+  struct timespec timeNow;
+
+  /* frames the drain didn't get through (e.g. write stopped at MAX_FRAME_COUNT) */
+  unsigned int leftFrames = free_queued_frames(selectQueue, &frameArena) + free_queued_frames(writeQueue, &frameArena);
+  if(leftFrames != 0) {
+    syslog(LOG_INFO, "%s freed %u frames left in the queues", __func__, leftFrames);
+  }
+
+  for(uint8_t ind = 0; ind < registry.numServices; ++ind) {
+    monitor_report(&monitors[ind]);
+  }
+  latency_report(&pMetrics->latency, "final");
+
+  /* frames each stage handled, by service index */
+  if(freeRun || ((threadParams[Thread_e::ACQ_THREAD].replayPath != NULL) && !virtualClock)) {
+    const uint64_t stageFrames[TOTAL_RT_THREADS] = {pMetrics->framesAcquired, pMetrics->framesDiffed,
+                                                    pMetrics->selectReceived, pMetrics->framesSaved};
+    uint64_t endNs = (pMetrics->replayDoneNs != 0) ? pMetrics->replayDoneNs : monitor_now_ns();
+    throughput_report(&throughputRun, pMetrics, stageFrames, pMetrics->framesAcquired, endNs);
+  }
+  if(wcetProfile != NULL) {
+    rm_save_wcet(&registry, wcetProfile, wcetNs);
+  }
+#if defined(TRACE_OUTPUT)
+  trace_stop();
+#endif
+
+  /* finish any stills still waiting to be encoded */
+  encoder_pool_destroy(&encoderPool);
+  task_executor_destroy(&executor);
+  retention_stop(&retention);
+  metrics_destroy();
+  registry_free(&registry);
+  frame_arena_report(&frameArena);
+  for(uint8_t ind = 0; ind < CIRCULAR_BUFF_LEN; ++ind) {
+    frame_arena_free(&frameArena, ringFrames[ind]);
+  }
+  frame_arena_destroy(&frameArena);
+
+  /* shutdown request to every thread joined and every pool freed */
+  if(shutdownNs != 0) {
+    clock_gettime(CLOCK_MONOTONIC, &timeNow);
+    double shutdownMs = ((((uint64_t)timeNow.tv_sec * 1000000000ULL) + timeNow.tv_nsec) - shutdownNs) / 1e6;
+    syslog(LOG_INFO, "%s shutdown took %.1f ms", __func__, shutdownMs);
+    cout  << "shutdown took " << shutdownMs << " ms\n";
+  }
 syslog(LOG_INFO, "%s (tid = %lu) exiting at: %f", __func__, pthread_self(),  TIMESPEC_TO_MSEC(startTime));
   syslog(LOG_INFO, "...");
   syslog(LOG_INFO, "..");
@@ -300,7 +766,8 @@ syslog(LOG_INFO, "%s (tid = %lu) exiting at: %f", __func__, pthread_self(),  TIM
   closelog();
 
   for(uint8_t ind = 0; ind < TOTAL_RT_THREADS; ++ind) {
-      sem_destroy(&semas[ind]);
+      close(releaseFds[ind]);
+      close(shutdownFds[ind]);
   }
   pthread_attr_destroy(&thread_attr);
   mq_unlink(selectQueueName);
@@ -311,9 +778,42 @@ syslog(LOG_INFO, "%s (tid = %lu) exiting at: %f", __func__, pthread_self(),  TIM
 
 void usage(void) 
 {
-  cout  << "Usage: sudo ./project [hough_enable] [filter_enable] [save_type]\n"
+  cout  << "Usage: sudo ./project [hough_enable] [filter_enable] [save_type] [options]\n"
+        << "  -c codec    save stills as ppm, pgm, png or jpg via the encoder pool (default: frame archive)\n"
+        << "  -q quality  jpg quality 0-100 (default: " << ENCODER_DEFAULT_QUALITY << ")\n"
+        << "  -z          delta compress the frame archive (keyframe + changed tiles)\n"
+        << "  -b MB       disk budget for outputs, oldest deleted first, 0 to keep all (default: " << RETENTION_BUDGET_MB << ")\n"
+        << "  -n files    file budget for outputs (default: " << RETENTION_MAX_FILES << ")\n"
+        << "  -r Hz       sequencer base rate (default: " << SEQ_DEFAULT_RATE_HZ << ")\n"
+        << "  -s mode     sequencer timer: nanosleep, timerfd or sigalrm (default: nanosleep)\n"
+        << "  -f file     service schedule config, one '-S' spec per line\n"
+        << "  -S spec     service schedule: name=rate[,phase[,prio_offset[,core[,runtime_us[,deadline_us]]]]]\n"
+        << "              services: acq (24 Hz), diff (2 Hz), proc (1 Hz), write (1 Hz)\n"
+        << "              cores are placed from the CPU topology (isolcpus / cpuset aware) unless given\n"
+        << "  -D          run services under SCHED_DEADLINE (falls back to FIFO if refused)\n"
+        << "  -m action   on a deadline miss / budget overrun: count, log or skip the next job (default: count)\n"
+        << "  -w file     WCET profile: measured WCETs used by the RM analysis, updated at exit\n"
+        << "  -F          refuse to start if the RM analysis finds the schedule infeasible (default: warn)\n"
+        << "  -e          event driven: acquisition is periodic, each later stage is woken when data is ready\n"
+        << "  -u path     serve live metrics as text on a Unix socket (also readable with ./projectstat)\n"
+        << "  -P          count cycles, instructions, cache / branch misses and context switches of each job\n"
+        << "  -p file     replay a recording (video file or image sequence, e.g. img%04d.ppm) instead of the camera\n"
+        << "  -R          free run the replay: no sequencer releases, stages block instead of dropping,\n"
+        << "              per-stage throughput and core utilisation reported at the end\n"
+        << "  -V          replay on a virtual clock: time advances as soon as the released jobs finish,\n"
+        << "              same releases and frame selection as real time, in a fraction of the time\n"
+        << "  -H          back the locked frame storage with hugepages (/proc/sys/vm/nr_hugepages)\n"
+        << "  -x spec     work-stealing executor for proc's Hough circle search: workers[,priority[,cpus]],\n"
+        << "              0 workers = one per CPU, SCHED_FIFO priority below every service (default: just\n"
+        << "              below the lowest), cpus e.g. 2-3 (default: the CPUs no service or helper uses)\n"
         << "sudo ./project on on 0\n"
-        << "sudo ./project off off 1\n";
+        << "sudo ./project off off 1\n"
+        << "sudo ./project on on 0 -c jpg -q 80\n"
+        << "sudo ./project on on 1 -z\n"
+        << "sudo ./project on on 0 -S proc=10 -S write=10\n"
+        << "sudo ./project on on 0 -p capture.avi -R\n"
+        << "sudo ./project on on 0 -p capture.avi -V\n"
+        << "sudo ./project on on 0 -x 0,10\n";
 }
 
 void print_scheduler(void)
@@ -363,9 +863,11 @@ int set_attr_policy(pthread_attr_t *attr, cpu_set_t *cpuSet, int policy, uint8_t
   rtnCode |= pthread_attr_init(attr);
   rtnCode |= pthread_attr_setinheritsched(attr, PTHREAD_EXPLICIT_SCHED);
   rtnCode |= pthread_attr_setschedpolicy(attr, policy);
+  rtnCode |= pthread_attr_setstacksize(attr, RT_STACK_SIZE);
 
   param.sched_priority = sched_get_priority_max(policy) - priorityOffset;
 
+  CPU_ZERO(cpuSet);
   CPU_SET(cpuCore, cpuSet);
   rtnCode |= pthread_attr_setaffinity_np(attr, sizeof(cpu_set_t), cpuSet);
 
@@ -377,6 +879,45 @@ int set_attr_policy(pthread_attr_t *attr, cpu_set_t *cpuSet, int policy, uint8_t
   return 0;
 }
 
+/*
+ * Create a service thread, under SCHED_DEADLINE while *pUseDeadline is set. If the
+ * kernel refuses the deadline parameters (not supported, no privileges or admission
+ * control) the new thread keeps attr's policy, the services already started are put
+ * back on their FIFO/RR layout and *pUseDeadline is cleared for the rest.
+ */
+int create_service(pthread_t *pThread, pthread_attr_t *attr, const serviceDef_t *pSvc, const deadlineParams_t *pDeadline,
+                   uint8_t *pUseDeadline, pthread_t *pStarted, const serviceDef_t *pStartedDefs, unsigned int numStarted)
+{
+  struct sched_param param;
+
+  if(!*pUseDeadline) {
+    return (pthread_create(pThread, attr, pSvc->pEntry, pSvc->pArg) == 0) ? 0 : -1;
+  }
+
+  int rtnCode = deadline_thread_create(pThread, attr, pSvc->pEntry, pSvc->pArg, pDeadline);
+  if(rtnCode == 1) {
+    syslog(LOG_WARNING, "%s %s refused SCHED_DEADLINE, falling back to SCHED_FIFO/SCHED_RR", __func__, pSvc->name);
+    printf("SCHED_DEADLINE refused for %s, using SCHED_FIFO/SCHED_RR\n", pSvc->name);
+    *pUseDeadline = FALSE;
+    for(unsigned int ind = 0; ind < numStarted; ++ind) {
+      param.sched_priority = sched_get_priority_max(pStartedDefs[ind].policy) - pStartedDefs[ind].priorityOffset;
+      if(pthread_setschedparam(pStarted[ind], pStartedDefs[ind].policy, &param) != 0) {
+        syslog(LOG_ERR, "%s couldn't restore %s policy", __func__, pStartedDefs[ind].name);
+      }
+
+      /* deadline threads had widened their affinity; pin them again */
+      cpu_set_t cpuSet;
+      CPU_ZERO(&cpuSet);
+      CPU_SET(pStartedDefs[ind].cpuCore, &cpuSet);
+      if(pthread_setaffinity_np(pStarted[ind], sizeof(cpu_set_t), &cpuSet) != 0) {
+        syslog(LOG_ERR, "%s couldn't restore %s core", __func__, pStartedDefs[ind].name);
+      }
+    }
+    rtnCode = 0;
+  }
+  return rtnCode;
+}
+
 int set_main_policy(int policy, uint8_t priorityOffset)
 {
   int rtnCode;
@@ -403,4 +944,21 @@ int set_main_policy(int policy, uint8_t priorityOffset)
     return -1;
   }
   return 0;
-}
\ No newline at end of file
+}
+
+/*
+ * Receive whatever is still queued (without blocking) and give the pixel buffers back.
+ */
+unsigned int free_queued_frames(mqd_t queue, frameArena_t *pArena)
+{
+  imgDef_t frame;
+  struct timespec expired;
+  unsigned int cnt = 0;
+
+  clock_gettime(SEMA_CLOCK_TYPE, &expired);
+  while(mq_timedreceive(queue, (char *)&frame, sizeof(imgDef_t), NULL, &expired) == (ssize_t)sizeof(imgDef_t)) {
+    frame_arena_free(pArena, frame.data);
+    ++cnt;
+  }
+  return cnt;
+}
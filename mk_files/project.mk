@@ -17,6 +17,48 @@ SRCS += main/project.c \
 				src/frameDifference.c \
 				src/frameProcessing.c \
 				src/frameWrite.c \
+				src/frameArchive.c \
+				src/archiveWriter.c \
+				src/deltaCodec.c \
+				src/encoderPool.c \
+				src/taskExecutor.c \
+				src/frameOverlay.c \
+				src/videoEncoder.c \
+				src/retention.c \
+				src/serviceRegistry.c \
+				src/deadlineSched.c \
+				src/cpuTopology.c \
+				src/serviceMonitor.c \
+				src/perfCounters.c \
+				src/rmAnalysis.c \
+				src/serviceRuntime.c \
+				src/clockSource.c \
+				src/rtMemory.c \
+				src/traceRing.c \
+				src/frameLatency.c \
+				src/metrics.c \
+				src/throughput.c \
 				src/sequencer.c
 
+# host tools (no OpenCV / RT dependencies)
+ARCHIVE_READER_SRCS += tools/archiveReader.c \
+				src/frameArchive.c \
+				src/deltaCodec.c
+
+TRACE_ANALYZER_SRCS += tools/traceAnalyzer.c \
+				src/frameLatency.c
+
+PROJECTSTAT_SRCS += tools/projectstat.c \
+				src/metrics.c \
+				src/perfCounters.c \
+				src/frameLatency.c
+
+TOOLS = archiveReader traceAnalyzer projectstat
+
+# stage benchmark (OpenCV), runs the pipeline sources outside of main
+STAGE_BENCH_SRCS += tools/stageBench.c \
+				$(filter-out main/project.c,$(SRCS))
+
+BENCH = stageBench
+
 PLATFORM = UBUNTU
\ No newline at end of file
@@ -7,26 +7,16 @@ if [ $# -eq 0 ]
 fi
 
 
-mkdir $1
-cat /var/log/syslog | grep "project\[$1\]" > $1/syslog_$1.txt
-
-cat $1/syslog_$1.txt | grep "sequencer cycle start" > $1/sequencer_start_$1.txt &
-cat $1/syslog_$1.txt | grep "sequencer" > $1/sequencer_ACET_$1.txt &
-cat $1/syslog_$1.txt | grep "sequencer cycle done" > $1/sequencer_finish_$1.txt &
-
-cat $1/syslog_$1.txt | grep "acquisitionTask frame process start" > $1/acqThread_start_$1.txt &
-cat $1/syslog_$1.txt | grep "acquisitionTask frame" > $1/acqThread_ACET_$1.txt &
-cat $1/syslog_$1.txt | grep "acquisitionTask frame inserted" > $1/acqThread_finish_$1.txt &
-
-cat $1/syslog_$1.txt | grep "differenceTask frame process start" > $1/diffThread_start_$1.txt &
-cat $1/syslog_$1.txt | grep "differenceTask frame" > $1/diffThread__ACET_$1.txt &
-cat $1/syslog_$1.txt | grep "differenceTask frame #" > $1/diffThread__finish_$1.txt &
-cat $1/syslog_$1.txt | grep "differenceTask countNonZero" > $1/diffThread__pixeldiff_$1.txt &
-
-cat $1/syslog_$1.txt | grep "processingTask frame process start" > $1/procThread_start_$1.txt &
-cat $1/syslog_$1.txt | grep "processingTask frame" > $1/procThread_ACET_$1.txt &
-cat $1/syslog_$1.txt | grep "processingTask frame #" > $1/procThread_finish_$1.txt &
-
-cat $1/syslog_$1.txt | grep "writeTask frame process start" > $1/writeThread_start_$1.txt &
-cat $1/syslog_$1.txt | grep "writeTask frame" > $1/writeThread_ACET_$1.txt &
-cat $1/syslog_$1.txt | grep "writeTask frame #" > $1/writeThread_finish_$1.txt &
+mkdir -p $1
+grep "project\[$1\]" /var/log/syslog > $1/syslog_$1.txt
+
+# end of run summaries logged by the services
+grep -E "sequencerTask jitter|monitor_report|latency_report" $1/syslog_$1.txt > $1/summary_$1.txt
+
+# per job / per frame timing from the binary trace (TRACE_OUTPUT)
+if [ -f ../project.trace ]
+  then
+    ../traceAnalyzer -o $1/trace_$1.csv ../project.trace > $1/trace_summary_$1.txt
+  else
+    echo "No ../project.trace, only the syslog summaries were extracted."
+fi
@@ -0,0 +1,41 @@
+#!/bin/bash
+
+# Replay a recording with the services under SCHED_DEADLINE (-D) and check that
+# write could still start its video encoder thread and the video was written.
+# Run as root from the scripts directory after 'make build'.
+
+if [ $# -eq 0 ]
+  then
+    echo "Need a recording to replay, e.g. ./testDeadlineVideo.sh capture.avi"
+    exit -1
+fi
+
+cd ..
+touch /tmp/testDeadlineVideo.start
+
+./project off off 0 -p $1 -D > /tmp/testDeadlineVideo.out 2>&1 &
+PID=$!
+wait $PID
+sleep 1
+
+grep "project\[$PID\]" /var/log/syslog > /tmp/testDeadlineVideo.syslog
+
+if grep -q "SCHED_DEADLINE refused" /tmp/testDeadlineVideo.syslog
+  then
+    echo "FAIL: SCHED_DEADLINE was refused, the services ran under FIFO"
+    exit 1
+fi
+if grep -q "failed to start video encoder" /tmp/testDeadlineVideo.out || \
+   grep -q "couldn't create video thread" /tmp/testDeadlineVideo.syslog
+  then
+    echo "FAIL: the video encoder didn't start under SCHED_DEADLINE"
+    exit 1
+fi
+if [ -z "$(find . -maxdepth 1 -name 'video_*.avi' -newer /tmp/testDeadlineVideo.start)" ]
+  then
+    echo "FAIL: no video written"
+    exit 1
+fi
+
+echo "PASS: video encoder started under SCHED_DEADLINE (pid $PID)"
+exit 0
@@ -0,0 +1,327 @@
+/***********************************************************************************
+ * @author Brian Ibeling
+ * ibelingb@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file archiveWriter.c
+ * @brief frame archive thread with rolling segments (see archiveWriter.h)
+ *
+ ************************************************************************************
+ */
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdint.h>
+#include <syslog.h>
+#include <time.h>
+
+/* project headers */
+#include "archiveWriter.h"
+
+/*---------------------------------------------------------------------------------*/
+/* PRIVATE FUNCTIONS */
+static void *archive_worker(void *arg);
+static int archive_writer_open_segment(archiveWriter_t *pWriter);
+static void archive_writer_free(archiveWriter_t *pWriter);
+
+/*---------------------------------------------------------------------------------*/
+int archive_writer_start(archiveWriter_t *pWriter, const char *prefix, size_t slotLen, size_t hintLen,
+                         uint32_t segmentFrames, uint8_t useDelta, const cpu_set_t *pCpuSet,
+                         retentionMgr_t *pRetention)
+{
+  if((pWriter == NULL) || (prefix == NULL) || (slotLen == 0) || (segmentFrames == 0)) {
+    return -1;
+  }
+  memset(pWriter, 0, sizeof(archiveWriter_t));
+  strncpy(pWriter->prefix, prefix, sizeof(pWriter->prefix) - 1);
+  pWriter->slotLen = slotLen;
+  pWriter->hintLen = hintLen;
+  pWriter->segmentFrames = segmentFrames;
+  pWriter->segmentCap = archive_capacity_for(segmentFrames, slotLen);
+  pWriter->pRetention = pRetention;
+
+  /* allocate all frame buffers now so nothing is allocated on the write path */
+  pWriter->pSlots = (archiveFrame_t *)calloc(ARCHIVE_QUEUE_LEN, sizeof(archiveFrame_t));
+  pWriter->pFreeStack = (unsigned int *)calloc(ARCHIVE_QUEUE_LEN, sizeof(unsigned int));
+  pWriter->pPending = (unsigned int *)calloc(ARCHIVE_QUEUE_LEN, sizeof(unsigned int));
+  if((pWriter->pSlots == NULL) || (pWriter->pFreeStack == NULL) || (pWriter->pPending == NULL)) {
+    syslog(LOG_ERR, "%s couldn't allocate queue", __func__);
+    archive_writer_free(pWriter);
+    return -1;
+  }
+  for(unsigned int ind = 0; ind < ARCHIVE_QUEUE_LEN; ++ind) {
+    pWriter->pSlots[ind].pData = (uint8_t *)malloc(slotLen);
+    pWriter->pSlots[ind].pHint = (hintLen != 0) ? (uint8_t *)malloc(hintLen) : NULL;
+    if((pWriter->pSlots[ind].pData == NULL) || ((hintLen != 0) && (pWriter->pSlots[ind].pHint == NULL))) {
+      syslog(LOG_ERR, "%s couldn't allocate slot #%u", __func__, ind);
+      archive_writer_free(pWriter);
+      return -1;
+    }
+    memset(pWriter->pSlots[ind].pData, 0, slotLen);
+    if(hintLen != 0) {
+      memset(pWriter->pSlots[ind].pHint, 0, hintLen);
+    }
+    pWriter->pFreeStack[pWriter->freeCnt++] = ind;
+  }
+
+  /* keyframe + residual compression of archived frames */
+  if(useDelta) {
+    if(delta_encoder_init(&pWriter->deltaEnc, slotLen, DELTA_KEYFRAME_INTERVAL) == 0) {
+      pWriter->useDelta = 1;
+    } else {
+      syslog(LOG_ERR, "%s couldn't initialize delta encoder, archiving raw frames", __func__);
+    }
+  }
+
+  /* the first segment is created here so the caller can fall back if it fails */
+  if(archive_writer_open_segment(pWriter) != 0) {
+    syslog(LOG_ERR, "%s couldn't create the first segment", __func__);
+    archive_writer_free(pWriter);
+    return -1;
+  }
+
+  pthread_mutex_init(&pWriter->mutex, NULL);
+  pthread_cond_init(&pWriter->workCond, NULL);
+  pWriter->running = 1;
+
+  /* archive at SCHED_OTHER so only idle time is used */
+  pthread_attr_t attr;
+  struct sched_param param;
+  memset(&param, 0, sizeof(param));
+  pthread_attr_init(&attr);
+  pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+  pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+  pthread_attr_setschedparam(&attr, &param);
+  if(pCpuSet != NULL) {
+    pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), pCpuSet);
+  }
+  int rtn = pthread_create(&pWriter->thread, &attr, archive_worker, (void *)pWriter);
+  pthread_attr_destroy(&attr);
+  if(rtn != 0) {
+    syslog(LOG_ERR, "%s couldn't create archive thread", __func__);
+    char filename[96];
+    snprintf(filename, sizeof(filename), "%s_%03u.farc", pWriter->prefix, pWriter->segment + 1);
+    retention_cancel_segment(pWriter->pRetention, filename);
+    pthread_mutex_destroy(&pWriter->mutex);
+    pthread_cond_destroy(&pWriter->workCond);
+    archive_writer_free(pWriter);
+    return -1;
+  }
+  pWriter->started = 1;
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+int archive_writer_submit(archiveWriter_t *pWriter, const archiveIndexEntry_t *pEntry, const uint8_t *pData,
+                          int elemSize, const uint8_t *pHint)
+{
+  if((pWriter == NULL) || !pWriter->started || (pEntry == NULL) || (pData == NULL)) {
+    return -1;
+  }
+  size_t len = (size_t)pEntry->rows * pEntry->cols * elemSize;
+  if(len > pWriter->slotLen) {
+    return -1;
+  }
+
+  pthread_mutex_lock(&pWriter->mutex);
+  if(pWriter->freeCnt == 0) {
+    ++pWriter->droppedCnt;
+    pthread_mutex_unlock(&pWriter->mutex);
+    return -1;
+  }
+  unsigned int idx = pWriter->pFreeStack[--pWriter->freeCnt];
+  pthread_mutex_unlock(&pWriter->mutex);
+
+  /* slot is ours until it is queued, copy outside the lock */
+  archiveFrame_t *pFrame = &pWriter->pSlots[idx];
+  memcpy(pFrame->pData, pData, len);
+  pFrame->hasHint = (pHint != NULL) && (pWriter->hintLen != 0);
+  if(pFrame->hasHint) {
+    memcpy(pFrame->pHint, pHint, pWriter->hintLen);
+  }
+  pFrame->elemSize = elemSize;
+  pFrame->entry = *pEntry;
+
+  pthread_mutex_lock(&pWriter->mutex);
+  pWriter->pPending[(pWriter->pendingHead + pWriter->pendingCnt) % ARCHIVE_QUEUE_LEN] = idx;
+  ++pWriter->pendingCnt;
+  pthread_cond_signal(&pWriter->workCond);
+  pthread_mutex_unlock(&pWriter->mutex);
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+void archive_writer_stop(archiveWriter_t *pWriter)
+{
+  char filename[96];
+
+  if((pWriter == NULL) || !pWriter->started) {
+    return;
+  }
+
+  pthread_mutex_lock(&pWriter->mutex);
+  pWriter->running = 0;
+  pthread_cond_broadcast(&pWriter->workCond);
+  pthread_mutex_unlock(&pWriter->mutex);
+  pthread_join(pWriter->thread, NULL);
+
+  /* retire the last segment and drop the one prepared after it */
+  unsigned int unused = pWriter->segment;
+  if(pWriter->segmentOpen) {
+    snprintf(filename, sizeof(filename), "%s_%03u.farc", pWriter->prefix, pWriter->segment);
+    retention_retire_segment(pWriter->pRetention, &pWriter->archive, filename);
+    pWriter->segmentOpen = 0;
+    ++unused;
+  }
+  snprintf(filename, sizeof(filename), "%s_%03u.farc", pWriter->prefix, unused);
+  retention_cancel_segment(pWriter->pRetention, filename);
+
+  syslog(LOG_INFO, "%s segments: %u, frames: %lu, failed: %lu, dropped (queue full): %lu", __func__,
+         pWriter->segment + 1, pWriter->archivedCnt, pWriter->failedCnt, pWriter->droppedCnt);
+  if(pWriter->useDelta) {
+    syslog(LOG_INFO, "%s delta archive: %llu raw bytes coded to %llu (%.1f:1)", __func__, pWriter->deltaEnc.rawBytes,
+           pWriter->deltaEnc.codedBytes,
+           (pWriter->deltaEnc.codedBytes != 0) ? ((double)pWriter->deltaEnc.rawBytes / pWriter->deltaEnc.codedBytes) : 0.0);
+  }
+  pthread_mutex_destroy(&pWriter->mutex);
+  pthread_cond_destroy(&pWriter->workCond);
+  archive_writer_free(pWriter);
+}
+
+/*---------------------------------------------------------------------------------*/
+static void archive_writer_free(archiveWriter_t *pWriter)
+{
+  if(pWriter->segmentOpen) {
+    archive_close(&pWriter->archive);
+  }
+  if(pWriter->useDelta) {
+    delta_encoder_free(&pWriter->deltaEnc);
+  }
+  if(pWriter->pSlots != NULL) {
+    for(unsigned int ind = 0; ind < ARCHIVE_QUEUE_LEN; ++ind) {
+      free(pWriter->pSlots[ind].pData);
+      free(pWriter->pSlots[ind].pHint);
+    }
+  }
+  free(pWriter->pSlots);
+  free(pWriter->pFreeStack);
+  free(pWriter->pPending);
+  memset(pWriter, 0, sizeof(archiveWriter_t));
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * Take the segment the retention thread prepared, else create it here (the first
+ * one, or if the thread couldn't); then have the thread prepare the one after.
+ * @return 0 on success, 1 if the thread is still creating it, -1 on error
+ */
+static int archive_writer_open_segment(archiveWriter_t *pWriter)
+{
+  char filename[96];
+
+  snprintf(filename, sizeof(filename), "%s_%03u.farc", pWriter->prefix, pWriter->segment);
+  int rtn = retention_take_segment(pWriter->pRetention, filename, &pWriter->archive);
+  if(rtn == 1) {
+    return 1;
+  }
+  if(rtn != 0) {
+    if(pWriter->segment != 0) {
+      syslog(LOG_WARNING, "%s segment #%u wasn't prepared, creating it in the archive thread", __func__, pWriter->segment);
+    }
+    retention_claim(pWriter->pRetention, filename);
+    if(archive_create(&pWriter->archive, filename, pWriter->segmentFrames, pWriter->segmentCap) != 0) {
+      return -1;
+    }
+  }
+  pWriter->segmentOpen = 1;
+
+  snprintf(filename, sizeof(filename), "%s_%03u.farc", pWriter->prefix, pWriter->segment + 1);
+  retention_prepare_segment(pWriter->pRetention, filename, pWriter->segmentFrames, pWriter->segmentCap);
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+static void *archive_worker(void *arg)
+{
+  archiveWriter_t *pWriter = (archiveWriter_t *)arg;
+  char filename[96];
+  const struct timespec prepareWait = {0, ARCHIVE_PREPARE_WAIT_MS * 1000000L};
+
+  while(1) {
+    pthread_mutex_lock(&pWriter->mutex);
+    while((pWriter->pendingCnt == 0) && pWriter->running) {
+      pthread_cond_wait(&pWriter->workCond, &pWriter->mutex);
+    }
+    if(pWriter->pendingCnt == 0) {
+      /* stopping and queue drained */
+      pthread_mutex_unlock(&pWriter->mutex);
+      break;
+    }
+    unsigned int idx = pWriter->pPending[pWriter->pendingHead];
+    pWriter->pendingHead = (pWriter->pendingHead + 1) % ARCHIVE_QUEUE_LEN;
+    --pWriter->pendingCnt;
+    pthread_mutex_unlock(&pWriter->mutex);
+    archiveFrame_t *pFrame = &pWriter->pSlots[idx];
+
+    /* a full segment is synced and closed by the retention thread, which normally
+     * has the next one mapped already; if not, wait here instead of in write */
+    if(pWriter->segmentOpen && (archive_frame_count(&pWriter->archive) >= pWriter->segmentFrames)) {
+      snprintf(filename, sizeof(filename), "%s_%03u.farc", pWriter->prefix, pWriter->segment);
+      retention_retire_segment(pWriter->pRetention, &pWriter->archive, filename);
+      pWriter->segmentOpen = 0;
+      ++pWriter->segment;
+      int rtn;
+      while((rtn = archive_writer_open_segment(pWriter)) == 1) {
+        nanosleep(&prepareWait, NULL);
+      }
+      if(rtn < 0) {
+        syslog(LOG_ERR, "%s couldn't start archive segment #%u, frames are not archived", __func__, pWriter->segment);
+      } else if(pWriter->useDelta) {
+        /* residuals must reference a keyframe in the same segment */
+        delta_encoder_force_key(&pWriter->deltaEnc);
+      }
+    }
+
+    if(!pWriter->segmentOpen) {
+      ++pWriter->failedCnt;
+    } else {
+      const uint8_t *pPayload = pFrame->pData;
+      uint32_t payloadLen = (uint32_t)pFrame->entry.rows * pFrame->entry.cols * pFrame->elemSize;
+      pFrame->entry.codec = ArchiveCodec_e::ARCHIVE_CODEC_RAW;
+      if(pWriter->useDelta) {
+        int codec = delta_encode(&pWriter->deltaEnc, pFrame->entry.frameNum, pFrame->pData, pFrame->entry.rows,
+                                 pFrame->entry.cols, pFrame->elemSize, pFrame->hasHint ? pFrame->pHint : NULL,
+                                 &pPayload, &payloadLen);
+        if(codec < 0) {
+          syslog(LOG_ERR, "%s delta encode failed for frame #%u, archiving raw", __func__, pFrame->entry.frameNum);
+          pPayload = pFrame->pData;
+          payloadLen = (uint32_t)pFrame->entry.rows * pFrame->entry.cols * pFrame->elemSize;
+        } else {
+          pFrame->entry.codec = (uint8_t)codec;
+        }
+      }
+      if(archive_append(&pWriter->archive, &pFrame->entry, pPayload, payloadLen) == 0) {
+        ++pWriter->archivedCnt;
+      } else {
+        ++pWriter->failedCnt;
+      }
+    }
+
+    /* give the slot back */
+    pthread_mutex_lock(&pWriter->mutex);
+    pWriter->pFreeStack[pWriter->freeCnt++] = idx;
+    pthread_mutex_unlock(&pWriter->mutex);
+  }
+
+  return NULL;
+}
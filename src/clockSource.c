@@ -0,0 +1,217 @@
+/***********************************************************************************
+ * @author Brian Ibeling
+ * ibelingb@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file clockSource.c
+ * @brief real / virtual time source (see clockSource.h)
+ *
+ ************************************************************************************
+ */
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <syslog.h>
+#include <pthread.h>
+
+/* project headers */
+#include "clockSource.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define NSEC_PER_SEC                  (1000000000ULL)
+#define IDLE_POLL_MS                  (10)    /* re-check the run flag while waiting */
+#define CS_LOAD(field)                __atomic_load_n(&(field), __ATOMIC_ACQUIRE)
+#define CS_STORE(field, val)          __atomic_store_n(&(field), (val), __ATOMIC_RELEASE)
+
+typedef struct {
+  int releaseFd;
+  unsigned long long released;                /* written by service_event_signal */
+  unsigned long long done;                    /* consumed and finished by the service */
+} clockSlot_t;
+
+static uint8_t isVirtual = 0;
+static uint64_t virtualNs = 0;                /* CLOCK_MONOTONIC */
+static int64_t realtimeOffsetNs = 0;          /* CLOCK_REALTIME - CLOCK_MONOTONIC at the switch */
+static clockSlot_t slots[CLOCK_SOURCE_MAX_SERVICES];
+static unsigned int numSlots = 0;
+static pthread_mutex_t idleMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t idleCond;
+
+/*---------------------------------------------------------------------------------*/
+/* PRIVATE FUNCTIONS */
+static clockSlot_t *find_slot(int fd);
+static uint8_t all_idle(void);
+static uint64_t timespec_ns(const struct timespec *pTime);
+
+/*---------------------------------------------------------------------------------*/
+int clock_source_virtual(const int *pReleaseFds, unsigned int numServices)
+{
+  struct timespec mono, real;
+  pthread_condattr_t condAttr;
+
+  if(numServices > CLOCK_SOURCE_MAX_SERVICES) {
+    syslog(LOG_ERR, "%s too many services, %u", __func__, numServices);
+    return -1;
+  }
+  memset(slots, 0, sizeof(slots));
+  for(unsigned int ind = 0; ind < numServices; ++ind) {
+    slots[ind].releaseFd = pReleaseFds[ind];
+  }
+  numSlots = numServices;
+
+  /* the idle wait is bounded in real (monotonic) time */
+  pthread_condattr_init(&condAttr);
+  pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+  pthread_cond_init(&idleCond, &condAttr);
+  pthread_condattr_destroy(&condAttr);
+
+  clock_gettime(CLOCK_MONOTONIC, &mono);
+  clock_gettime(CLOCK_REALTIME, &real);
+  realtimeOffsetNs = (int64_t)timespec_ns(&real) - (int64_t)timespec_ns(&mono);
+  CS_STORE(virtualNs, timespec_ns(&mono));
+  isVirtual = 1;
+  syslog(LOG_INFO, "%s virtual clock, %u services", __func__, numServices);
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+uint8_t clock_source_is_virtual(void)
+{
+  return isVirtual;
+}
+
+/*---------------------------------------------------------------------------------*/
+uint64_t clock_source_now_ns(void)
+{
+  struct timespec now;
+
+  if(isVirtual) {
+    return CS_LOAD(virtualNs);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return timespec_ns(&now);
+}
+
+/*---------------------------------------------------------------------------------*/
+int clock_source_gettime(clockid_t clk, struct timespec *pTime)
+{
+  uint64_t nowNs;
+
+  if(!isVirtual || ((clk != CLOCK_MONOTONIC) && (clk != CLOCK_REALTIME))) {
+    return clock_gettime(clk, pTime);
+  }
+  nowNs = CS_LOAD(virtualNs);
+  if(clk == CLOCK_REALTIME) {
+    nowNs += realtimeOffsetNs;
+  }
+  pTime->tv_sec = nowNs / NSEC_PER_SEC;
+  pTime->tv_nsec = nowNs % NSEC_PER_SEC;
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+void clock_source_advance(uint64_t nowNs)
+{
+  if(nowNs > CS_LOAD(virtualNs)) {
+    CS_STORE(virtualNs, nowNs);
+  }
+}
+
+/*---------------------------------------------------------------------------------*/
+void clock_source_released(int fd)
+{
+  clockSlot_t *pSlot = find_slot(fd);
+
+  /* counted before the write so the service can never finish a release not yet counted */
+  if(pSlot != NULL) {
+    __atomic_add_fetch(&pSlot->released, 1, __ATOMIC_ACQ_REL);
+  }
+}
+
+/*---------------------------------------------------------------------------------*/
+void clock_source_idle(int releaseFd, unsigned long long releasesDone)
+{
+  clockSlot_t *pSlot = find_slot(releaseFd);
+
+  if(pSlot == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&idleMutex);
+  CS_STORE(pSlot->done, releasesDone);
+  pthread_cond_broadcast(&idleCond);
+  pthread_mutex_unlock(&idleMutex);
+}
+
+/*---------------------------------------------------------------------------------*/
+int clock_source_wait_idle(volatile sig_atomic_t *pRunning)
+{
+  struct timespec now, timeout;
+
+  if(!isVirtual) {
+    return 0;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  uint64_t giveUpNs = timespec_ns(&now) + ((uint64_t)CLOCK_SOURCE_STALL_MS * 1000000ULL);
+
+  pthread_mutex_lock(&idleMutex);
+  while(!all_idle()) {
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t nowNs = timespec_ns(&now);
+    if(!*pRunning || (nowNs >= giveUpNs)) {
+      pthread_mutex_unlock(&idleMutex);
+      if(*pRunning) {
+        syslog(LOG_WARNING, "%s jobs still running after %d ms, advancing anyway", __func__, CLOCK_SOURCE_STALL_MS);
+      }
+      return -1;
+    }
+    uint64_t wakeNs = nowNs + ((uint64_t)IDLE_POLL_MS * 1000000ULL);
+    timeout.tv_sec = wakeNs / NSEC_PER_SEC;
+    timeout.tv_nsec = wakeNs % NSEC_PER_SEC;
+    pthread_cond_timedwait(&idleCond, &idleMutex, &timeout);
+  }
+  pthread_mutex_unlock(&idleMutex);
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+static clockSlot_t *find_slot(int fd)
+{
+  if(!isVirtual || (fd < 0)) {
+    return NULL;
+  }
+  for(unsigned int ind = 0; ind < numSlots; ++ind) {
+    if(slots[ind].releaseFd == fd) {
+      return &slots[ind];
+    }
+  }
+  return NULL;
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * Each service has finished every release written to it (call with idleMutex held).
+ */
+static uint8_t all_idle(void)
+{
+  for(unsigned int ind = 0; ind < numSlots; ++ind) {
+    if(CS_LOAD(slots[ind].done) < CS_LOAD(slots[ind].released)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/*---------------------------------------------------------------------------------*/
+static uint64_t timespec_ns(const struct timespec *pTime)
+{
+  return ((uint64_t)pTime->tv_sec * NSEC_PER_SEC) + pTime->tv_nsec;
+}
@@ -0,0 +1,337 @@
+/***********************************************************************************
+ * @author Joshua Malburg
+ * joshua.malburg@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file cpuTopology.c
+ * @brief core placement of the services (see cpuTopology.h)
+ *
+ ************************************************************************************
+ */
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+
+/* project headers */
+#include "cpuTopology.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define SYSFS_CPU_DIR                 "/sys/devices/system/cpu"
+#define LIST_LINE_LEN                 (256)
+
+/*---------------------------------------------------------------------------------*/
+/* PRIVATE FUNCTIONS */
+static int read_cpu_list(const char *filename, cpu_set_t *pSet);
+static int read_int(const char *filename, int *pValue);
+static void usable_isolated(cpuTopology_t *pTopo);
+static uint8_t can_pin(int cpu);
+static unsigned int sibling_load(const cpuTopology_t *pTopo, const unsigned int *pLoad, unsigned int cpu);
+
+/*---------------------------------------------------------------------------------*/
+/* GLOBAL VARIABLES */
+static int housekeepingCore = CPU_HOUSEKEEPING_DEFAULT;
+
+/*---------------------------------------------------------------------------------*/
+int cpu_topology_read(cpuTopology_t *pTopo)
+{
+  char filename[128];
+  cpu_set_t affinity;
+
+  memset(pTopo, 0, sizeof(cpuTopology_t));
+  if(read_cpu_list(SYSFS_CPU_DIR "/online", &pTopo->online) != 0) {
+    /* no sysfs: whatever we may run on is online */
+    sched_getaffinity(0, sizeof(cpu_set_t), &pTopo->online);
+  }
+  if(read_cpu_list(SYSFS_CPU_DIR "/isolated", &pTopo->isolated) == 0) {
+    CPU_AND(&pTopo->isolated, &pTopo->isolated, &pTopo->online);
+  }
+  if(sched_getaffinity(0, sizeof(cpu_set_t), &affinity) != 0) {
+    affinity = pTopo->online;
+  }
+  CPU_AND(&pTopo->allowed, &affinity, &pTopo->online);
+  usable_isolated(pTopo);
+
+  pTopo->housekeeping = -1;
+  for(unsigned int cpu = 0; cpu < CPU_TOPO_MAX_CPUS; ++cpu) {
+    if(!CPU_ISSET(cpu, &pTopo->online)) {
+      pTopo->physCore[cpu] = -1;
+      continue;
+    }
+    pTopo->numCpus = cpu + 1;
+
+    /* package << 16 | core_id; each CPU its own core if unknown */
+    int coreId = (int)cpu, packageId = 0;
+    snprintf(filename, sizeof(filename), SYSFS_CPU_DIR "/cpu%u/topology/core_id", cpu);
+    read_int(filename, &coreId);
+    snprintf(filename, sizeof(filename), SYSFS_CPU_DIR "/cpu%u/topology/physical_package_id", cpu);
+    read_int(filename, &packageId);
+    pTopo->physCore[cpu] = (packageId << 16) | (coreId & 0xFFFF);
+
+    if((pTopo->housekeeping < 0) && CPU_ISSET(cpu, &pTopo->allowed) && !CPU_ISSET(cpu, &pTopo->isolated)) {
+      pTopo->housekeeping = (int)cpu;
+    }
+  }
+  for(unsigned int cpu = 0; (cpu < pTopo->numCpus) && (pTopo->housekeeping < 0); ++cpu) {
+    if(CPU_ISSET(cpu, &pTopo->allowed)) {
+      pTopo->housekeeping = (int)cpu;
+    }
+  }
+  if(pTopo->housekeeping < 0) {
+    syslog(LOG_ERR, "%s no usable CPU", __func__);
+    return -1;
+  }
+  housekeepingCore = pTopo->housekeeping;
+  syslog(LOG_INFO, "%s %d online, %d allowed, %d isolated, housekeeping cpu%d", __func__, CPU_COUNT(&pTopo->online),
+         CPU_COUNT(&pTopo->allowed), CPU_COUNT(&pTopo->isolated), pTopo->housekeeping);
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+unsigned int cpu_topology_place(const cpuTopology_t *pTopo, serviceDef_t **ppSvcs, unsigned int numSvcs)
+{
+  unsigned int load[CPU_TOPO_MAX_CPUS];
+  cpu_set_t usable, rtPool;
+  serviceDef_t *pOrder[SERVICE_MAX + 1];
+
+  /* RT services go to the isolated CPUs, else everything allowed but housekeeping */
+  CPU_OR(&usable, &pTopo->allowed, &pTopo->isolated);
+  if(CPU_COUNT(&pTopo->isolated) != 0) {
+    rtPool = pTopo->isolated;
+  } else {
+    rtPool = pTopo->allowed;
+    if(CPU_COUNT(&rtPool) > 1) {
+      CPU_CLR(pTopo->housekeeping, &rtPool);
+    }
+  }
+
+  /* services pinned with -S keep their CPU when it is usable */
+  if(numSvcs > SERVICE_MAX + 1) {
+    numSvcs = SERVICE_MAX + 1;
+  }
+  memset(load, 0, sizeof(load));
+  unsigned int numAuto = 0;
+  for(unsigned int ind = 0; ind < numSvcs; ++ind) {
+    serviceDef_t *pSvc = ppSvcs[ind];
+    if((pSvc->cpuCore != CPU_CORE_AUTO) &&
+       ((pSvc->cpuCore < 0) || (pSvc->cpuCore >= CPU_TOPO_MAX_CPUS) || !CPU_ISSET(pSvc->cpuCore, &usable))) {
+      syslog(LOG_WARNING, "%s %s: cpu%d not usable, placing automatically", __func__, pSvc->name, pSvc->cpuCore);
+      pSvc->cpuCore = CPU_CORE_AUTO;
+    }
+    if(pSvc->cpuCore != CPU_CORE_AUTO) {
+      ++load[pSvc->cpuCore];
+      continue;
+    }
+
+    /* highest priority first; given order among equals */
+    unsigned int pos = numAuto++;
+    while((pos > 0) && (pOrder[pos - 1]->priorityOffset > pSvc->priorityOffset)) {
+      pOrder[pos] = pOrder[pos - 1];
+      --pos;
+    }
+    pOrder[pos] = pSvc;
+  }
+
+  /* least loaded CPU, then least loaded physical core, then lowest number */
+  for(unsigned int ind = 0; ind < numAuto; ++ind) {
+    int best = -1;
+    for(unsigned int cpu = 0; cpu < pTopo->numCpus; ++cpu) {
+      if(!CPU_ISSET(cpu, &rtPool)) {
+        continue;
+      }
+      if((best < 0) || (load[cpu] < load[best]) ||
+         ((load[cpu] == load[best]) && (sibling_load(pTopo, load, cpu) < sibling_load(pTopo, load, best)))) {
+        best = (int)cpu;
+      }
+    }
+    pOrder[ind]->cpuCore = best;
+    ++load[best];
+  }
+
+  /* layout and contention */
+  unsigned int contended = 0;
+  printf("core placement (housekeeping cpu%d):\n", pTopo->housekeeping);
+  for(unsigned int ind = 0; ind < numSvcs; ++ind) {
+    const serviceDef_t *pSvc = ppSvcs[ind];
+    int cpu = pSvc->cpuCore;
+    const char *pTag = CPU_ISSET(cpu, &pTopo->isolated) ? ", isolated" : "";
+    syslog(LOG_INFO, "%s %s: cpu%d (core %d, package %d%s)", __func__, pSvc->name, cpu, pTopo->physCore[cpu] & 0xFFFF,
+           pTopo->physCore[cpu] >> 16, pTag);
+    printf("  %-6s cpu%d (core %d, package %d%s)\n", pSvc->name, cpu, pTopo->physCore[cpu] & 0xFFFF,
+           pTopo->physCore[cpu] >> 16, pTag);
+  }
+  for(unsigned int cpu = 0; cpu < pTopo->numCpus; ++cpu) {
+    uint8_t withHousekeeping = ((int)cpu == pTopo->housekeeping) && (load[cpu] != 0);
+    if((load[cpu] < 2) && !withHousekeeping) {
+      continue;
+    }
+    char names[LIST_LINE_LEN] = "";
+    for(unsigned int ind = 0; ind < numSvcs; ++ind) {
+      if(ppSvcs[ind]->cpuCore == (int)cpu) {
+        strncat(names, " ", sizeof(names) - strlen(names) - 1);
+        strncat(names, ppSvcs[ind]->name, sizeof(names) - strlen(names) - 1);
+      }
+    }
+    syslog(LOG_WARNING, "%s cpu%u shared by%s%s", __func__, cpu, names, withHousekeeping ? " and housekeeping" : "");
+    printf("  contention: cpu%u shared by%s%s\n", cpu, names, withHousekeeping ? " and housekeeping" : "");
+    ++contended;
+  }
+  return contended;
+}
+
+/*---------------------------------------------------------------------------------*/
+int cpu_topology_spare(const cpuTopology_t *pTopo, serviceDef_t * const *ppSvcs, unsigned int numSvcs, cpu_set_t *pSet)
+{
+  *pSet = pTopo->allowed;
+  for(unsigned int ind = 0; ind < numSvcs; ++ind) {
+    if((ppSvcs[ind]->cpuCore >= 0) && (ppSvcs[ind]->cpuCore < CPU_TOPO_MAX_CPUS)) {
+      CPU_CLR(ppSvcs[ind]->cpuCore, pSet);
+    }
+  }
+  /* nor the helpers' CPU: busy FIFO work there would starve them */
+  CPU_CLR(pTopo->housekeeping, pSet);
+  return CPU_COUNT(pSet);
+}
+
+/*---------------------------------------------------------------------------------*/
+int cpu_list_parse(const char *pList, cpu_set_t *pSet)
+{
+  char line[LIST_LINE_LEN];
+
+  CPU_ZERO(pSet);
+  strncpy(line, pList, sizeof(line) - 1);
+  line[sizeof(line) - 1] = '\0';
+
+  char *pSave = NULL;
+  for(char *pTok = strtok_r(line, ",\n", &pSave); pTok != NULL; pTok = strtok_r(NULL, ",\n", &pSave)) {
+    unsigned int first, last;
+    int fields = sscanf(pTok, "%u-%u", &first, &last);
+    if(fields < 1) {
+      return -1;
+    }
+    if(fields == 1) {
+      last = first;
+    }
+    for(unsigned int cpu = first; (cpu <= last) && (cpu < CPU_TOPO_MAX_CPUS); ++cpu) {
+      CPU_SET(cpu, pSet);
+    }
+  }
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+int cpu_housekeeping_core(void)
+{
+  return housekeepingCore;
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * Read a sysfs CPU list file (see cpu_list_parse); an empty file is an empty set.
+ */
+static int read_cpu_list(const char *filename, cpu_set_t *pSet)
+{
+  char line[LIST_LINE_LEN];
+
+  CPU_ZERO(pSet);
+  FILE *pFile = fopen(filename, "r");
+  if(pFile == NULL) {
+    return -1;
+  }
+  if(fgets(line, sizeof(line), pFile) == NULL) {
+    line[0] = '\0';
+  }
+  fclose(pFile);
+  return cpu_list_parse(line, pSet);
+}
+
+/*---------------------------------------------------------------------------------*/
+static int read_int(const char *filename, int *pValue)
+{
+  FILE *pFile = fopen(filename, "r");
+  if(pFile == NULL) {
+    return -1;
+  }
+  int rtnCode = (fscanf(pFile, "%d", pValue) == 1) ? 0 : -1;
+  fclose(pFile);
+  return rtnCode;
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * Keep only the isolated CPUs we may be pinned to: the ones in our affinity, else,
+ * with the default affinity (everything online but isolcpus=), the ones our cpuset
+ * allows. A narrower affinity (taskset) that leaves them out means none.
+ */
+static void usable_isolated(cpuTopology_t *pTopo)
+{
+  cpu_set_t inAffinity, defaultSet, usable;
+
+  if(CPU_COUNT(&pTopo->isolated) == 0) {
+    return;
+  }
+  CPU_AND(&inAffinity, &pTopo->isolated, &pTopo->allowed);
+  CPU_XOR(&defaultSet, &pTopo->online, &pTopo->isolated);
+  if(CPU_COUNT(&inAffinity) != 0) {
+    usable = inAffinity;
+  } else if(CPU_EQUAL(&pTopo->allowed, &defaultSet)) {
+    CPU_ZERO(&usable);
+    for(unsigned int cpu = 0; cpu < CPU_TOPO_MAX_CPUS; ++cpu) {
+      if(CPU_ISSET(cpu, &pTopo->isolated) && can_pin((int)cpu)) {
+        CPU_SET(cpu, &usable);
+      }
+    }
+  } else {
+    CPU_ZERO(&usable);
+  }
+
+  if(!CPU_EQUAL(&usable, &pTopo->isolated)) {
+    syslog(LOG_WARNING, "%s %d of %d isolated CPUs usable (cpuset / taskset)", __func__, CPU_COUNT(&usable),
+           CPU_COUNT(&pTopo->isolated));
+  }
+  pTopo->isolated = usable;
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * Can a thread of ours be pinned to cpu; tried on the calling thread, then undone.
+ */
+static uint8_t can_pin(int cpu)
+{
+  cpu_set_t saved, single;
+
+  if(sched_getaffinity(0, sizeof(cpu_set_t), &saved) != 0) {
+    return 0;
+  }
+  CPU_ZERO(&single);
+  CPU_SET(cpu, &single);
+  uint8_t pinned = (sched_setaffinity(0, sizeof(cpu_set_t), &single) == 0);
+  sched_setaffinity(0, sizeof(cpu_set_t), &saved);
+  return pinned;
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * Services (and the housekeeping threads) already on the other SMT threads of
+ * cpu's physical core.
+ */
+static unsigned int sibling_load(const cpuTopology_t *pTopo, const unsigned int *pLoad, unsigned int cpu)
+{
+  unsigned int siblings = 0;
+
+  for(unsigned int other = 0; other < pTopo->numCpus; ++other) {
+    if((other != cpu) && (pTopo->physCore[other] == pTopo->physCore[cpu])) {
+      siblings += pLoad[other] + (((int)other == pTopo->housekeeping) ? 1 : 0);
+    }
+  }
+  return siblings;
+}
@@ -0,0 +1,150 @@
+/***********************************************************************************
+ * @author Joshua Malburg
+ * joshua.malburg@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file deadlineSched.c
+ * @brief run service threads under SCHED_DEADLINE (see deadlineSched.h)
+ *
+ ************************************************************************************
+ * References and Resources:
+ *   - https://www.kernel.org/doc/html/latest/scheduler/sched-deadline.html
+ ************************************************************************************
+ */
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <semaphore.h>
+#include <syslog.h>
+#include <sys/syscall.h>
+
+/* project headers */
+#include "deadlineSched.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+
+/* kernel ABI of sched_setattr (glibc 2.27 has no wrapper) */
+typedef struct {
+  uint32_t size;
+  uint32_t sched_policy;
+  uint64_t sched_flags;
+  int32_t sched_nice;
+  uint32_t sched_priority;
+  uint64_t sched_runtime;
+  uint64_t sched_deadline;
+  uint64_t sched_period;
+} dlSchedAttr_t;
+
+/* handed to the new thread; only valid until it posts ready */
+typedef struct {
+  void *(*entry)(void *);
+  void *arg;
+  deadlineParams_t params;
+  sem_t ready;
+  int result;
+  int error;
+} dlLaunch_t;
+
+/*---------------------------------------------------------------------------------*/
+/* PRIVATE FUNCTIONS */
+static void *deadline_trampoline(void *arg);
+
+/*---------------------------------------------------------------------------------*/
+int deadline_set_self(const deadlineParams_t *pParams)
+{
+#ifdef SYS_sched_setattr
+  dlSchedAttr_t attr;
+
+  if((pParams == NULL) || (pParams->runtimeNs < DEADLINE_MIN_RUNTIME_NS) ||
+     (pParams->runtimeNs > pParams->deadlineNs) || (pParams->deadlineNs > pParams->periodNs)) {
+    errno = EINVAL;
+    return -1;
+  }
+  memset(&attr, 0, sizeof(dlSchedAttr_t));
+  attr.size = sizeof(dlSchedAttr_t);
+  attr.sched_policy = SCHED_DEADLINE;
+  attr.sched_flags = SCHED_FLAG_RESET_ON_FORK;  /* else pthread_create fails with EAGAIN */
+  attr.sched_runtime = pParams->runtimeNs;
+  attr.sched_deadline = pParams->deadlineNs;
+  attr.sched_period = pParams->periodNs;
+  return (syscall(SYS_sched_setattr, 0, &attr, 0) == 0) ? 0 : -1;
+#else
+  (void)pParams;
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+/*---------------------------------------------------------------------------------*/
+int deadline_thread_create(pthread_t *pThread, const pthread_attr_t *pAttr, void *(*entry)(void *), void *arg,
+                           const deadlineParams_t *pParams)
+{
+  dlLaunch_t launch;
+
+  if((pThread == NULL) || (entry == NULL) || (pParams == NULL)) {
+    return -1;
+  }
+  launch.entry = entry;
+  launch.arg = arg;
+  launch.params = *pParams;
+  launch.result = -1;
+  launch.error = 0;
+  if(sem_init(&launch.ready, 0, 0) != 0) {
+    return -1;
+  }
+  if(pthread_create(pThread, pAttr, deadline_trampoline, &launch) != 0) {
+    sem_destroy(&launch.ready);
+    return -1;
+  }
+  while((sem_wait(&launch.ready) != 0) && (errno == EINTR)) {
+    /* retry */
+  }
+  sem_destroy(&launch.ready);
+
+  if(launch.result != 0) {
+    syslog(LOG_WARNING, "%s SCHED_DEADLINE refused (runtime %llu, deadline %llu, period %llu ns), errno: %d [%s]",
+           __func__, (unsigned long long)pParams->runtimeNs, (unsigned long long)pParams->deadlineNs,
+           (unsigned long long)pParams->periodNs, launch.error, strerror(launch.error));
+    return 1;
+  }
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+static void *deadline_trampoline(void *arg)
+{
+  dlLaunch_t *pLaunch = (dlLaunch_t *)arg;
+  void *(*entry)(void *) = pLaunch->entry;
+  void *entryArg = pLaunch->arg;
+
+  /* admission needs the whole root domain; the kernel trims this to our cpuset */
+  cpu_set_t pinned, everywhere;
+  uint8_t widened = 0;
+  if(pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &pinned) == 0) {
+    CPU_ZERO(&everywhere);
+    for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      CPU_SET(cpu, &everywhere);
+    }
+    widened = (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &everywhere) == 0);
+  }
+
+  pLaunch->result = deadline_set_self(&pLaunch->params);
+  pLaunch->error = (pLaunch->result == 0) ? 0 : errno;
+  if((pLaunch->result != 0) && widened) {
+    /* staying on FIFO/RR: back to the service core */
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &pinned);
+  }
+  sem_post(&pLaunch->ready);        /* pLaunch is gone after this */
+
+  return entry(entryArg);
+}
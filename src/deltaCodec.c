@@ -0,0 +1,309 @@
+/***********************************************************************************
+ * @author Joshua Malburg
+ * joshua.malburg@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file deltaCodec.c
+ * @brief lossless temporal (keyframe + residual) frame compression (see deltaCodec.h)
+ *
+ ************************************************************************************
+ */
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <syslog.h>
+#include <zlib.h>
+
+/* project headers */
+#include "deltaCodec.h"
+#include "frameArchive.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define BIT_IS_SET(pBits, ind)  (((pBits)[(ind) >> 3] >> ((ind) & 7)) & 1)
+#define BIT_SET(pBits, ind)     ((pBits)[(ind) >> 3] |= (uint8_t)(1 << ((ind) & 7)))
+
+/*---------------------------------------------------------------------------------*/
+/* PRIVATE FUNCTIONS */
+static int encode_key(deltaEncoder_t *pEnc, uint32_t frameNum, const uint8_t *pFrame, int rows, int cols, int elemSize,
+                      const uint8_t **ppOut, uint32_t *pLen);
+static uint8_t tile_differs(const uint8_t *pFrame, const uint8_t *pKey, size_t rowLen, int x0, int y0, int tileW, int tileH);
+
+/*---------------------------------------------------------------------------------*/
+int delta_encoder_init(deltaEncoder_t *pEnc, size_t maxFrameLen, unsigned int keyInterval)
+{
+  if((pEnc == NULL) || (maxFrameLen == 0)) {
+    return -1;
+  }
+  memset(pEnc, 0, sizeof(deltaEncoder_t));
+  pEnc->maxFrameLen = maxFrameLen;
+  pEnc->keyInterval = (keyInterval == 0) ? 1 : keyInterval;
+
+  /* worst case output is an incompressible frame plus header and bitmap */
+  pEnc->outCap = sizeof(deltaHeader_t) + maxFrameLen + compressBound(maxFrameLen);
+  pEnc->pKey = (uint8_t *)malloc(maxFrameLen);
+  pEnc->pResidual = (uint8_t *)malloc(maxFrameLen);
+  pEnc->pOut = (uint8_t *)malloc(pEnc->outCap);
+  pEnc->pDirty = (uint8_t *)calloc(1, (maxFrameLen / 64) + 16); /* >= tile bitmap of any geometry that fits */
+  if((pEnc->pKey == NULL) || (pEnc->pResidual == NULL) || (pEnc->pOut == NULL) || (pEnc->pDirty == NULL)) {
+    syslog(LOG_ERR, "%s couldn't allocate buffers", __func__);
+    delta_encoder_free(pEnc);
+    return -1;
+  }
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+int delta_encode(deltaEncoder_t *pEnc, uint32_t frameNum, const uint8_t *pFrame, int rows, int cols, int elemSize,
+                 const uint8_t *pHint, const uint8_t **ppOut, uint32_t *pLen)
+{
+  if((pEnc == NULL) || (pFrame == NULL) || (ppOut == NULL) || (pLen == NULL) ||
+     (rows <= 0) || (cols <= 0) || (elemSize <= 0) || (((size_t)rows * cols * elemSize) > pEnc->maxFrameLen)) {
+    return -1;
+  }
+
+  /* new keyframe on schedule or whenever the geometry changes */
+  if((pEnc->sinceKey == 0) || (pEnc->sinceKey >= pEnc->keyInterval) ||
+     (rows != pEnc->rows) || (cols != pEnc->cols) || (elemSize != pEnc->elemSize)) {
+    return encode_key(pEnc, frameNum, pFrame, rows, cols, elemSize, ppOut, pLen);
+  }
+  ++pEnc->sinceKey;
+
+  int tilesX = DELTA_TILES(cols);
+  int tilesY = DELTA_TILES(rows);
+  size_t bitmapLen = DELTA_BITMAP_BYTES(rows, cols);
+  size_t rowLen = (size_t)cols * elemSize;
+
+  deltaHeader_t *pHdr = (deltaHeader_t *)pEnc->pOut;
+  uint8_t *pBitmap = pEnc->pOut + sizeof(deltaHeader_t);
+  memset(pHdr, 0, sizeof(deltaHeader_t));
+  memset(pBitmap, 0, bitmapLen);
+
+  if(pHint != NULL) {
+    for(size_t ind = 0; ind < bitmapLen; ++ind) {
+      pEnc->pDirty[ind] |= pHint[ind];
+    }
+  }
+
+  /* gather residuals of every tile that differs from the keyframe */
+  size_t residualLen = 0;
+  for(int ty = 0; ty < tilesY; ++ty) {
+    int y0 = ty * DELTA_TILE_SIZE;
+    int tileH = ((y0 + DELTA_TILE_SIZE) > rows) ? (rows - y0) : DELTA_TILE_SIZE;
+    for(int tx = 0; tx < tilesX; ++tx) {
+      int tile = (ty * tilesX) + tx;
+      int x0 = tx * DELTA_TILE_SIZE;
+      int tileW = ((x0 + DELTA_TILE_SIZE) > cols) ? (cols - x0) : DELTA_TILE_SIZE;
+
+      /* hinted tiles moved, don't bother comparing them */
+      if(!BIT_IS_SET(pEnc->pDirty, tile) && !tile_differs(pFrame, pEnc->pKey, rowLen, x0 * elemSize, y0, tileW * elemSize, tileH)) {
+        continue;
+      }
+      BIT_SET(pBitmap, tile);
+      for(int row = y0; row < (y0 + tileH); ++row) {
+        const uint8_t *pSrc = pFrame + (row * rowLen) + (x0 * elemSize);
+        const uint8_t *pRef = pEnc->pKey + (row * rowLen) + (x0 * elemSize);
+        for(int col = 0; col < (tileW * elemSize); ++col) {
+          pEnc->pResidual[residualLen++] = (uint8_t)(pSrc[col] - pRef[col]);
+        }
+      }
+    }
+  }
+
+  uLongf zLen = pEnc->outCap - sizeof(deltaHeader_t) - bitmapLen;
+  if(compress2(pBitmap + bitmapLen, &zLen, pEnc->pResidual, residualLen, DELTA_ZLIB_LEVEL) != Z_OK) {
+    syslog(LOG_ERR, "%s compress2 failed on frame #%u", __func__, frameNum);
+    return -1;
+  }
+
+  pHdr->keyFrameNum = pEnc->keyFrameNum;
+  pHdr->residualLen = residualLen;
+  pHdr->tilesX = tilesX;
+  pHdr->tilesY = tilesY;
+  pHdr->tileSize = DELTA_TILE_SIZE;
+
+  *ppOut = pEnc->pOut;
+  *pLen = sizeof(deltaHeader_t) + bitmapLen + zLen;
+  pEnc->rawBytes += (size_t)rows * rowLen;
+  pEnc->codedBytes += *pLen;
+  return ARCHIVE_CODEC_DELTA;
+}
+
+/*---------------------------------------------------------------------------------*/
+void delta_encoder_force_key(deltaEncoder_t *pEnc)
+{
+  if(pEnc != NULL) {
+    pEnc->sinceKey = 0;
+  }
+}
+
+/*---------------------------------------------------------------------------------*/
+void delta_encoder_free(deltaEncoder_t *pEnc)
+{
+  if(pEnc == NULL) {
+    return;
+  }
+  free(pEnc->pKey);
+  free(pEnc->pResidual);
+  free(pEnc->pOut);
+  free(pEnc->pDirty);
+  memset(pEnc, 0, sizeof(deltaEncoder_t));
+}
+
+/*---------------------------------------------------------------------------------*/
+int delta_decode_key(const uint8_t *pPayload, uint32_t len, uint8_t *pOut, size_t outLen)
+{
+  uLongf destLen = outLen;
+
+  if((pPayload == NULL) || (pOut == NULL)) {
+    return -1;
+  }
+  if((uncompress(pOut, &destLen, pPayload, len) != Z_OK) || (destLen != outLen)) {
+    return -1;
+  }
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+int delta_decode(const uint8_t *pPayload, uint32_t len, const uint8_t *pKey, int rows, int cols, int elemSize, uint8_t *pOut)
+{
+  if((pPayload == NULL) || (pKey == NULL) || (pOut == NULL) || (len < sizeof(deltaHeader_t))) {
+    return -1;
+  }
+
+  deltaHeader_t hdr;
+  memcpy(&hdr, pPayload, sizeof(deltaHeader_t));
+  size_t bitmapLen = DELTA_BITMAP_BYTES(rows, cols);
+  size_t rowLen = (size_t)cols * elemSize;
+  if((hdr.tileSize != DELTA_TILE_SIZE) || (hdr.tilesX != DELTA_TILES(cols)) || (hdr.tilesY != DELTA_TILES(rows)) ||
+     (hdr.residualLen > ((size_t)rows * rowLen)) || (len < (sizeof(deltaHeader_t) + bitmapLen))) {
+    return -1;
+  }
+  const uint8_t *pBitmap = pPayload + sizeof(deltaHeader_t);
+
+  /* decoding only happens offline in the reader, so a scratch allocation is fine */
+  uint8_t *pResidual = (uint8_t *)malloc((hdr.residualLen > 0) ? hdr.residualLen : 1);
+  if(pResidual == NULL) {
+    return -1;
+  }
+  uLongf residualLen = hdr.residualLen;
+  if((uncompress(pResidual, &residualLen, pBitmap + bitmapLen, len - sizeof(deltaHeader_t) - bitmapLen) != Z_OK) ||
+     (residualLen != hdr.residualLen)) {
+    free(pResidual);
+    return -1;
+  }
+
+  memcpy(pOut, pKey, (size_t)rows * rowLen);
+  size_t pos = 0;
+  int rtnCode = 0;
+  for(int ty = 0; (ty < hdr.tilesY) && (rtnCode == 0); ++ty) {
+    int y0 = ty * DELTA_TILE_SIZE;
+    int tileH = ((y0 + DELTA_TILE_SIZE) > rows) ? (rows - y0) : DELTA_TILE_SIZE;
+    for(int tx = 0; tx < hdr.tilesX; ++tx) {
+      if(!BIT_IS_SET(pBitmap, (ty * hdr.tilesX) + tx)) {
+        continue;
+      }
+      int x0 = tx * DELTA_TILE_SIZE;
+      int tileW = ((x0 + DELTA_TILE_SIZE) > cols) ? (cols - x0) : DELTA_TILE_SIZE;
+      if((pos + ((size_t)tileW * elemSize * tileH)) > residualLen) {
+        rtnCode = -1;
+        break;
+      }
+      for(int row = y0; row < (y0 + tileH); ++row) {
+        uint8_t *pDst = pOut + (row * rowLen) + (x0 * elemSize);
+        for(int col = 0; col < (tileW * elemSize); ++col) {
+          pDst[col] = (uint8_t)(pDst[col] + pResidual[pos++]);
+        }
+      }
+    }
+  }
+  free(pResidual);
+  return rtnCode;
+}
+
+/*---------------------------------------------------------------------------------*/
+int delta_key_frame(const uint8_t *pPayload, uint32_t len, uint32_t *pKeyFrameNum)
+{
+  if((pPayload == NULL) || (pKeyFrameNum == NULL) || (len < sizeof(deltaHeader_t))) {
+    return -1;
+  }
+  deltaHeader_t hdr;
+  memcpy(&hdr, pPayload, sizeof(deltaHeader_t));
+  *pKeyFrameNum = hdr.keyFrameNum;
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+void delta_tile_bitmap(const uint8_t *pMask, int rows, int cols, size_t step, uint8_t *pBitmap)
+{
+  int tilesX = DELTA_TILES(cols);
+
+  memset(pBitmap, 0, DELTA_BITMAP_BYTES(rows, cols));
+  for(int row = 0; row < rows; ++row) {
+    const uint8_t *pRow = pMask + (row * step);
+    int tileRow = (row / DELTA_TILE_SIZE) * tilesX;
+    for(int col = 0; col < cols; ++col) {
+      if(pRow[col] != 0) {
+        BIT_SET(pBitmap, tileRow + (col / DELTA_TILE_SIZE));
+        /* rest of this tile's row can't add anything */
+        col |= (DELTA_TILE_SIZE - 1);
+      }
+    }
+  }
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * Store the frame as the new reference and emit it zlib compressed.
+ */
+static int encode_key(deltaEncoder_t *pEnc, uint32_t frameNum, const uint8_t *pFrame, int rows, int cols, int elemSize,
+                      const uint8_t **ppOut, uint32_t *pLen)
+{
+  size_t frameLen = (size_t)rows * cols * elemSize;
+
+  uLongf zLen = pEnc->outCap;
+  if(compress2(pEnc->pOut, &zLen, pFrame, frameLen, DELTA_ZLIB_LEVEL) != Z_OK) {
+    syslog(LOG_ERR, "%s compress2 failed on keyframe #%u", __func__, frameNum);
+    pEnc->sinceKey = 0;
+    return -1;
+  }
+
+  memcpy(pEnc->pKey, pFrame, frameLen);
+  memset(pEnc->pDirty, 0, DELTA_BITMAP_BYTES(rows, cols));
+  pEnc->rows = rows;
+  pEnc->cols = cols;
+  pEnc->elemSize = elemSize;
+  pEnc->keyFrameNum = frameNum;
+  pEnc->sinceKey = 1;
+
+  *ppOut = pEnc->pOut;
+  *pLen = zLen;
+  pEnc->rawBytes += frameLen;
+  pEnc->codedBytes += zLen;
+  return ARCHIVE_CODEC_ZLIB;
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * Compare one tile of the frame against the keyframe.
+ * @return 1 if any byte differs
+ */
+static uint8_t tile_differs(const uint8_t *pFrame, const uint8_t *pKey, size_t rowLen, int x0, int y0, int tileW, int tileH)
+{
+  for(int row = y0; row < (y0 + tileH); ++row) {
+    size_t offset = (row * rowLen) + x0;
+    if(memcmp(pFrame + offset, pKey + offset, tileW) != 0) {
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,287 @@
+/***********************************************************************************
+ * @author Brian Ibeling
+ * ibelingb@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file encoderPool.c
+ * @brief pool of non-RT worker threads that encode and save still images
+ *
+ ************************************************************************************
+ */
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdint.h>
+#include <syslog.h>
+
+/* opencv headers */
+#include <opencv2/core.hpp>     // Basic OpenCV structures (cv::Mat, Scalar)
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#include <string>   // for strings
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+/* project headers */
+#include "encoderPool.h"
+
+/*---------------------------------------------------------------------------------*/
+/* PRIVATE FUNCTIONS */
+static void *encoder_worker(void *arg);
+static void encode_job(encoderPool_t *pPool, encodeJob_t *pJob);
+
+/*---------------------------------------------------------------------------------*/
+int encoder_pool_create(encoderPool_t *pPool, unsigned int numWorkers, unsigned int numSlots, size_t slotLen,
+                        EncodeCodec_e codec, int quality, const cpu_set_t *pCpuSet, retentionMgr_t *pRetention)
+{
+  if((pPool == NULL) || (numWorkers == 0) || (numSlots == 0) || (codec >= ENCODE_CODEC_END)) {
+    return -1;
+  }
+  memset(pPool, 0, sizeof(encoderPool_t));
+  pPool->codec = codec;
+  pPool->quality = quality;
+  pPool->numSlots = numSlots;
+  pPool->slotLen = slotLen;
+  pPool->pRetention = pRetention;
+
+  /* allocate all frame buffers now so nothing is allocated on the write path */
+  pPool->pSlots = (encodeJob_t *)calloc(numSlots, sizeof(encodeJob_t));
+  pPool->pFreeStack = (unsigned int *)calloc(numSlots, sizeof(unsigned int));
+  pPool->pPending = (unsigned int *)calloc(numSlots, sizeof(unsigned int));
+  pPool->pThreads = (pthread_t *)calloc(numWorkers, sizeof(pthread_t));
+  if((pPool->pSlots == NULL) || (pPool->pFreeStack == NULL) || (pPool->pPending == NULL) || (pPool->pThreads == NULL)) {
+    syslog(LOG_ERR, "%s couldn't allocate pool", __func__);
+    encoder_pool_destroy(pPool);
+    return -1;
+  }
+  for(unsigned int ind = 0; ind < numSlots; ++ind) {
+    pPool->pSlots[ind].pData = (uint8_t *)malloc(slotLen);
+    if(pPool->pSlots[ind].pData == NULL) {
+      syslog(LOG_ERR, "%s couldn't allocate slot #%u", __func__, ind);
+      encoder_pool_destroy(pPool);
+      return -1;
+    }
+    memset(pPool->pSlots[ind].pData, 0, slotLen);
+    pPool->pFreeStack[pPool->freeCnt++] = ind;
+  }
+
+  pthread_mutex_init(&pPool->mutex, NULL);
+  pthread_cond_init(&pPool->workCond, NULL);
+  pPool->running = 1;
+
+  /* workers run SCHED_OTHER so they only ever use time the RT services leave idle */
+  pthread_attr_t attr;
+  struct sched_param param;
+  memset(&param, 0, sizeof(param));
+  pthread_attr_init(&attr);
+  pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+  pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+  pthread_attr_setschedparam(&attr, &param);
+  if(pCpuSet != NULL) {
+    pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), pCpuSet);
+  }
+  for(unsigned int ind = 0; ind < numWorkers; ++ind) {
+    if(pthread_create(&pPool->pThreads[ind], &attr, encoder_worker, (void *)pPool) != 0) {
+      syslog(LOG_ERR, "%s couldn't create encoder thread #%u", __func__, ind);
+      break;
+    }
+    ++pPool->numWorkers;
+  }
+  pthread_attr_destroy(&attr);
+
+  if(pPool->numWorkers == 0) {
+    encoder_pool_destroy(pPool);
+    return -1;
+  }
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+encodeJob_t *encoder_pool_acquire(encoderPool_t *pPool)
+{
+  encodeJob_t *pJob = NULL;
+
+  if((pPool == NULL) || (pPool->pSlots == NULL)) {
+    return NULL;
+  }
+
+  pthread_mutex_lock(&pPool->mutex);
+  if(pPool->freeCnt > 0) {
+    pJob = &pPool->pSlots[pPool->pFreeStack[--pPool->freeCnt]];
+  } else {
+    ++pPool->droppedCnt;
+  }
+  pthread_mutex_unlock(&pPool->mutex);
+  return pJob;
+}
+
+/*---------------------------------------------------------------------------------*/
+int encoder_pool_submit(encoderPool_t *pPool, encodeJob_t *pJob)
+{
+  if((pPool == NULL) || (pJob == NULL) || (pJob < pPool->pSlots) || (pJob >= (pPool->pSlots + pPool->numSlots))) {
+    return -1;
+  }
+
+  pthread_mutex_lock(&pPool->mutex);
+  unsigned int tail = (pPool->pendingHead + pPool->pendingCnt) % pPool->numSlots;
+  pPool->pPending[tail] = (unsigned int)(pJob - pPool->pSlots);
+  ++pPool->pendingCnt;
+  pthread_cond_signal(&pPool->workCond);
+  pthread_mutex_unlock(&pPool->mutex);
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+void encoder_pool_destroy(encoderPool_t *pPool)
+{
+  if(pPool == NULL) {
+    return;
+  }
+
+  /* workers drain the pending jobs before exiting */
+  if(pPool->numWorkers > 0) {
+    pthread_mutex_lock(&pPool->mutex);
+    pPool->running = 0;
+    pthread_cond_broadcast(&pPool->workCond);
+    pthread_mutex_unlock(&pPool->mutex);
+    for(unsigned int ind = 0; ind < pPool->numWorkers; ++ind) {
+      pthread_join(pPool->pThreads[ind], NULL);
+    }
+    pthread_mutex_destroy(&pPool->mutex);
+    pthread_cond_destroy(&pPool->workCond);
+    syslog(LOG_INFO, "%s encoded: %lu, failed: %lu, dropped (pool full): %lu", __func__,
+           pPool->encodedCnt, pPool->failedCnt, pPool->droppedCnt);
+  }
+
+  if(pPool->pSlots != NULL) {
+    for(unsigned int ind = 0; ind < pPool->numSlots; ++ind) {
+      free(pPool->pSlots[ind].pData);
+    }
+  }
+  free(pPool->pSlots);
+  free(pPool->pFreeStack);
+  free(pPool->pPending);
+  free(pPool->pThreads);
+  memset(pPool, 0, sizeof(encoderPool_t));
+}
+
+/*---------------------------------------------------------------------------------*/
+EncodeCodec_e encoder_codec_from_name(const char *name)
+{
+  if(name == NULL) {
+    return ENCODE_CODEC_END;
+  }
+  if(strcasecmp(name, "ppm") == 0) {
+    return ENCODE_PPM;
+  } else if(strcasecmp(name, "pgm") == 0) {
+    return ENCODE_PGM;
+  } else if(strcasecmp(name, "png") == 0) {
+    return ENCODE_PNG;
+  } else if((strcasecmp(name, "jpg") == 0) || (strcasecmp(name, "jpeg") == 0)) {
+    return ENCODE_JPEG;
+  }
+  return ENCODE_CODEC_END;
+}
+
+/*---------------------------------------------------------------------------------*/
+static void *encoder_worker(void *arg)
+{
+  encoderPool_t *pPool = (encoderPool_t *)arg;
+
+  while(1) {
+    pthread_mutex_lock(&pPool->mutex);
+    while((pPool->pendingCnt == 0) && pPool->running) {
+      pthread_cond_wait(&pPool->workCond, &pPool->mutex);
+    }
+    if(pPool->pendingCnt == 0) {
+      /* shutting down and nothing left to encode */
+      pthread_mutex_unlock(&pPool->mutex);
+      break;
+    }
+    encodeJob_t *pJob = &pPool->pSlots[pPool->pPending[pPool->pendingHead]];
+    pPool->pendingHead = (pPool->pendingHead + 1) % pPool->numSlots;
+    --pPool->pendingCnt;
+    pthread_mutex_unlock(&pPool->mutex);
+
+    encode_job(pPool, pJob);
+
+    /* return the slot to the pool */
+    pthread_mutex_lock(&pPool->mutex);
+    pPool->pFreeStack[pPool->freeCnt++] = (unsigned int)(pJob - pPool->pSlots);
+    pthread_mutex_unlock(&pPool->mutex);
+  }
+  return NULL;
+}
+
+/*---------------------------------------------------------------------------------*/
+static void encode_job(encoderPool_t *pPool, encodeJob_t *pJob)
+{
+  vector<int> params;
+  const char *ext;
+
+  Mat img(Size(pJob->cols, pJob->rows), pJob->type, pJob->pData);
+  Mat gray;
+
+  switch(pPool->codec) {
+  case ENCODE_PGM:
+    if(img.channels() != 1) {
+      cvtColor(img, gray, COLOR_RGB2GRAY);
+      img = gray;
+    }
+    ext = "pgm";
+    params.push_back(IMWRITE_PXM_BINARY);
+    params.push_back(1);
+    break;
+  case ENCODE_PNG:
+    ext = "png";
+    params.push_back(IMWRITE_PNG_COMPRESSION);
+    params.push_back(ENCODER_PNG_COMPRESSION);
+    break;
+  case ENCODE_JPEG:
+    ext = "jpg";
+    params.push_back(IMWRITE_JPEG_QUALITY);
+    params.push_back(pPool->quality);
+    break;
+  case ENCODE_PPM:
+  default:
+    ext = (img.channels() == 1) ? "pgm" : "ppm";
+    params.push_back(IMWRITE_PXM_BINARY);
+    params.push_back(1);
+    break;
+  }
+
+  char filename[sizeof(pJob->basename) + 8];
+  snprintf(filename, sizeof(filename), "%s.%s", pJob->basename, ext);
+  bool saved = false;
+  try {
+    saved = imwrite(filename, img, params);
+  } catch(const cv::Exception &e) {
+    syslog(LOG_ERR, "%s imwrite exception: %s", __func__, e.what());
+  }
+
+  pthread_mutex_lock(&pPool->mutex);
+  if(saved) {
+    ++pPool->encodedCnt;
+  } else {
+    ++pPool->failedCnt;
+  }
+  pthread_mutex_unlock(&pPool->mutex);
+  if(!saved) {
+    syslog(LOG_ERR, "%s couldn't write %s", __func__, filename);
+  } else {
+    retention_track(pPool->pRetention, filename);
+  }
+}
@@ -51,15 +51,10 @@ using namespace std;
 
 /*---------------------------------------------------------------------------------*/
 /* PRIVATE FUNCTIONS */
+static void replay_drain(const threadParams_t *pParams, serviceLoop_t *pLoop);
 
 /*---------------------------------------------------------------------------------*/
 /* GLOBAL VARIABLES */
-uint8_t runAcqThread;
-
-/*---------------------------------------------------------------------------------*/
-void shutdownAcqThread(int sig) {
-  runAcqThread = FALSE;
-}
 
 /*---------------------------------------------------------------------------------*/
 void *acquisitionTask(void*arg)
@@ -71,8 +66,8 @@ void *acquisitionTask(void*arg)
   }
   threadParams_t threadParams = *(threadParams_t *)arg;
 
-  if(threadParams.pSema == NULL) {
-    syslog(LOG_ERR, "invalid semaphore provided to %s", __func__);
+  if((threadParams.releaseFd < 0) || (threadParams.shutdownFd < 0)) {
+    syslog(LOG_ERR, "invalid release / shutdown events provided to %s", __func__);
     return NULL;
   }
   if(threadParams.pCBuff == NULL) {
@@ -84,12 +79,17 @@ void *acquisitionTask(void*arg)
     return NULL;
   }
 
-  /* Register shutdown signal handler */ 
-  signal(SIGNAL_KILL_ACQ, shutdownAcqThread);
-
-  /* open camera stream */
+  /* open camera stream, or the recording to replay */
   VideoCapture cam;
-  if(!cam.open(threadParams.cameraIdx)) {
+  if(threadParams.replayPath != NULL) {
+    if(!cam.open(threadParams.replayPath)) {
+      syslog(LOG_ERR, "couldn't open replay %s", threadParams.replayPath);
+      cout << "couldn't open replay " << threadParams.replayPath << endl;
+      return NULL;
+    }
+    cout  << "replay size (HxW): " << cam.get(CAP_PROP_FRAME_WIDTH)
+          << " x " << cam.get(CAP_PROP_FRAME_HEIGHT) << endl;
+  } else if(!cam.open(threadParams.cameraIdx)) {
     syslog(LOG_ERR, "couldn't open camera");
     cout << "couldn't open camera" << endl;
     return NULL;
@@ -101,45 +101,71 @@ void *acquisitionTask(void*arg)
           << " x " << cam.get(CAP_PROP_FRAME_HEIGHT) << endl;
   }
 
+  /* stack resident before the first job */
+  rt_stack_prefault();
+
+  /* releases and shutdown arrive as events */
+  serviceLoop_t loop;
+  if(service_loop_init(&loop, __func__, threadParams.releaseFd, threadParams.shutdownFd) != 0) {
+    return NULL;
+  }
+#if defined(TRACE_OUTPUT)
+  trace_register(Thread_e::ACQ_THREAD);
+#endif
+  monitor_counters_open(threadParams.pMonitor);
+
   Mat readImg;
   struct timespec timeNow;
 #if defined(DT_SYSLOG_OUTPUT)
   struct timespec prevReadTime;
 #endif
 
-  clock_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
+  clock_source_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
   syslog(LOG_INFO, "%s (tid = %lu) started at %f", __func__, pthread_self(),  TIMESPEC_TO_MSEC(timeNow));
-  unsigned int skipCount = 0;
+  /* a recording has no warm-up frames to throw away */
+  unsigned int skipCount = (threadParams.replayPath != NULL) ? FRAMES_TO_SKIP_AT_START : 0;
   unsigned int readCount = 0;
-  runAcqThread = TRUE;
-  while(runAcqThread == TRUE) {
-    /* wait for semaphore */
-    clock_gettime(SEMA_CLOCK_TYPE, &timeNow);
-    timeNow.tv_nsec += ACQ_THREAD_SEMA_TIMEOUT;
-    if(timeNow.tv_nsec  > 1e9) {
-      timeNow.tv_sec += 1;
-      timeNow.tv_nsec -= 1e9;
+  while(TRUE) {
+    /* wait for a release */
+    int wake = service_loop_wait(&loop, ACQ_THREAD_WAKE_TIMEOUT_MS);
+    if((wake < 0) || (wake & SERVICE_WAKE_SHUTDOWN)) {
+      break;
     }
-    if(sem_timedwait(threadParams.pSema, &timeNow) < 0) {
-      if(errno != ETIMEDOUT) {
-        syslog(LOG_ERR, "%s error with sem_timedwait, errno: %d [%s]", __func__, errno, strerror(errno));
-      } else {
-        syslog(LOG_ERR, "%s semaphore timed out", __func__);
+    if(!(wake & SERVICE_WAKE_RELEASE)) {
+      /* free running: no release just means difference is behind */
+      if(!threadParams.free_run) {
+        METRICS_ADD(releaseTimeouts[Thread_e::ACQ_THREAD], 1);
+        syslog(LOG_ERR, "%s release timed out", __func__);
       }
+      continue;
+    }
+    if(monitor_job_start(threadParams.pMonitor) == MONITOR_SKIP_JOB) {
+      continue;
     }
 
-#if defined(TIMESTAMP_SYSLOG_OUTPUT)
-    clock_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
+#if defined(TRACE_OUTPUT)
+    trace_event(TRACE_FRAME_START, readCount, 0);
+#elif defined(TIMESTAMP_SYSLOG_OUTPUT)
+    clock_source_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
     syslog(LOG_INFO, "%s frame process start (msec):, %.2f", __func__, TIMESPEC_TO_MSEC(timeNow));
 #endif
 
     /* read image from video */
     cam >> readImg;
+    uint64_t captureNs = monitor_now_ns();
+
+    /* end of the replay: let what was read drain, then stop the run */
+    if(readImg.empty() && (threadParams.replayPath != NULL)) {
+      monitor_job_end(threadParams.pMonitor);
+      replay_drain(&threadParams, &loop);
+      break;
+    }
 
     /* verify we've skipped required frames at start */
     if((!readImg.empty()) && (++skipCount > FRAMES_TO_SKIP_AT_START)) {
       skipCount = FRAMES_TO_SKIP_AT_START;
       ++readCount;
+      METRICS_ADD(framesAcquired, 1);
 
       // char filename[80];
       // sprintf(filename, "./acquiredFrame%d.ppm", readCount);
@@ -147,12 +173,18 @@ void *acquisitionTask(void*arg)
 
       /* insert in circular buffer */
       pthread_mutex_lock(threadParams.pMutex);
-      threadParams.pCBuffcv->put(readImg);
+      threadParams.pCBuffcv->put(readImg, captureNs, monitor_now_ns());
       //threadParams.pCBuff->put(readImg);
+      METRICS_SET(ringDepth, threadParams.pCBuffcv->size());
       pthread_mutex_unlock(threadParams.pMutex);
 
-#if defined(TIMESTAMP_SYSLOG_OUTPUT)
-      clock_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
+      /* event driven: let the difference service look at it now */
+      registry_trigger(threadParams.pNext);
+
+#if defined(TRACE_OUTPUT)
+      trace_event(TRACE_ACQ_INSERTED, readCount, 0);
+#elif defined(TIMESTAMP_SYSLOG_OUTPUT)
+      clock_source_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
       syslog(LOG_INFO, "%s frame inserted to CircBuffer at (msec):, %.2f", __func__, TIMESPEC_TO_MSEC(timeNow));
 #endif
 #if defined(DT_SYSLOG_OUTPUT)
@@ -166,8 +198,51 @@ void *acquisitionTask(void*arg)
         syslog(LOG_WARNING, "%s CB is full!", __func__);
       }
     }
+
+    /* free running: read the next frame right away unless difference is falling
+     * behind, in which case it releases us once it has caught up */
+    if(threadParams.free_run && (threadParams.pCBuffcv->size() < FREE_RUN_RING_HIGH)) {
+      monitor_trigger(threadParams.pMonitor, monitor_now_ns());
+      service_event_signal(threadParams.releaseFd);
+    }
+    monitor_job_end(threadParams.pMonitor);
   }
-  clock_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
+  monitor_counters_close(threadParams.pMonitor);
+  service_loop_close(&loop);
+  METRICS_RELEASE(serviceExited[Thread_e::ACQ_THREAD], 1);
+  clock_source_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
   syslog(LOG_INFO, "%s (tid = %lu) exiting at: %f", __func__, pthread_self(),  TIMESPEC_TO_MSEC(timeNow));
   return NULL;
 }
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * Waits until the frames read so far are through the pipeline: the ring is down
+ * to what difference always keeps, both queues are empty and no stage has moved
+ * for REPLAY_DRAIN_IDLE_POLLS polls. Then has the sequencer shut the run down.
+ */
+static void replay_drain(const threadParams_t *pParams, serviceLoop_t *pLoop)
+{
+  uint64_t lastProgress = UINT64_MAX;
+  unsigned int idlePolls = 0;
+
+  syslog(LOG_INFO, "%s replay finished, draining the pipeline", __func__);
+  while(idlePolls < REPLAY_DRAIN_IDLE_POLLS) {
+    int wake = service_loop_wait(pLoop, REPLAY_DRAIN_POLL_MS);
+    if((wake < 0) || (wake & SERVICE_WAKE_SHUTDOWN)) {
+      return;
+    }
+    uint64_t progress = METRICS_LOAD(framesDiffed) + METRICS_LOAD(selectReceived) + METRICS_LOAD(framesSaved);
+    uint8_t queued = (METRICS_LOAD(selectSent) != METRICS_LOAD(selectReceived)) ||
+                     (METRICS_LOAD(writeSent) != METRICS_LOAD(writeReceived));
+    uint8_t ringBusy = (pParams->pCBuffcv->size() > (FRAMES_TO_SKIP + 1));
+    idlePolls = (queued || ringBusy || (progress != lastProgress)) ? 0 : idlePolls + 1;
+    lastProgress = progress;
+  }
+
+  METRICS_SET(replayDoneNs, monitor_now_ns());
+  syslog(LOG_INFO, "%s pipeline drained, stopping", __func__);
+  if(pParams->pTidSeqThread != NULL) {
+    pthread_kill(*pParams->pTidSeqThread, SIGNAL_KILL_SEQ);
+  }
+}
@@ -0,0 +1,281 @@
+/***********************************************************************************
+ * @author Joshua Malburg
+ * joshua.malburg@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file frameArchive.c
+ * @brief append-only, memory-mapped frame archive (see frameArchive.h for layout)
+ *
+ ************************************************************************************
+ */
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <syslog.h>
+
+/* project headers */
+#include "frameArchive.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define ALIGN_UP(val, align)  ((((val) + (align) - 1) / (align)) * (align))
+
+/*---------------------------------------------------------------------------------*/
+/* PRIVATE FUNCTIONS */
+static int archive_map(frameArchive_t *pArchive, size_t len, int prot);
+
+/*---------------------------------------------------------------------------------*/
+int archive_create(frameArchive_t *pArchive, const char *filename, uint32_t maxFrames, uint64_t capacity)
+{
+  if((pArchive == NULL) || (filename == NULL) || (maxFrames == 0)) {
+    return -1;
+  }
+  memset(pArchive, 0, sizeof(frameArchive_t));
+  pArchive->fd = -1;
+
+  uint64_t dataOffset = ALIGN_UP(sizeof(archiveHeader_t) + ((uint64_t)maxFrames * sizeof(archiveIndexEntry_t)), ARCHIVE_DATA_ALIGN);
+  if(capacity <= dataOffset) {
+    syslog(LOG_ERR, "%s capacity %llu too small for %u frames", __func__, (unsigned long long)capacity, maxFrames);
+    return -1;
+  }
+
+  /* not truncated: a file preallocated ahead of time keeps its blocks */
+  pArchive->fd = open(filename, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  if(pArchive->fd < 0) {
+    syslog(LOG_ERR, "%s couldn't open %s, errno: %d [%s]", __func__, filename, errno, strerror(errno));
+    return -1;
+  }
+  if(ftruncate(pArchive->fd, capacity) != 0) {
+    syslog(LOG_ERR, "%s couldn't size %s, errno: %d [%s]", __func__, filename, errno, strerror(errno));
+    close(pArchive->fd);
+    pArchive->fd = -1;
+    return -1;
+  }
+
+  /* reserve the blocks up front so appends never extend the file (no-op if already reserved) */
+  int rtn = posix_fallocate(pArchive->fd, 0, capacity);
+  if(rtn != 0) {
+    syslog(LOG_ERR, "%s couldn't preallocate %llu bytes, err: %d [%s]", __func__, (unsigned long long)capacity, rtn, strerror(rtn));
+    close(pArchive->fd);
+    pArchive->fd = -1;
+    return -1;
+  }
+
+  if(archive_map(pArchive, capacity, PROT_READ | PROT_WRITE) != 0) {
+    close(pArchive->fd);
+    pArchive->fd = -1;
+    return -1;
+  }
+  pArchive->writable = 1;
+
+  /* frame data is written sequentially and rarely re-read by this process */
+  madvise(pArchive->pBase + dataOffset, capacity - dataOffset, MADV_SEQUENTIAL);
+
+  memset(pArchive->pBase, 0, dataOffset);
+  pArchive->pHdr->magic = ARCHIVE_MAGIC;
+  pArchive->pHdr->version = ARCHIVE_VERSION;
+  pArchive->pHdr->maxFrames = maxFrames;
+  pArchive->pHdr->frameCount = 0;
+  pArchive->pHdr->capacity = capacity;
+  pArchive->pHdr->dataOffset = dataOffset;
+  pArchive->pHdr->writeOffset = dataOffset;
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+uint64_t archive_capacity_for(uint32_t maxFrames, size_t maxFrameLen)
+{
+  uint64_t dataOffset = ALIGN_UP(sizeof(archiveHeader_t) + ((uint64_t)maxFrames * sizeof(archiveIndexEntry_t)), ARCHIVE_DATA_ALIGN);
+  return dataOffset + ((uint64_t)maxFrames * ALIGN_UP((uint64_t)maxFrameLen, ARCHIVE_DATA_ALIGN));
+}
+
+/*---------------------------------------------------------------------------------*/
+int archive_open(frameArchive_t *pArchive, const char *filename)
+{
+  struct stat fileStat;
+
+  if((pArchive == NULL) || (filename == NULL)) {
+    return -1;
+  }
+  memset(pArchive, 0, sizeof(frameArchive_t));
+
+  pArchive->fd = open(filename, O_RDONLY);
+  if(pArchive->fd < 0) {
+    fprintf(stderr, "couldn't open %s: %s\n", filename, strerror(errno));
+    return -1;
+  }
+  if((fstat(pArchive->fd, &fileStat) != 0) || ((size_t)fileStat.st_size < sizeof(archiveHeader_t))) {
+    fprintf(stderr, "%s is not a frame archive\n", filename);
+    close(pArchive->fd);
+    return -1;
+  }
+  if(archive_map(pArchive, fileStat.st_size, PROT_READ) != 0) {
+    close(pArchive->fd);
+    return -1;
+  }
+
+  archiveHeader_t *pHdr = pArchive->pHdr;
+  if((pHdr->magic != ARCHIVE_MAGIC) || (pHdr->version != ARCHIVE_VERSION) ||
+     (pHdr->dataOffset > (uint64_t)fileStat.st_size) || (pHdr->frameCount > pHdr->maxFrames) ||
+     ((sizeof(archiveHeader_t) + ((uint64_t)pHdr->maxFrames * sizeof(archiveIndexEntry_t))) > pHdr->dataOffset)) {
+    fprintf(stderr, "%s has a bad header\n", filename);
+    archive_close(pArchive);
+    return -1;
+  }
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+int archive_append(frameArchive_t *pArchive, const archiveIndexEntry_t *pEntry, const uint8_t *pData, uint32_t len)
+{
+  if((pArchive == NULL) || (pEntry == NULL) || (pData == NULL) || !pArchive->writable) {
+    return -1;
+  }
+
+  archiveHeader_t *pHdr = pArchive->pHdr;
+  if(pHdr->frameCount >= pHdr->maxFrames) {
+    syslog(LOG_ERR, "%s index full (%u frames)", __func__, pHdr->maxFrames);
+    return -1;
+  }
+  if((pHdr->writeOffset + len) > pHdr->capacity) {
+    syslog(LOG_ERR, "%s out of space, frame #%u (%u bytes) dropped", __func__, pEntry->frameNum, len);
+    return -1;
+  }
+
+  /* copy data, then the index entry, then publish by bumping the count */
+  memcpy(pArchive->pBase + pHdr->writeOffset, pData, len);
+
+  archiveIndexEntry_t *pSlot = &pArchive->pIndex[pHdr->frameCount];
+  *pSlot = *pEntry;
+  pSlot->offset = pHdr->writeOffset;
+  pSlot->size = len;
+
+  /* start write-back now rather than letting dirty pages pile up until close */
+  uint64_t syncStart = pHdr->writeOffset & ~((uint64_t)ARCHIVE_DATA_ALIGN - 1);
+  msync(pArchive->pBase + syncStart, (pHdr->writeOffset + len) - syncStart, MS_ASYNC);
+
+  pHdr->writeOffset = ALIGN_UP(pHdr->writeOffset + len, (pEntry->codec == ARCHIVE_CODEC_RAW) ? ARCHIVE_DATA_ALIGN : ARCHIVE_PACKED_ALIGN);
+  __atomic_store_n(&pHdr->frameCount, pHdr->frameCount + 1, __ATOMIC_RELEASE);
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+const archiveIndexEntry_t *archive_get_index(const frameArchive_t *pArchive, uint32_t idx, const uint8_t **ppData)
+{
+  if((pArchive == NULL) || (pArchive->pHdr == NULL) || (idx >= pArchive->pHdr->frameCount)) {
+    return NULL;
+  }
+
+  const archiveIndexEntry_t *pEntry = &pArchive->pIndex[idx];
+  if((pEntry->offset + pEntry->size) > pArchive->mapLen) {
+    return NULL;
+  }
+  if(ppData != NULL) {
+    *ppData = pArchive->pBase + pEntry->offset;
+  }
+  return pEntry;
+}
+
+/*---------------------------------------------------------------------------------*/
+const archiveIndexEntry_t *archive_find_frame(const frameArchive_t *pArchive, uint32_t frameNum, const uint8_t **ppData)
+{
+  if((pArchive == NULL) || (pArchive->pHdr == NULL)) {
+    return NULL;
+  }
+
+  /* frames are numbered sequentially and a segment continues the numbering of the
+   * last one, so the slot is normally the offset from the segment's first frame */
+  uint32_t count = archive_frame_count(pArchive);
+  if((count == 0) || (frameNum < pArchive->pIndex[0].frameNum)) {
+    return NULL;
+  }
+  uint32_t slot = frameNum - pArchive->pIndex[0].frameNum;
+  if((slot < count) && (pArchive->pIndex[slot].frameNum == frameNum)) {
+    return archive_get_index(pArchive, slot, ppData);
+  }
+
+  /* frames were dropped: numbers still increase, so bisect up to that slot */
+  uint32_t low = 0;
+  uint32_t high = (slot < count) ? slot : count;
+  while(low < high) {
+    uint32_t mid = low + ((high - low) / 2);
+    if(pArchive->pIndex[mid].frameNum < frameNum) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  if((low < count) && (pArchive->pIndex[low].frameNum == frameNum)) {
+    return archive_get_index(pArchive, low, ppData);
+  }
+  return NULL;
+}
+
+/*---------------------------------------------------------------------------------*/
+uint32_t archive_frame_count(const frameArchive_t *pArchive)
+{
+  if((pArchive == NULL) || (pArchive->pHdr == NULL)) {
+    return 0;
+  }
+  return __atomic_load_n(&pArchive->pHdr->frameCount, __ATOMIC_ACQUIRE);
+}
+
+/*---------------------------------------------------------------------------------*/
+int archive_close(frameArchive_t *pArchive)
+{
+  int rtnCode = 0;
+
+  if((pArchive == NULL) || (pArchive->pBase == NULL)) {
+    return -1;
+  }
+
+  uint64_t usedLen = 0;
+  if(pArchive->writable) {
+    usedLen = pArchive->pHdr->writeOffset;
+    pArchive->pHdr->capacity = usedLen;
+    rtnCode |= msync(pArchive->pBase, pArchive->mapLen, MS_SYNC);
+  }
+  rtnCode |= munmap(pArchive->pBase, pArchive->mapLen);
+
+  /* give back the unused part of the preallocation */
+  if(pArchive->writable) {
+    rtnCode |= ftruncate(pArchive->fd, usedLen);
+    rtnCode |= fsync(pArchive->fd);
+  }
+  rtnCode |= close(pArchive->fd);
+
+  memset(pArchive, 0, sizeof(frameArchive_t));
+  pArchive->fd = -1;
+  return (rtnCode == 0) ? 0 : -1;
+}
+
+/*---------------------------------------------------------------------------------*/
+static int archive_map(frameArchive_t *pArchive, size_t len, int prot)
+{
+  void *pMap = mmap(NULL, len, prot, MAP_SHARED, pArchive->fd, 0);
+  if(pMap == MAP_FAILED) {
+    syslog(LOG_ERR, "%s couldn't map %zu bytes, errno: %d [%s]", __func__, len, errno, strerror(errno));
+    fprintf(stderr, "couldn't map archive: %s\n", strerror(errno));
+    return -1;
+  }
+  pArchive->pBase = (uint8_t *)pMap;
+  pArchive->mapLen = len;
+  pArchive->pHdr = (archiveHeader_t *)pMap;
+  pArchive->pIndex = (archiveIndexEntry_t *)(pArchive->pBase + sizeof(archiveHeader_t));
+  return 0;
+}
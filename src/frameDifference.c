@@ -45,23 +45,19 @@ using namespace std;
 
 /* project headers */
 #include "project.h"
+#include "frameDifference.h"
 
 /*---------------------------------------------------------------------------------*/
 /* MACROS / TYPES / CONST */
 #define FILTER_SIZE   (15)
 #define FILTER_SIGMA  (2.0)
+#define DIFF_PIXEL_THRESHOLD  (20)
 
 /*---------------------------------------------------------------------------------*/
 /* PRIVATE FUNCTIONS */
 
 /*---------------------------------------------------------------------------------*/
 /* GLOBAL VARIABLES */
-uint8_t runDiffThread;
-
-/*---------------------------------------------------------------------------------*/
-void shutdownDiffThread(int sig) {
-  runDiffThread = FALSE;
-}
 
 /*---------------------------------------------------------------------------------*/
 void *differenceTask(void *arg)
@@ -76,8 +72,8 @@ void *differenceTask(void *arg)
   }
   threadParams_t threadParams = *(threadParams_t *)arg;
 
-  if(threadParams.pSema == NULL) {
-    syslog(LOG_ERR, "invalid semaphore provided to %s", __func__);
+  if((threadParams.releaseFd < 0) || (threadParams.shutdownFd < 0)) {
+    syslog(LOG_ERR, "invalid release / shutdown events provided to %s", __func__);
     return NULL;
   }
   if(threadParams.pCBuff == NULL) {
@@ -89,9 +85,6 @@ void *differenceTask(void *arg)
     return NULL;
   }
 
-  /* Register shutdown signal handler */ 
-  signal(SIGNAL_KILL_DIFF, shutdownDiffThread);
-
   /* open handle to queue */
   mqd_t selectQueue = mq_open(threadParams.selectQueueName,O_WRONLY, 0666, NULL);
   if(selectQueue == -1) {
@@ -100,6 +93,20 @@ void *differenceTask(void *arg)
     return NULL;
   }
 
+  /* stack resident before the first job */
+  rt_stack_prefault();
+
+  /* releases and shutdown arrive as events */
+  serviceLoop_t loop;
+  if(service_loop_init(&loop, __func__, threadParams.releaseFd, threadParams.shutdownFd) != 0) {
+    mq_close(selectQueue);
+    return NULL;
+  }
+#if defined(TRACE_OUTPUT)
+  trace_register(Thread_e::DIFF_THREAD);
+#endif
+  monitor_counters_open(threadParams.pMonitor);
+
   /* create filter kernel */
   Mat kern1D = getGaussianKernel(FILTER_SIZE, FILTER_SIGMA, CV_32F);
   
@@ -108,28 +115,30 @@ void *differenceTask(void *arg)
   struct timespec prevSendTime;
   #endif
 
-  clock_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
+  clock_source_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
   syslog(LOG_INFO, "%s (tid = %lu) started at %f", __func__, pthread_self(),  TIMESPEC_TO_MSEC(timeNow));
+  /* kept across jobs so the ring copies and the difference reuse their storage */
   Mat prevFrame;
+  Mat readFrame, nextFrame, diffFrame, bw;
   Mat blank = Mat::zeros(Size(MAX_IMG_COLS, MAX_IMG_ROWS), CV_8UC1);
   Mat newTimeFrame;
   unsigned int timeoutCnt = 0;
   uint8_t skipNextCnt = 0;
-  runDiffThread = TRUE;
-	while(runDiffThread == TRUE) {
-    /* wait for semaphore */
-    clock_gettime(SEMA_CLOCK_TYPE, &timeNow);
-    timeNow.tv_nsec += DIFF_THREAD_SEMA_TIMEOUT;
-    if(timeNow.tv_nsec > 1e9) {
-      timeNow.tv_sec += 1;
-      timeNow.tv_nsec -= 1e9;
+	while(TRUE) {
+    /* wait for a release */
+    int wake = service_loop_wait(&loop, DIFF_THREAD_WAKE_TIMEOUT_MS);
+    if((wake < 0) || (wake & SERVICE_WAKE_SHUTDOWN)) {
+      break;
     }
-    if(sem_timedwait(threadParams.pSema, &timeNow) < 0) {
-      if(errno != ETIMEDOUT) {
-        syslog(LOG_ERR, "%s error with sem_timedwait, errno: %d [%s]", __func__, errno, strerror(errno));
-      } else {
-        syslog(LOG_ERR, "%s semaphore timed out", __func__);
+    if(!(wake & SERVICE_WAKE_RELEASE)) {
+      if(!threadParams.event_driven) {
+        METRICS_ADD(releaseTimeouts[Thread_e::DIFF_THREAD], 1);
+        syslog(LOG_ERR, "%s release timed out", __func__);
       }
+      continue;
+    }
+    if(monitor_job_start(threadParams.pMonitor) == MONITOR_SKIP_JOB) {
+      continue;
     }
 
     /* if this is the first time through, fill previous frame */
@@ -150,38 +159,37 @@ void *differenceTask(void *arg)
     while(threadParams.pCBuffcv->size() > FRAMES_TO_SKIP + 1)
     //while(!threadParams.pCBuff->empty())
     {
-#if defined(TIMESTAMP_SYSLOG_OUTPUT)
-      clock_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
+#if defined(TRACE_OUTPUT)
+      trace_event(TRACE_FRAME_START, cnt, 0);
+#elif defined(TIMESTAMP_SYSLOG_OUTPUT)
+      clock_source_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
       syslog(LOG_INFO, "%s frame process start (msec):, %.2f", __func__, TIMESPEC_TO_MSEC(timeNow));
 #endif
       pthread_mutex_lock(threadParams.pMutex);
-      Mat readFrame;
-      threadParams.pCBuffcv->get(readFrame);
+      uint64_t captureNs = 0, ringInNs = 0;
+      threadParams.pCBuffcv->get(readFrame, &captureNs, &ringInNs);
       //readFrame = threadParams.pCBuff->get();
+      METRICS_SET(ringDepth, threadParams.pCBuffcv->size());
       pthread_mutex_unlock(threadParams.pMutex);
+      uint64_t ringOutNs = monitor_now_ns();
       if(readFrame.empty()) {
         cout << "ERROR: nextFrame empty still!" << endl;
         continue;
       }
 
-      Mat nextFrame;
-      cvtColor(readFrame, nextFrame, COLOR_RGB2GRAY);
-
-      /* find difference */
-      Mat diffFrame = nextFrame - prevFrame;
-  
-      /* convert to binary */
-      Mat bw;
-      threshold(diffFrame, bw, 20, 255, THRESH_BINARY);
-
-      unsigned int pixelDiffCount = countNonZero(bw);
+      unsigned int pixelDiffCount = frame_difference(prevFrame, readFrame, nextFrame, diffFrame, bw);
+      METRICS_ADD(framesDiffed, 1);
       if(pixelDiffCount !=0) {
-        clock_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
+#if defined(TRACE_OUTPUT)
+        trace_event(TRACE_DIFF_PIXELS, cnt, pixelDiffCount);
+#else
+        clock_source_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
         syslog(LOG_INFO, "%s countNonZero(bw):, %d, Time:, %.2f", __func__, pixelDiffCount, TIMESPEC_TO_MSEC(timeNow));
+#endif
       }
       /* if a difference was found, take the next
        * frame to ensure the hands are stationary */
-      clock_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
+      clock_source_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
       if(pixelDiffCount > 100) {
         skipNextCnt = FRAMES_TO_SKIP;
 
@@ -196,9 +204,11 @@ void *differenceTask(void *arg)
             // sprintf(filename, "./Diff_acquiredFrame%d_skip#%d.ppm", cnt, skipNextCnt);
             // imwrite(filename, readFrame);
             pthread_mutex_lock(threadParams.pMutex);
-            threadParams.pCBuffcv->get(readFrame);
+            threadParams.pCBuffcv->get(readFrame, &captureNs, &ringInNs);
             //readFrame = threadParams.pCBuff->get();
+            METRICS_SET(ringDepth, threadParams.pCBuffcv->size());
             pthread_mutex_unlock(threadParams.pMutex);
+            ringOutNs = monitor_now_ns();
             cvtColor(readFrame, nextFrame, COLOR_RGB2GRAY);
             --skipNextCnt;
           }
@@ -213,9 +223,9 @@ void *differenceTask(void *arg)
         } else {
           nextFrame.copyTo(newTimeFrame);
         }
-        clock_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
+        clock_source_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
         int len = newTimeFrame.rows * newTimeFrame.cols * newTimeFrame.elemSize();
-        uint8_t *pixelData = (uint8_t *)malloc(len);
+        uint8_t *pixelData = (uint8_t *)frame_arena_alloc(threadParams.pFrameArena, len);
         memcpy(pixelData, newTimeFrame.data, len);
 
         /* this is a really ugly way to do this but I didn't 
@@ -231,19 +241,37 @@ void *differenceTask(void *arg)
                             .diffFrameTime = CALC_DT_MSEC(timeNow, threadParams.programStartTime),
                             .isColor = (threadParams.save_type == SaveType_e::SAVE_COLOR_IMAGE)};
 
+        /* tell the archive where the hands moved so it can skip comparing those tiles */
+        if((bw.rows <= MAX_IMG_ROWS) && (bw.cols <= MAX_IMG_COLS)) {
+          delta_tile_bitmap(bw.data, bw.rows, bw.cols, bw.step, dummy.changeTiles);
+        }
+
+        /* stamps of the frame that was selected (the last one read when skipping) */
+        dummy.stampNs[FRAME_STAMP_CAPTURE] = captureNs;
+        dummy.stampNs[FRAME_STAMP_RING_IN] = ringInNs;
+        dummy.stampNs[FRAME_STAMP_RING_OUT] = ringOutNs;
+
         /* try to insert image but don't block if full
-        * so that we loop around and just get the newest */
+        * so that we loop around and just get the newest;
+        * free running waits for room instead (no drops) */
+        dummy.stampNs[FRAME_STAMP_SELECT_IN] = monitor_now_ns();
         clock_gettime(SEMA_CLOCK_TYPE, &timeNow);
+        if(threadParams.free_run) {
+          TIMESPEC_ADD_MSEC(timeNow, FREE_RUN_SEND_TIMEOUT_MS);
+        }
         if(mq_timedsend(selectQueue, (char *)&dummy, SELECT_QUEUE_MSG_SIZE, prio, &timeNow) != 0) {
             if(errno == ETIMEDOUT) {
+              METRICS_ADD(selectSendTimeouts, 1);
               cout << __func__ << " mq_timedsend(writeQueue, ...) TIMEOUT#" << timeoutCnt++ << endl;
             }
-            free(dummy.data);
+            frame_arena_free(threadParams.pFrameArena, dummy.data);
             syslog(LOG_ERR, "%s error with mq_timedsend, errno: %d [%s]", __func__, errno, strerror(errno));
         } else {
 
-          clock_gettime(SYSLOG_CLOCK_TYPE, &sendTime);
-#if defined(TIMESTAMP_SYSLOG_OUTPUT)
+          clock_source_gettime(SYSLOG_CLOCK_TYPE, &sendTime);
+#if defined(TRACE_OUTPUT)
+          trace_event(TRACE_DIFF_SELECTED, cnt, 0);
+#elif defined(TIMESTAMP_SYSLOG_OUTPUT)
           syslog(LOG_INFO, "%s frame #%d inserted to selectQueue at (msec):, %.2f", __func__, cnt, TIMESPEC_TO_MSEC(sendTime));
 #endif
 #if defined(DT_SYSLOG_OUTPUT)
@@ -253,14 +281,40 @@ void *differenceTask(void *arg)
           prevSendTime.tv_nsec = sendTime.tv_nsec;
 #endif
           ++cnt;
+          METRICS_ADD(selectSent, 1);
+
+          /* event driven: process the selected frame now */
+          registry_trigger(threadParams.pNext);
         }
       }
       /* store old frame */
       nextFrame.copyTo(prevFrame);
     }
+
+    /* free running: caught up, let acquisition read again */
+    if(threadParams.free_run) {
+      registry_trigger(threadParams.pPrev);
+    }
+    monitor_job_end(threadParams.pMonitor);
 	}
+  monitor_counters_close(threadParams.pMonitor);
+  service_loop_close(&loop);
   mq_close(selectQueue);
-  clock_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
+  METRICS_RELEASE(serviceExited[Thread_e::DIFF_THREAD], 1);
+  clock_source_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
   syslog(LOG_INFO, "%s (tid = %lu) exiting at: %f", __func__, pthread_self(),  TIMESPEC_TO_MSEC(timeNow));
   return NULL;
 }
+
+/*---------------------------------------------------------------------------------*/
+unsigned int frame_difference(const Mat &prevGray, const Mat &frame, Mat &nextGray, Mat &diffFrame, Mat &bw)
+{
+  cvtColor(frame, nextGray, COLOR_RGB2GRAY);
+
+  /* find difference */
+  diffFrame = nextGray - prevGray;
+
+  /* convert to binary */
+  threshold(diffFrame, bw, DIFF_PIXEL_THRESHOLD, 255, THRESH_BINARY);
+  return countNonZero(bw);
+}
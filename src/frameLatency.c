@@ -0,0 +1,146 @@
+/***********************************************************************************
+ * @author Joshua Malburg
+ * joshua.malburg@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file frameLatency.c
+ * @brief per-frame stage latency histograms (see frameLatency.h)
+ *
+ ************************************************************************************
+ */
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdio.h>
+#include <string.h>
+#include <syslog.h>
+
+/* project headers */
+#include "frameLatency.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define LAT_LOAD(field)               __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#define LAT_ADD(field, val)           __atomic_fetch_add(&(field), (val), __ATOMIC_RELAXED)
+#define NSEC_TO_USEC(ns)              ((double)(ns) / 1000.0)
+
+static const char *stageNames[LATENCY_STAGE_END] = {"acq", "ring", "diff", "selectQueue", "proc",
+                                                    "writeQueue", "write", "endToEnd"};
+
+/*---------------------------------------------------------------------------------*/
+/* PRIVATE FUNCTIONS */
+static unsigned int bucket_index(uint64_t valueNs);
+static uint64_t bucket_upper(unsigned int index);
+
+/*---------------------------------------------------------------------------------*/
+void latency_init(frameLatency_t *pLat)
+{
+  memset(pLat, 0, sizeof(frameLatency_t));
+}
+
+/*---------------------------------------------------------------------------------*/
+void latency_hist_record(latencyHist_t *pHist, uint64_t valueNs)
+{
+  LAT_ADD(pHist->buckets[bucket_index(valueNs)], 1);
+  if(valueNs > LAT_LOAD(pHist->maxNs)) {
+    __atomic_store_n(&pHist->maxNs, valueNs, __ATOMIC_RELAXED);
+  }
+  LAT_ADD(pHist->count, 1);
+}
+
+/*---------------------------------------------------------------------------------*/
+uint64_t latency_hist_percentile(const latencyHist_t *pHist, double percentile)
+{
+  uint64_t count = LAT_LOAD(pHist->count);
+  uint64_t maxNs = LAT_LOAD(pHist->maxNs);
+  uint64_t seen = 0;
+
+  if(count == 0) {
+    return 0;
+  }
+  uint64_t target = (uint64_t)((percentile / 100.0) * count + 0.5);
+  if(target == 0) {
+    target = 1;
+  }
+  for(unsigned int ind = 0; ind < LATENCY_BUCKETS; ++ind) {
+    seen += LAT_LOAD(pHist->buckets[ind]);
+    if(seen >= target) {
+      uint64_t upper = bucket_upper(ind);
+      return (upper < maxNs) ? upper : maxNs;
+    }
+  }
+  return maxNs;
+}
+
+/*---------------------------------------------------------------------------------*/
+void latency_record_frame(frameLatency_t *pLat, const uint64_t *pStampNs)
+{
+  if(pLat == NULL) {
+    return;
+  }
+  for(unsigned int ind = 0; ind < (FRAME_STAMP_END - 1); ++ind) {
+    if((pStampNs[ind] != 0) && (pStampNs[ind + 1] >= pStampNs[ind])) {
+      latency_hist_record(&pLat->stages[ind], pStampNs[ind + 1] - pStampNs[ind]);
+    }
+  }
+  if((pStampNs[FRAME_STAMP_CAPTURE] != 0) && (pStampNs[FRAME_STAMP_SAVED] >= pStampNs[FRAME_STAMP_CAPTURE])) {
+    latency_hist_record(&pLat->stages[LATENCY_STAGE_END_TO_END],
+                        pStampNs[FRAME_STAMP_SAVED] - pStampNs[FRAME_STAMP_CAPTURE]);
+  }
+}
+
+/*---------------------------------------------------------------------------------*/
+void latency_report(const frameLatency_t *pLat, const char *when)
+{
+  for(unsigned int ind = 0; ind < LATENCY_STAGE_END; ++ind) {
+    const latencyHist_t *pHist = &pLat->stages[ind];
+    syslog(LOG_INFO, "%s %s %s: frames, %llu, p50, %.1f, p99, %.1f, p99.9, %.1f, max, %.1f us", __func__, when,
+           stageNames[ind], (unsigned long long)LAT_LOAD(pHist->count),
+           NSEC_TO_USEC(latency_hist_percentile(pHist, 50.0)), NSEC_TO_USEC(latency_hist_percentile(pHist, 99.0)),
+           NSEC_TO_USEC(latency_hist_percentile(pHist, 99.9)), NSEC_TO_USEC(LAT_LOAD(pHist->maxNs)));
+  }
+}
+
+/*---------------------------------------------------------------------------------*/
+const char *latency_stage_name(unsigned int stage)
+{
+  return (stage < LATENCY_STAGE_END) ? stageNames[stage] : "?";
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * Values below 2 * LATENCY_SUB_BUCKETS get a bucket each; above that each power of
+ * 2 [2^msb, 2^(msb+1)) is split into LATENCY_SUB_BUCKETS buckets.
+ */
+static unsigned int bucket_index(uint64_t valueNs)
+{
+  if(valueNs < LATENCY_SUB_BUCKETS) {
+    return (unsigned int)valueNs;
+  }
+  unsigned int msb = 63 - __builtin_clzll(valueNs);
+  if(msb > LATENCY_MAX_MSB) {
+    return LATENCY_BUCKETS - 1;
+  }
+  unsigned int shift = msb - LATENCY_SUB_BITS;
+  return ((shift + 1) << LATENCY_SUB_BITS) + ((valueNs >> shift) & (LATENCY_SUB_BUCKETS - 1));
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * Highest value that maps to a bucket.
+ */
+static uint64_t bucket_upper(unsigned int index)
+{
+  unsigned int group = index >> LATENCY_SUB_BITS;
+  if(group <= 1) {
+    return index;
+  }
+  unsigned int shift = group - 1;
+  uint64_t lower = (uint64_t)((index & (LATENCY_SUB_BUCKETS - 1)) | LATENCY_SUB_BUCKETS) << shift;
+  return lower + (1ULL << shift) - 1;
+}
@@ -0,0 +1,332 @@
+/***********************************************************************************
+ * @author Brian Ibeling
+ * ibelingb@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file frameOverlay.c
+ * @brief pre-rendered annotation overlays (see frameOverlay.h)
+ *
+ ************************************************************************************
+ * References/Resources Used:
+ *  - https://stackoverflow.com/questions/3596310/c-how-to-use-the-function-uname
+ */
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <syslog.h>
+#include <sys/utsname.h>
+
+/* opencv headers */
+#include <opencv2/core.hpp>     // Basic OpenCV structures (cv::Mat, Scalar)
+#include <opencv2/imgproc.hpp>
+
+#include <string>   // for strings
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+/* project headers */
+#include "frameOverlay.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define OVERLAY_FONT                  (FONT_HERSHEY_SIMPLEX)
+#define OVERLAY_FONT_THICKNESS        (1)
+#define OVERLAY_GLYPH_PAD             (2)     /* room for glyphs that overhang their cell */
+
+/*---------------------------------------------------------------------------------*/
+/* PRIVATE FUNCTIONS */
+static void render_text(overlayBitmap_t *pBitmap, const string &text, int ascent, int descent);
+static void blit(Mat &dst, const overlayBitmap_t *pBitmap, int x, int y, const Scalar &color);
+static const overlayStamp_t *stamp_lookup(frameOverlay_t *pOverlay, int radius, int thickness);
+static void blit_stamp(Mat &dst, const overlayStamp_t *pStamp, int x, int y, const Scalar &color);
+static inline void blend(uint8_t *pDst, const uint8_t *pColor, int channels, unsigned int a);
+static inline void color_bytes(const Scalar &color, int channels, uint8_t *pColor);
+
+/*---------------------------------------------------------------------------------*/
+int overlay_init(frameOverlay_t *pOverlay)
+{
+  struct utsname unameData;
+  int baseline = 0;
+
+  if(pOverlay == NULL) {
+    return -1;
+  }
+
+  /* uname doesn't change while we run, so only ask once */
+  if(uname(&unameData) != 0) {
+    syslog(LOG_ERR, "%s uname failed", __func__);
+    strcpy(unameData.sysname, "unknown");
+  }
+
+  /* common cell height so every piece shares the same baseline */
+  Size textSize = getTextSize(string("Frame time: ms uname") + OVERLAY_GLYPHS + unameData.sysname,
+                              OVERLAY_FONT, OVERLAY_FONT_SCALE, OVERLAY_FONT_THICKNESS, &baseline);
+  int ascent = textSize.height;
+  int descent = baseline + OVERLAY_FONT_THICKNESS;
+
+  render_text(&pOverlay->unameText, format("uname: %s", unameData.sysname), ascent, descent);
+  render_text(&pOverlay->timePrefix, "Frame time: ", ascent, descent);
+  render_text(&pOverlay->timeSuffix, " ms", ascent, descent);
+  for(size_t ind = 0; ind < OVERLAY_GLYPH_COUNT; ++ind) {
+    render_text(&pOverlay->glyphs[ind], string(1, OVERLAY_GLYPHS[ind]), ascent, descent);
+  }
+
+  /* circle stamps are rendered on first use */
+  for(size_t ind = 0; ind < OVERLAY_STAMP_COUNT; ++ind) {
+    pOverlay->stamps[ind].radius = -1;
+    pOverlay->stamps[ind].thickness = 0;
+    pOverlay->stamps[ind].lastUse = 0;
+    pOverlay->stamps[ind].points.clear();
+  }
+  pOverlay->stampClock = 0;
+  pOverlay->stampMisses = 0;
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+void overlay_draw_text(frameOverlay_t *pOverlay, Mat &img, float timeMsec)
+{
+  const Scalar white(255, 255, 255);
+  char digits[32];
+
+  if((pOverlay == NULL) || (pOverlay->timePrefix.alpha.empty())) {
+    return;
+  }
+
+  /* timestamp line: static prefix, glyphs for the number, static suffix */
+  int penX = OVERLAY_TEXT_X;
+  blit(img, &pOverlay->timePrefix, penX, OVERLAY_TIMESTAMP_Y, white);
+  penX += pOverlay->timePrefix.advance;
+
+  snprintf(digits, sizeof(digits), "%.2f", timeMsec);
+  for(const char *pChar = digits; *pChar != '\0'; ++pChar) {
+    const char *pGlyph = strchr(OVERLAY_GLYPHS, *pChar);
+    if(pGlyph == NULL) {
+      continue;
+    }
+    const overlayBitmap_t *pBitmap = &pOverlay->glyphs[pGlyph - OVERLAY_GLYPHS];
+    blit(img, pBitmap, penX, OVERLAY_TIMESTAMP_Y, white);
+    penX += pBitmap->advance;
+  }
+  blit(img, &pOverlay->timeSuffix, penX, OVERLAY_TIMESTAMP_Y, white);
+
+  /* uname line */
+  blit(img, &pOverlay->unameText, OVERLAY_TEXT_X, OVERLAY_STATIC_Y, white);
+}
+
+/*---------------------------------------------------------------------------------*/
+void overlay_draw_lines(frameOverlay_t *pOverlay, Mat &img, const vector<Vec4i> &lines,
+                        const Scalar &color, int thickness)
+{
+  /* segment geometry changes every frame, nothing worth caching */
+  for(size_t i = 0; i < lines.size(); i++) {
+    Vec4i l = lines[i];
+    line(img, Point(l[0], l[1]), Point(l[2], l[3]), color, thickness, LINE_AA);
+  }
+}
+
+/*---------------------------------------------------------------------------------*/
+void overlay_draw_circles(frameOverlay_t *pOverlay, Mat &img, const vector<Vec3f> &circles,
+                          const Scalar &color, int thickness)
+{
+  if(pOverlay == NULL) {
+    return;
+  }
+
+  /* integer centers, so an outline looks the same wherever it is placed */
+  for(size_t i = 0; i < circles.size(); i++) {
+    Vec3i c = circles[i];
+    const overlayStamp_t *pStamp = stamp_lookup(pOverlay, 1, thickness);
+    if(pStamp != NULL) {
+      blit_stamp(img, pStamp, c[0], c[1], color);
+    }
+    pStamp = stamp_lookup(pOverlay, c[2], thickness);
+    if(pStamp != NULL) {
+      blit_stamp(img, pStamp, c[0], c[1], color);
+    }
+  }
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * Rasterise text once into an alpha bitmap.
+ * @param pBitmap - bitmap to fill
+ * @param text - string to render
+ * @param ascent - height above baseline shared by all text bitmaps
+ * @param descent - height below baseline shared by all text bitmaps
+ */
+static void render_text(overlayBitmap_t *pBitmap, const string &text, int ascent, int descent)
+{
+  int baseline = 0;
+  Size textSize = getTextSize(text, OVERLAY_FONT, OVERLAY_FONT_SCALE, OVERLAY_FONT_THICKNESS, &baseline);
+
+  pBitmap->alpha = Mat::zeros(Size(textSize.width + (2 * OVERLAY_GLYPH_PAD), ascent + descent), CV_8UC1);
+  pBitmap->originX = OVERLAY_GLYPH_PAD;
+  pBitmap->originY = ascent;
+  pBitmap->advance = textSize.width - OVERLAY_FONT_THICKNESS;
+  putText(pBitmap->alpha, text, Point(pBitmap->originX, pBitmap->originY), OVERLAY_FONT, OVERLAY_FONT_SCALE,
+          Scalar(255), OVERLAY_FONT_THICKNESS);
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * Blend a bitmap onto an 8-bit frame with its origin at (x, y); fully covered
+ * pixels are a plain store, partially covered (anti-aliased) pixels are blended.
+ * @param dst - 8-bit gray or color frame
+ * @param pBitmap - bitmap to draw
+ * @param x, y - frame position of the bitmap origin
+ * @param color - color to draw with
+ */
+static void blit(Mat &dst, const overlayBitmap_t *pBitmap, int x, int y, const Scalar &color)
+{
+  int channels = dst.channels();
+  int left = x - pBitmap->originX;
+  int top = y - pBitmap->originY;
+
+  if((dst.depth() != CV_8U) || (channels > 4) || pBitmap->alpha.empty()) {
+    return;
+  }
+
+  Rect area = Rect(left, top, pBitmap->alpha.cols, pBitmap->alpha.rows) & Rect(0, 0, dst.cols, dst.rows);
+  if(area.area() <= 0) {
+    return;
+  }
+
+  uint8_t colorVal[4];
+  color_bytes(color, channels, colorVal);
+
+  for(int row = 0; row < area.height; ++row) {
+    const uint8_t *pAlpha = pBitmap->alpha.ptr<uint8_t>(area.y - top + row) + (area.x - left);
+    uint8_t *pDst = dst.ptr<uint8_t>(area.y + row) + (area.x * channels);
+    for(int col = 0; col < area.width; ++col, pDst += channels) {
+      if(pAlpha[col] != 0) {
+        blend(pDst, colorVal, channels, pAlpha[col]);
+      }
+    }
+  }
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * Find the outline stamp of a circle, rasterising it over the least recently
+ * used one on a miss.
+ * @param pOverlay - overlay engine
+ * @param radius, thickness - circle to draw
+ * @return stamp, NULL if the circle can't be stamped
+ */
+static const overlayStamp_t *stamp_lookup(frameOverlay_t *pOverlay, int radius, int thickness)
+{
+  overlayStamp_t *pVictim = &pOverlay->stamps[0];
+
+  if((radius < 0) || (thickness < 1)) {
+    return NULL;
+  }
+
+  ++pOverlay->stampClock;
+  for(size_t ind = 0; ind < OVERLAY_STAMP_COUNT; ++ind) {
+    overlayStamp_t *pStamp = &pOverlay->stamps[ind];
+    if((pStamp->radius == radius) && (pStamp->thickness == thickness)) {
+      pStamp->lastUse = pOverlay->stampClock;
+      return pStamp;
+    }
+    if(pStamp->lastUse < pVictim->lastUse) {
+      pVictim = pStamp;
+    }
+  }
+
+  /* rasterise the outline centered in the scratch image and keep its covered pixels */
+  int half = radius + thickness + 2;
+  if(half > INT16_MAX) {
+    return NULL;
+  }
+  pOverlay->stampScratch.create(Size((2 * half) + 1, (2 * half) + 1), CV_8UC1);
+  pOverlay->stampScratch.setTo(Scalar(0));
+  circle(pOverlay->stampScratch, Point(half, half), radius, Scalar(255), thickness, LINE_AA);
+
+  pVictim->points.clear();
+  for(int row = 0; row < pOverlay->stampScratch.rows; ++row) {
+    const uint8_t *pAlpha = pOverlay->stampScratch.ptr<uint8_t>(row);
+    for(int col = 0; col < pOverlay->stampScratch.cols; ++col) {
+      if(pAlpha[col] != 0) {
+        overlayStampPoint_t point = {(int16_t)(col - half), (int16_t)(row - half), pAlpha[col]};
+        pVictim->points.push_back(point);
+      }
+    }
+  }
+  pVictim->radius = radius;
+  pVictim->thickness = thickness;
+  pVictim->lastUse = pOverlay->stampClock;
+  ++pOverlay->stampMisses;
+  return pVictim;
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * Blend an outline stamp onto an 8-bit frame centered at (x, y).
+ * @param dst - 8-bit gray or color frame
+ * @param pStamp - stamp to draw
+ * @param x, y - frame position of the circle center
+ * @param color - color to draw with
+ */
+static void blit_stamp(Mat &dst, const overlayStamp_t *pStamp, int x, int y, const Scalar &color)
+{
+  int channels = dst.channels();
+
+  if((dst.depth() != CV_8U) || (channels > 4)) {
+    return;
+  }
+
+  uint8_t colorVal[4];
+  color_bytes(color, channels, colorVal);
+
+  for(size_t ind = 0; ind < pStamp->points.size(); ++ind) {
+    const overlayStampPoint_t *pPoint = &pStamp->points[ind];
+    int col = x + pPoint->dx;
+    int row = y + pPoint->dy;
+    if((col < 0) || (row < 0) || (col >= dst.cols) || (row >= dst.rows)) {
+      continue;
+    }
+    blend(dst.ptr<uint8_t>(row) + (col * channels), colorVal, channels, pPoint->alpha);
+  }
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * Fully covered pixels are a plain store, partially covered (anti-aliased)
+ * pixels are blended.
+ */
+static inline void blend(uint8_t *pDst, const uint8_t *pColor, int channels, unsigned int a)
+{
+  if(a == 255) {
+    for(int ch = 0; ch < channels; ++ch) {
+      pDst[ch] = pColor[ch];
+    }
+  } else {
+    for(int ch = 0; ch < channels; ++ch) {
+      pDst[ch] = (uint8_t)(pDst[ch] + ((((int)pColor[ch] - (int)pDst[ch]) * (int)a) / 255));
+    }
+  }
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * Clamp a Scalar to 8-bit channel values.
+ */
+static inline void color_bytes(const Scalar &color, int channels, uint8_t *pColor)
+{
+  for(int ch = 0; ch < channels; ++ch) {
+    pColor[ch] = (uint8_t)((color[ch] < 0) ? 0 : ((color[ch] > 255) ? 255 : color[ch]));
+  }
+}
+
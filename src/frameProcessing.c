@@ -46,23 +46,22 @@ using namespace std;
 
 /* project headers */
 #include "project.h"
+#include "frameOverlay.h"
+#include "frameProcessing.h"
 
 /*---------------------------------------------------------------------------------*/
 /* MACROS / TYPES / CONST */
+typedef struct {
+  Mat *pGray;                                 /* blurred in place */
+  vector<Vec3f> circles;
+} circleTask_t;
 
 /*---------------------------------------------------------------------------------*/
 /* PRIVATE FUNCTIONS */
+static void detect_circles(void *arg);
 
 /*---------------------------------------------------------------------------------*/
 /* GLOBAL VARIABLES */
-uint8_t runProcThread;
-uint8_t emptyFlag = 0;
-
-/*---------------------------------------------------------------------------------*/
-void shutdownProcThread(int sig) {
-  runProcThread = FALSE;
-  emptyFlag = TRUE;
-}
 
 /*---------------------------------------------------------------------------------*/
 void *processingTask(void *arg)
@@ -76,16 +75,20 @@ void *processingTask(void *arg)
   }
   threadParams_t threadParams = *(threadParams_t *)arg;
 
-  if(threadParams.pSema == NULL) {
-    syslog(LOG_ERR, "invalid semaphore provided to %s", __func__);
+  if((threadParams.releaseFd < 0) || (threadParams.shutdownFd < 0)) {
+    syslog(LOG_ERR, "invalid release / shutdown events provided to %s", __func__);
     return NULL;
   }
 
-  /* Register shutdown signal handler */ 
-  signal(SIGNAL_KILL_PROC, shutdownProcThread);
+  /* draws the Hough annotations */
+  frameOverlay_t overlay;
+  if(overlay_init(&overlay) != 0) {
+    syslog(LOG_ERR, "%s couldn't initialize overlay", __func__);
+    return NULL;
+  }
 
-  /* open handle to queue */
-  mqd_t selectQueue = mq_open(threadParams.selectQueueName, O_RDONLY, 0666, NULL);
+  /* open non-blocking handle to queue; it is drained after each release */
+  mqd_t selectQueue = mq_open(threadParams.selectQueueName, O_RDONLY | O_NONBLOCK, 0666, NULL);
   if(selectQueue == -1) {
     syslog(LOG_ERR, "%s couldn't open queue", __func__);
     cout << __func__<< " couldn't open queue" << endl;
@@ -97,34 +100,51 @@ void *processingTask(void *arg)
   if(writeQueue == -1) {
     syslog(LOG_ERR, "%s couldn't open queue", __func__);
     cout << __func__<< " couldn't open queue" << endl;
+    mq_close(selectQueue);
+    return NULL;
+  }
+
+  /* stack resident before the first job */
+  rt_stack_prefault();
+
+  /* releases and shutdown arrive as events */
+  serviceLoop_t loop;
+  if(service_loop_init(&loop, __func__, threadParams.releaseFd, threadParams.shutdownFd) != 0) {
+    mq_close(selectQueue);
+    mq_close(writeQueue);
     return NULL;
   }
+#if defined(TRACE_OUTPUT)
+  trace_register(Thread_e::PROC_THREAD);
+#endif
+  monitor_counters_open(threadParams.pMonitor);
   
   struct timespec timeNow, sendTime;
 #if defined(DT_SYSLOG_OUTPUT)
   struct timespec prevSendTime;
 #endif
-  Mat readImg, procImg;
+  Mat readImg, procImg, grayImg;                /* work images, reused by every frame */
 
   unsigned int prio;
   unsigned int timeoutCnt = 0;
-  runProcThread = TRUE;
-  clock_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
+  uint8_t emptyFlag;
+  clock_source_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
   syslog(LOG_INFO, "%s (tid = %lu) started at %f", __func__, pthread_self(),  TIMESPEC_TO_MSEC(timeNow));
-  while(runProcThread == TRUE) {
-    /* wait for semaphore */
-    clock_gettime(SEMA_CLOCK_TYPE, &timeNow);
-    timeNow.tv_nsec += PROC_THREAD_SEMA_TIMEOUT;
-    if(timeNow.tv_nsec > 1e9) {
-      timeNow.tv_sec += 1;
-      timeNow.tv_nsec -= 1e9;
+  while(TRUE) {
+    /* wait for a release */
+    int wake = service_loop_wait(&loop, PROC_THREAD_WAKE_TIMEOUT_MS);
+    if((wake < 0) || (wake & SERVICE_WAKE_SHUTDOWN)) {
+      break;
     }
-    if(sem_timedwait(threadParams.pSema, &timeNow) < 0) {
-      if(errno != ETIMEDOUT) {
-        syslog(LOG_ERR, "%s error with sem_timedwait, errno: %d [%s]", __func__, errno, strerror(errno));
-      } else {
-        syslog(LOG_ERR, "%s semaphore timed out", __func__);
+    if(!(wake & SERVICE_WAKE_RELEASE)) {
+      if(!threadParams.event_driven) {
+        METRICS_ADD(releaseTimeouts[Thread_e::PROC_THREAD], 1);
+        syslog(LOG_ERR, "%s release timed out", __func__);
       }
+      continue;
+    }
+    if(monitor_job_start(threadParams.pMonitor) == MONITOR_SKIP_JOB) {
+      continue;
     }
 
     /* read oldest, highest priority msg from the message queue */
@@ -134,93 +154,45 @@ void *processingTask(void *arg)
       if(mq_receive(selectQueue, (char *)&dummy, SELECT_QUEUE_MSG_SIZE, &prio) < 0) {
         if(errno != EAGAIN) {
           syslog(LOG_ERR, "%s error with mq_receive, errno: %d [%s]", __func__, errno, strerror(errno));
-        } else {
-          emptyFlag = 1;
         }
+        emptyFlag = 1;
       } else {
+        dummy.stampNs[FRAME_STAMP_SELECT_OUT] = monitor_now_ns();
+        METRICS_ADD(selectReceived, 1);
         if ((dummy.rows == 0) || (dummy.cols == 0)) {
           syslog(LOG_ERR, "%s received bad frame: rows = %d, cols = %d", __func__, dummy.rows, dummy.cols);
         } else {
-#if defined(TIMESTAMP_SYSLOG_OUTPUT)
-          clock_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
+#if defined(TRACE_OUTPUT)
+          trace_event(TRACE_FRAME_START, dummy.diffFrameNum, 0);
+#elif defined(TIMESTAMP_SYSLOG_OUTPUT)
+          clock_source_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
           syslog(LOG_INFO, "%s frame process start (msec):,  %.2f", __func__, TIMESPEC_TO_MSEC(timeNow));
 #endif
           Mat readImg(Size(dummy.cols, dummy.rows), dummy.type, dummy.data);
-
-          if(threadParams.save_type == SaveType_e::SAVE_COLOR_IMAGE) {
-            cvtColor(readImg, procImg, COLOR_RGB2GRAY);
-          } else {
-            procImg = readImg.clone();
-          }
-          Mat gray = procImg.clone();
-
-          /* add edge enhancement */
-          if(threadParams.filter_enable) {
-            int thres = 70;
-            Canny(procImg, procImg, thres, thres*4, 3);
-          }
-
-          /* Draw the lines */
-          if(threadParams.hough_enable) {
-            /* find lines */
-            vector<Vec4i> linesP;
-            HoughLinesP(procImg,  // grayscale input image
-                linesP,           // output vector of lines
-                1,                // distance resolution
-                CV_PI/180,        // angle resolution
-                80,               // score threshold
-                80,               // minimum length
-                20);              // maximum allowed gap
-            
-            /* Draw the lines */
-            if(threadParams.save_type != SaveType_e::SAVE_COLOR_IMAGE) {
-              cvtColor(procImg, procImg, COLOR_GRAY2RGB);
-            }
-            
-            for( size_t i = 0; i < linesP.size(); i++ )
-            {
-                Vec4i l = linesP[i];
-                line(readImg, Point(l[0], l[1]), Point(l[2], l[3]), Scalar(0, 0, 255), 5, LINE_AA);
-            }
-
-            /* draw circles */
-            medianBlur(gray, gray, 5);
-            vector<Vec3f> circles;
-            HoughCircles(gray, circles, 
-                        HOUGH_GRADIENT, // method
-                        1,              // dp inverse accumulator resolution
-                        gray.rows/4,    // min distance between centers of detected circles
-                        100,            // high threshold
-                        30,             // low threshold
-                        140,            // min. circle radius
-                        250             // max. circle radius
-            );
-
-            for( size_t i = 0; i < circles.size(); i++ )
-            {
-                Vec3i c = circles[i];
-                Point center = Point(c[0], c[1]);
-                circle( readImg, center, 1, Scalar(255,0, 0), 3, LINE_AA);
-
-                int radius = c[2];
-                circle( readImg, center, radius, Scalar(255,0,0), 3, LINE_AA);
-            }
-          }
+          frame_process(&overlay, readImg, procImg, grayImg, (threadParams.save_type == SaveType_e::SAVE_COLOR_IMAGE),
+                        threadParams.filter_enable, threadParams.hough_enable, threadParams.pExecutor);
 #if defined(DISPLAY_FRAMES)
           imshow("readImg", readImg);
           waitKey(1);
 #endif
           /* Send frame to frameWrite via writeQueue */
+          dummy.stampNs[FRAME_STAMP_WRITE_IN] = monitor_now_ns();
           clock_gettime(SEMA_CLOCK_TYPE, &timeNow);
+          if(threadParams.free_run) {
+            TIMESPEC_ADD_MSEC(timeNow, FREE_RUN_SEND_TIMEOUT_MS);
+          }
           if(mq_timedsend(writeQueue, (char *)&dummy, SELECT_QUEUE_MSG_SIZE, prio, &timeNow) != 0) {
             if(errno == ETIMEDOUT) {
+              METRICS_ADD(writeSendTimeouts, 1);
               cout << __func__ << " mq_timedsend(writeQueue, ...) TIMEOUT#" << timeoutCnt++ << endl;
             } 
-            free(dummy.data);
+            frame_arena_free(threadParams.pFrameArena, dummy.data);
             syslog(LOG_ERR, "%s error with mq_timedsend, errno: %d [%s]", __func__, errno, strerror(errno));
           } else {
-            clock_gettime(SYSLOG_CLOCK_TYPE, &sendTime);
-#if defined(TIMESTAMP_SYSLOG_OUTPUT)
+            clock_source_gettime(SYSLOG_CLOCK_TYPE, &sendTime);
+#if defined(TRACE_OUTPUT)
+            trace_event(TRACE_PROC_QUEUED, dummy.diffFrameNum, 0);
+#elif defined(TIMESTAMP_SYSLOG_OUTPUT)
             syslog(LOG_INFO, "%s frame #%d inserted to writeQueue at (msec):,  %.2f", __func__, dummy.diffFrameNum, TIMESPEC_TO_MSEC(sendTime));
 #endif
 #if defined(DT_SYSLOG_OUTPUT)
@@ -230,15 +202,92 @@ void *processingTask(void *arg)
             prevSendTime.tv_nsec = sendTime.tv_nsec;
 #endif
             ++cnt;
+            METRICS_ADD(writeSent, 1);
+
+            /* event driven: write it now */
+            registry_trigger(threadParams.pNext);
           }
         }
       }
     } while(!emptyFlag);
+    monitor_job_end(threadParams.pMonitor);
   }
 
+  monitor_counters_close(threadParams.pMonitor);
+  service_loop_close(&loop);
   mq_close(selectQueue);
   mq_close(writeQueue);
-  clock_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
+  METRICS_RELEASE(serviceExited[Thread_e::PROC_THREAD], 1);
+  clock_source_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
   syslog(LOG_INFO, "%s (tid = %lu) exiting at: %f", __func__, pthread_self(),  TIMESPEC_TO_MSEC(timeNow));
   return NULL;
-}
\ No newline at end of file
+}
+
+/*---------------------------------------------------------------------------------*/
+void frame_process(frameOverlay_t *pOverlay, Mat &img, Mat &procImg, Mat &grayImg, uint8_t isColor,
+                   uint8_t filterEnable, uint8_t houghEnable, taskExecutor_t *pExecutor)
+{
+  /* the work images keep their storage from the last frame */
+  if(isColor) {
+    cvtColor(img, procImg, COLOR_RGB2GRAY);
+  } else {
+    img.copyTo(procImg);
+  }
+  procImg.copyTo(grayImg);
+
+  /* circles only need the gray frame: find them on a worker meanwhile */
+  circleTask_t circleTask;
+  taskGroup_t circleGroup;
+  circleTask.pGray = &grayImg;
+  if(houghEnable) {
+    task_group_init(&circleGroup);
+    task_executor_submit(pExecutor, detect_circles, &circleTask, &circleGroup);
+  }
+
+  /* add edge enhancement */
+  if(filterEnable) {
+    int thres = 70;
+    Canny(procImg, procImg, thres, thres*4, 3);
+  }
+
+  /* Draw the lines */
+  if(houghEnable) {
+    /* find lines */
+    vector<Vec4i> linesP;
+    HoughLinesP(procImg,  // grayscale input image
+        linesP,           // output vector of lines
+        1,                // distance resolution
+        CV_PI/180,        // angle resolution
+        80,               // score threshold
+        80,               // minimum length
+        20);              // maximum allowed gap
+    
+    /* Draw the lines (onto img; procImg stays gray so its storage is reused) */
+    overlay_draw_lines(pOverlay, img, linesP, Scalar(0, 0, 255), 5);
+
+    /* draw circles; run the search here if no worker has picked it up yet */
+    task_group_finish(pExecutor, &circleGroup);
+    task_group_destroy(&circleGroup);
+    overlay_draw_circles(pOverlay, img, circleTask.circles, Scalar(255, 0, 0), 3);
+  }
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * Executor task of frame_process: blur the gray frame and find the circles.
+ */
+static void detect_circles(void *arg)
+{
+  circleTask_t *pTask = (circleTask_t *)arg;
+
+  medianBlur(*pTask->pGray, *pTask->pGray, 5);
+  HoughCircles(*pTask->pGray, pTask->circles,
+              HOUGH_GRADIENT,         // method
+              1,                      // dp inverse accumulator resolution
+              pTask->pGray->rows/4,   // min distance between centers of detected circles
+              100,                    // high threshold
+              30,                     // low threshold
+              140,                    // min. circle radius
+              250                     // max. circle radius
+  );
+}
@@ -12,8 +12,6 @@
  * @brief 
  *
  ************************************************************************************
- * References/Resources Used:
- *  - https://stackoverflow.com/questions/3596310/c-how-to-use-the-function-uname
  */
 
 /*---------------------------------------------------------------------------------*/
@@ -30,7 +28,6 @@
 #include <stdint.h>
 #include <unistd.h>
 #include <syslog.h>
-#include <sys/utsname.h>
 #include <signal.h>
 
 /* opencv headers */
@@ -49,9 +46,14 @@ using namespace std;
 
 /* project headers */
 #include "project.h"
+#include "frameArchive.h"
+#include "frameOverlay.h"
+#include "videoEncoder.h"
+#include "archiveWriter.h"
 
 /*---------------------------------------------------------------------------------*/
 /* MACROS / TYPES / CONST */
+#define ARCHIVE_SEGMENT_PREFIX  "./frames_filt%d_hough%d"
 
 /*---------------------------------------------------------------------------------*/
 /* PRIVATE FUNCTIONS */
@@ -66,10 +68,9 @@ void *writeTask(void *arg)
   uint8_t emptyFlag = 0;
   uint8_t runWriteProc = 1;
   unsigned int prio;
+  unsigned int savedCnt = 0;
   imgDef_t dummy;
-  std::string timestamp;
-  std::string procName;
-  struct utsname unameData;
+  frameOverlay_t overlay;
   struct timespec timeNow, saveTime;
 #if defined(DT_SYSLOG_OUTPUT)
   struct timespec prevSaveTime;
@@ -82,9 +83,15 @@ void *writeTask(void *arg)
   }
   threadParams_t threadParams = *(threadParams_t *)arg;
 
-  /* Verify semaphore is valid */
-  if(threadParams.pSema == NULL) {
-    syslog(LOG_ERR, "invalid semaphore provided to %s", __func__);
+  /* Verify release / shutdown events are valid */
+  if((threadParams.releaseFd < 0) || (threadParams.shutdownFd < 0)) {
+    syslog(LOG_ERR, "invalid release / shutdown events provided to %s", __func__);
+    return NULL;
+  }
+
+  /* pre-render the annotation text */
+  if(overlay_init(&overlay) != 0) {
+    syslog(LOG_ERR, "%s couldn't initialize overlay", __func__);
     return NULL;
   }
 
@@ -96,42 +103,79 @@ void *writeTask(void *arg)
     return NULL;
   }
 
-  /* create video writer */
-  // int codec = VideoWriter::fourcc('M',''P','G','4'');
-  // string videoFilename = "video.mp4";
-  int codec = VideoWriter::fourcc('M','J','P','G');
-  string videoFilename = "video.avi";
-  VideoWriter writer;
-  int isColor = 1;
-  double fps = 10.0;
-  writer.open(videoFilename, codec, fps, Size(MAX_IMG_COLS, MAX_IMG_ROWS), isColor);
-  if(!writer.isOpened()) {
-    cout << "failed to open video writer" << std::endl;
+  /* stack resident before the first job */
+  rt_stack_prefault();
+
+  /* releases and shutdown arrive as events */
+  serviceLoop_t loop;
+  if(service_loop_init(&loop, __func__, threadParams.releaseFd, threadParams.shutdownFd) != 0) {
+    mq_close(writeQueue);
+    return NULL;
   }
+#if defined(TRACE_OUTPUT)
+  trace_register(Thread_e::WRITE_THREAD);
+#endif
+  monitor_counters_open(threadParams.pMonitor);
 
-  clock_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
+#if defined(OUTPUT_VIDEO)
+  /* video is encoded on its own non-RT thread */
+  videoEncoder_t videoEncoder;
+  cpu_set_t videoCpu;
+  CPU_ZERO(&videoCpu);
+  CPU_SET(cpu_housekeeping_core(), &videoCpu);
+  if(video_encoder_start(&videoEncoder, "./video", MAX_IMG_ROWS * MAX_IMG_COLS * 3, &videoCpu, threadParams.pRetention,
+                         threadParams.videoFps) != 0) {
+    cout << "failed to start video encoder" << std::endl;
+  }
+#endif
+
+#if defined(OUTPUT_ARCHIVE)
+  /* frames are delta encoded and archived in preallocated segments on a non-RT
+   * thread; fall back to PPMs if that fails */
+  archiveWriter_t archiveWriter;
+  uint8_t useArchive = FALSE;
+  if(threadParams.pEncoderPool == NULL) {
+    /* still images go through the encoder pool otherwise */
+    cpu_set_t archiveCpu;
+    CPU_ZERO(&archiveCpu);
+    CPU_SET(cpu_housekeeping_core(), &archiveCpu);
+    size_t maxFrameLen = MAX_IMG_ROWS * MAX_IMG_COLS * ((threadParams.save_type == SaveType_e::SAVE_COLOR_IMAGE) ? 3 : 1);
+    sprintf(filename, ARCHIVE_SEGMENT_PREFIX, threadParams.filter_enable, threadParams.hough_enable);
+    if(archive_writer_start(&archiveWriter, filename, maxFrameLen, DELTA_BITMAP_BYTES(MAX_IMG_ROWS, MAX_IMG_COLS),
+                            ARCHIVE_SEGMENT_FRAMES, threadParams.delta_enable, &archiveCpu, threadParams.pRetention) == 0) {
+      useArchive = TRUE;
+    } else {
+      cout << "failed to create frame archive, writing PPMs instead" << std::endl;
+    }
+  }
+#endif
+
+  clock_source_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
   syslog(LOG_INFO, "%s (tid = %lu) started at %f", __func__, pthread_self(), TIMESPEC_TO_MSEC(timeNow));
 	while(runWriteProc == TRUE) {
-    /* wait for semaphore */
-    clock_gettime(SEMA_CLOCK_TYPE, &timeNow);
-    timeNow.tv_nsec += WRITE_THREAD_SEMA_TIMEOUT;
-    if(timeNow.tv_nsec > 1e9) {
-      timeNow.tv_sec += 1;
-      timeNow.tv_nsec -= 1e9;
+    /* wait for a release */
+    int wake = service_loop_wait(&loop, WRITE_THREAD_WAKE_TIMEOUT_MS);
+    if((wake < 0) || (wake & SERVICE_WAKE_SHUTDOWN)) {
+      break;
     }
-    if(sem_timedwait(threadParams.pSema, &timeNow) < 0) {
-      if(errno != ETIMEDOUT) {
-        syslog(LOG_ERR, "%s error with sem_timedwait, errno: %d [%s]", __func__, errno, strerror(errno));
-      } else {
-        syslog(LOG_ERR, "%s semaphore timed out", __func__);
+    if(!(wake & SERVICE_WAKE_RELEASE)) {
+      if(!threadParams.event_driven) {
+        METRICS_ADD(releaseTimeouts[Thread_e::WRITE_THREAD], 1);
+        syslog(LOG_ERR, "%s release timed out", __func__);
       }
+      continue;
+    }
+    if(monitor_job_start(threadParams.pMonitor) == MONITOR_SKIP_JOB) {
+      continue;
     }
 
     /* Read Frame from writeQueue */
     emptyFlag = 0;
     do {
-#if defined(TIMESTAMP_SYSLOG_OUTPUT)
-      clock_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
+#if defined(TRACE_OUTPUT)
+      trace_event(TRACE_FRAME_START, 0, 0);
+#elif defined(TIMESTAMP_SYSLOG_OUTPUT)
+      clock_source_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
       syslog(LOG_INFO, "%s frame process start (msec):, %.2f", __func__, TIMESPEC_TO_MSEC(timeNow));
 #endif
       if(mq_receive(writeQueue, (char *)&dummy, WRITE_QUEUE_MSG_SIZE, &prio) < 0) {
@@ -143,33 +187,80 @@ void *writeTask(void *arg)
           syslog(LOG_ERR, "%s error with mq_receive, errno: %d [%s]", __func__, errno, strerror(errno));
         }
       } else {
+        dummy.stampNs[FRAME_STAMP_WRITE_OUT] = monitor_now_ns();
+        METRICS_ADD(writeReceived, 1);
         if ((dummy.rows == 0) || (dummy.cols == 0)) {
           syslog(LOG_ERR, "%s received bad frame: rows = %d, cols = %d", __func__, dummy.rows, dummy.cols);
         } else {
           /* Convert received data into Mat object */
           Mat receivedImg(Size(dummy.cols, dummy.rows), dummy.type, dummy.data);
 
-          /* Save frame to memory */
-          sprintf(filename, "./f%d_filt%d_hough%d.ppm", dummy.diffFrameNum, threadParams.filter_enable, threadParams.hough_enable);
-
           /* Add timestamp and uname to frame and write frame to output file */
-          uname(&unameData);
-          clock_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
-          timestamp = format("Frame time: %.2f ms", TIMESPEC_TO_MSEC(timeNow));
-          procName = format("uname: %s", unameData.sysname);
-          putText(receivedImg, timestamp, Point(0, 15), FONT_HERSHEY_SIMPLEX, 0.5, Scalar(255, 255, 255));
-          putText(receivedImg, procName, Point(0, 30), FONT_HERSHEY_SIMPLEX, 0.5, Scalar(255, 255, 255));
-          imwrite(filename, receivedImg);
-
-          if(threadParams.save_type != SaveType_e::SAVE_COLOR_IMAGE) {
-            cvtColor(receivedImg, receivedImg, COLOR_GRAY2RGB);
+          clock_source_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
+          overlay_draw_text(&overlay, receivedImg, TIMESPEC_TO_MSEC(timeNow));
+
+          /* Save frame to memory */
+          if(threadParams.pEncoderPool != NULL) {
+            /* hand off to the encoder pool; drop the still if every slot is busy */
+            size_t len = dummy.rows * dummy.cols * dummy.elem_size;
+            encodeJob_t *pJob = NULL;
+            if(len <= threadParams.pEncoderPool->slotLen) {
+              pJob = encoder_pool_acquire(threadParams.pEncoderPool);
+            }
+            if(pJob == NULL) {
+              METRICS_ADD(stillsDropped, 1);
+              syslog(LOG_ERR, "%s no encoder slot for frame #%d, still image dropped", __func__, dummy.diffFrameNum);
+            } else {
+              memcpy(pJob->pData, dummy.data, len);
+              pJob->type = dummy.type;
+              pJob->rows = dummy.rows;
+              pJob->cols = dummy.cols;
+              snprintf(pJob->basename, sizeof(pJob->basename), "./f%d_filt%d_hough%d", dummy.diffFrameNum, threadParams.filter_enable, threadParams.hough_enable);
+              encoder_pool_submit(threadParams.pEncoderPool, pJob);
+            }
+          }
+#if defined(OUTPUT_ARCHIVE)
+          else if(useArchive) {
+            /* copy into the archive queue; drop the frame if it is full */
+            archiveIndexEntry_t entry;
+            memset(&entry, 0, sizeof(archiveIndexEntry_t));
+            entry.frameNum = dummy.diffFrameNum;
+            entry.frameTime = dummy.diffFrameTime;
+            entry.type = dummy.type;
+            entry.rows = dummy.rows;
+            entry.cols = dummy.cols;
+            entry.isColor = dummy.isColor;
+            if(archive_writer_submit(&archiveWriter, &entry, dummy.data, dummy.elem_size, dummy.changeTiles) != 0) {
+              METRICS_ADD(archiveDropped, 1);
+              syslog(LOG_ERR, "%s frame #%d not queued for the archive", __func__, dummy.diffFrameNum);
+            }
+          }
+#endif
+          else {
+            sprintf(filename, "./f%d_filt%d_hough%d.ppm", dummy.diffFrameNum, threadParams.filter_enable, threadParams.hough_enable);
+            if(imwrite(filename, receivedImg)) {
+              retention_track(threadParams.pRetention, filename);
+            }
           }
+
 #if defined(OUTPUT_VIDEO)
-          writer.write(receivedImg);
+          /* gray frames are converted on the encoder thread */
+          if(video_encoder_submit(&videoEncoder, dummy.data, dummy.type, dummy.rows, dummy.cols, dummy.diffFrameTime) != 0) {
+            METRICS_ADD(videoDropped, 1);
+            syslog(LOG_ERR, "%s frame #%d not queued for video", __func__, dummy.diffFrameNum);
+          }
 #endif
 
-          clock_gettime(SYSLOG_CLOCK_TYPE, &saveTime);
-#if defined(TIMESTAMP_SYSLOG_OUTPUT)
+          clock_source_gettime(SYSLOG_CLOCK_TYPE, &saveTime);
+          dummy.stampNs[FRAME_STAMP_SAVED] = monitor_now_ns();
+          METRICS_ADD(framesSaved, 1);
+          latency_record_frame(threadParams.pLatency, dummy.stampNs);
+          if((threadParams.pLatency != NULL) && ((++savedCnt % LATENCY_LIVE_REPORT_FRAMES) == 0)) {
+            latency_report(threadParams.pLatency, "live");
+          }
+#if defined(TRACE_OUTPUT)
+          trace_event(TRACE_WRITE_SAVED, dummy.diffFrameNum, 0);
+#elif defined(TIMESTAMP_SYSLOG_OUTPUT)
           syslog(LOG_INFO, "%s frame #%d saved at (msec):, %.2f", __func__, dummy.diffFrameNum, TIMESPEC_TO_MSEC(saveTime));
 #endif
 #if defined(DT_SYSLOG_OUTPUT)
@@ -189,17 +280,29 @@ void *writeTask(void *arg)
           pthread_kill(*(threadParams.pTidSeqThread), SIGNAL_KILL_SEQ);
         }
 
-        /* free malloced data */
-        free(dummy.data);
+        /* give the pixel buffer back */
+        frame_arena_free(threadParams.pFrameArena, dummy.data);
       }
     } while(!emptyFlag);
+    monitor_job_end(threadParams.pMonitor);
 	}
 
 
   /* Thread exit - cleanup */
+#if defined(OUTPUT_VIDEO)
+  video_encoder_stop(&videoEncoder);
+#endif
+#if defined(OUTPUT_ARCHIVE)
+  if(useArchive) {
+    archive_writer_stop(&archiveWriter);
+  }
+#endif
+  monitor_counters_close(threadParams.pMonitor);
+  service_loop_close(&loop);
   mq_close(writeQueue);
-  clock_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
+  METRICS_RELEASE(serviceExited[Thread_e::WRITE_THREAD], 1);
+  clock_source_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
   syslog(LOG_INFO, "%s (tid = %lu) exiting at: %f", __func__, pthread_self(),  TIMESPEC_TO_MSEC(timeNow));
 
   return NULL;
-}
\ No newline at end of file
+}
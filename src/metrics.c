@@ -0,0 +1,369 @@
+/***********************************************************************************
+ * @author Joshua Malburg
+ * joshua.malburg@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file metrics.c
+ * @brief live pipeline metrics in a shared memory block (see metrics.h)
+ *
+ ************************************************************************************
+ */
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <syslog.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/eventfd.h>
+
+/* project headers */
+#include "metrics.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define LOAD(field)                   __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#define NSEC_TO_USEC(ns)              ((double)(ns) / 1e3)
+
+typedef struct {
+  char *pBuf;
+  size_t len;
+  size_t used;
+} textBuf_t;
+
+/*---------------------------------------------------------------------------------*/
+/* PRIVATE FUNCTIONS */
+static void append(textBuf_t *pText, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static void *metrics_server_thread(void *arg);
+
+/*---------------------------------------------------------------------------------*/
+/* GLOBAL VARIABLES */
+pipelineMetrics_t *pMetrics = NULL;
+
+static uint8_t isShared = 0;
+static int serverFd = -1;
+static int stopFd = -1;
+static pthread_t serverThread;
+static char serverPath[sizeof(((struct sockaddr_un *)0)->sun_path)];
+
+/*---------------------------------------------------------------------------------*/
+pipelineMetrics_t *metrics_create(void)
+{
+  struct timespec now;
+  pipelineMetrics_t *pBlock = NULL;
+
+  int fd = shm_open(METRICS_SHM_NAME, O_CREAT | O_RDWR, 0644);
+  if((fd >= 0) && (ftruncate(fd, 0) == 0) && (ftruncate(fd, sizeof(pipelineMetrics_t)) == 0)) {
+    void *pMap = mmap(NULL, sizeof(pipelineMetrics_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(pMap != MAP_FAILED) {
+      pBlock = (pipelineMetrics_t *)pMap;
+      isShared = 1;
+    }
+  }
+  if(fd >= 0) {
+    close(fd);
+  }
+  if(pBlock == NULL) {
+    syslog(LOG_WARNING, "%s no shared memory metrics (errno: %d [%s]), keeping them private", __func__, errno,
+           strerror(errno));
+    shm_unlink(METRICS_SHM_NAME);
+    pBlock = (pipelineMetrics_t *)calloc(1, sizeof(pipelineMetrics_t));
+    if(pBlock == NULL) {
+      return NULL;
+    }
+    isShared = 0;
+  }
+
+  memset(pBlock, 0, sizeof(pipelineMetrics_t));
+  pBlock->version = METRICS_VERSION;
+  pBlock->size = sizeof(pipelineMetrics_t);
+  pBlock->pid = getpid();
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  pBlock->startNs = ((uint64_t)now.tv_sec * 1000000000ULL) + now.tv_nsec;
+  latency_init(&pBlock->latency);
+
+  /* every service updates it each job; mapped after mlockall, so locked here */
+  if(mlock(pBlock, sizeof(pipelineMetrics_t)) != 0) {
+    syslog(LOG_WARNING, "%s mlock failed, errno: %d [%s]; services may page fault on it", __func__, errno,
+           strerror(errno));
+  }
+
+  /* magic last, readers check it before trusting the rest */
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  memcpy(pBlock->magic, METRICS_MAGIC, sizeof(pBlock->magic));
+  pMetrics = pBlock;
+  return pBlock;
+}
+
+/*---------------------------------------------------------------------------------*/
+void metrics_destroy(void)
+{
+  if(serverFd >= 0) {
+    uint64_t one = 1;
+    (void)!write(stopFd, &one, sizeof(one));
+    pthread_join(serverThread, NULL);
+    close(serverFd);
+    close(stopFd);
+    unlink(serverPath);
+    serverFd = -1;
+    stopFd = -1;
+  }
+  if(pMetrics == NULL) {
+    return;
+  }
+  if(isShared) {
+    munmap(pMetrics, sizeof(pipelineMetrics_t));
+    shm_unlink(METRICS_SHM_NAME);
+  } else {
+    free(pMetrics);
+  }
+  pMetrics = NULL;
+}
+
+/*---------------------------------------------------------------------------------*/
+const pipelineMetrics_t *metrics_attach(void)
+{
+  struct stat info;
+
+  int fd = shm_open(METRICS_SHM_NAME, O_RDONLY, 0);
+  if(fd < 0) {
+    return NULL;
+  }
+  if((fstat(fd, &info) != 0) || ((size_t)info.st_size < sizeof(pipelineMetrics_t))) {
+    close(fd);
+    return NULL;
+  }
+  void *pMap = mmap(NULL, sizeof(pipelineMetrics_t), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if(pMap == MAP_FAILED) {
+    return NULL;
+  }
+
+  const pipelineMetrics_t *pBlock = (const pipelineMetrics_t *)pMap;
+  if((memcmp(pBlock->magic, METRICS_MAGIC, sizeof(pBlock->magic)) != 0) || (pBlock->version != METRICS_VERSION) ||
+     (pBlock->size != sizeof(pipelineMetrics_t))) {
+    munmap(pMap, sizeof(pipelineMetrics_t));
+    return NULL;
+  }
+  return pBlock;
+}
+
+/*---------------------------------------------------------------------------------*/
+void metrics_detach(const pipelineMetrics_t *pBlock)
+{
+  if(pBlock != NULL) {
+    munmap((void *)pBlock, sizeof(pipelineMetrics_t));
+  }
+}
+
+/*---------------------------------------------------------------------------------*/
+size_t metrics_format(const pipelineMetrics_t *pBlock, char *pBuf, size_t len)
+{
+  struct timespec now;
+  textBuf_t text = {pBuf, len, 0};
+  static const double quantiles[] = {50.0, 99.0, 99.9};
+
+  if(len == 0) {
+    return 0;
+  }
+  pBuf[0] = '\0';
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  uint64_t nowNs = ((uint64_t)now.tv_sec * 1000000000ULL) + now.tv_nsec;
+
+  append(&text, "project_pid %d\n", pBlock->pid);
+  append(&text, "project_uptime_seconds %.3f\n", (nowNs - pBlock->startNs) / 1e9);
+  append(&text, "project_ring_depth %llu\n", (unsigned long long)LOAD(pBlock->ringDepth));
+  append(&text, "project_ring_capacity %u\n", pBlock->ringCapacity);
+  append(&text, "project_frames_acquired_total %llu\n", (unsigned long long)LOAD(pBlock->framesAcquired));
+  append(&text, "project_frames_diffed_total %llu\n", (unsigned long long)LOAD(pBlock->framesDiffed));
+  uint64_t received = LOAD(pBlock->selectReceived);
+  append(&text, "project_select_queue_depth %llu\n", (unsigned long long)(LOAD(pBlock->selectSent) - received));
+  append(&text, "project_select_queue_send_timeouts_total %llu\n", (unsigned long long)LOAD(pBlock->selectSendTimeouts));
+  received = LOAD(pBlock->writeReceived);
+  append(&text, "project_write_queue_depth %llu\n", (unsigned long long)(LOAD(pBlock->writeSent) - received));
+  append(&text, "project_write_queue_send_timeouts_total %llu\n", (unsigned long long)LOAD(pBlock->writeSendTimeouts));
+  append(&text, "project_frames_saved_total %llu\n", (unsigned long long)LOAD(pBlock->framesSaved));
+  append(&text, "project_stills_dropped_total %llu\n", (unsigned long long)LOAD(pBlock->stillsDropped));
+  append(&text, "project_video_dropped_total %llu\n", (unsigned long long)LOAD(pBlock->videoDropped));
+  append(&text, "project_archive_dropped_total %llu\n", (unsigned long long)LOAD(pBlock->archiveDropped));
+
+  unsigned int numServices = (pBlock->numServices < SERVICE_MAX) ? pBlock->numServices : SERVICE_MAX;
+  for(unsigned int ind = 0; ind < numServices; ++ind) {
+    const serviceMonitor_t *pMon = &pBlock->monitors[ind];
+    uint64_t jobs = LOAD(pMon->jobs);
+    double avgExecUs = (jobs != 0) ? NSEC_TO_USEC((double)LOAD(pMon->sumExecNs) / jobs) : 0.0;
+    append(&text, "project_service_jobs_total{service=\"%s\"} %llu\n", pMon->name, (unsigned long long)jobs);
+    append(&text, "project_service_exec_avg_us{service=\"%s\"} %.1f\n", pMon->name, avgExecUs);
+    append(&text, "project_service_exec_max_us{service=\"%s\"} %.1f\n", pMon->name, NSEC_TO_USEC(LOAD(pMon->maxExecNs)));
+    append(&text, "project_service_response_max_us{service=\"%s\"} %.1f\n", pMon->name, NSEC_TO_USEC(LOAD(pMon->maxRespNs)));
+    append(&text, "project_service_wakeup_max_us{service=\"%s\"} %.1f\n", pMon->name, NSEC_TO_USEC(LOAD(pMon->maxWakeNs)));
+    append(&text, "project_service_deadline_misses_total{service=\"%s\"} %llu\n", pMon->name,
+           (unsigned long long)LOAD(pMon->deadlineMisses));
+    append(&text, "project_service_budget_overruns_total{service=\"%s\"} %llu\n", pMon->name,
+           (unsigned long long)LOAD(pMon->budgetOverruns));
+    append(&text, "project_service_skipped_jobs_total{service=\"%s\"} %llu\n", pMon->name,
+           (unsigned long long)LOAD(pMon->skippedJobs));
+    append(&text, "project_service_release_timeouts_total{service=\"%s\"} %llu\n", pMon->name,
+           (unsigned long long)LOAD(pBlock->releaseTimeouts[ind]));
+    append(&text, "project_service_page_faults_total{service=\"%s\",type=\"minor\"} %llu\n", pMon->name,
+           (unsigned long long)LOAD(pMon->minorFaults));
+    append(&text, "project_service_page_faults_total{service=\"%s\",type=\"major\"} %llu\n", pMon->name,
+           (unsigned long long)LOAD(pMon->majorFaults));
+
+    /* hardware counters (-P), per measured job */
+    const perfStats_t *pPerf = &pMon->perf;
+    uint32_t available = LOAD(pPerf->available);
+    uint64_t perfJobs = LOAD(pPerf->jobs);
+    for(unsigned int counter = 0; (perfJobs != 0) && (counter < PERF_COUNTER_END); ++counter) {
+      if(available & (1U << counter)) {
+        append(&text, "project_service_perf_per_job{service=\"%s\",counter=\"%s\"} %.1f\n", pMon->name,
+               perf_counter_name(counter), (double)LOAD(pPerf->sum[counter]) / perfJobs);
+      }
+    }
+  }
+
+  for(unsigned int stage = 0; stage < LATENCY_STAGE_END; ++stage) {
+    const latencyHist_t *pHist = &pBlock->latency.stages[stage];
+    const char *name = latency_stage_name(stage);
+    append(&text, "project_frame_latency_count{stage=\"%s\"} %llu\n", name, (unsigned long long)LOAD(pHist->count));
+    for(unsigned int q = 0; q < (sizeof(quantiles) / sizeof(quantiles[0])); ++q) {
+      append(&text, "project_frame_latency_us{stage=\"%s\",quantile=\"%g\"} %.1f\n", name, quantiles[q] / 100.0,
+             NSEC_TO_USEC(latency_hist_percentile(pHist, quantiles[q])));
+    }
+    append(&text, "project_frame_latency_max_us{stage=\"%s\"} %.1f\n", name, NSEC_TO_USEC(LOAD(pHist->maxNs)));
+  }
+  return text.used;
+}
+
+/*---------------------------------------------------------------------------------*/
+int metrics_serve(const char *path, const cpu_set_t *pCpuSet)
+{
+  struct sockaddr_un addr;
+
+  if((pMetrics == NULL) || (serverFd >= 0) || (strlen(path) >= sizeof(addr.sun_path))) {
+    return -1;
+  }
+  memset(&addr, 0, sizeof(struct sockaddr_un));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+  strncpy(serverPath, path, sizeof(serverPath) - 1);
+
+  unlink(path);
+  serverFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  stopFd = eventfd(0, EFD_CLOEXEC);
+  int rtnCode = -1;
+  if((serverFd < 0) || (stopFd < 0) || (bind(serverFd, (struct sockaddr *)&addr, sizeof(addr)) != 0) ||
+     (listen(serverFd, 4) != 0)) {
+    syslog(LOG_ERR, "%s couldn't listen on %s, errno: %d [%s]", __func__, path, errno, strerror(errno));
+  } else {
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+    if(pCpuSet != NULL) {
+      pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), pCpuSet);
+    }
+    rtnCode = pthread_create(&serverThread, &attr, metrics_server_thread, NULL);
+    pthread_attr_destroy(&attr);
+    if(rtnCode != 0) {
+      syslog(LOG_ERR, "%s couldn't create server thread", __func__);
+      unlink(path);
+    }
+  }
+
+  if(rtnCode != 0) {
+    if(serverFd >= 0) {
+      close(serverFd);
+    }
+    if(stopFd >= 0) {
+      close(stopFd);
+    }
+    serverFd = -1;
+    stopFd = -1;
+    return -1;
+  }
+  syslog(LOG_INFO, "%s metrics on %s", __func__, path);
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * One snapshot per connection until metrics_destroy writes stopFd.
+ */
+static void *metrics_server_thread(void *arg)
+{
+  struct pollfd fds[2];
+  char *pText = (char *)malloc(METRICS_TEXT_LEN);
+
+  if(pText == NULL) {
+    return NULL;
+  }
+  fds[0].fd = serverFd;
+  fds[0].events = POLLIN;
+  fds[1].fd = stopFd;
+  fds[1].events = POLLIN;
+  for(;;) {
+    if(poll(fds, 2, -1) < 0) {
+      if(errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    if(fds[1].revents & POLLIN) {
+      break;
+    }
+    if(!(fds[0].revents & POLLIN)) {
+      continue;
+    }
+    int client = accept4(serverFd, NULL, NULL, SOCK_CLOEXEC);
+    if(client < 0) {
+      continue;
+    }
+    size_t len = metrics_format(pMetrics, pText, METRICS_TEXT_LEN);
+    for(size_t sent = 0; sent < len;) {
+      ssize_t cnt = send(client, pText + sent, len - sent, MSG_NOSIGNAL);
+      if(cnt <= 0) {
+        break;
+      }
+      sent += cnt;
+    }
+    close(client);
+  }
+  free(pText);
+  return NULL;
+}
+
+/*---------------------------------------------------------------------------------*/
+static void append(textBuf_t *pText, const char *fmt, ...)
+{
+  va_list args;
+
+  if(pText->used >= (pText->len - 1)) {
+    return;
+  }
+  va_start(args, fmt);
+  int cnt = vsnprintf(pText->pBuf + pText->used, pText->len - pText->used, fmt, args);
+  va_end(args);
+  if(cnt > 0) {
+    pText->used += cnt;
+    if(pText->used > (pText->len - 1)) {
+      pText->used = pText->len - 1;
+    }
+  }
+}
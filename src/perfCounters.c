@@ -0,0 +1,250 @@
+/***********************************************************************************
+ * @author Brian Ibeling
+ * ibelingb@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file perfCounters.c
+ * @brief optional per-service hardware counters (see perfCounters.h)
+ *
+ ************************************************************************************
+ */
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <syslog.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+/* project headers */
+#include "perfCounters.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define PERF_LOAD(field)              __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#define PERF_STORE(field, val)        __atomic_store_n(&(field), (val), __ATOMIC_RELAXED)
+
+/* read() of a PERF_FORMAT_GROUP leader with both times */
+typedef struct {
+  uint64_t nr;
+  uint64_t timeEnabled;
+  uint64_t timeRunning;
+  uint64_t values[PERF_COUNTER_END];
+} perfGroupRead_t;
+
+typedef struct {
+  uint32_t type;
+  uint64_t config;
+  const char *name;
+} perfEventDef_t;
+
+static const perfEventDef_t eventDefs[PERF_COUNTER_END] = {
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES,        "cycles"},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS,      "instructions"},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES,  "cacheRefs"},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES,      "cacheMisses"},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES,     "branchMisses"},
+  {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES,  "contextSwitches"},
+};
+
+static uint8_t perfEnabled = 0;
+
+/* counter group of the calling thread */
+static __thread int groupFd = -1;
+static __thread int memberFds[PERF_COUNTER_END];
+static __thread uint8_t numMembers = 0;
+static __thread uint8_t slotCounter[PERF_COUNTER_END];   /* PerfCounter_e of each value slot */
+static __thread perfStats_t *pThreadStats = NULL;
+static __thread perfGroupRead_t jobStart;
+
+/*---------------------------------------------------------------------------------*/
+/* PRIVATE FUNCTIONS */
+static int open_counter(unsigned int counter, int leaderFd);
+static int read_group(perfGroupRead_t *pRead);
+
+/*---------------------------------------------------------------------------------*/
+void perf_enable(void)
+{
+  perfEnabled = 1;
+}
+
+/*---------------------------------------------------------------------------------*/
+int perf_open(perfStats_t *pStats)
+{
+  if(!perfEnabled || (groupFd >= 0)) {
+    return 0;
+  }
+
+  /* the first counter that opens leads the group, the rest join it */
+  uint32_t available = 0;
+  for(unsigned int counter = 0; counter < PERF_COUNTER_END; ++counter) {
+    int fd = open_counter(counter, groupFd);
+    if(fd < 0) {
+      syslog(LOG_WARNING, "%s %s unavailable: %s", __func__, eventDefs[counter].name, strerror(errno));
+      continue;
+    }
+    if(groupFd < 0) {
+      groupFd = fd;
+    }
+    memberFds[numMembers] = fd;
+    slotCounter[numMembers] = counter;
+    ++numMembers;
+    available |= (1U << counter);
+  }
+  if(groupFd < 0) {
+    syslog(LOG_ERR, "%s no counters available", __func__);
+    return -1;
+  }
+
+  pThreadStats = pStats;
+  PERF_STORE(pStats->available, available);
+  ioctl(groupFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(groupFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  jobStart.nr = 0;
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+void perf_close(void)
+{
+  if(groupFd < 0) {
+    return;
+  }
+  ioctl(groupFd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+  for(uint8_t ind = 0; ind < numMembers; ++ind) {
+    close(memberFds[ind]);
+  }
+  groupFd = -1;
+  numMembers = 0;
+  pThreadStats = NULL;
+}
+
+/*---------------------------------------------------------------------------------*/
+void perf_job_start(void)
+{
+  if(groupFd < 0) {
+    return;
+  }
+  if(read_group(&jobStart) != 0) {
+    jobStart.nr = 0;
+  }
+}
+
+/*---------------------------------------------------------------------------------*/
+void perf_job_end(uint64_t job)
+{
+  perfGroupRead_t jobEnd;
+
+  if((groupFd < 0) || (jobStart.nr == 0)) {
+    return;
+  }
+  perfStats_t *pStats = pThreadStats;
+  uint8_t haveEnd = (read_group(&jobEnd) == 0);
+  jobStart.nr = 0;
+  if(!haveEnd) {
+    return;
+  }
+
+  /* partly multiplexed off the PMU: the deltas would only be estimates */
+  if((jobEnd.timeRunning - jobStart.timeRunning) < (jobEnd.timeEnabled - jobStart.timeEnabled)) {
+    PERF_STORE(pStats->unscheduled, pStats->unscheduled + 1);
+    return;
+  }
+  for(uint8_t slot = 0; slot < numMembers; ++slot) {
+    uint8_t counter = slotCounter[slot];
+    uint64_t delta = jobEnd.values[slot] - jobStart.values[slot];
+    PERF_STORE(pStats->sum[counter], pStats->sum[counter] + delta);
+    if(delta > pStats->max[counter]) {
+      PERF_STORE(pStats->max[counter], delta);
+      PERF_STORE(pStats->maxJob[counter], job);
+    }
+  }
+  PERF_STORE(pStats->jobs, pStats->jobs + 1);
+}
+
+/*---------------------------------------------------------------------------------*/
+void perf_report(const perfStats_t *pStats, const char *name)
+{
+  uint32_t available = PERF_LOAD(pStats->available);
+  uint64_t jobs = PERF_LOAD(pStats->jobs);
+
+  if(available == 0) {
+    return;
+  }
+  if(jobs == 0) {
+    syslog(LOG_INFO, "%s %s: no jobs counted, unscheduled, %llu", __func__, name,
+           (unsigned long long)PERF_LOAD(pStats->unscheduled));
+    return;
+  }
+  for(unsigned int counter = 0; counter < PERF_COUNTER_END; ++counter) {
+    if(available & (1U << counter)) {
+      syslog(LOG_INFO, "%s %s %s: jobs, %llu, per job avg, %.1f, max, %llu (job %llu)", __func__, name,
+             eventDefs[counter].name, (unsigned long long)jobs, (double)PERF_LOAD(pStats->sum[counter]) / jobs,
+             (unsigned long long)PERF_LOAD(pStats->max[counter]), (unsigned long long)PERF_LOAD(pStats->maxJob[counter]));
+    }
+  }
+
+  /* the ratios a data layout change should move */
+  uint32_t ipcMask = (1U << PERF_CYCLES) | (1U << PERF_INSTRUCTIONS);
+  uint32_t missMask = (1U << PERF_CACHE_REFS) | (1U << PERF_CACHE_MISSES);
+  double ipc = 0.0;
+  double missPct = 0.0;
+  if(((available & ipcMask) == ipcMask) && (PERF_LOAD(pStats->sum[PERF_CYCLES]) != 0)) {
+    ipc = (double)PERF_LOAD(pStats->sum[PERF_INSTRUCTIONS]) / PERF_LOAD(pStats->sum[PERF_CYCLES]);
+  }
+  if(((available & missMask) == missMask) && (PERF_LOAD(pStats->sum[PERF_CACHE_REFS]) != 0)) {
+    missPct = (100.0 * PERF_LOAD(pStats->sum[PERF_CACHE_MISSES])) / PERF_LOAD(pStats->sum[PERF_CACHE_REFS]);
+  }
+  syslog(LOG_INFO, "%s %s: ipc, %.2f, cache miss, %.2f %%, unscheduled jobs, %llu", __func__, name, ipc, missPct,
+         (unsigned long long)PERF_LOAD(pStats->unscheduled));
+}
+
+/*---------------------------------------------------------------------------------*/
+const char *perf_counter_name(unsigned int counter)
+{
+  return (counter < PERF_COUNTER_END) ? eventDefs[counter].name : "?";
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * Counts the calling thread on any core. Kernel time is included when allowed
+ * (mq / eventfd syscalls are part of the job), else user space only.
+ */
+static int open_counter(unsigned int counter, int leaderFd)
+{
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(struct perf_event_attr));
+  attr.size = sizeof(struct perf_event_attr);
+  attr.type = eventDefs[counter].type;
+  attr.config = eventDefs[counter].config;
+  attr.disabled = (leaderFd < 0) ? 1 : 0;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+  int fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, leaderFd, 0);
+  if((fd < 0) && ((errno == EACCES) || (errno == EPERM))) {
+    attr.exclude_kernel = 1;
+    fd = (int)syscall(__NR_perf_event_open, &attr, 0, -1, leaderFd, 0);
+  }
+  return fd;
+}
+
+/*---------------------------------------------------------------------------------*/
+static int read_group(perfGroupRead_t *pRead)
+{
+  ssize_t size = read(groupFd, pRead, sizeof(perfGroupRead_t));
+  if((size < (ssize_t)(3 * sizeof(uint64_t))) || (pRead->nr != numMembers)) {
+    return -1;
+  }
+  return 0;
+}
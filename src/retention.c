@@ -0,0 +1,561 @@
+/***********************************************************************************
+ * @author Joshua Malburg
+ * joshua.malburg@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file retention.c
+ * @brief disk space bounded retention of output files (see retention.h)
+ *
+ ************************************************************************************
+ */
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdint.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+
+/* project headers */
+#include "retention.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define RING_ENTRY(pMgr, ind)  (&(pMgr)->pFiles[((pMgr)->head + (ind)) % (pMgr)->ringLen])
+
+/* still image extensions of the encoder pool / per-frame fallback */
+static const char *stillExts[] = {"ppm", "pgm", "png", "jpg", NULL};
+
+/*---------------------------------------------------------------------------------*/
+/* PRIVATE FUNCTIONS */
+static void *retention_worker(void *arg);
+static void retention_scan(retentionMgr_t *pMgr);
+static int track_locked(retentionMgr_t *pMgr, const char *path);
+static void claim_locked(retentionMgr_t *pMgr, const char *path);
+static void evict(retentionMgr_t *pMgr, const retentionFile_t *pFile);
+static uint64_t free_bytes(const retentionMgr_t *pMgr);
+static int is_output(const char *name);
+static int compare_mtime(const void *pA, const void *pB);
+
+/*---------------------------------------------------------------------------------*/
+int retention_start(retentionMgr_t *pMgr, const char *dir, uint64_t maxBytes, unsigned int maxFiles,
+                    uint64_t minFreeBytes, const cpu_set_t *pCpuSet)
+{
+  if((pMgr == NULL) || (dir == NULL) || (maxFiles == 0)) {
+    return -1;
+  }
+  memset(pMgr, 0, sizeof(retentionMgr_t));
+  strncpy(pMgr->dir, dir, sizeof(pMgr->dir) - 1);
+  pMgr->maxBytes = maxBytes;
+  pMgr->maxFiles = maxFiles;
+  pMgr->minFreeBytes = minFreeBytes;
+  pMgr->ringLen = maxFiles + RETENTION_TRACK_SLACK;
+
+  pMgr->pFiles = (retentionFile_t *)calloc(pMgr->ringLen, sizeof(retentionFile_t));
+  if(pMgr->pFiles == NULL) {
+    syslog(LOG_ERR, "%s couldn't allocate ring", __func__);
+    return -1;
+  }
+
+  /* adopt what previous runs left behind before anything new is tracked */
+  if(maxBytes != 0) {
+    retention_scan(pMgr);
+  }
+
+  pthread_mutex_init(&pMgr->mutex, NULL);
+  pthread_cond_init(&pMgr->workCond, NULL);
+  pMgr->running = 1;
+
+  /* deletes and segment I/O run at SCHED_OTHER so only idle time is used */
+  pthread_attr_t attr;
+  struct sched_param param;
+  memset(&param, 0, sizeof(param));
+  pthread_attr_init(&attr);
+  pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+  pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+  pthread_attr_setschedparam(&attr, &param);
+  if(pCpuSet != NULL) {
+    pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), pCpuSet);
+  }
+  int rtn = pthread_create(&pMgr->thread, &attr, retention_worker, (void *)pMgr);
+  pthread_attr_destroy(&attr);
+  if(rtn != 0) {
+    syslog(LOG_ERR, "%s couldn't create retention thread", __func__);
+    pthread_mutex_destroy(&pMgr->mutex);
+    pthread_cond_destroy(&pMgr->workCond);
+    free(pMgr->pFiles);
+    memset(pMgr, 0, sizeof(retentionMgr_t));
+    return -1;
+  }
+  pMgr->started = 1;
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+int retention_track(retentionMgr_t *pMgr, const char *path)
+{
+  if((pMgr == NULL) || !pMgr->started || (path == NULL) || (path[0] == '\0')) {
+    return -1;
+  }
+
+  pthread_mutex_lock(&pMgr->mutex);
+  int rtn = track_locked(pMgr, path);
+  pthread_mutex_unlock(&pMgr->mutex);
+  return rtn;
+}
+
+/*---------------------------------------------------------------------------------*/
+void retention_claim(retentionMgr_t *pMgr, const char *path)
+{
+  if((pMgr == NULL) || !pMgr->started || (path == NULL)) {
+    return;
+  }
+  pthread_mutex_lock(&pMgr->mutex);
+  claim_locked(pMgr, path);
+  pthread_mutex_unlock(&pMgr->mutex);
+}
+
+/*---------------------------------------------------------------------------------*/
+int retention_prepare_segment(retentionMgr_t *pMgr, const char *path, uint32_t maxFrames, uint64_t capacity)
+{
+  if((pMgr == NULL) || !pMgr->started || (path == NULL) || (maxFrames == 0) || (capacity == 0)) {
+    return -1;
+  }
+  pthread_mutex_lock(&pMgr->mutex);
+  if((pMgr->nextState == SEGMENT_BUILDING) || (pMgr->nextState == SEGMENT_READY)) {
+    /* one segment at a time; the write service takes or cancels it first */
+    pthread_mutex_unlock(&pMgr->mutex);
+    return -1;
+  }
+  strncpy(pMgr->next.path, path, RETENTION_PATH_LEN - 1);
+  pMgr->next.path[RETENTION_PATH_LEN - 1] = '\0';
+  pMgr->nextFrames = maxFrames;
+  pMgr->nextLen = capacity;
+  pMgr->nextState = SEGMENT_PENDING;
+  pthread_cond_signal(&pMgr->workCond);
+  pthread_mutex_unlock(&pMgr->mutex);
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+int retention_take_segment(retentionMgr_t *pMgr, const char *path, frameArchive_t *pArchive)
+{
+  int rtn = -1;
+
+  if((pMgr == NULL) || !pMgr->started || (path == NULL)) {
+    return -1;
+  }
+  pthread_mutex_lock(&pMgr->mutex);
+  if(strcmp(pMgr->next.path, path) == 0) {
+    if(pMgr->nextState == SEGMENT_READY) {
+      *pArchive = pMgr->next.archive;
+      pMgr->next.path[0] = '\0';
+      pMgr->nextState = SEGMENT_NONE;
+      rtn = 0;
+    } else if((pMgr->nextState == SEGMENT_PENDING) || (pMgr->nextState == SEGMENT_BUILDING)) {
+      rtn = 1;
+    }
+  }
+  pthread_mutex_unlock(&pMgr->mutex);
+  return rtn;
+}
+
+/*---------------------------------------------------------------------------------*/
+void retention_cancel_segment(retentionMgr_t *pMgr, const char *path)
+{
+  if((pMgr == NULL) || !pMgr->started || (path == NULL)) {
+    return;
+  }
+
+  pthread_mutex_lock(&pMgr->mutex);
+  if(strcmp(pMgr->next.path, path) != 0) {
+    pthread_mutex_unlock(&pMgr->mutex);
+    return;
+  }
+  if(pMgr->nextState == SEGMENT_BUILDING) {
+    /* the thread removes it once created */
+    pMgr->nextState = SEGMENT_CANCELLED;
+    pthread_mutex_unlock(&pMgr->mutex);
+    return;
+  }
+  retentionSegment_t seg = pMgr->next;
+  uint8_t ready = (pMgr->nextState == SEGMENT_READY);
+  pMgr->next.path[0] = '\0';
+  pMgr->nextState = SEGMENT_NONE;
+  pthread_mutex_unlock(&pMgr->mutex);
+
+  /* also removes what a failed attempt left behind */
+  if(ready) {
+    archive_close(&seg.archive);
+  }
+  unlink(seg.path);
+}
+
+/*---------------------------------------------------------------------------------*/
+void retention_retire_segment(retentionMgr_t *pMgr, frameArchive_t *pArchive, const char *path)
+{
+  if((pMgr != NULL) && pMgr->started) {
+    pthread_mutex_lock(&pMgr->mutex);
+    if(pMgr->retireCnt < RETENTION_RETIRE_LEN) {
+      retentionSegment_t *pSeg = &pMgr->retire[pMgr->retireCnt++];
+      pSeg->archive = *pArchive;
+      strncpy(pSeg->path, path, RETENTION_PATH_LEN - 1);
+      pSeg->path[RETENTION_PATH_LEN - 1] = '\0';
+      pthread_cond_signal(&pMgr->workCond);
+      pthread_mutex_unlock(&pMgr->mutex);
+
+      /* the manager owns it now */
+      memset(pArchive, 0, sizeof(frameArchive_t));
+      pArchive->fd = -1;
+      return;
+    }
+    ++pMgr->retireSyncCnt;
+    pthread_mutex_unlock(&pMgr->mutex);
+    syslog(LOG_WARNING, "%s %u segments already waiting, closing %s in the caller", __func__, RETENTION_RETIRE_LEN, path);
+  }
+  archive_close(pArchive);
+  retention_track(pMgr, path);
+}
+
+/*---------------------------------------------------------------------------------*/
+void retention_stop(retentionMgr_t *pMgr)
+{
+  if((pMgr == NULL) || !pMgr->started) {
+    return;
+  }
+
+  pthread_mutex_lock(&pMgr->mutex);
+  pMgr->running = 0;
+  pthread_cond_broadcast(&pMgr->workCond);
+  pthread_mutex_unlock(&pMgr->mutex);
+  pthread_join(pMgr->thread, NULL);
+
+  /* a prepared segment nobody took */
+  if(pMgr->nextState == SEGMENT_READY) {
+    archive_close(&pMgr->next.archive);
+    unlink(pMgr->next.path);
+  }
+
+  syslog(LOG_INFO, "%s kept: %u files (%llu bytes), deleted: %lu files (%llu bytes), untracked: %lu, "
+         "segments prepared: %lu (failed %lu), retired: %lu (closed by caller %lu)",
+         __func__, pMgr->liveCnt, (unsigned long long)pMgr->totalBytes, pMgr->deletedCnt, pMgr->deletedBytes,
+         pMgr->untrackedCnt, pMgr->preparedCnt, pMgr->prepareFailCnt, pMgr->retiredCnt, pMgr->retireSyncCnt);
+  pthread_mutex_destroy(&pMgr->mutex);
+  pthread_cond_destroy(&pMgr->workCond);
+  free(pMgr->pFiles);
+  memset(pMgr, 0, sizeof(retentionMgr_t));
+}
+
+/*---------------------------------------------------------------------------------*/
+static void *retention_worker(void *arg)
+{
+  retentionMgr_t *pMgr = (retentionMgr_t *)arg;
+  struct timespec timeout;
+  uint8_t stuck = 0;
+
+  pthread_mutex_lock(&pMgr->mutex);
+  while(1) {
+    /* size newly tracked files; stat outside the lock */
+    while(pMgr->sizedCnt < pMgr->count) {
+      retentionFile_t *pFile = RING_ENTRY(pMgr, pMgr->sizedCnt);
+      if(pFile->path[0] != '\0') {
+        char path[RETENTION_PATH_LEN];
+        struct stat fileStat;
+        strcpy(path, pFile->path);
+        pthread_mutex_unlock(&pMgr->mutex);
+        int rtn = stat(path, &fileStat);
+        pthread_mutex_lock(&pMgr->mutex);
+        if(pFile->path[0] != '\0') {
+          if(rtn == 0) {
+            pFile->size = (uint64_t)fileStat.st_blocks * 512;
+            pFile->mtime = fileStat.st_mtim;
+            pMgr->totalBytes += pFile->size;
+          } else {
+            pFile->path[0] = '\0';
+            --pMgr->liveCnt;
+          }
+        }
+      }
+      ++pMgr->sizedCnt;
+    }
+
+    /* close full segments first so the budget sees their trimmed size */
+    if(pMgr->retireCnt != 0) {
+      retentionSegment_t seg = pMgr->retire[0];
+      --pMgr->retireCnt;
+      memmove(&pMgr->retire[0], &pMgr->retire[1], pMgr->retireCnt * sizeof(retentionSegment_t));
+      pthread_mutex_unlock(&pMgr->mutex);
+      if(archive_close(&seg.archive) != 0) {
+        syslog(LOG_ERR, "%s couldn't close %s cleanly", __func__, seg.path);
+      }
+      pthread_mutex_lock(&pMgr->mutex);
+      ++pMgr->retiredCnt;
+      track_locked(pMgr, seg.path);
+      continue;
+    }
+
+    /* delete the oldest file, then re-check; the requested segment counts as used */
+    uint64_t reserve = (pMgr->nextState == SEGMENT_PENDING) ? pMgr->nextLen : 0;
+    pthread_mutex_unlock(&pMgr->mutex);
+    uint64_t freeBytes = free_bytes(pMgr);
+    pthread_mutex_lock(&pMgr->mutex);
+    if((pMgr->maxBytes != 0) &&
+       (((pMgr->totalBytes + reserve) > pMgr->maxBytes) || (pMgr->liveCnt > pMgr->maxFiles) ||
+        (freeBytes < (pMgr->minFreeBytes + reserve)))) {
+      if(pMgr->sizedCnt != 0) {
+        retentionFile_t oldest = *RING_ENTRY(pMgr, 0);
+        pMgr->head = (pMgr->head + 1) % pMgr->ringLen;
+        --pMgr->count;
+        --pMgr->sizedCnt;
+        if(oldest.path[0] != '\0') {
+          --pMgr->liveCnt;
+          pMgr->totalBytes -= oldest.size;
+          pthread_mutex_unlock(&pMgr->mutex);
+          evict(pMgr, &oldest);
+          pthread_mutex_lock(&pMgr->mutex);
+        }
+        continue;
+      }
+      if(!stuck) {
+        syslog(LOG_ERR, "%s over budget with nothing left to delete (free: %llu bytes)", __func__, (unsigned long long)freeBytes);
+        stuck = 1;
+      }
+    } else {
+      stuck = 0;
+    }
+
+    /* create, preallocate and map the next segment now that there is room for it */
+    if((pMgr->nextState == SEGMENT_PENDING) && pMgr->running) {
+      retentionSegment_t seg;
+      strcpy(seg.path, pMgr->next.path);
+      uint32_t frames = pMgr->nextFrames;
+      uint64_t len = pMgr->nextLen;
+      pMgr->nextState = SEGMENT_BUILDING;
+      claim_locked(pMgr, seg.path);
+      pthread_mutex_unlock(&pMgr->mutex);
+      int rtn = archive_create(&seg.archive, seg.path, frames, len);
+      pthread_mutex_lock(&pMgr->mutex);
+      if(pMgr->nextState == SEGMENT_BUILDING) {
+        if(rtn == 0) {
+          pMgr->next.archive = seg.archive;
+          pMgr->nextState = SEGMENT_READY;
+          ++pMgr->preparedCnt;
+        } else {
+          syslog(LOG_ERR, "%s couldn't prepare %s (%llu bytes)", __func__, seg.path, (unsigned long long)len);
+          pMgr->nextState = SEGMENT_NONE;
+          ++pMgr->prepareFailCnt;
+        }
+      } else {
+        /* cancelled meanwhile */
+        pMgr->nextState = SEGMENT_NONE;
+        pMgr->next.path[0] = '\0';
+        pthread_mutex_unlock(&pMgr->mutex);
+        if(rtn == 0) {
+          archive_close(&seg.archive);
+        }
+        unlink(seg.path);
+        pthread_mutex_lock(&pMgr->mutex);
+      }
+      continue;
+    }
+
+    if(!pMgr->running) {
+      break;
+    }
+    if(pMgr->sizedCnt == pMgr->count) {
+      clock_gettime(CLOCK_REALTIME, &timeout);
+      timeout.tv_sec += RETENTION_POLL_MSEC / 1000;
+      timeout.tv_nsec += (RETENTION_POLL_MSEC % 1000) * 1000000L;
+      if(timeout.tv_nsec >= 1000000000L) {
+        timeout.tv_sec += 1;
+        timeout.tv_nsec -= 1000000000L;
+      }
+      pthread_cond_timedwait(&pMgr->workCond, &pMgr->mutex, &timeout);
+    }
+  }
+  pthread_mutex_unlock(&pMgr->mutex);
+  return NULL;
+}
+
+/*---------------------------------------------------------------------------------*/
+static void retention_scan(retentionMgr_t *pMgr)
+{
+  DIR *pDir = opendir(pMgr->dir);
+  if(pDir == NULL) {
+    syslog(LOG_ERR, "%s couldn't open %s, errno: %d [%s]", __func__, pMgr->dir, errno, strerror(errno));
+    return;
+  }
+
+  retentionFile_t *pFound = NULL;
+  unsigned int foundCnt = 0, foundCap = 0;
+  struct dirent *pEntry;
+  while((pEntry = readdir(pDir)) != NULL) {
+    if(!is_output(pEntry->d_name)) {
+      continue;
+    }
+    if(foundCnt == foundCap) {
+      unsigned int newCap = (foundCap == 0) ? 256 : (foundCap * 2);
+      retentionFile_t *pNew = (retentionFile_t *)realloc(pFound, newCap * sizeof(retentionFile_t));
+      if(pNew == NULL) {
+        break;
+      }
+      pFound = pNew;
+      foundCap = newCap;
+    }
+    retentionFile_t *pFile = &pFound[foundCnt];
+    struct stat fileStat;
+    if((snprintf(pFile->path, RETENTION_PATH_LEN, "%s/%s", pMgr->dir, pEntry->d_name) >= RETENTION_PATH_LEN) ||
+       (stat(pFile->path, &fileStat) != 0) || !S_ISREG(fileStat.st_mode)) {
+      continue;
+    }
+    pFile->size = (uint64_t)fileStat.st_blocks * 512;
+    pFile->mtime = fileStat.st_mtim;
+    ++foundCnt;
+  }
+  closedir(pDir);
+
+  /* oldest first; whatever doesn't fit the file budget goes now */
+  qsort(pFound, foundCnt, sizeof(retentionFile_t), compare_mtime);
+  unsigned int first = (foundCnt > pMgr->maxFiles) ? (foundCnt - pMgr->maxFiles) : 0;
+  for(unsigned int ind = 0; ind < first; ++ind) {
+    evict(pMgr, &pFound[ind]);
+  }
+  for(unsigned int ind = first; ind < foundCnt; ++ind) {
+    *RING_ENTRY(pMgr, pMgr->count) = pFound[ind];
+    ++pMgr->count;
+    pMgr->totalBytes += pFound[ind].size;
+  }
+  pMgr->sizedCnt = pMgr->count;
+  pMgr->liveCnt = pMgr->count;
+  free(pFound);
+
+  syslog(LOG_INFO, "%s adopted %u existing outputs (%llu bytes) in %s", __func__, pMgr->count,
+         (unsigned long long)pMgr->totalBytes, pMgr->dir);
+}
+
+/*---------------------------------------------------------------------------------*/
+static int track_locked(retentionMgr_t *pMgr, const char *path)
+{
+  /* without a budget nothing is ever deleted, so nothing needs tracking */
+  if(pMgr->maxBytes == 0) {
+    return 0;
+  }
+  if(pMgr->count == pMgr->ringLen) {
+    ++pMgr->untrackedCnt;
+    return -1;
+  }
+  retentionFile_t *pFile = RING_ENTRY(pMgr, pMgr->count);
+  strncpy(pFile->path, path, RETENTION_PATH_LEN - 1);
+  pFile->path[RETENTION_PATH_LEN - 1] = '\0';
+  pFile->size = 0;
+  ++pMgr->count;
+  ++pMgr->liveCnt;
+  pthread_cond_signal(&pMgr->workCond);
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+static void claim_locked(retentionMgr_t *pMgr, const char *path)
+{
+  for(unsigned int ind = 0; ind < pMgr->count; ++ind) {
+    retentionFile_t *pFile = RING_ENTRY(pMgr, ind);
+    if((pFile->path[0] != '\0') && (strcmp(pFile->path, path) == 0)) {
+      if(ind < pMgr->sizedCnt) {
+        pMgr->totalBytes -= pFile->size;
+      }
+      pFile->path[0] = '\0';
+      --pMgr->liveCnt;
+    }
+  }
+}
+
+/*---------------------------------------------------------------------------------*/
+static void evict(retentionMgr_t *pMgr, const retentionFile_t *pFile)
+{
+  struct stat fileStat;
+
+  /* a file rewritten since it was tracked (same name, newer run) is not ours to delete */
+  if(stat(pFile->path, &fileStat) != 0) {
+    return;
+  }
+  if((fileStat.st_mtim.tv_sec != pFile->mtime.tv_sec) || (fileStat.st_mtim.tv_nsec != pFile->mtime.tv_nsec)) {
+    return;
+  }
+  if(unlink(pFile->path) != 0) {
+    syslog(LOG_ERR, "%s couldn't delete %s, errno: %d [%s]", __func__, pFile->path, errno, strerror(errno));
+    return;
+  }
+  ++pMgr->deletedCnt;
+  pMgr->deletedBytes += pFile->size;
+}
+
+/*---------------------------------------------------------------------------------*/
+static uint64_t free_bytes(const retentionMgr_t *pMgr)
+{
+  struct statvfs fsStat;
+  if(statvfs(pMgr->dir, &fsStat) != 0) {
+    return UINT64_MAX;
+  }
+  return (uint64_t)fsStat.f_bavail * fsStat.f_frsize;
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * Only names the application writes itself are adopted (and so may be deleted):
+ * f<frame>_filt<n>_hough<n>.<still ext>, video_<seg>.avi and
+ * frames_filt<n>_hough<n>_<seg>.farc. Anything else in the directory, such as a
+ * replay input, is left alone.
+ */
+static int is_output(const char *name)
+{
+  int frame, filt, hough, len;
+  unsigned int seg;
+  char ext[8];
+
+  len = -1;
+  if((sscanf(name, "f%d_filt%d_hough%d.%7[a-z]%n", &frame, &filt, &hough, ext, &len) == 4) && (len > 0) &&
+     (name[len] == '\0')) {
+    for(unsigned int ind = 0; stillExts[ind] != NULL; ++ind) {
+      if(strcmp(ext, stillExts[ind]) == 0) {
+        return 1;
+      }
+    }
+    return 0;
+  }
+  len = -1;
+  if((sscanf(name, "video_%u.avi%n", &seg, &len) == 1) && (len > 0) && (name[len] == '\0')) {
+    return 1;
+  }
+  len = -1;
+  if((sscanf(name, "frames_filt%d_hough%d_%u.farc%n", &filt, &hough, &seg, &len) == 3) && (len > 0) &&
+     (name[len] == '\0')) {
+    return 1;
+  }
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+static int compare_mtime(const void *pA, const void *pB)
+{
+  const struct timespec *pTimeA = &((const retentionFile_t *)pA)->mtime;
+  const struct timespec *pTimeB = &((const retentionFile_t *)pB)->mtime;
+  if(pTimeA->tv_sec != pTimeB->tv_sec) {
+    return (pTimeA->tv_sec < pTimeB->tv_sec) ? -1 : 1;
+  }
+  if(pTimeA->tv_nsec != pTimeB->tv_nsec) {
+    return (pTimeA->tv_nsec < pTimeB->tv_nsec) ? -1 : 1;
+  }
+  return 0;
+}
@@ -0,0 +1,238 @@
+/***********************************************************************************
+ * @author Brian Ibeling
+ * ibelingb@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file rmAnalysis.c
+ * @brief rate monotonic feasibility of the service schedule (see rmAnalysis.h)
+ *
+ ************************************************************************************
+ * References and Resources:
+ *   - Liu & Layland, Scheduling Algorithms for Multiprogramming in a Hard Real-Time
+ *     Environment, JACM 1973
+ *   - Joseph & Pandya, Finding Response Times in a Real-Time System, 1986
+ ************************************************************************************
+ */
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <math.h>
+#include <syslog.h>
+
+/* project headers */
+#include "rmAnalysis.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define PROFILE_LINE_LEN      (128)
+
+/*---------------------------------------------------------------------------------*/
+/* PRIVATE FUNCTIONS */
+static uint8_t interferes(const serviceDef_t *pOther, const serviceDef_t *pSvc);
+
+/*---------------------------------------------------------------------------------*/
+int rm_load_wcet(const serviceRegistry_t *pReg, const char *filename, uint64_t *pWcetNs)
+{
+  char line[PROFILE_LINE_LEN];
+  char name[SERVICE_NAME_LEN];
+  double wcetUs;
+  int loaded = 0;
+
+  FILE *pFile = fopen(filename, "r");
+  if(pFile == NULL) {
+    syslog(LOG_WARNING, "%s no WCET profile %s, errno: %d [%s]", __func__, filename, errno, strerror(errno));
+    return -1;
+  }
+  while(fgets(line, sizeof(line), pFile) != NULL) {
+    if((line[0] == '#') || (sscanf(line, "%15s %lf", name, &wcetUs) != 2) || (wcetUs < 0.0)) {
+      continue;
+    }
+    for(unsigned int ind = 0; ind < pReg->numServices; ++ind) {
+      if(strcmp(pReg->services[ind].name, name) == 0) {
+        pWcetNs[ind] = (uint64_t)llround(wcetUs * 1e3);
+        ++loaded;
+      }
+    }
+  }
+  fclose(pFile);
+  return loaded;
+}
+
+/*---------------------------------------------------------------------------------*/
+int rm_save_wcet(const serviceRegistry_t *pReg, const char *filename, const uint64_t *pWcetNs)
+{
+  FILE *pFile = fopen(filename, "w");
+  if(pFile == NULL) {
+    syslog(LOG_ERR, "%s couldn't open %s, errno: %d [%s]", __func__, filename, errno, strerror(errno));
+    return -1;
+  }
+  fprintf(pFile, "# service  wcet_usec (max measured execution time)\n");
+  for(unsigned int ind = 0; ind < pReg->numServices; ++ind) {
+    const serviceDef_t *pSvc = &pReg->services[ind];
+    uint64_t wcetNs = pWcetNs[ind];
+    if((pSvc->pMonitor != NULL) && (__atomic_load_n(&pSvc->pMonitor->maxExecNs, __ATOMIC_RELAXED) > wcetNs)) {
+      wcetNs = __atomic_load_n(&pSvc->pMonitor->maxExecNs, __ATOMIC_RELAXED);
+    }
+    if(wcetNs != 0) {
+      fprintf(pFile, "%s %.1f\n", pSvc->name, wcetNs / 1e3);
+    }
+  }
+  fclose(pFile);
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+int rm_analyze(const serviceRegistry_t *pReg, const uint64_t *pWcetNs, rmResult_t *pResults)
+{
+  int infeasibleCnt = 0;
+
+  if((pReg == NULL) || (pReg->baseRateHz == 0) || (pResults == NULL)) {
+    return -1;
+  }
+
+  /* C, T and D of every service */
+  for(unsigned int ind = 0; ind < pReg->numServices; ++ind) {
+    const serviceDef_t *pSvc = &pReg->services[ind];
+    rmResult_t *pRes = &pResults[ind];
+    memset(pRes, 0, sizeof(rmResult_t));
+    pRes->wcetNs = ((pWcetNs != NULL) && (pWcetNs[ind] != 0)) ? pWcetNs[ind] : (uint64_t)pSvc->runtimeUs * 1000;
+    pRes->periodNs = registry_period_ns(pReg, ind);
+    pRes->deadlineNs = (pSvc->deadlineUs != 0) ? (uint64_t)pSvc->deadlineUs * 1000 : pRes->periodNs;
+    pRes->utilization = (double)pRes->wcetNs / pRes->periodNs;
+    pRes->feasible = 1;
+    if(pRes->wcetNs == 0) {
+      syslog(LOG_WARNING, "%s %s has no WCET, left out of the analysis", __func__, pSvc->name);
+    }
+  }
+
+  /* response time analysis: R(k+1) = C + sum ceil(R(k) / Tj) * Cj until R converges or passes D */
+  for(unsigned int ind = 0; ind < pReg->numServices; ++ind) {
+    const serviceDef_t *pSvc = &pReg->services[ind];
+    rmResult_t *pRes = &pResults[ind];
+    if(pRes->wcetNs == 0) {
+      continue;
+    }
+    uint64_t respNs = pRes->wcetNs;
+    uint64_t prevNs = 0;
+    while((respNs != prevNs) && (respNs <= pRes->deadlineNs)) {
+      prevNs = respNs;
+      respNs = pRes->wcetNs;
+      for(unsigned int other = 0; other < pReg->numServices; ++other) {
+        if((other != ind) && interferes(&pReg->services[other], pSvc)) {
+          respNs += ((prevNs + pResults[other].periodNs - 1) / pResults[other].periodNs) * pResults[other].wcetNs;
+        }
+      }
+    }
+    pRes->responseNs = respNs;
+    pRes->slackNs = (int64_t)pRes->deadlineNs - (int64_t)respNs;
+    pRes->feasible = (respNs <= pRes->deadlineNs);
+    if(!pRes->feasible) {
+      ++infeasibleCnt;
+    }
+    syslog(pRes->feasible ? LOG_INFO : LOG_ERR, "%s core %d %s: C %.1f, T %.1f, D %.1f, R %.1f, slack %.1f usec, U %.3f, %s",
+           __func__, pSvc->cpuCore, pSvc->name, pRes->wcetNs / 1e3, pRes->periodNs / 1e3, pRes->deadlineNs / 1e3,
+           respNs / 1e3, pRes->slackNs / 1e3, pRes->utilization, pRes->feasible ? "feasible" : "INFEASIBLE");
+  }
+
+  /* RM least upper bound per core (sufficient only; RTA above is exact) */
+  for(unsigned int ind = 0; ind < pReg->numServices; ++ind) {
+    int core = pReg->services[ind].cpuCore;
+    uint8_t firstOnCore = 1;
+    for(unsigned int prev = 0; prev < ind; ++prev) {
+      if(pReg->services[prev].cpuCore == core) {
+        firstOnCore = 0;
+      }
+    }
+    if(!firstOnCore) {
+      continue;
+    }
+
+    double utilization = 0.0;
+    unsigned int count = 0;
+    uint8_t rateMonotonic = 1;
+    for(unsigned int svc = ind; svc < pReg->numServices; ++svc) {
+      if((pReg->services[svc].cpuCore != core) || (pResults[svc].wcetNs == 0)) {
+        continue;
+      }
+      utilization += pResults[svc].utilization;
+      ++count;
+      for(unsigned int other = ind; other < pReg->numServices; ++other) {
+        /* a longer period at a strictly higher priority isn't rate monotonic */
+        if((pReg->services[other].cpuCore == core) && (pResults[other].wcetNs != 0) &&
+           (pReg->services[other].priorityOffset < pReg->services[svc].priorityOffset) &&
+           (pResults[other].periodNs > pResults[svc].periodNs)) {
+          rateMonotonic = 0;
+        }
+      }
+    }
+    if(count == 0) {
+      continue;
+    }
+    double bound = count * (pow(2.0, 1.0 / count) - 1.0);
+    syslog((utilization <= 1.0) ? LOG_INFO : LOG_ERR, "%s core %d: %u services, U %.3f, RM bound %.3f, %s%s", __func__,
+           core, count, utilization, bound, (utilization <= bound) ? "within bound" : "above bound (RTA decides)",
+           rateMonotonic ? "" : ", priorities not rate monotonic");
+  }
+  return infeasibleCnt;
+}
+
+/*---------------------------------------------------------------------------------*/
+int rm_analyze_executor(const serviceRegistry_t *pReg, const rmResult_t *pResults, const cpu_set_t *pCpus, int priority,
+                        int housekeeping)
+{
+  int delayedCnt = 0;
+
+  if((pReg == NULL) || (pResults == NULL) || (pCpus == NULL)) {
+    return -1;
+  }
+  int workerOffset = sched_get_priority_max(SCHED_FIFO) - priority;
+
+  for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if(!CPU_ISSET(cpu, pCpus)) {
+      continue;
+    }
+
+    /* the workers have no period or WCET: only services above them are still analyzable */
+    double utilization = 0.0;
+    unsigned int count = 0;
+    for(unsigned int ind = 0; ind < pReg->numServices; ++ind) {
+      const serviceDef_t *pSvc = &pReg->services[ind];
+      if(pSvc->cpuCore != cpu) {
+        continue;
+      }
+      utilization += pResults[ind].utilization;
+      ++count;
+      uint8_t isRt = (pSvc->policy == SCHED_FIFO) || (pSvc->policy == SCHED_RR);
+      if(!isRt || (workerOffset <= pSvc->priorityOffset)) {
+        ++delayedCnt;
+        syslog(LOG_ERR, "%s core %d: workers at priority %d can delay %s by an unbounded time", __func__, cpu,
+               priority, pSvc->name);
+      }
+    }
+    if(cpu == housekeeping) {
+      syslog(LOG_WARNING, "%s core %d: workers can starve the SCHED_OTHER helpers of the housekeeping CPU", __func__,
+             cpu);
+    }
+    syslog(LOG_INFO, "%s core %d: %u services above the workers (SCHED_FIFO %d), U %.3f, %.3f left to the workers",
+           __func__, cpu, count, priority, utilization, (utilization < 1.0) ? 1.0 - utilization : 0.0);
+  }
+  return delayedCnt;
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * Whether pOther can delay pSvc: same core and at least its priority (FIFO and RR
+ * share a priority range, so the offset from max orders them).
+ */
+static uint8_t interferes(const serviceDef_t *pOther, const serviceDef_t *pSvc)
+{
+  return (pOther->cpuCore == pSvc->cpuCore) && (pOther->priorityOffset <= pSvc->priorityOffset);
+}
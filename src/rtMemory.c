@@ -0,0 +1,212 @@
+/***********************************************************************************
+ * @author Joshua Malburg
+ * joshua.malburg@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file rtMemory.c
+ * @brief locked memory and the frame arena (see rtMemory.h)
+ *
+ ************************************************************************************
+ */
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <malloc.h>
+#include <syslog.h>
+#include <sys/mman.h>
+
+/* project headers */
+#include "rtMemory.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define SLOT_ALIGN                    (64)    /* cache line */
+#define ROUND_UP(len, align)          ((((len) + (align) - 1) / (align)) * (align))
+
+/*---------------------------------------------------------------------------------*/
+/* PRIVATE FUNCTIONS */
+static uint8_t *map_frames(size_t *pLen, uint8_t hugePages, uint8_t *pGotHuge);
+
+/*---------------------------------------------------------------------------------*/
+int rt_memory_lock(void)
+{
+  /* freed heap stays with the process and large blocks come from the (locked) heap */
+  mallopt(M_TRIM_THRESHOLD, -1);
+  mallopt(M_MMAP_MAX, 0);
+
+  if(mlockall(MCL_CURRENT) != 0) {
+    syslog(LOG_WARNING, "%s mlockall failed, errno: %d [%s]; services may page fault", __func__, errno, strerror(errno));
+    return -1;
+  }
+  syslog(LOG_INFO, "%s current process memory locked", __func__);
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+void rt_stack_prefault(void)
+{
+  uint8_t stack[RT_STACK_PREFAULT];
+
+  /* volatile so the stores aren't dropped */
+  volatile uint8_t *pStack = stack;
+  for(size_t ind = 0; ind < sizeof(stack); ind += 1024) {
+    pStack[ind] = 0;
+  }
+
+  /* stacks are mapped after rt_memory_lock, so lock these pages here */
+  if(mlock(stack, sizeof(stack)) != 0) {
+    syslog(LOG_WARNING, "%s mlock failed, errno: %d [%s]", __func__, errno, strerror(errno));
+  }
+}
+
+/*---------------------------------------------------------------------------------*/
+int frame_arena_create(frameArena_t *pArena, size_t slotLen, unsigned int numSlots, uint8_t hugePages)
+{
+  memset(pArena, 0, sizeof(frameArena_t));
+  if((slotLen == 0) || (numSlots == 0)) {
+    syslog(LOG_ERR, "%s invalid arena, %zu x %u", __func__, slotLen, numSlots);
+    return -1;
+  }
+  pArena->slotLen = ROUND_UP(slotLen, SLOT_ALIGN);
+  pArena->numSlots = numSlots;
+  pArena->pFree = (unsigned int *)malloc(numSlots * sizeof(unsigned int));
+  if(pArena->pFree == NULL) {
+    syslog(LOG_ERR, "%s couldn't allocate free list", __func__);
+    return -1;
+  }
+
+  pArena->mapLen = pArena->slotLen * numSlots;
+  pArena->pBase = map_frames(&pArena->mapLen, hugePages, &pArena->hugePages);
+  if(pArena->pBase == NULL) {
+    free(pArena->pFree);
+    pArena->pFree = NULL;
+    return -1;
+  }
+
+  /* resident before the first frame; mapped after mlockall, so locked here */
+  if(mlock(pArena->pBase, pArena->mapLen) != 0) {
+    syslog(LOG_WARNING, "%s mlock failed, errno: %d [%s]", __func__, errno, strerror(errno));
+  }
+  memset(pArena->pBase, 0, pArena->mapLen);
+
+  /* lowest slots handed out first */
+  for(unsigned int ind = 0; ind < numSlots; ++ind) {
+    pArena->pFree[ind] = numSlots - 1 - ind;
+  }
+  pArena->numFree = numSlots;
+  pArena->minFree = numSlots;
+  pthread_mutex_init(&pArena->lock, NULL);
+  syslog(LOG_INFO, "%s %u frames of %zu bytes, %zu MB%s", __func__, numSlots, pArena->slotLen, pArena->mapLen >> 20,
+         pArena->hugePages ? " on hugepages" : "");
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+void *frame_arena_alloc(frameArena_t *pArena, size_t len)
+{
+  void *p = NULL;
+
+  if((pArena == NULL) || (pArena->pBase == NULL)) {
+    return malloc(len);
+  }
+  pthread_mutex_lock(&pArena->lock);
+  if((len <= pArena->slotLen) && (pArena->numFree != 0)) {
+    p = pArena->pBase + ((size_t)pArena->pFree[--pArena->numFree] * pArena->slotLen);
+    if(pArena->numFree < pArena->minFree) {
+      pArena->minFree = pArena->numFree;
+    }
+  } else {
+    ++pArena->overflows;
+  }
+  pthread_mutex_unlock(&pArena->lock);
+  return (p != NULL) ? p : malloc(len);
+}
+
+/*---------------------------------------------------------------------------------*/
+void frame_arena_free(frameArena_t *pArena, void *p)
+{
+  if((pArena == NULL) || (pArena->pBase == NULL) || ((uint8_t *)p < pArena->pBase) ||
+     ((uint8_t *)p >= pArena->pBase + (pArena->slotLen * pArena->numSlots))) {
+    free(p);
+    return;
+  }
+  pthread_mutex_lock(&pArena->lock);
+  pArena->pFree[pArena->numFree++] = (unsigned int)(((uint8_t *)p - pArena->pBase) / pArena->slotLen);
+  pthread_mutex_unlock(&pArena->lock);
+}
+
+/*---------------------------------------------------------------------------------*/
+void frame_arena_report(frameArena_t *pArena)
+{
+  if(pArena->pBase == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&pArena->lock);
+  unsigned int peak = pArena->numSlots - pArena->minFree;
+  unsigned long long overflows = pArena->overflows;
+  pthread_mutex_unlock(&pArena->lock);
+
+  syslog((overflows != 0) ? LOG_WARNING : LOG_INFO, "%s %u of %u frames used at most, %llu malloc fallbacks",
+         __func__, peak, pArena->numSlots, overflows);
+  printf("frame arena: %u of %u frames used at most, %llu malloc fallbacks%s\n", peak, pArena->numSlots, overflows,
+         pArena->hugePages ? " (hugepages)" : "");
+}
+
+/*---------------------------------------------------------------------------------*/
+void frame_arena_destroy(frameArena_t *pArena)
+{
+  if(pArena->pBase == NULL) {
+    return;
+  }
+  if(pArena->numFree != pArena->numSlots) {
+    syslog(LOG_WARNING, "%s %u frames not given back", __func__, pArena->numSlots - pArena->numFree);
+  }
+  munmap(pArena->pBase, pArena->mapLen);
+  pthread_mutex_destroy(&pArena->lock);
+  free(pArena->pFree);
+  memset(pArena, 0, sizeof(frameArena_t));
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * Anonymous mapping of at least *pLen bytes (updated to what was mapped). With
+ * hugePages, explicit hugepages are tried first; without them (none reserved in
+ * /proc/sys/vm/nr_hugepages) transparent hugepages are asked for instead.
+ */
+static uint8_t *map_frames(size_t *pLen, uint8_t hugePages, uint8_t *pGotHuge)
+{
+  void *p = MAP_FAILED;
+
+  *pGotHuge = 0;
+  if(hugePages) {
+    size_t hugeLen = ROUND_UP(*pLen, RT_HUGEPAGE_SIZE);
+    p = mmap(NULL, hugeLen, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if(p != MAP_FAILED) {
+      *pLen = hugeLen;
+      *pGotHuge = 1;
+      return (uint8_t *)p;
+    }
+    syslog(LOG_WARNING, "%s no hugepages (errno: %d [%s]), using normal pages", __func__, errno, strerror(errno));
+  }
+
+  p = mmap(NULL, *pLen, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(p == MAP_FAILED) {
+    syslog(LOG_ERR, "%s couldn't map %zu bytes, errno: %d [%s]", __func__, *pLen, errno, strerror(errno));
+    return NULL;
+  }
+#if defined(MADV_HUGEPAGE)
+  if(hugePages) {
+    madvise(p, *pLen, MADV_HUGEPAGE);
+  }
+#endif
+  return (uint8_t *)p;
+}
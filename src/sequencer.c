@@ -1,7 +1,7 @@
 /***********************************************************************************
  * @author Brian Ibeling
  * ibelingb@colorado.edu
- * 
+ *
  * Real-time Embedded Systems
  * ECEN5623 - Sam Siewert
  * @date 25Jul2020
@@ -9,16 +9,41 @@
  ************************************************************************************
  *
  * @file sequencer.c
- * @brief Sequencer service that drives execution of all other services via synchronized semaphores
- * 
- * The Sequencer acts as the executive dispatch service and provides a base rate frequency from 
- * which all other threads are driven from. This is done by updating blocking semaphores to all 
- * other service threads within the system at specified intervals. These dispatch intervals are 
- * a substrate of the Sequencer’s base rate, which is set to a default value 120 Hz. 
- * 
- * This service is driven from the high frequency oscillator provided by the RPi3, checking a 
- * comparator against the Interval Timer (IT) and sending an interrupt signal to the Sequencer 
- * at the desired frequency.
+ * @brief Sequencer service that drives execution of all other services via release events
+ *
+ * The Sequencer acts as the executive dispatch service and provides a base rate frequency from
+ * which all other threads are driven from. This is done by signalling the release eventfd of
+ * each other service thread within the system at specified intervals. These dispatch intervals are
+ * a substrate of the Sequencer’s base rate, which is set to a default value 120 Hz. Which
+ * services exist and when they are released comes from the service registry (see
+ * serviceRegistry.h), so each tick is a single dispatch table lookup.
+ *
+ * The sequencer thread keeps the base rate itself: each release time is computed as an
+ * absolute CLOCK_MONOTONIC time from the start, and the thread sleeps until it with
+ * clock_nanosleep(TIMER_ABSTIME) (or reads a periodic timerfd), so wake-up error never
+ * accumulates and wall-clock changes have no effect. A late wake-up that spans several
+ * base periods is counted as overruns; every service released during the missed periods
+ * is still posted, once.
+ *
+ * The wake-up latency of every cycle is accumulated and logged at shutdown:
+ *   "sequencerTask jitter <mode> @ <rate> Hz: ..."
+ * Use -s sigalrm for the original timer for before/after comparisons, -r for the rate.
+ *
+ * In the free running mode (-R) nothing is released on a timer: the sequencer starts
+ * acquisition once (the services then release each other, see project.c) and only
+ * waits for the shutdown signal.
+ *
+ * With the virtual clock (-V, see clockSource.h) there is no timer either: the sequencer
+ * sets the clock to each release time in turn, releases the services due one at a time
+ * in priority order and waits for each (and whatever it triggers) to finish, so a replay
+ * runs as fast as the jobs execute and makes the same decisions on every run.
+ *
+ * Shutdown (SIGNAL_KILL_SEQ) only stops the release loop; the sequencer thread then
+ * stops acquisition and drains the stages in pipeline order: each is released until its
+ * input (ring or queue) is empty, it stops making progress or SHUTDOWN_STAGE_MS is up,
+ * then shut down, and the next is only drained once it has exited (so the frame it was
+ * working on has been passed on). All of it shares one SHUTDOWN_TOTAL_MS deadline, so
+ * the pipeline stops well within a second.
  *
  ************************************************************************************
  * References and Resources:
@@ -29,6 +54,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <string.h>
+#include <math.h>
 
 #include <pthread.h>
 #include <sched.h>
@@ -38,6 +65,7 @@
 #include <syslog.h>
 #include <sys/time.h>
 #include <sys/sysinfo.h>
+#include <sys/timerfd.h>
 #include <errno.h>
 
 #include <signal.h>
@@ -53,25 +81,40 @@
 
 #define SCHED_TYPE SCHED_FIFO
 
-#define SEQ_TIMER_INTERVAL_NSEC (8333333) // 120 Hz base rate for sequencer
-
-#define ACQUIRE_FRAMES_EXEC_RATE_HZ (24) /* Freq to trigger AcquireFrames thread service */
-#define DIFFERENCE_FRAMES_EXEC_RATE_HZ (2) /* Freq to trigger DifferenceFrames thread service */
-#define PROC_WRITE_FRAMES_EXEC_RATE_HZ (1) /* Freq to trigger FrameProcessing and FrameWrite thread services */
-
-#define ACQUIRE_FRAMES_MOD_CALC (120 / ACQUIRE_FRAMES_EXEC_RATE_HZ)
-#define DIFFERENCE_FRAMES_MOD_CALC (120 / DIFFERENCE_FRAMES_EXEC_RATE_HZ)
-#define PROC_WRITE_FRAMES_MOD_CALC (120 / PROC_WRITE_FRAMES_EXEC_RATE_HZ)
+#define TIMESPEC_TO_NSEC(time) (((int64_t)(time).tv_sec * NANOSEC_PER_SEC) + (time).tv_nsec)
 
 /*------------------------------------------------------------------------*/
 /* GLOBAL VARIABLES */
 static unsigned long long sequenceCount = 0;
+static volatile sig_atomic_t seqRunning = 1;
+static seqJitterStats_t jitterStats;
+static int64_t seqStartNs;                  /* release time of tick 0 */
+static int64_t seqPeriodNs;
+#if defined(TRACE_OUTPUT)
+static traceRing_t *pSeqTrace = NULL;    /* dispatch may run in the SIGALRM handler, not via TLS */
+#endif
+
+static const char *timerModeNames[SEQ_TIMER_END] = {"nanosleep", "timerfd", "sigalrm"};
 
 seqThreadParams_t sequencerParams;
 struct timespec timeNow;
 sem_t appCompleteSem;
 timer_t seqTimer;
 
+/*------------------------------------------------------------------------*/
+/* PRIVATE FUNCTIONS */
+static void dispatch(unsigned long long firstTick, unsigned long long lastTick, int64_t releaseNs);
+static void record_jitter(int64_t lateNs);
+static void run_nanosleep(void);
+static void run_timerfd(void);
+static void run_sigalrm(void);
+static void run_free(void);
+static void run_virtual(void);
+static void drain_and_stop(void);
+static uint64_t stage_backlog(unsigned int stage);
+static uint64_t stage_progress(unsigned int stage);
+static uint64_t real_now_ns(void);
+
 /*------------------------------------------------------------------------*/
 /*** METHODS ***/
 /*------------------------------------------------------------------------*/
@@ -80,79 +123,249 @@ timer_t seqTimer;
  * @param sig - received signal
  */
 void shutdownApp(int sig) {
-  clock_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
-  syslog(LOG_INFO, "Sequecer - Shutdown Signal received, signaling all other threads to shutdown at:, %.2f", 
-         TIMESPEC_TO_MSEC(timeNow));
-  printf("Shutting down App...\n");
-
-  /* Max desired frames saved - initiate shutdown of application in reverse order services were started */
-  pthread_kill(sequencerParams.tidProcThread, SIGNAL_KILL_PROC);
-  sleep(3); /* Delay so frameProc can avoid getting blocked by MQ read/write calls */
-  pthread_kill(sequencerParams.tidDiffThread, SIGNAL_KILL_DIFF);
-  pthread_kill(sequencerParams.tidAcqThread, SIGNAL_KILL_ACQ);
-
+  /* only stop the release loop here; the sequencer thread drains and stops the services */
+  if(METRICS_LOAD(shutdownNs) == 0) {
+    METRICS_SET(shutdownNs, real_now_ns());
+  }
+  seqRunning = 0;
   sem_post(&appCompleteSem);
 }
 
 /*------------------------------------------------------------------------*/
 /*
- * Sequencer to trigger updates to semaphores of other service threads at the 
- * specified rates based on a sub-rate of the base-rate.
- * 
+ * Legacy SIGALRM handler; releases services for one base rate tick.
+ *
  * @param signal - Signal type received
  */
 void sequencer(int signal) {
-/* Used for capture sequencer jitter - comment out for data processing
-#if defined(TIMESTAMP_SYSLOG_OUTPUT)
-  clock_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
-  syslog(LOG_INFO, "%s cycle start (msec):, %.2f", __func__, TIMESPEC_TO_MSEC(timeNow));
+  struct timespec now;
+
+  /* a late timer reports the expirations it folded into this one */
+  clock_gettime(CLOCK_REALTIME, &now);
+  int missed = timer_getoverrun(seqTimer);
+  if(missed < 0) {
+    missed = 0;
+  }
+  jitterStats.overruns += missed;
+  unsigned long long firstTick = sequenceCount + 1;
+  sequenceCount += missed + 1;
+  record_jitter(TIMESPEC_TO_NSEC(now) - (seqStartNs + ((int64_t)sequenceCount * seqPeriodNs)));
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  dispatch(firstTick, sequenceCount, TIMESPEC_TO_NSEC(now));
+}
+
+/*------------------------------------------------------------------------*/
+/*
+ * Signal the release eventfd of each service released in ticks [firstTick, lastTick];
+ * a service released more than once in the range is still only signalled once.
+ * releaseNs (CLOCK_MONOTONIC) is stamped into each released service's monitor.
+ */
+static void dispatch(unsigned long long firstTick, unsigned long long lastTick, int64_t releaseNs) {
+  const serviceRegistry_t *pReg = sequencerParams.pRegistry;
+  uint32_t mask = registry_released(pReg, firstTick, lastTick);
+
+#if defined(TRACE_OUTPUT)
+  if((pSeqTrace != NULL) && (mask != 0)) {
+    trace_ring_push(pSeqTrace, TRACE_SEQ_RELEASE, (uint32_t)lastTick, mask);
+  }
 #endif
-*/
+  for(unsigned int ind = 0; mask != 0; ++ind, mask >>= 1) {
+    if(mask & 1) {
+      monitor_release(pReg->services[ind].pMonitor, (uint64_t)releaseNs);
+      service_event_signal(pReg->services[ind].releaseFd);
+    }
+  }
+}
 
-  /* Increment sequence count */
-  sequenceCount++;
+/*------------------------------------------------------------------------*/
+/*
+ * Accumulate wake-up latency (safe to call from the signal handler).
+ */
+static void record_jitter(int64_t lateNs) {
+  if((jitterStats.ticks == 0) || (lateNs < jitterStats.minLateNs)) {
+    jitterStats.minLateNs = lateNs;
+  }
+  if((jitterStats.ticks == 0) || (lateNs > jitterStats.maxLateNs)) {
+    jitterStats.maxLateNs = lateNs;
+  }
+  jitterStats.sumLateNs += (double)lateNs;
+  jitterStats.sumSqLateNs += (double)lateNs * (double)lateNs;
+  ++jitterStats.ticks;
+}
 
-  /* Post a semaphore for each service based on sub-rate of sequencer */
-  // Acquire Frames @ 24 Hz
-  if((sequenceCount % (int)ACQUIRE_FRAMES_MOD_CALC) == 0) {
-    sem_post(sequencerParams.pAcqSema);
+/*------------------------------------------------------------------------*/
+/*
+ * Sleep until each absolute release time with clock_nanosleep.
+ */
+static void run_nanosleep(void) {
+  struct timespec release, now;
+  int64_t releaseNs = seqStartNs;
+
+  while(seqRunning) {
+    releaseNs += seqPeriodNs;
+    release.tv_sec = releaseNs / NANOSEC_PER_SEC;
+    release.tv_nsec = releaseNs % NANOSEC_PER_SEC;
+    int rtn;
+    do {
+      rtn = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &release, NULL);
+    } while((rtn == EINTR) && seqRunning);
+    if(!seqRunning) {
+      break;
+    }
+
+    /* skip (and count) any releases we slept through */
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t lateNs = TIMESPEC_TO_NSEC(now) - releaseNs;
+    unsigned long long missed = (lateNs > 0) ? (unsigned long long)(lateNs / seqPeriodNs) : 0;
+    record_jitter(lateNs);
+    jitterStats.overruns += missed;
+    releaseNs += (int64_t)missed * seqPeriodNs;
+    unsigned long long firstTick = sequenceCount + 1;
+    sequenceCount += missed + 1;
+    dispatch(firstTick, sequenceCount, releaseNs);
   }
+}
 
-  // Determine Frame Differences @ 2 Hz
-  if((sequenceCount % (int)DIFFERENCE_FRAMES_MOD_CALC) == 0) {
-    sem_post(sequencerParams.pDiffSema);
+/*------------------------------------------------------------------------*/
+/*
+ * Block on a periodic timerfd; each read returns the expirations since the last.
+ */
+static void run_timerfd(void) {
+  struct itimerspec itime;
+  struct timespec now;
+  uint64_t expirations;
+
+  int fd = timerfd_create(CLOCK_MONOTONIC, 0);
+  if(fd < 0) {
+    syslog(LOG_ERR, "%s timerfd_create failed, errno: %d [%s]", __func__, errno, strerror(errno));
+    return;
+  }
+  itime.it_interval.tv_sec = seqPeriodNs / NANOSEC_PER_SEC;
+  itime.it_interval.tv_nsec = seqPeriodNs % NANOSEC_PER_SEC;
+  itime.it_value.tv_sec = (seqStartNs + seqPeriodNs) / NANOSEC_PER_SEC;
+  itime.it_value.tv_nsec = (seqStartNs + seqPeriodNs) % NANOSEC_PER_SEC;
+  if(timerfd_settime(fd, TFD_TIMER_ABSTIME, &itime, NULL) != 0) {
+    syslog(LOG_ERR, "%s timerfd_settime failed, errno: %d [%s]", __func__, errno, strerror(errno));
+    close(fd);
+    return;
   }
 
-  // Process frame images @ 1 Hz
-  // Write Frames to memory @ 1 Hz
-  if((sequenceCount % (int)PROC_WRITE_FRAMES_MOD_CALC) == 0) {
-    sem_post(sequencerParams.pProcSema);
-    sem_post(sequencerParams.pWriteSema);
+  while(seqRunning) {
+    if(read(fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+      if(errno == EINTR) {
+        continue;
+      }
+      syslog(LOG_ERR, "%s timerfd read failed, errno: %d [%s]", __func__, errno, strerror(errno));
+      break;
+    }
+    if(!seqRunning) {
+      break;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    unsigned long long firstTick = sequenceCount + 1;
+    sequenceCount += expirations;
+    jitterStats.overruns += expirations - 1;
+    record_jitter(TIMESPEC_TO_NSEC(now) - (seqStartNs + ((int64_t)sequenceCount * seqPeriodNs)));
+    dispatch(firstTick, sequenceCount, seqStartNs + ((int64_t)sequenceCount * seqPeriodNs));
   }
+  close(fd);
+}
 
+/*------------------------------------------------------------------------*/
+/*
+ * Original implementation: CLOCK_REALTIME POSIX timer delivering SIGALRM.
+ */
+static void run_sigalrm(void) {
+  struct itimerspec itime;
+  struct itimerspec last_itime;
+  struct timespec now;
+  int flags = 0;
+
+  /* Create Timer to trigger Sequencer at the base rate */
+  timer_create(CLOCK_REALTIME, NULL, &seqTimer);
+  signal(SIGALRM, sequencer);
+  itime.it_interval.tv_sec = seqPeriodNs / NANOSEC_PER_SEC;
+  itime.it_interval.tv_nsec = seqPeriodNs % NANOSEC_PER_SEC;
+  itime.it_value = itime.it_interval;
+  clock_gettime(CLOCK_REALTIME, &now);
+  seqStartNs = TIMESPEC_TO_NSEC(now);
+  timer_settime(seqTimer, flags, &itime, &last_itime);
+
+  // Block until released from sequencer after 1800 acquired frames
+  while(sem_wait(&appCompleteSem) != 0) {
+    /* interrupted by SIGALRM */
+  }
+  timer_delete(seqTimer);
+}
 
-/* Used for capture sequencer jitter - comment out for data processing
-#if defined(TIMESTAMP_SYSLOG_OUTPUT)
-  clock_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
-  syslog(LOG_INFO, "%s cycle done (msec):, %.2f", __func__, TIMESPEC_TO_MSEC(timeNow));
+/*------------------------------------------------------------------------*/
+/*
+ * Free running: kick acquisition once, then wait for the shutdown.
+ */
+static void run_free(void) {
+  registry_trigger(&sequencerParams.pRegistry->services[Thread_e::ACQ_THREAD]);
+  while(sem_wait(&appCompleteSem) != 0) {
+    /* interrupted by the shutdown signal */
+  }
+}
+
+/*------------------------------------------------------------------------*/
+/*
+ * Virtual clock: jump to each release time, release the services due one by one,
+ * highest priority first, and let each run to completion before the next.
+ */
+static void run_virtual(void) {
+  const serviceRegistry_t *pReg = sequencerParams.pRegistry;
+  unsigned int order[SERVICE_MAX];
+
+  /* priority order; registry order among equals */
+  for(unsigned int ind = 0; ind < pReg->numServices; ++ind) {
+    unsigned int pos = ind;
+    while((pos > 0) && (pReg->services[order[pos - 1]].priorityOffset > pReg->services[ind].priorityOffset)) {
+      order[pos] = order[pos - 1];
+      --pos;
+    }
+    order[pos] = ind;
+  }
+
+  unsigned long long stalls = 0;
+  while(seqRunning) {
+    ++sequenceCount;
+    int64_t releaseNs = seqStartNs + ((int64_t)sequenceCount * seqPeriodNs);
+    clock_source_advance((uint64_t)releaseNs);
+    uint32_t mask = registry_released(pReg, sequenceCount, sequenceCount);
+#if defined(TRACE_OUTPUT)
+    if((pSeqTrace != NULL) && (mask != 0)) {
+      trace_ring_push(pSeqTrace, TRACE_SEQ_RELEASE, (uint32_t)sequenceCount, mask);
+    }
 #endif
-*/
+    for(unsigned int pos = 0; (pos < pReg->numServices) && seqRunning; ++pos) {
+      unsigned int ind = order[pos];
+      if(mask & (1U << ind)) {
+        monitor_release(pReg->services[ind].pMonitor, (uint64_t)releaseNs);
+        service_event_signal(pReg->services[ind].releaseFd);
+        if((clock_source_wait_idle(&seqRunning) != 0) && seqRunning) {
+          ++stalls;
+        }
+      }
+    }
+  }
+  syslog(LOG_INFO, "%s virtual ticks, %llu, simulated, %.3f sec, stalled releases, %llu", __func__, sequenceCount,
+         (sequenceCount * seqPeriodNs) / 1e9, stalls);
 }
 
 /*------------------------------------------------------------------------*/
 /*
- * Service started from main() to setup all necessary data types (semaphores),
- * register the appShutdown signal handler, and initiate the timer which drives
- * the sequencer base-rate task at the desired frequency. App blocks on the 
- * appCompleteSemaphore until a signal is received from the writeFrame service 
- * to indicate the max number of frames have been written to memory. 
- * 
+ * Service started from main() to setup all necessary data types,
+ * register the appShutdown signal handler, and run the base rate loop which
+ * releases all other services. Returns once the writeFrame service signals
+ * that the max number of frames have been written to memory.
+ *
  * @arg - void pointer for pthread arguments passed from main().
  */
 void *sequencerTask(void *arg) {
-  struct itimerspec itime = {{1, 0}, {1, 0}};
-  struct itimerspec last_itime;
-  int flags = 0;
+  struct timespec now;
 
   /* get thread parameters */
   if(arg == NULL) {
@@ -161,45 +374,203 @@ void *sequencerTask(void *arg) {
   }
   sequencerParams = *(seqThreadParams_t *)arg;
 
-  if(sequencerParams.pAcqSema == NULL) {
-    syslog(LOG_ERR, "invalid Acq semaphore provided to %s", __func__);
-    return NULL;
-  }
-  if(sequencerParams.pDiffSema == NULL) {
-    syslog(LOG_ERR, "invalid Diff semaphore provided to %s", __func__);
+  if((sequencerParams.baseRateHz == 0) || (sequencerParams.baseRateHz > SEQ_MAX_RATE_HZ) ||
+     (sequencerParams.timerMode >= SEQ_TIMER_END)) {
+    syslog(LOG_ERR, "invalid base rate / timer mode provided to %s", __func__);
     return NULL;
   }
-  if(sequencerParams.pProcSema == NULL) {
-    syslog(LOG_ERR, "invalid Proc semaphore provided to %s", __func__);
+
+  /* the dispatch table must have been built for this base rate */
+  const serviceRegistry_t *pReg = sequencerParams.pRegistry;
+  if((pReg == NULL) || (pReg->pDispatch == NULL) || (pReg->baseRateHz != sequencerParams.baseRateHz)) {
+    syslog(LOG_ERR, "invalid service registry provided to %s", __func__);
     return NULL;
   }
-  if(sequencerParams.pWriteSema == NULL) {
-    syslog(LOG_ERR, "invalid Write semaphore provided to %s", __func__);
-    return NULL;
+  for(unsigned int ind = 0; ind < pReg->numServices; ++ind) {
+    if((pReg->services[ind].releaseFd < 0) || (pReg->services[ind].shutdownFd < 0)) {
+      syslog(LOG_ERR, "invalid %s events provided to %s", pReg->services[ind].name, __func__);
+      return NULL;
+    }
   }
 
-  /* Register the signal handler */ 
+  seqPeriodNs = NANOSEC_PER_SEC / sequencerParams.baseRateHz;
+  syslog(LOG_INFO, "%s %s @ %u Hz, %u services, hyperperiod %u ticks", __func__,
+         timerModeNames[sequencerParams.timerMode], sequencerParams.baseRateHz, pReg->numServices,
+         pReg->hyperperiodTicks);
+
+  /* stack resident before the first tick */
+  rt_stack_prefault();
+
+  /* Register the signal handler */
   signal(SIGNAL_KILL_SEQ, shutdownApp);
 
+#if defined(TRACE_OUTPUT)
+  if(trace_register(Thread_e::SEQ_THREAD) == 0) {
+    pSeqTrace = pTraceRing;
+  }
+#endif
+
   /* Initialize appComplete semaphore and shutdownApp variable */
   sem_init(&appCompleteSem, 0, 0);
+  memset(&jitterStats, 0, sizeof(seqJitterStats_t));
+  clock_source_gettime(CLOCK_MONOTONIC, &now);
+  seqStartNs = TIMESPEC_TO_NSEC(now);
 
-  /* Create Timer to trigger Sequencer at 120 Hz (8.3333 msec) */
-  timer_create(CLOCK_REALTIME, NULL, &seqTimer);
-  signal(SIGALRM, sequencer);
-  itime.it_interval.tv_sec = 0;
-  itime.it_interval.tv_nsec = SEQ_TIMER_INTERVAL_NSEC;
-  itime.it_value.tv_sec = 0;
-  itime.it_value.tv_nsec = SEQ_TIMER_INTERVAL_NSEC;
-  timer_settime(seqTimer, flags, &itime, &last_itime);
+  if(clock_source_is_virtual()) {
+    run_virtual();
+  } else if(sequencerParams.freeRun) {
+    syslog(LOG_INFO, "%s free running, no releases", __func__);
+    run_free();
+  } else {
+    switch(sequencerParams.timerMode) {
+    case SEQ_TIMER_TIMERFD:
+      run_timerfd();
+      break;
+    case SEQ_TIMER_SIGALRM:
+      run_sigalrm();
+      break;
+    case SEQ_TIMER_NANOSLEEP:
+    default:
+      run_nanosleep();
+      break;
+    }
+  }
 
-  // Block until released from sequencer after 1800 acquired frames
-  sem_wait(&appCompleteSem);
+  drain_and_stop();
+
+  /* report wake-up latency */
+  if(jitterStats.ticks != 0) {
+    double avg = jitterStats.sumLateNs / jitterStats.ticks;
+    double var = (jitterStats.sumSqLateNs / jitterStats.ticks) - (avg * avg);
+    syslog(LOG_INFO, "%s jitter %s @ %u Hz: ticks, %llu, overruns, %llu, latency usec min, %.1f, avg, %.1f, max, %.1f, stddev, %.1f",
+           __func__, timerModeNames[sequencerParams.timerMode], sequencerParams.baseRateHz, jitterStats.ticks,
+           jitterStats.overruns, jitterStats.minLateNs / 1e3, avg / 1e3, jitterStats.maxLateNs / 1e3,
+           sqrt((var > 0.0) ? var : 0.0) / 1e3);
+  }
 
   // Cleanup thread and exit
-  timer_delete(seqTimer);
   sem_destroy(&appCompleteSem);
 
   return NULL;
 }
-/*------------------------------------------------------------------------*/
\ No newline at end of file
+
+/*------------------------------------------------------------------------*/
+/*
+ * Stop the stages in pipeline order. Each one after acquisition is first released until
+ * its input is empty, then shut down, and the next stage is only drained once this one
+ * has exited: a stage counts its input as taken before it has forwarded the frame, so
+ * until it is out of its loop it may still send one on. A stage gets at most
+ * SHUTDOWN_STAGE_MS to drain and its drain is given up early once it has made no
+ * progress for SHUTDOWN_IDLE_POLLS polls (e.g. write has already stopped at
+ * MAX_FRAME_COUNT). Draining and waiting for the exits all end by SHUTDOWN_TOTAL_MS
+ * after the start; whatever is left in the queues is freed by main.
+ */
+static void drain_and_stop(void) {
+  const serviceRegistry_t *pReg = sequencerParams.pRegistry;
+  struct timespec poll = {0, SHUTDOWN_POLL_MS * NANOSEC_PER_MSEC};
+
+  uint64_t startNs = real_now_ns();
+  uint64_t endByNs = startNs + ((uint64_t)SHUTDOWN_TOTAL_MS * NANOSEC_PER_MSEC);
+  if(METRICS_LOAD(shutdownNs) == 0) {
+    METRICS_SET(shutdownNs, startNs);
+  }
+  clock_source_gettime(SYSLOG_CLOCK_TYPE, &timeNow);
+  syslog(LOG_INFO, "Sequecer - Shutdown Signal received, draining and stopping all other threads at:, %.2f",
+         TIMESPEC_TO_MSEC(timeNow));
+  printf("Shutting down App...\n");
+
+  for(unsigned int stage = Thread_e::ACQ_THREAD; stage < pReg->numServices; ++stage) {
+    const serviceDef_t *pSvc = &pReg->services[stage];
+    uint64_t stageStartNs = real_now_ns();
+    uint64_t giveUpNs = stageStartNs + ((uint64_t)SHUTDOWN_STAGE_MS * NANOSEC_PER_MSEC);
+    giveUpNs = (giveUpNs < endByNs) ? giveUpNs : endByNs;
+
+    /* acquisition has no input: nothing new enters the pipeline once it stops */
+    if(stage != Thread_e::ACQ_THREAD) {
+      uint64_t lastProgress = stage_progress(stage);
+      unsigned int idlePolls = 0;
+      while((stage_backlog(stage) != 0) && (idlePolls < SHUTDOWN_IDLE_POLLS) && (real_now_ns() < giveUpNs)) {
+        registry_trigger(pSvc);
+        clock_nanosleep(CLOCK_MONOTONIC, 0, &poll, NULL);
+        uint64_t progress = stage_progress(stage);
+        idlePolls = (progress != lastProgress) ? 0 : idlePolls + 1;
+        lastProgress = progress;
+      }
+    }
+    service_event_signal(pSvc->shutdownFd);
+
+    /* its last frame is only in the next stage's input once it is out of its loop */
+    uint64_t drainedNs = real_now_ns();
+    while((pMetrics != NULL) && (METRICS_ACQUIRE(serviceExited[stage]) == 0) && (real_now_ns() < endByNs)) {
+      clock_nanosleep(CLOCK_MONOTONIC, 0, &poll, NULL);
+    }
+    if((pMetrics != NULL) && (METRICS_ACQUIRE(serviceExited[stage]) == 0)) {
+      syslog(LOG_WARNING, "%s %s still running at the %d ms shutdown deadline", __func__, pSvc->name,
+             SHUTDOWN_TOTAL_MS);
+    }
+    syslog(LOG_INFO, "%s %s drained in %.1f ms (exited %.1f ms later), %llu frames left", __func__, pSvc->name,
+           (drainedNs - stageStartNs) / 1e6, (real_now_ns() - drainedNs) / 1e6,
+           (unsigned long long)stage_backlog(stage));
+  }
+  syslog(LOG_INFO, "%s pipeline stopped %.1f ms after the shutdown request", __func__,
+         (real_now_ns() - METRICS_LOAD(shutdownNs)) / 1e6);
+}
+
+/*------------------------------------------------------------------------*/
+/*
+ * Frames waiting for a stage: the ring beyond what difference keeps, else its queue.
+ */
+static uint64_t stage_backlog(unsigned int stage) {
+  uint64_t depth;
+
+  switch(stage) {
+  case Thread_e::DIFF_THREAD:
+    depth = METRICS_LOAD(ringDepth);
+    return (depth > (FRAMES_TO_SKIP + 1)) ? depth - (FRAMES_TO_SKIP + 1) : 0;
+  case Thread_e::PROC_THREAD:
+    return METRICS_LOAD(selectSent) - METRICS_LOAD(selectReceived);
+  case Thread_e::WRITE_THREAD:
+    return METRICS_LOAD(writeSent) - METRICS_LOAD(writeReceived);
+  default:
+    return 0;
+  }
+}
+
+/*------------------------------------------------------------------------*/
+/*
+ * Frames a stage has taken from its input so far.
+ */
+static uint64_t stage_progress(unsigned int stage) {
+  switch(stage) {
+  case Thread_e::DIFF_THREAD:
+    return METRICS_LOAD(framesDiffed);
+  case Thread_e::PROC_THREAD:
+    return METRICS_LOAD(selectReceived);
+  case Thread_e::WRITE_THREAD:
+    return METRICS_LOAD(writeReceived);
+  default:
+    return 0;
+  }
+}
+
+/*------------------------------------------------------------------------*/
+/*
+ * Real CLOCK_MONOTONIC (also under the virtual clock); safe in the signal handler.
+ */
+static uint64_t real_now_ns(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)TIMESPEC_TO_NSEC(now);
+}
+
+/*------------------------------------------------------------------------*/
+SeqTimerMode_e seq_timer_mode_from_name(const char *name) {
+  for(int mode = 0; mode < SEQ_TIMER_END; ++mode) {
+    if(strcmp(name, timerModeNames[mode]) == 0) {
+      return (SeqTimerMode_e)mode;
+    }
+  }
+  return SEQ_TIMER_END;
+}
+/*------------------------------------------------------------------------*/
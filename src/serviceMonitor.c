@@ -0,0 +1,234 @@
+/***********************************************************************************
+ * @author Brian Ibeling
+ * ibelingb@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file serviceMonitor.c
+ * @brief per-service execution time / deadline monitor (see serviceMonitor.h)
+ *
+ ************************************************************************************
+ */
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <syslog.h>
+#include <sys/resource.h>
+
+/* project headers */
+#include "serviceMonitor.h"
+#include "traceRing.h"
+#include "clockSource.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define MON_LOAD(field)               __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#define MON_STORE(field, val)         __atomic_store_n(&(field), (val), __ATOMIC_RELAXED)
+
+static const char *actionNames[MONITOR_ACTION_END] = {"count", "log", "skip"};
+
+/*---------------------------------------------------------------------------------*/
+void monitor_init(serviceMonitor_t *pMon, const char *name, uint64_t budgetNs, uint64_t deadlineNs,
+                  MonitorAction_e action)
+{
+  memset(pMon, 0, sizeof(serviceMonitor_t));
+  strncpy(pMon->name, name, MONITOR_NAME_LEN - 1);
+  pMon->budgetNs = budgetNs;
+  pMon->deadlineNs = deadlineNs;
+  pMon->action = action;
+  pMon->minExecNs = UINT64_MAX;
+  pMon->minRespNs = UINT64_MAX;
+  pMon->minWakeNs = UINT64_MAX;
+}
+
+/*---------------------------------------------------------------------------------*/
+void monitor_counters_open(serviceMonitor_t *pMon)
+{
+  if(pMon != NULL) {
+    perf_open(&pMon->perf);
+  }
+}
+
+/*---------------------------------------------------------------------------------*/
+void monitor_counters_close(serviceMonitor_t *pMon)
+{
+  struct timespec cpuTime;
+
+  perf_close();
+  if((pMon != NULL) && (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpuTime) == 0)) {
+    MON_STORE(pMon->threadCpuNs, ((uint64_t)cpuTime.tv_sec * 1000000000ULL) + cpuTime.tv_nsec);
+  }
+}
+
+/*---------------------------------------------------------------------------------*/
+void monitor_release(serviceMonitor_t *pMon, uint64_t releaseNs)
+{
+  if(pMon != NULL) {
+    MON_STORE(pMon->releaseNs, releaseNs);
+  }
+}
+
+/*---------------------------------------------------------------------------------*/
+void monitor_trigger(serviceMonitor_t *pMon, uint64_t releaseNs)
+{
+  if((pMon != NULL) && (MON_LOAD(pMon->releaseNs) == MON_LOAD(pMon->lastReleaseNs))) {
+    MON_STORE(pMon->releaseNs, releaseNs);
+  }
+}
+
+/*---------------------------------------------------------------------------------*/
+int monitor_job_start(serviceMonitor_t *pMon)
+{
+  if(pMon == NULL) {
+    return MONITOR_RUN_JOB;
+  }
+
+  /* nothing to measure against without a new release */
+  uint64_t releaseNs = MON_LOAD(pMon->releaseNs);
+  if((releaseNs == 0) || (releaseNs == pMon->lastReleaseNs)) {
+    pMon->jobActive = 0;
+    return MONITOR_RUN_JOB;
+  }
+  MON_STORE(pMon->lastReleaseNs, releaseNs);
+
+  if(pMon->skipNext) {
+    pMon->skipNext = 0;
+    pMon->jobActive = 0;
+    MON_STORE(pMon->skippedJobs, pMon->skippedJobs + 1);
+    return MONITOR_SKIP_JOB;
+  }
+  pMon->startNs = monitor_now_ns();
+  pMon->jobActive = 1;
+  trace_event(TRACE_JOB_START, (uint32_t)pMon->jobs, releaseNs);
+
+  uint64_t wakeNs = pMon->startNs - releaseNs;
+  if(wakeNs < pMon->minWakeNs) {
+    MON_STORE(pMon->minWakeNs, wakeNs);
+  }
+  if(wakeNs > pMon->maxWakeNs) {
+    MON_STORE(pMon->maxWakeNs, wakeNs);
+  }
+  MON_STORE(pMon->sumWakeNs, pMon->sumWakeNs + wakeNs);
+
+  /* last, so the counters only see the job body */
+  perf_job_start();
+  return MONITOR_RUN_JOB;
+}
+
+/*---------------------------------------------------------------------------------*/
+void monitor_job_end(serviceMonitor_t *pMon)
+{
+  if((pMon == NULL) || !pMon->jobActive) {
+    return;
+  }
+  pMon->jobActive = 0;
+  perf_job_end(pMon->jobs);
+
+  uint64_t endNs = monitor_now_ns();
+  uint64_t execNs = endNs - pMon->startNs;
+  uint64_t respNs = endNs - pMon->lastReleaseNs;
+  trace_event(TRACE_JOB_END, (uint32_t)pMon->jobs, execNs);
+  if(execNs < pMon->minExecNs) {
+    MON_STORE(pMon->minExecNs, execNs);
+  }
+  if(execNs > pMon->maxExecNs) {
+    MON_STORE(pMon->maxExecNs, execNs);
+  }
+  if(respNs < pMon->minRespNs) {
+    MON_STORE(pMon->minRespNs, respNs);
+  }
+  if(respNs > pMon->maxRespNs) {
+    MON_STORE(pMon->maxRespNs, respNs);
+  }
+  MON_STORE(pMon->sumExecNs, pMon->sumExecNs + execNs);
+  MON_STORE(pMon->sumRespNs, pMon->sumRespNs + respNs);
+  MON_STORE(pMon->jobs, pMon->jobs + 1);
+
+  /* page faults of the thread: warm-up, then any since (memory not locked / prefaulted) */
+  struct rusage usage;
+  if(getrusage(RUSAGE_THREAD, &usage) == 0) {
+    if(pMon->jobs <= MONITOR_WARMUP_JOBS) {
+      MON_STORE(pMon->warmupMinorFaults, (uint64_t)usage.ru_minflt);
+      MON_STORE(pMon->warmupMajorFaults, (uint64_t)usage.ru_majflt);
+    } else {
+      MON_STORE(pMon->minorFaults, (uint64_t)usage.ru_minflt - pMon->warmupMinorFaults);
+      MON_STORE(pMon->majorFaults, (uint64_t)usage.ru_majflt - pMon->warmupMajorFaults);
+    }
+  }
+
+  uint8_t violation = 0;
+  if((pMon->budgetNs != 0) && (execNs > pMon->budgetNs)) {
+    MON_STORE(pMon->budgetOverruns, pMon->budgetOverruns + 1);
+    violation = 1;
+  }
+  if((pMon->deadlineNs != 0) && (respNs > pMon->deadlineNs)) {
+    MON_STORE(pMon->deadlineMisses, pMon->deadlineMisses + 1);
+    violation = 1;
+  }
+  if(!violation) {
+    return;
+  }
+
+  switch(pMon->action) {
+  case MONITOR_ACTION_LOG:
+    syslog(LOG_WARNING, "%s %s job %llu: exec %.1f usec (budget %.1f), response %.1f usec (deadline %.1f)", __func__,
+           pMon->name, (unsigned long long)pMon->jobs, execNs / 1e3, pMon->budgetNs / 1e3, respNs / 1e3,
+           pMon->deadlineNs / 1e3);
+    break;
+  case MONITOR_ACTION_SKIP:
+    pMon->skipNext = 1;
+    break;
+  case MONITOR_ACTION_COUNT:
+  default:
+    break;
+  }
+}
+
+/*---------------------------------------------------------------------------------*/
+void monitor_report(const serviceMonitor_t *pMon)
+{
+  uint64_t jobs = MON_LOAD(pMon->jobs);
+
+  if(jobs == 0) {
+    syslog(LOG_INFO, "%s %s: no jobs measured", __func__, pMon->name);
+    return;
+  }
+  syslog(LOG_INFO, "%s %s: jobs, %llu, exec usec min, %.1f, avg, %.1f, max, %.1f, response usec min, %.1f, avg, %.1f, max, %.1f, "
+         "wake-up usec min, %.1f, avg, %.1f, max, %.1f, deadline misses, %llu, budget overruns, %llu, skipped, %llu",
+         __func__, pMon->name, (unsigned long long)jobs,
+         MON_LOAD(pMon->minExecNs) / 1e3, ((double)MON_LOAD(pMon->sumExecNs) / jobs) / 1e3, MON_LOAD(pMon->maxExecNs) / 1e3,
+         MON_LOAD(pMon->minRespNs) / 1e3, ((double)MON_LOAD(pMon->sumRespNs) / jobs) / 1e3, MON_LOAD(pMon->maxRespNs) / 1e3,
+         MON_LOAD(pMon->minWakeNs) / 1e3, ((double)MON_LOAD(pMon->sumWakeNs) / jobs) / 1e3, MON_LOAD(pMon->maxWakeNs) / 1e3,
+         (unsigned long long)MON_LOAD(pMon->deadlineMisses), (unsigned long long)MON_LOAD(pMon->budgetOverruns),
+         (unsigned long long)MON_LOAD(pMon->skippedJobs));
+  syslog((MON_LOAD(pMon->minorFaults) + MON_LOAD(pMon->majorFaults) != 0) ? LOG_WARNING : LOG_INFO,
+         "%s %s: page faults warm-up minor, %llu, major, %llu, after warm-up minor, %llu, major, %llu", __func__,
+         pMon->name, (unsigned long long)MON_LOAD(pMon->warmupMinorFaults),
+         (unsigned long long)MON_LOAD(pMon->warmupMajorFaults), (unsigned long long)MON_LOAD(pMon->minorFaults),
+         (unsigned long long)MON_LOAD(pMon->majorFaults));
+  perf_report(&pMon->perf, pMon->name);
+}
+
+/*---------------------------------------------------------------------------------*/
+MonitorAction_e monitor_action_from_name(const char *name)
+{
+  for(int action = 0; action < MONITOR_ACTION_END; ++action) {
+    if(strcmp(name, actionNames[action]) == 0) {
+      return (MonitorAction_e)action;
+    }
+  }
+  return MONITOR_ACTION_END;
+}
+
+/*---------------------------------------------------------------------------------*/
+uint64_t monitor_now_ns(void)
+{
+  return clock_source_now_ns();
+}
@@ -0,0 +1,261 @@
+/***********************************************************************************
+ * @author Joshua Malburg
+ * joshua.malburg@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file serviceRegistry.c
+ * @brief table of sequenced services and their release schedule (see serviceRegistry.h)
+ *
+ ************************************************************************************
+ */
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <syslog.h>
+
+/* project headers */
+#include "serviceRegistry.h"
+#include "serviceRuntime.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define SPEC_LINE_LEN         (128)
+
+/*---------------------------------------------------------------------------------*/
+/* PRIVATE FUNCTIONS */
+static unsigned long long gcd(unsigned long long a, unsigned long long b);
+
+/*---------------------------------------------------------------------------------*/
+int registry_add(serviceRegistry_t *pReg, const serviceDef_t *pDef)
+{
+  if((pReg == NULL) || (pDef == NULL) || (pReg->numServices >= SERVICE_MAX) || (pDef->rateHz <= 0.0)) {
+    return -1;
+  }
+  if(registry_find(pReg, pDef->name) != NULL) {
+    syslog(LOG_ERR, "%s service %s already registered", __func__, pDef->name);
+    return -1;
+  }
+  serviceDef_t *pSvc = &pReg->services[pReg->numServices];
+  *pSvc = *pDef;
+  pSvc->name[SERVICE_NAME_LEN - 1] = '\0';
+  pSvc->periodTicks = 0;
+  return (int)pReg->numServices++;
+}
+
+/*---------------------------------------------------------------------------------*/
+serviceDef_t *registry_find(serviceRegistry_t *pReg, const char *name)
+{
+  if((pReg == NULL) || (name == NULL)) {
+    return NULL;
+  }
+  for(unsigned int ind = 0; ind < pReg->numServices; ++ind) {
+    if(strcmp(pReg->services[ind].name, name) == 0) {
+      return &pReg->services[ind];
+    }
+  }
+  return NULL;
+}
+
+/*---------------------------------------------------------------------------------*/
+int registry_set(serviceRegistry_t *pReg, const char *spec)
+{
+  char line[SPEC_LINE_LEN];
+  char name[SERVICE_NAME_LEN];
+  double rateHz;
+  unsigned int phase, priorityOffset, runtimeUs, deadlineUs;
+  int core;
+
+  if((pReg == NULL) || (spec == NULL)) {
+    return -1;
+  }
+  strncpy(line, spec, sizeof(line) - 1);
+  line[sizeof(line) - 1] = '\0';
+  for(char *pChar = line; *pChar != '\0'; ++pChar) {
+    if((*pChar == '=') || (*pChar == ',')) {
+      *pChar = ' ';
+    }
+  }
+
+  int fields = sscanf(line, "%15s %lf %u %u %d %u %u", name, &rateHz, &phase, &priorityOffset, &core, &runtimeUs,
+                      &deadlineUs);
+  if(fields < 2) {
+    syslog(LOG_ERR, "%s malformed service spec \"%s\"", __func__, spec);
+    return -1;
+  }
+  serviceDef_t *pSvc = registry_find(pReg, name);
+  if(pSvc == NULL) {
+    syslog(LOG_ERR, "%s unknown service \"%s\"", __func__, name);
+    return -1;
+  }
+  if((rateHz <= 0.0) || ((fields >= 4) && (priorityOffset > 99)) || ((fields >= 5) && (core < 0))) {
+    syslog(LOG_ERR, "%s invalid setting for %s in \"%s\"", __func__, name, spec);
+    return -1;
+  }
+
+  pSvc->rateHz = rateHz;
+  if(fields >= 3) {
+    pSvc->phaseTicks = phase;
+  }
+  if(fields >= 4) {
+    pSvc->priorityOffset = (uint8_t)priorityOffset;
+  }
+  if(fields >= 5) {
+    pSvc->cpuCore = core;
+  }
+  if(fields >= 6) {
+    pSvc->runtimeUs = runtimeUs;
+  }
+  if(fields >= 7) {
+    pSvc->deadlineUs = deadlineUs;
+  }
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+int registry_load(serviceRegistry_t *pReg, const char *filename)
+{
+  char line[SPEC_LINE_LEN];
+  int rtnCode = 0;
+  unsigned int lineNum = 0;
+
+  FILE *pFile = fopen(filename, "r");
+  if(pFile == NULL) {
+    syslog(LOG_ERR, "%s couldn't open %s, errno: %d [%s]", __func__, filename, errno, strerror(errno));
+    return -1;
+  }
+  while(fgets(line, sizeof(line), pFile) != NULL) {
+    ++lineNum;
+    char *pComment = strchr(line, '#');
+    if(pComment != NULL) {
+      *pComment = '\0';
+    }
+    char first[2];
+    if(sscanf(line, "%1s", first) != 1) {
+      continue;         /* blank */
+    }
+    if(registry_set(pReg, line) != 0) {
+      syslog(LOG_ERR, "%s %s:%u rejected", __func__, filename, lineNum);
+      rtnCode = -1;
+    }
+  }
+  fclose(pFile);
+  return rtnCode;
+}
+
+/*---------------------------------------------------------------------------------*/
+int registry_build(serviceRegistry_t *pReg, unsigned int baseRateHz)
+{
+  if((pReg == NULL) || (baseRateHz == 0) || (pReg->numServices == 0)) {
+    return -1;
+  }
+  registry_free(pReg);
+  pReg->baseRateHz = baseRateHz;
+
+  /* periods in whole base rate ticks; the hyperperiod is their LCM */
+  unsigned long long hyperperiod = 1;
+  for(unsigned int ind = 0; ind < pReg->numServices; ++ind) {
+    serviceDef_t *pSvc = &pReg->services[ind];
+    long long period = llround(baseRateHz / pSvc->rateHz);
+    if(period <= 0) {
+      syslog(LOG_ERR, "%s %s at %.2f Hz is faster than the %u Hz base rate", __func__, pSvc->name, pSvc->rateHz, baseRateHz);
+      return -1;
+    }
+    pSvc->periodTicks = (unsigned int)period;
+    if(pSvc->phaseTicks >= pSvc->periodTicks) {
+      syslog(LOG_ERR, "%s %s phase %u not within its %u tick period", __func__, pSvc->name, pSvc->phaseTicks, pSvc->periodTicks);
+      return -1;
+    }
+    if(fabs(((double)baseRateHz / period) - pSvc->rateHz) > (0.01 * pSvc->rateHz)) {
+      syslog(LOG_WARNING, "%s %s runs at %.2f Hz (%.2f Hz doesn't divide the %u Hz base rate)", __func__, pSvc->name,
+             (double)baseRateHz / period, pSvc->rateHz, baseRateHz);
+    }
+    hyperperiod = (hyperperiod / gcd(hyperperiod, period)) * period;
+    if(hyperperiod > SERVICE_MAX_HYPERPERIOD) {
+      syslog(LOG_ERR, "%s hyperperiod exceeds %u ticks, choose harmonic rates", __func__, SERVICE_MAX_HYPERPERIOD);
+      return -1;
+    }
+  }
+
+  pReg->pDispatch = (uint32_t *)calloc(hyperperiod, sizeof(uint32_t));
+  if(pReg->pDispatch == NULL) {
+    syslog(LOG_ERR, "%s couldn't allocate %llu tick dispatch table", __func__, hyperperiod);
+    return -1;
+  }
+  pReg->hyperperiodTicks = (unsigned int)hyperperiod;
+  for(unsigned int ind = 0; ind < pReg->numServices; ++ind) {
+    const serviceDef_t *pSvc = &pReg->services[ind];
+    for(unsigned int tick = pSvc->phaseTicks; (tick < pReg->hyperperiodTicks) && !pSvc->triggered; tick += pSvc->periodTicks) {
+      pReg->pDispatch[tick] |= (1u << ind);
+    }
+    syslog(LOG_INFO, "%s %s: %.2f Hz%s, period %u ticks, phase %u, prio max-%u, core %d", __func__, pSvc->name,
+           (double)baseRateHz / pSvc->periodTicks, pSvc->triggered ? " (triggered)" : "", pSvc->periodTicks,
+           pSvc->phaseTicks, pSvc->priorityOffset, pSvc->cpuCore);
+  }
+  syslog(LOG_INFO, "%s %u services, base rate %u Hz, hyperperiod %u ticks", __func__, pReg->numServices,
+         baseRateHz, pReg->hyperperiodTicks);
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+uint32_t registry_released(const serviceRegistry_t *pReg, unsigned long long firstTick, unsigned long long lastTick)
+{
+  uint32_t mask = 0;
+
+  /* a range covering a whole hyperperiod releases everything */
+  if((lastTick - firstTick + 1) >= pReg->hyperperiodTicks) {
+    return (pReg->numServices >= 32) ? UINT32_MAX : ((1u << pReg->numServices) - 1);
+  }
+  unsigned int tick = (unsigned int)(firstTick % pReg->hyperperiodTicks);
+  for(unsigned long long cnt = firstTick; cnt <= lastTick; ++cnt) {
+    mask |= pReg->pDispatch[tick];
+    if(++tick == pReg->hyperperiodTicks) {
+      tick = 0;
+    }
+  }
+  return mask;
+}
+
+/*---------------------------------------------------------------------------------*/
+void registry_trigger(const serviceDef_t *pSvc)
+{
+  if(pSvc == NULL) {
+    return;
+  }
+
+  /* the eventfd counter folds a burst into one wake-up */
+  monitor_trigger(pSvc->pMonitor, monitor_now_ns());
+  service_event_signal(pSvc->releaseFd);
+}
+
+/*---------------------------------------------------------------------------------*/
+void registry_free(serviceRegistry_t *pReg)
+{
+  if(pReg == NULL) {
+    return;
+  }
+  free(pReg->pDispatch);
+  pReg->pDispatch = NULL;
+  pReg->hyperperiodTicks = 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+static unsigned long long gcd(unsigned long long a, unsigned long long b)
+{
+  while(b != 0) {
+    unsigned long long tmp = a % b;
+    a = b;
+    b = tmp;
+  }
+  return a;
+}
@@ -0,0 +1,149 @@
+/***********************************************************************************
+ * @author Joshua Malburg
+ * joshua.malburg@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file serviceRuntime.c
+ * @brief common wait loop of the RT services (see serviceRuntime.h)
+ *
+ ************************************************************************************
+ */
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <syslog.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+/* project headers */
+#include "serviceRuntime.h"
+#include "clockSource.h"
+
+/*---------------------------------------------------------------------------------*/
+int service_loop_init(serviceLoop_t *pLoop, const char *name, int releaseFd, int shutdownFd)
+{
+  memset(pLoop, 0, sizeof(serviceLoop_t));
+  strncpy(pLoop->name, name, SERVICE_LOOP_NAME_LEN - 1);
+  pLoop->releaseFd = releaseFd;
+  pLoop->shutdownFd = shutdownFd;
+  pLoop->epollFd = epoll_create1(EPOLL_CLOEXEC);
+  if(pLoop->epollFd < 0) {
+    syslog(LOG_ERR, "%s %s epoll_create1 failed, errno: %d [%s]", __func__, name, errno, strerror(errno));
+    return -1;
+  }
+
+  struct epoll_event event;
+  memset(&event, 0, sizeof(struct epoll_event));
+  event.events = EPOLLIN;
+  event.data.fd = releaseFd;
+  int rtnCode = epoll_ctl(pLoop->epollFd, EPOLL_CTL_ADD, releaseFd, &event);
+  event.data.fd = shutdownFd;
+  rtnCode |= epoll_ctl(pLoop->epollFd, EPOLL_CTL_ADD, shutdownFd, &event);
+  if(rtnCode != 0) {
+    syslog(LOG_ERR, "%s %s couldn't watch release / shutdown events, errno: %d [%s]", __func__, name, errno, strerror(errno));
+    close(pLoop->epollFd);
+    pLoop->epollFd = -1;
+    return -1;
+  }
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+int service_loop_add_fd(serviceLoop_t *pLoop, int fd)
+{
+  struct epoll_event event;
+
+  memset(&event, 0, sizeof(struct epoll_event));
+  event.events = EPOLLIN;
+  event.data.fd = fd;
+  if(epoll_ctl(pLoop->epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+    syslog(LOG_ERR, "%s %s couldn't watch fd %d, errno: %d [%s]", __func__, pLoop->name, fd, errno, strerror(errno));
+    return -1;
+  }
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+int service_loop_wait(serviceLoop_t *pLoop, int timeoutMsec)
+{
+  struct epoll_event events[SERVICE_LOOP_MAX_FDS];
+  int wake = 0;
+
+  /* back to waiting: every release read so far has been handled. Under the virtual
+   * clock the next release can be any number of real msec away, so no watchdog */
+  clock_source_idle(pLoop->releaseFd, pLoop->releases);
+  if(clock_source_is_virtual()) {
+    timeoutMsec = -1;
+  }
+  int cnt = epoll_wait(pLoop->epollFd, events, SERVICE_LOOP_MAX_FDS, timeoutMsec);
+  if(cnt < 0) {
+    if(errno == EINTR) {
+      return 0;
+    }
+    syslog(LOG_ERR, "%s %s epoll_wait failed, errno: %d [%s]", __func__, pLoop->name, errno, strerror(errno));
+    return -1;
+  }
+  ++pLoop->wakeups;
+  if(cnt == 0) {
+    ++pLoop->timeouts;
+    return 0;
+  }
+
+  for(int ind = 0; ind < cnt; ++ind) {
+    if(events[ind].data.fd == pLoop->shutdownFd) {
+      wake |= SERVICE_WAKE_SHUTDOWN;
+    } else if(events[ind].data.fd == pLoop->releaseFd) {
+      uint64_t releases;
+      if(read(pLoop->releaseFd, &releases, sizeof(releases)) == sizeof(releases)) {
+        pLoop->releases += releases;
+        pLoop->coalesced += releases - 1;
+        wake |= SERVICE_WAKE_RELEASE;
+      }
+    } else {
+      wake |= SERVICE_WAKE_DATA;
+    }
+  }
+  return wake;
+}
+
+/*---------------------------------------------------------------------------------*/
+void service_loop_close(serviceLoop_t *pLoop)
+{
+  if(pLoop->epollFd < 0) {
+    return;
+  }
+  syslog(LOG_INFO, "%s %s: wakeups, %llu, releases, %llu, coalesced, %llu, timeouts, %llu", __func__, pLoop->name,
+         pLoop->wakeups, pLoop->releases, pLoop->coalesced, pLoop->timeouts);
+  close(pLoop->epollFd);
+  pLoop->epollFd = -1;
+}
+
+/*---------------------------------------------------------------------------------*/
+int service_event_create(void)
+{
+  int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if(fd < 0) {
+    syslog(LOG_ERR, "%s eventfd failed, errno: %d [%s]", __func__, errno, strerror(errno));
+  }
+  return fd;
+}
+
+/*---------------------------------------------------------------------------------*/
+void service_event_signal(int fd)
+{
+  uint64_t one = 1;
+
+  if(fd >= 0) {
+    clock_source_released(fd);
+    (void)!write(fd, &one, sizeof(one));
+  }
+}
@@ -0,0 +1,345 @@
+/***********************************************************************************
+ * @author Brian Ibeling
+ * ibelingb@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file taskExecutor.c
+ * @brief work-stealing executor (see taskExecutor.h)
+ *
+ ************************************************************************************
+ */
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <syslog.h>
+
+/* project headers */
+#include "taskExecutor.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define EXEC_LOAD(field)              __atomic_load_n(&(field), __ATOMIC_ACQUIRE)
+#define EXEC_ADD(field, n)            __atomic_add_fetch(&(field), (n), __ATOMIC_ACQ_REL)
+
+/*---------------------------------------------------------------------------------*/
+/* PRIVATE FUNCTIONS */
+static void *task_worker(void *arg);
+static uint8_t deque_push(taskDeque_t *pDeque, const task_t *pTask);
+static uint8_t deque_pop(taskDeque_t *pDeque, task_t *pTask);
+static uint8_t deque_steal(taskDeque_t *pDeque, task_t *pTask);
+static uint8_t deque_take_group(taskDeque_t *pDeque, const taskGroup_t *pGroup, task_t *pTask);
+static uint8_t take_task(taskExecutor_t *pExec, unsigned int index, task_t *pTask);
+static void run_task(const task_t *pTask);
+
+/*---------------------------------------------------------------------------------*/
+/* GLOBAL VARIABLES */
+static __thread taskExecutor_t *pOwnExecutor = NULL;   /* set in worker threads */
+static __thread unsigned int ownIndex = 0;
+
+/*---------------------------------------------------------------------------------*/
+int task_executor_create(taskExecutor_t *pExec, unsigned int numWorkers, int priority, const cpu_set_t *pCpuSet)
+{
+  if((pExec == NULL) || (numWorkers == 0) || (numWorkers > TASK_EXECUTOR_MAX_WORKERS) ||
+     (priority < 0) || (priority > sched_get_priority_max(SCHED_FIFO))) {
+    syslog(LOG_ERR, "%s invalid executor, %u workers, priority %d", __func__, numWorkers, priority);
+    return -1;
+  }
+  memset(pExec, 0, sizeof(taskExecutor_t));
+  for(unsigned int ind = 0; ind < TASK_EXECUTOR_MAX_WORKERS; ++ind) {
+    pExec->deques[ind].pExec = pExec;
+    pExec->deques[ind].index = ind;
+    pthread_mutex_init(&pExec->deques[ind].mutex, NULL);
+  }
+  pthread_mutex_init(&pExec->idleMutex, NULL);
+  pthread_cond_init(&pExec->idleCond, NULL);
+  pExec->running = 1;
+
+  /* SCHED_OTHER only uses what the RT services leave idle; a FIFO priority below theirs
+   * still preempts everything else on those cores */
+  pthread_attr_t attr;
+  struct sched_param param;
+  memset(&param, 0, sizeof(param));
+  param.sched_priority = priority;
+  pthread_attr_init(&attr);
+  pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+  pthread_attr_setschedpolicy(&attr, (priority != 0) ? SCHED_FIFO : SCHED_OTHER);
+  pthread_attr_setschedparam(&attr, &param);
+
+  /* fixed before any worker runs; they steal from all of them */
+  pExec->numWorkers = numWorkers;
+  unsigned int started = 0;
+  int cpu = -1;
+  for(unsigned int ind = 0; ind < numWorkers; ++ind) {
+    if((pCpuSet != NULL) && (CPU_COUNT(pCpuSet) != 0)) {
+      do {
+        cpu = (cpu + 1) % CPU_SETSIZE;
+      } while(!CPU_ISSET(cpu, pCpuSet));
+      cpu_set_t workerCpu;
+      CPU_ZERO(&workerCpu);
+      CPU_SET(cpu, &workerCpu);
+      pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &workerCpu);
+    }
+    if(pthread_create(&pExec->threads[ind], &attr, task_worker, &pExec->deques[ind]) != 0) {
+      syslog(LOG_ERR, "%s couldn't create worker #%u, errno: %d [%s]", __func__, ind, errno, strerror(errno));
+      break;
+    }
+    ++started;
+  }
+  pthread_attr_destroy(&attr);
+
+  if(started != numWorkers) {
+    pExec->numWorkers = started;
+    task_executor_destroy(pExec);
+    return -1;
+  }
+  syslog(LOG_INFO, "%s %u workers, %s priority %d", __func__, pExec->numWorkers,
+         (priority != 0) ? "SCHED_FIFO" : "SCHED_OTHER", priority);
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+int task_executor_submit(taskExecutor_t *pExec, taskFn_t pFn, void *pArg, taskGroup_t *pGroup)
+{
+  task_t task = {pFn, pArg, pGroup};
+
+  if(pGroup != NULL) {
+    pthread_mutex_lock(&pGroup->mutex);
+    ++pGroup->pending;
+    pthread_mutex_unlock(&pGroup->mutex);
+  }
+  if((pExec == NULL) || (pExec->numWorkers == 0)) {
+    run_task(&task);
+    return 1;
+  }
+
+  /* own deque from inside a task, else the next one in turn; the first with room */
+  unsigned int first = (pOwnExecutor == pExec) ? ownIndex : (EXEC_ADD(pExec->nextDeque, 1) % pExec->numWorkers);
+  EXEC_ADD(pExec->queued, 1);
+  for(unsigned int ind = 0; ind < pExec->numWorkers; ++ind) {
+    if(deque_push(&pExec->deques[(first + ind) % pExec->numWorkers], &task)) {
+      pthread_mutex_lock(&pExec->idleMutex);
+      pthread_cond_signal(&pExec->idleCond);
+      pthread_mutex_unlock(&pExec->idleMutex);
+      return 0;
+    }
+  }
+  EXEC_ADD(pExec->queued, -1);
+  EXEC_ADD(pExec->inlineCnt, 1);
+  run_task(&task);
+  return 1;
+}
+
+/*---------------------------------------------------------------------------------*/
+void task_executor_destroy(taskExecutor_t *pExec)
+{
+  if((pExec == NULL) || !pExec->running) {
+    return;
+  }
+
+  /* workers empty the deques before exiting */
+  pthread_mutex_lock(&pExec->idleMutex);
+  pExec->running = 0;
+  pthread_cond_broadcast(&pExec->idleCond);
+  pthread_mutex_unlock(&pExec->idleMutex);
+  for(unsigned int ind = 0; ind < pExec->numWorkers; ++ind) {
+    pthread_join(pExec->threads[ind], NULL);
+    syslog(LOG_INFO, "%s worker #%u: tasks, %llu, stolen, %llu", __func__, ind, pExec->deques[ind].executed,
+           pExec->deques[ind].stolen);
+  }
+  syslog(LOG_INFO, "%s ran in the caller (deques full), %llu, taken back unstarted, %llu", __func__,
+         pExec->inlineCnt, pExec->reclaimedCnt);
+
+  for(unsigned int ind = 0; ind < TASK_EXECUTOR_MAX_WORKERS; ++ind) {
+    pthread_mutex_destroy(&pExec->deques[ind].mutex);
+  }
+  pthread_mutex_destroy(&pExec->idleMutex);
+  pthread_cond_destroy(&pExec->idleCond);
+  pExec->numWorkers = 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+void task_group_init(taskGroup_t *pGroup)
+{
+  pthread_mutex_init(&pGroup->mutex, NULL);
+  pthread_cond_init(&pGroup->doneCond, NULL);
+  pGroup->pending = 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+void task_group_wait(taskGroup_t *pGroup)
+{
+  pthread_mutex_lock(&pGroup->mutex);
+  while(pGroup->pending != 0) {
+    pthread_cond_wait(&pGroup->doneCond, &pGroup->mutex);
+  }
+  pthread_mutex_unlock(&pGroup->mutex);
+}
+
+/*---------------------------------------------------------------------------------*/
+void task_group_finish(taskExecutor_t *pExec, taskGroup_t *pGroup)
+{
+  task_t task;
+
+  /* what no worker has started yet runs here, so only tasks already running are waited on */
+  if((pExec != NULL) && (pExec->numWorkers != 0)) {
+    for(unsigned int ind = 0; ind < pExec->numWorkers; ++ind) {
+      while(deque_take_group(&pExec->deques[ind], pGroup, &task)) {
+        EXEC_ADD(pExec->queued, -1);
+        EXEC_ADD(pExec->reclaimedCnt, 1);
+        run_task(&task);
+      }
+    }
+  }
+  task_group_wait(pGroup);
+}
+
+/*---------------------------------------------------------------------------------*/
+void task_group_destroy(taskGroup_t *pGroup)
+{
+  pthread_mutex_destroy(&pGroup->mutex);
+  pthread_cond_destroy(&pGroup->doneCond);
+}
+
+/*---------------------------------------------------------------------------------*/
+static void *task_worker(void *arg)
+{
+  taskDeque_t *pOwn = (taskDeque_t *)arg;
+  taskExecutor_t *pExec = (taskExecutor_t *)pOwn->pExec;
+  task_t task;
+
+  pOwnExecutor = pExec;
+  ownIndex = pOwn->index;
+  while(1) {
+    if(take_task(pExec, ownIndex, &task)) {
+      run_task(&task);
+      continue;
+    }
+
+    /* nothing anywhere: sleep until a submit (queued is raised before the push) */
+    pthread_mutex_lock(&pExec->idleMutex);
+    while((EXEC_LOAD(pExec->queued) == 0) && pExec->running) {
+      pthread_cond_wait(&pExec->idleCond, &pExec->idleMutex);
+    }
+    uint8_t done = (EXEC_LOAD(pExec->queued) == 0) && !pExec->running;
+    pthread_mutex_unlock(&pExec->idleMutex);
+    if(done) {
+      break;
+    }
+  }
+  return NULL;
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * Own deque first, newest task; else the oldest task of the next non-empty deque.
+ */
+static uint8_t take_task(taskExecutor_t *pExec, unsigned int index, task_t *pTask)
+{
+  taskDeque_t *pOwn = &pExec->deques[index];
+
+  if(deque_pop(pOwn, pTask)) {
+    EXEC_ADD(pExec->queued, -1);
+    ++pOwn->executed;
+    return 1;
+  }
+  for(unsigned int ind = 1; ind < pExec->numWorkers; ++ind) {
+    if(deque_steal(&pExec->deques[(index + ind) % pExec->numWorkers], pTask)) {
+      EXEC_ADD(pExec->queued, -1);
+      ++pOwn->executed;
+      ++pOwn->stolen;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+static uint8_t deque_push(taskDeque_t *pDeque, const task_t *pTask)
+{
+  uint8_t pushed = 0;
+
+  pthread_mutex_lock(&pDeque->mutex);
+  if((pDeque->bottom - pDeque->top) < TASK_DEQUE_LEN) {
+    pDeque->tasks[pDeque->bottom % TASK_DEQUE_LEN] = *pTask;
+    ++pDeque->bottom;
+    pushed = 1;
+  }
+  pthread_mutex_unlock(&pDeque->mutex);
+  return pushed;
+}
+
+/*---------------------------------------------------------------------------------*/
+static uint8_t deque_pop(taskDeque_t *pDeque, task_t *pTask)
+{
+  uint8_t popped = 0;
+
+  pthread_mutex_lock(&pDeque->mutex);
+  if(pDeque->bottom != pDeque->top) {
+    --pDeque->bottom;
+    *pTask = pDeque->tasks[pDeque->bottom % TASK_DEQUE_LEN];
+    popped = 1;
+  }
+  pthread_mutex_unlock(&pDeque->mutex);
+  return popped;
+}
+
+/*---------------------------------------------------------------------------------*/
+static uint8_t deque_steal(taskDeque_t *pDeque, task_t *pTask)
+{
+  uint8_t stolen = 0;
+
+  pthread_mutex_lock(&pDeque->mutex);
+  if(pDeque->bottom != pDeque->top) {
+    *pTask = pDeque->tasks[pDeque->top % TASK_DEQUE_LEN];
+    ++pDeque->top;
+    stolen = 1;
+  }
+  pthread_mutex_unlock(&pDeque->mutex);
+  return stolen;
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * Remove the oldest task of pGroup from anywhere in the deque, keeping the others in order.
+ */
+static uint8_t deque_take_group(taskDeque_t *pDeque, const taskGroup_t *pGroup, task_t *pTask)
+{
+  uint8_t taken = 0;
+
+  pthread_mutex_lock(&pDeque->mutex);
+  for(unsigned int pos = pDeque->top; pos != pDeque->bottom; ++pos) {
+    if(pDeque->tasks[pos % TASK_DEQUE_LEN].pGroup == pGroup) {
+      *pTask = pDeque->tasks[pos % TASK_DEQUE_LEN];
+      for(unsigned int next = pos + 1; next != pDeque->bottom; ++next) {
+        pDeque->tasks[(next - 1) % TASK_DEQUE_LEN] = pDeque->tasks[next % TASK_DEQUE_LEN];
+      }
+      --pDeque->bottom;
+      taken = 1;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&pDeque->mutex);
+  return taken;
+}
+
+/*---------------------------------------------------------------------------------*/
+static void run_task(const task_t *pTask)
+{
+  pTask->pFn(pTask->pArg);
+  if(pTask->pGroup != NULL) {
+    pthread_mutex_lock(&pTask->pGroup->mutex);
+    if(--pTask->pGroup->pending == 0) {
+      pthread_cond_broadcast(&pTask->pGroup->doneCond);
+    }
+    pthread_mutex_unlock(&pTask->pGroup->mutex);
+  }
+}
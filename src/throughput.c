@@ -0,0 +1,124 @@
+/***********************************************************************************
+ * @author Joshua Malburg
+ * joshua.malburg@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file throughput.c
+ * @brief stage / end to end throughput and core utilisation (see throughput.h)
+ *
+ ************************************************************************************
+ */
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdio.h>
+#include <string.h>
+#include <syslog.h>
+
+/* project headers */
+#include "throughput.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define LOAD(field)                   __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#define PROC_STAT_FILE                "/proc/stat"
+
+/*---------------------------------------------------------------------------------*/
+/* PRIVATE FUNCTIONS */
+static unsigned int read_cpu_ticks(uint64_t *pBusy, uint64_t *pTotal);
+
+/*---------------------------------------------------------------------------------*/
+void throughput_start(throughputRun_t *pRun)
+{
+  memset(pRun, 0, sizeof(throughputRun_t));
+  pRun->numCpus = read_cpu_ticks(pRun->busyTicks, pRun->totalTicks);
+  pRun->startNs = monitor_now_ns();
+}
+
+/*---------------------------------------------------------------------------------*/
+void throughput_report(const throughputRun_t *pRun, const pipelineMetrics_t *pBlock, const uint64_t *pStageFrames,
+                       uint64_t inputFrames, uint64_t endNs)
+{
+  uint64_t busyTicks[THROUGHPUT_MAX_CPUS];
+  uint64_t totalTicks[THROUGHPUT_MAX_CPUS];
+  double runSec = (endNs > pRun->startNs) ? (endNs - pRun->startNs) / 1e9 : 0.0;
+
+  if(runSec == 0.0) {
+    return;
+  }
+  syslog(LOG_INFO, "%s run: %.3f sec, input frames, %llu, end to end fps, %.1f, saved, %llu", __func__, runSec,
+         (unsigned long long)inputFrames, inputFrames / runSec, (unsigned long long)LOAD(pBlock->framesSaved));
+  printf("throughput: %.3f sec, %llu frames, end to end %.1f fps\n", runSec, (unsigned long long)inputFrames,
+         inputFrames / runSec);
+
+  /* capacity: what the stage would sustain with a core to itself */
+  unsigned int numServices = (pBlock->numServices < SERVICE_MAX) ? pBlock->numServices : SERVICE_MAX;
+  for(unsigned int ind = 0; ind < numServices; ++ind) {
+    const serviceMonitor_t *pMon = &pBlock->monitors[ind];
+    uint64_t cpuNs = LOAD(pMon->threadCpuNs);
+    double cpuPct = (100.0 * cpuNs) / (runSec * 1e9);
+    double capacityFps = (cpuNs != 0) ? (pStageFrames[ind] * 1e9) / cpuNs : 0.0;
+    syslog(LOG_INFO, "%s %s: frames, %llu, fps, %.1f, cpu, %.1f %%, capacity fps, %.1f", __func__, pMon->name,
+           (unsigned long long)pStageFrames[ind], pStageFrames[ind] / runSec, cpuPct, capacityFps);
+    printf("  %-6s %8llu frames %8.1f fps  cpu %5.1f %%  capacity %8.1f fps\n", pMon->name,
+           (unsigned long long)pStageFrames[ind], pStageFrames[ind] / runSec, cpuPct, capacityFps);
+  }
+
+  unsigned int numCpus = read_cpu_ticks(busyTicks, totalTicks);
+  if(numCpus > pRun->numCpus) {
+    numCpus = pRun->numCpus;
+  }
+  for(unsigned int cpu = 0; cpu < numCpus; ++cpu) {
+    if((pRun->totalTicks[cpu] == 0) || (totalTicks[cpu] == 0)) {
+      /* offline at the start or the end */
+      continue;
+    }
+    uint64_t total = totalTicks[cpu] - pRun->totalTicks[cpu];
+    double busyPct = (total != 0) ? (100.0 * (busyTicks[cpu] - pRun->busyTicks[cpu])) / total : 0.0;
+    syslog(LOG_INFO, "%s cpu%u: utilisation, %.1f %%", __func__, cpu, busyPct);
+    printf("  cpu%u   %5.1f %%\n", cpu, busyPct);
+  }
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * Busy (everything but idle / iowait) and total jiffies of each "cpuN" line, stored
+ * by N; offline CPUs aren't listed and are left at 0.
+ * @return highest cpu id + 1
+ */
+static unsigned int read_cpu_ticks(uint64_t *pBusy, uint64_t *pTotal)
+{
+  char line[256];
+  unsigned int numCpus = 0;
+
+  memset(pBusy, 0, THROUGHPUT_MAX_CPUS * sizeof(uint64_t));
+  memset(pTotal, 0, THROUGHPUT_MAX_CPUS * sizeof(uint64_t));
+  FILE *pFile = fopen(PROC_STAT_FILE, "r");
+  if(pFile == NULL) {
+    syslog(LOG_ERR, "%s couldn't open %s", __func__, PROC_STAT_FILE);
+    return 0;
+  }
+  while(fgets(line, sizeof(line), pFile) != NULL) {
+    unsigned int cpu;
+    unsigned long long user, nice, system, idle, iowait, irq, softirq, steal;
+    if(sscanf(line, "cpu%u %llu %llu %llu %llu %llu %llu %llu %llu", &cpu, &user, &nice, &system, &idle, &iowait, &irq,
+              &softirq, &steal) != 9) {
+      continue;
+    }
+    if(cpu >= THROUGHPUT_MAX_CPUS) {
+      continue;
+    }
+    pTotal[cpu] = user + nice + system + idle + iowait + irq + softirq + steal;
+    pBusy[cpu] = pTotal[cpu] - idle - iowait;
+    if(cpu >= numCpus) {
+      numCpus = cpu + 1;
+    }
+  }
+  fclose(pFile);
+  return numCpus;
+}
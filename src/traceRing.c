@@ -0,0 +1,224 @@
+/***********************************************************************************
+ * @author Brian Ibeling
+ * ibelingb@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file traceRing.c
+ * @brief lock-free binary trace of the pipeline's timing events (see traceRing.h)
+ *
+ ************************************************************************************
+ */
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <syslog.h>
+
+/* project headers */
+#include "traceRing.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define TRACE_CALIBRATE_EVENTS        (TRACE_RING_EVENTS - 1)
+
+/*---------------------------------------------------------------------------------*/
+/* PRIVATE FUNCTIONS */
+static void *trace_flush_thread(void *arg);
+static unsigned long trace_drain(void);
+static uint32_t trace_measure_overhead(void);
+
+/*---------------------------------------------------------------------------------*/
+/* GLOBAL VARIABLES */
+__thread traceRing_t *pTraceRing = NULL;
+
+static traceRing_t *pRings = NULL;            /* TRACE_MAX_THREADS rings */
+static unsigned int numRings = 0;
+static FILE *pTraceFile = NULL;
+static pthread_t flushThread;
+static pthread_mutex_t traceMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stopCond = PTHREAD_COND_INITIALIZER;
+static uint8_t flushRunning = 0;
+static unsigned long long eventsWritten = 0;
+
+/*---------------------------------------------------------------------------------*/
+int trace_start(const char *filename, const cpu_set_t *pCpuSet)
+{
+  traceFileHeader_t header;
+
+  if(pTraceFile != NULL) {
+    return -1;
+  }
+  if(posix_memalign((void **)&pRings, TRACE_CACHE_LINE, TRACE_MAX_THREADS * sizeof(traceRing_t)) != 0) {
+    syslog(LOG_ERR, "%s couldn't allocate trace rings", __func__);
+    return -1;
+  }
+  memset(pRings, 0, TRACE_MAX_THREADS * sizeof(traceRing_t));
+  numRings = 0;
+  eventsWritten = 0;
+
+  pTraceFile = fopen(filename, "wb");
+  if(pTraceFile == NULL) {
+    syslog(LOG_ERR, "%s couldn't open %s, errno: %d [%s]", __func__, filename, errno, strerror(errno));
+    free(pRings);
+    pRings = NULL;
+    return -1;
+  }
+
+  memset(&header, 0, sizeof(traceFileHeader_t));
+  memcpy(header.magic, TRACE_FILE_MAGIC, sizeof(header.magic));
+  header.version = TRACE_FILE_VERSION;
+  header.eventSize = sizeof(traceEvent_t);
+  header.overheadNs = trace_measure_overhead();
+  header.startNs = clock_source_now_ns();
+  header.flags = clock_source_is_virtual() ? TRACE_FLAG_VIRTUAL_CLOCK : 0;
+  fwrite(&header, sizeof(traceFileHeader_t), 1, pTraceFile);
+  syslog(LOG_INFO, "%s tracing to %s, %u ns per event", __func__, filename, header.overheadNs);
+
+  /* low priority drain on the non-RT core */
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+  pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+  if(pCpuSet != NULL) {
+    pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), pCpuSet);
+  }
+  flushRunning = 1;
+  if(pthread_create(&flushThread, &attr, trace_flush_thread, NULL) != 0) {
+    syslog(LOG_ERR, "%s couldn't create flush thread, tracing until the rings fill", __func__);
+    flushRunning = 0;
+  }
+  pthread_attr_destroy(&attr);
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+int trace_register(uint8_t thread)
+{
+  int rtnCode = -1;
+
+  pthread_mutex_lock(&traceMutex);
+  if((pRings != NULL) && (numRings < TRACE_MAX_THREADS)) {
+    traceRing_t *pRing = &pRings[numRings];
+    pRing->thread = thread;
+    __atomic_store_n(&numRings, numRings + 1, __ATOMIC_RELEASE);
+    pTraceRing = pRing;
+    rtnCode = 0;
+  }
+  pthread_mutex_unlock(&traceMutex);
+  return rtnCode;
+}
+
+/*---------------------------------------------------------------------------------*/
+void trace_stop(void)
+{
+  unsigned long long dropped = 0;
+
+  if(pTraceFile == NULL) {
+    return;
+  }
+  pthread_mutex_lock(&traceMutex);
+  uint8_t joinFlush = flushRunning;
+  flushRunning = 0;
+  pthread_cond_signal(&stopCond);
+  pthread_mutex_unlock(&traceMutex);
+  if(joinFlush) {
+    pthread_join(flushThread, NULL);
+  }
+
+  trace_drain();
+  for(unsigned int ind = 0; ind < numRings; ++ind) {
+    dropped += __atomic_load_n(&pRings[ind].dropped, __ATOMIC_RELAXED);
+  }
+  fclose(pTraceFile);
+  pTraceFile = NULL;
+  syslog(LOG_INFO, "%s %llu events written, %llu dropped (ring full)", __func__, eventsWritten, dropped);
+
+  /* rings stay allocated; threads that traced may still hold pTraceRing */
+}
+
+/*---------------------------------------------------------------------------------*/
+static void *trace_flush_thread(void *arg)
+{
+  struct timespec wakeTime;
+
+  pthread_mutex_lock(&traceMutex);
+  while(flushRunning) {
+    clock_gettime(CLOCK_REALTIME, &wakeTime);
+    wakeTime.tv_nsec += TRACE_FLUSH_MSEC * 1000000L;
+    if(wakeTime.tv_nsec >= 1000000000L) {
+      wakeTime.tv_sec += 1;
+      wakeTime.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(&stopCond, &traceMutex, &wakeTime);
+    if(!flushRunning) {
+      break;
+    }
+    pthread_mutex_unlock(&traceMutex);
+    trace_drain();
+    pthread_mutex_lock(&traceMutex);
+  }
+  pthread_mutex_unlock(&traceMutex);
+  return NULL;
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * Copy everything published in each ring to the file (consumer side).
+ */
+static unsigned long trace_drain(void)
+{
+  unsigned long drained = 0;
+  unsigned int rings = __atomic_load_n(&numRings, __ATOMIC_ACQUIRE);
+
+  for(unsigned int ind = 0; ind < rings; ++ind) {
+    traceRing_t *pRing = &pRings[ind];
+    uint32_t tail = pRing->tail;
+    uint32_t head = __atomic_load_n(&pRing->head, __ATOMIC_ACQUIRE);
+    while(tail != head) {
+      /* contiguous run up to the end of the ring */
+      uint32_t start = tail & (TRACE_RING_EVENTS - 1);
+      uint32_t cnt = head - tail;
+      if(cnt > (TRACE_RING_EVENTS - start)) {
+        cnt = TRACE_RING_EVENTS - start;
+      }
+      fwrite(&pRing->events[start], sizeof(traceEvent_t), cnt, pTraceFile);
+      tail += cnt;
+      drained += cnt;
+    }
+    __atomic_store_n(&pRing->tail, tail, __ATOMIC_RELEASE);
+  }
+  eventsWritten += drained;
+  return drained;
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * Average cost of one trace_ring_push, timed on a scratch ring.
+ */
+static uint32_t trace_measure_overhead(void)
+{
+  struct timespec start, end;
+
+  traceRing_t *pScratch = NULL;
+  if(posix_memalign((void **)&pScratch, TRACE_CACHE_LINE, sizeof(traceRing_t)) != 0) {
+    return 0;
+  }
+  memset(pScratch, 0, sizeof(traceRing_t));
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for(uint32_t ind = 0; ind < TRACE_CALIBRATE_EVENTS; ++ind) {
+    trace_ring_push(pScratch, TRACE_FRAME_START, ind, ind);
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  free(pScratch);
+
+  int64_t elapsedNs = ((int64_t)(end.tv_sec - start.tv_sec) * 1000000000LL) + (end.tv_nsec - start.tv_nsec);
+  return (uint32_t)(elapsedNs / TRACE_CALIBRATE_EVENTS);
+}
@@ -0,0 +1,266 @@
+/***********************************************************************************
+ * @author Brian Ibeling
+ * ibelingb@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file videoEncoder.c
+ * @brief video encoding thread with rolling segments (see videoEncoder.h)
+ *
+ ************************************************************************************
+ */
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <syslog.h>
+#include <sys/stat.h>
+
+/* opencv headers */
+#include <opencv2/core.hpp>     // Basic OpenCV structures (cv::Mat, Scalar)
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+
+#include <algorithm>
+
+using namespace cv;
+using namespace std;
+
+/* project headers */
+#include "videoEncoder.h"
+
+/*---------------------------------------------------------------------------------*/
+/* PRIVATE FUNCTIONS */
+static void *video_worker(void *arg);
+static void video_encoder_free(videoEncoder_t *pEncoder);
+
+/*---------------------------------------------------------------------------------*/
+int video_encoder_start(videoEncoder_t *pEncoder, const char *prefix, size_t slotLen, const cpu_set_t *pCpuSet,
+                        retentionMgr_t *pRetention, double fps)
+{
+  if((pEncoder == NULL) || (prefix == NULL) || (slotLen == 0)) {
+    return -1;
+  }
+  memset(pEncoder, 0, sizeof(videoEncoder_t));
+  strncpy(pEncoder->prefix, prefix, sizeof(pEncoder->prefix) - 1);
+  pEncoder->slotLen = slotLen;
+  pEncoder->pRetention = pRetention;
+  pEncoder->fps = (fps > 0.0) ? fps : VIDEO_TIMEBASE_FPS;
+
+  /* allocate all frame buffers now so nothing is allocated on the write path */
+  pEncoder->pSlots = (videoFrame_t *)calloc(VIDEO_QUEUE_LEN, sizeof(videoFrame_t));
+  pEncoder->pFreeStack = (unsigned int *)calloc(VIDEO_QUEUE_LEN, sizeof(unsigned int));
+  pEncoder->pPending = (unsigned int *)calloc(VIDEO_QUEUE_LEN, sizeof(unsigned int));
+  if((pEncoder->pSlots == NULL) || (pEncoder->pFreeStack == NULL) || (pEncoder->pPending == NULL)) {
+    syslog(LOG_ERR, "%s couldn't allocate queue", __func__);
+    video_encoder_free(pEncoder);
+    return -1;
+  }
+  for(unsigned int ind = 0; ind < VIDEO_QUEUE_LEN; ++ind) {
+    pEncoder->pSlots[ind].pData = (uint8_t *)malloc(slotLen);
+    if(pEncoder->pSlots[ind].pData == NULL) {
+      syslog(LOG_ERR, "%s couldn't allocate slot #%u", __func__, ind);
+      video_encoder_free(pEncoder);
+      return -1;
+    }
+    memset(pEncoder->pSlots[ind].pData, 0, slotLen);
+    pEncoder->pFreeStack[pEncoder->freeCnt++] = ind;
+  }
+
+  pthread_mutex_init(&pEncoder->mutex, NULL);
+  pthread_cond_init(&pEncoder->workCond, NULL);
+  pEncoder->running = 1;
+
+  /* encode at SCHED_OTHER so only idle time is used */
+  pthread_attr_t attr;
+  struct sched_param param;
+  memset(&param, 0, sizeof(param));
+  pthread_attr_init(&attr);
+  pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+  pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+  pthread_attr_setschedparam(&attr, &param);
+  if(pCpuSet != NULL) {
+    pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), pCpuSet);
+  }
+  int rtn = pthread_create(&pEncoder->thread, &attr, video_worker, (void *)pEncoder);
+  pthread_attr_destroy(&attr);
+  if(rtn != 0) {
+    syslog(LOG_ERR, "%s couldn't create video thread", __func__);
+    pthread_mutex_destroy(&pEncoder->mutex);
+    pthread_cond_destroy(&pEncoder->workCond);
+    video_encoder_free(pEncoder);
+    return -1;
+  }
+  pEncoder->started = 1;
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+int video_encoder_submit(videoEncoder_t *pEncoder, const uint8_t *pData, int type, int rows, int cols, float frameTime)
+{
+  if((pEncoder == NULL) || !pEncoder->started || (pData == NULL)) {
+    return -1;
+  }
+  size_t len = (size_t)rows * cols * CV_ELEM_SIZE(type);
+  if(len > pEncoder->slotLen) {
+    return -1;
+  }
+
+  pthread_mutex_lock(&pEncoder->mutex);
+  if(pEncoder->freeCnt == 0) {
+    ++pEncoder->droppedCnt;
+    pthread_mutex_unlock(&pEncoder->mutex);
+    return -1;
+  }
+  unsigned int idx = pEncoder->pFreeStack[--pEncoder->freeCnt];
+  pthread_mutex_unlock(&pEncoder->mutex);
+
+  /* slot is ours until it is queued, copy outside the lock */
+  videoFrame_t *pFrame = &pEncoder->pSlots[idx];
+  memcpy(pFrame->pData, pData, len);
+  pFrame->type = type;
+  pFrame->rows = rows;
+  pFrame->cols = cols;
+  pFrame->frameTime = frameTime;
+
+  pthread_mutex_lock(&pEncoder->mutex);
+  pEncoder->pPending[(pEncoder->pendingHead + pEncoder->pendingCnt) % VIDEO_QUEUE_LEN] = idx;
+  ++pEncoder->pendingCnt;
+  pthread_cond_signal(&pEncoder->workCond);
+  pthread_mutex_unlock(&pEncoder->mutex);
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+void video_encoder_stop(videoEncoder_t *pEncoder)
+{
+  if((pEncoder == NULL) || !pEncoder->started) {
+    return;
+  }
+
+  pthread_mutex_lock(&pEncoder->mutex);
+  pEncoder->running = 0;
+  pthread_cond_broadcast(&pEncoder->workCond);
+  pthread_mutex_unlock(&pEncoder->mutex);
+  pthread_join(pEncoder->thread, NULL);
+
+  syslog(LOG_INFO, "%s segments: %u, frames: %lu, repeats: %lu, dropped (queue full): %lu", __func__,
+         pEncoder->segmentCnt, pEncoder->encodedCnt, pEncoder->repeatCnt, pEncoder->droppedCnt);
+  pthread_mutex_destroy(&pEncoder->mutex);
+  pthread_cond_destroy(&pEncoder->workCond);
+  video_encoder_free(pEncoder);
+}
+
+/*---------------------------------------------------------------------------------*/
+static void video_encoder_free(videoEncoder_t *pEncoder)
+{
+  if(pEncoder->pSlots != NULL) {
+    for(unsigned int ind = 0; ind < VIDEO_QUEUE_LEN; ++ind) {
+      free(pEncoder->pSlots[ind].pData);
+    }
+  }
+  free(pEncoder->pSlots);
+  free(pEncoder->pFreeStack);
+  free(pEncoder->pPending);
+  memset(pEncoder, 0, sizeof(videoEncoder_t));
+}
+
+/*---------------------------------------------------------------------------------*/
+static void *video_worker(void *arg)
+{
+  videoEncoder_t *pEncoder = (videoEncoder_t *)arg;
+  int codec = VideoWriter::fourcc('M','J','P','G');
+  VideoWriter writer;
+  char filename[96];
+  Mat frame, lastFrame;
+  float segStartTime = 0.0;
+  long long lastSlot = -1;
+  const double fps = pEncoder->fps;
+  const long long maxRepeat = (long long)(VIDEO_MAX_REPEAT_SEC * fps);
+
+  while(1) {
+    pthread_mutex_lock(&pEncoder->mutex);
+    while((pEncoder->pendingCnt == 0) && pEncoder->running) {
+      pthread_cond_wait(&pEncoder->workCond, &pEncoder->mutex);
+    }
+    if(pEncoder->pendingCnt == 0) {
+      /* stopping and queue drained */
+      pthread_mutex_unlock(&pEncoder->mutex);
+      break;
+    }
+    unsigned int idx = pEncoder->pPending[pEncoder->pendingHead];
+    pEncoder->pendingHead = (pEncoder->pendingHead + 1) % VIDEO_QUEUE_LEN;
+    --pEncoder->pendingCnt;
+    pthread_mutex_unlock(&pEncoder->mutex);
+
+    /* the container is always 3 channel; convert, then give the slot back */
+    videoFrame_t *pFrame = &pEncoder->pSlots[idx];
+    Mat img(Size(pFrame->cols, pFrame->rows), pFrame->type, pFrame->pData);
+    if(img.channels() == 1) {
+      cvtColor(img, frame, COLOR_GRAY2RGB);
+    } else {
+      img.copyTo(frame);
+    }
+    float frameTime = pFrame->frameTime;
+    pthread_mutex_lock(&pEncoder->mutex);
+    pEncoder->pFreeStack[pEncoder->freeCnt++] = idx;
+    pthread_mutex_unlock(&pEncoder->mutex);
+
+    /* hold the previous frame on screen until this one was captured */
+    long long slot = llround((frameTime - segStartTime) * fps / 1000.0);
+    if(writer.isOpened() && !lastFrame.empty()) {
+      long long gap = std::min(slot - lastSlot - 1, maxRepeat);
+      for(; gap > 0; --gap) {
+        writer.write(lastFrame);
+        ++pEncoder->repeatCnt;
+      }
+    }
+
+    /* roll to a new segment on time or size */
+    if(writer.isOpened()) {
+      struct stat segStat;
+      if(((frameTime - segStartTime) >= (VIDEO_SEGMENT_SEC * 1000.0)) ||
+         ((stat(filename, &segStat) == 0) && (segStat.st_size >= ((off_t)VIDEO_SEGMENT_MB << 20)))) {
+        writer.release();
+        retention_track(pEncoder->pRetention, filename);
+      }
+    }
+    if(!writer.isOpened()) {
+      snprintf(filename, sizeof(filename), "%s_%03u.avi", pEncoder->prefix, pEncoder->segmentCnt);
+      retention_claim(pEncoder->pRetention, filename);
+      if(!writer.open(filename, codec, fps, frame.size(), true)) {
+        syslog(LOG_ERR, "%s couldn't open %s", __func__, filename);
+        continue;
+      }
+      ++pEncoder->segmentCnt;
+      segStartTime = frameTime;
+      lastSlot = -1;
+      slot = 0;
+    }
+
+    /* a frame early by jitter still gets its own slot */
+    if(slot <= lastSlot) {
+      slot = lastSlot + 1;
+    }
+    writer.write(frame);
+    ++pEncoder->encodedCnt;
+    lastSlot = slot;
+    std::swap(frame, lastFrame);
+  }
+
+  if(writer.isOpened()) {
+    writer.release();
+    retention_track(pEncoder->pRetention, filename);
+  }
+  return NULL;
+}
@@ -0,0 +1,267 @@
+/***********************************************************************************
+ * @author Joshua Malburg
+ * joshua.malburg@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file archiveReader.c
+ * @brief list, extract or stream frames from a frame archive
+ *
+ * Frames are written as binary PPM (color) or PGM (grayscale) so the output matches
+ * what writeTask used to produce with imwrite. Delta compressed archives (-z) are
+ * decoded transparently; each residual only needs its keyframe, which is found
+ * through the index (archive_find_frame: O(1) within any segment, a bisection if
+ * frames were dropped) and cached while streaming. "stream" concatenates the
+ * images on stdout, e.g.:
+ *   ./archiveReader frames.farc stream | ffmpeg -f image2pipe -c:v ppm -i - out.mp4
+ *
+ ************************************************************************************
+ */
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+
+/* project headers */
+#include "frameArchive.h"
+#include "deltaCodec.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define MAT_DEPTH(type)     ((type) & 7)
+#define MAT_CHANNELS(type)  (((type) >> 3) + 1)
+
+/*---------------------------------------------------------------------------------*/
+/* PRIVATE FUNCTIONS */
+static void usage(void);
+static void list_frames(const frameArchive_t *pArchive);
+static const uint8_t *decode_frame(const frameArchive_t *pArchive, const archiveIndexEntry_t *pEntry, const uint8_t *pData);
+static int write_pnm(FILE *pFile, const frameArchive_t *pArchive, const archiveIndexEntry_t *pEntry, const uint8_t *pData);
+static int extract_frame(const frameArchive_t *pArchive, const archiveIndexEntry_t *pEntry, const uint8_t *pData, const char *outDir);
+
+/*---------------------------------------------------------------------------------*/
+/* GLOBAL VARIABLES */
+static uint8_t *pKeyBuf = NULL;               /* decoded keyframe cache */
+static uint32_t keyBufFrameNum = UINT32_MAX;
+static uint8_t *pFrameBuf = NULL;             /* decoded frame */
+static size_t frameBufLen = 0;
+
+/*---------------------------------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+  frameArchive_t archive;
+  const archiveIndexEntry_t *pEntry;
+  const uint8_t *pData;
+  int rtnCode = 0;
+
+  if(argc < 2) {
+    usage();
+    return -1;
+  }
+  if(archive_open(&archive, argv[1]) != 0) {
+    return -1;
+  }
+
+  const char *cmd = (argc > 2) ? argv[2] : "list";
+  if(strcmp(cmd, "list") == 0) {
+    list_frames(&archive);
+  } else if(strcmp(cmd, "extract") == 0) {
+    const char *outDir = (argc > 4) ? argv[4] : ".";
+    if((argc < 4) || (strcmp(argv[3], "all") == 0)) {
+      for(uint32_t idx = 0; idx < archive_frame_count(&archive); ++idx) {
+        pEntry = archive_get_index(&archive, idx, &pData);
+        if((pEntry == NULL) || (extract_frame(&archive, pEntry, pData, outDir) != 0)) {
+          rtnCode = -1;
+        }
+      }
+    } else {
+      pEntry = archive_find_frame(&archive, strtoul(argv[3], NULL, 10), &pData);
+      if(pEntry == NULL) {
+        fprintf(stderr, "frame %s not in archive\n", argv[3]);
+        rtnCode = -1;
+      } else {
+        rtnCode = extract_frame(&archive, pEntry, pData, outDir);
+      }
+    }
+  } else if(strcmp(cmd, "stream") == 0) {
+    uint32_t first = (argc > 3) ? strtoul(argv[3], NULL, 10) : 0;
+    uint32_t last = (argc > 4) ? strtoul(argv[4], NULL, 10) : UINT32_MAX;
+    for(uint32_t idx = 0; idx < archive_frame_count(&archive); ++idx) {
+      pEntry = archive_get_index(&archive, idx, &pData);
+      if((pEntry == NULL) || (pEntry->frameNum < first) || (pEntry->frameNum > last)) {
+        continue;
+      }
+      if(write_pnm(stdout, &archive, pEntry, pData) != 0) {
+        rtnCode = -1;
+        break;
+      }
+    }
+    fflush(stdout);
+  } else {
+    usage();
+    rtnCode = -1;
+  }
+
+  archive_close(&archive);
+  free(pKeyBuf);
+  free(pFrameBuf);
+  return rtnCode;
+}
+
+/*---------------------------------------------------------------------------------*/
+static void usage(void)
+{
+  fprintf(stderr, "Usage: ./archiveReader [archive] [list | extract [frame#|all] [outDir] | stream [first#] [last#]]\n"
+                  "./archiveReader frames.farc list\n"
+                  "./archiveReader frames.farc extract 42 ./frames\n"
+                  "./archiveReader frames.farc stream > frames.ppm\n");
+}
+
+/*---------------------------------------------------------------------------------*/
+static void list_frames(const frameArchive_t *pArchive)
+{
+  const archiveHeader_t *pHdr = pArchive->pHdr;
+
+  printf("frames: %u of %u, data: %llu bytes\n", pHdr->frameCount, pHdr->maxFrames,
+         (unsigned long long)(pHdr->writeOffset - pHdr->dataOffset));
+  printf("frame#, time (msec), offset, size, rows, cols, channels, codec\n");
+  for(uint32_t idx = 0; idx < archive_frame_count(pArchive); ++idx) {
+    const archiveIndexEntry_t *pEntry = archive_get_index(pArchive, idx, NULL);
+    if(pEntry == NULL) {
+      printf("slot %u is corrupt\n", idx);
+      continue;
+    }
+    printf("%u, %.2f, %llu, %u, %u, %u, %d, %u\n", pEntry->frameNum, pEntry->frameTime,
+           (unsigned long long)pEntry->offset, pEntry->size, pEntry->rows, pEntry->cols,
+           MAT_CHANNELS(pEntry->type), pEntry->codec);
+  }
+}
+
+/*---------------------------------------------------------------------------------*/
+static const uint8_t *decode_frame(const frameArchive_t *pArchive, const archiveIndexEntry_t *pEntry, const uint8_t *pData)
+{
+  size_t len = (size_t)pEntry->rows * pEntry->cols * MAT_CHANNELS(pEntry->type);
+
+  if(pEntry->codec == ARCHIVE_CODEC_RAW) {
+    return (pEntry->size >= len) ? pData : NULL;
+  }
+  if((pEntry->codec != ARCHIVE_CODEC_ZLIB) && (pEntry->codec != ARCHIVE_CODEC_DELTA)) {
+    return NULL;
+  }
+
+  /* both buffers are sized for the largest frame seen so far */
+  if(len > frameBufLen) {
+    free(pKeyBuf);
+    free(pFrameBuf);
+    pKeyBuf = (uint8_t *)malloc(len);
+    pFrameBuf = (uint8_t *)malloc(len);
+    keyBufFrameNum = UINT32_MAX;
+    frameBufLen = (pKeyBuf && pFrameBuf) ? len : 0;
+    if(frameBufLen == 0) {
+      return NULL;
+    }
+  }
+
+  if(pEntry->codec == ARCHIVE_CODEC_ZLIB) {
+    if(delta_decode_key(pData, pEntry->size, pKeyBuf, len) != 0) {
+      keyBufFrameNum = UINT32_MAX;
+      return NULL;
+    }
+    keyBufFrameNum = pEntry->frameNum;
+    return pKeyBuf;
+  }
+
+  uint32_t keyFrameNum;
+  if(delta_key_frame(pData, pEntry->size, &keyFrameNum) != 0) {
+    return NULL;
+  }
+  if(keyFrameNum != keyBufFrameNum) {
+    const uint8_t *pKeyData;
+    const archiveIndexEntry_t *pKey = archive_find_frame(pArchive, keyFrameNum, &pKeyData);
+    if((pKey == NULL) || (pKey->codec != ARCHIVE_CODEC_ZLIB) || (pKey->rows != pEntry->rows) ||
+       (pKey->cols != pEntry->cols) || (pKey->type != pEntry->type) ||
+       (delta_decode_key(pKeyData, pKey->size, pKeyBuf, len) != 0)) {
+      fprintf(stderr, "frame %u: keyframe %u missing or corrupt\n", pEntry->frameNum, keyFrameNum);
+      keyBufFrameNum = UINT32_MAX;
+      return NULL;
+    }
+    keyBufFrameNum = keyFrameNum;
+  }
+  if(delta_decode(pData, pEntry->size, pKeyBuf, pEntry->rows, pEntry->cols, MAT_CHANNELS(pEntry->type), pFrameBuf) != 0) {
+    return NULL;
+  }
+  return pFrameBuf;
+}
+
+/*---------------------------------------------------------------------------------*/
+static int write_pnm(FILE *pFile, const frameArchive_t *pArchive, const archiveIndexEntry_t *pEntry, const uint8_t *pData)
+{
+  int channels = MAT_CHANNELS(pEntry->type);
+  size_t rowLen = (size_t)pEntry->cols * channels;
+
+  if((MAT_DEPTH(pEntry->type) != 0) || ((channels != 1) && (channels != 3))) {
+    fprintf(stderr, "frame %u: unsupported format (type %d)\n", pEntry->frameNum, pEntry->type);
+    return -1;
+  }
+  pData = decode_frame(pArchive, pEntry, pData);
+  if(pData == NULL) {
+    fprintf(stderr, "frame %u: couldn't decode (codec %u)\n", pEntry->frameNum, pEntry->codec);
+    return -1;
+  }
+
+  fprintf(pFile, "P%d\n%u %u\n255\n", (channels == 3) ? 6 : 5, pEntry->cols, pEntry->rows);
+  if(channels == 1) {
+    return (fwrite(pData, rowLen, pEntry->rows, pFile) == pEntry->rows) ? 0 : -1;
+  }
+
+  /* OpenCV stores BGR; PPM is RGB */
+  uint8_t *pRow = (uint8_t *)malloc(rowLen);
+  if(pRow == NULL) {
+    return -1;
+  }
+  int rtnCode = 0;
+  for(uint32_t row = 0; (row < pEntry->rows) && (rtnCode == 0); ++row) {
+    const uint8_t *pSrc = pData + (row * rowLen);
+    for(size_t col = 0; col < rowLen; col += 3) {
+      pRow[col] = pSrc[col + 2];
+      pRow[col + 1] = pSrc[col + 1];
+      pRow[col + 2] = pSrc[col];
+    }
+    if(fwrite(pRow, rowLen, 1, pFile) != 1) {
+      rtnCode = -1;
+    }
+  }
+  free(pRow);
+  return rtnCode;
+}
+
+/*---------------------------------------------------------------------------------*/
+static int extract_frame(const frameArchive_t *pArchive, const archiveIndexEntry_t *pEntry, const uint8_t *pData, const char *outDir)
+{
+  char filename[256];
+
+  snprintf(filename, sizeof(filename), "%s/f%u.%s", outDir, pEntry->frameNum,
+           (MAT_CHANNELS(pEntry->type) == 3) ? "ppm" : "pgm");
+  FILE *pFile = fopen(filename, "wb");
+  if(pFile == NULL) {
+    fprintf(stderr, "couldn't create %s: %s\n", filename, strerror(errno));
+    return -1;
+  }
+  int rtnCode = write_pnm(pFile, pArchive, pEntry, pData);
+  if(fclose(pFile) != 0) {
+    rtnCode = -1;
+  }
+  if(rtnCode != 0) {
+    fprintf(stderr, "failed writing %s\n", filename);
+  }
+  return rtnCode;
+}
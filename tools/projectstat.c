@@ -0,0 +1,111 @@
+/***********************************************************************************
+ * @author Joshua Malburg
+ * joshua.malburg@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file projectstat.c
+ * @brief print the live metrics of a running pipeline (metrics.h)
+ *
+ * Maps the pipeline's shared memory metrics read only and prints them every
+ * interval; the pipeline's threads are never signalled or blocked, so any refresh
+ * rate is fine:
+ *   ./projectstat            refresh every second until Ctrl-C
+ *   ./projectstat -i 100     every 100 ms
+ *   ./projectstat -n 1       print once (e.g. for scripts)
+ *
+ ************************************************************************************
+ */
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+/* project headers */
+#include "metrics.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define DEFAULT_INTERVAL_MSEC         (1000)
+#define CLEAR_SCREEN                  "\033[H\033[J"
+
+/*---------------------------------------------------------------------------------*/
+/* PRIVATE FUNCTIONS */
+static void usage(void);
+
+/*---------------------------------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+  long intervalMsec = DEFAULT_INTERVAL_MSEC;
+  long count = 0;
+  int opt;
+
+  while((opt = getopt(argc, argv, "i:n:")) != -1) {
+    switch(opt) {
+    case 'i':
+      intervalMsec = atol(optarg);
+      if(intervalMsec <= 0) {
+        usage();
+        return -1;
+      }
+      break;
+    case 'n':
+      count = atol(optarg);
+      if(count < 0) {
+        usage();
+        return -1;
+      }
+      break;
+    default:
+      usage();
+      return -1;
+    }
+  }
+
+  const pipelineMetrics_t *pBlock = metrics_attach();
+  if(pBlock == NULL) {
+    fprintf(stderr, "no running pipeline publishing %s\n", METRICS_SHM_NAME);
+    return -1;
+  }
+
+  char *pText = (char *)malloc(METRICS_TEXT_LEN);
+  if(pText == NULL) {
+    metrics_detach(pBlock);
+    return -1;
+  }
+  uint8_t clear = (count != 1) && isatty(STDOUT_FILENO);
+  struct timespec interval = {intervalMsec / 1000, (intervalMsec % 1000) * 1000000L};
+  for(long ind = 0; (count == 0) || (ind < count); ++ind) {
+    if(ind != 0) {
+      nanosleep(&interval, NULL);
+    }
+    metrics_format(pBlock, pText, METRICS_TEXT_LEN);
+    printf("%s%s", clear ? CLEAR_SCREEN : "", pText);
+    if(!clear && (count != 1)) {
+      printf("\n");
+    }
+    fflush(stdout);
+  }
+
+  free(pText);
+  metrics_detach(pBlock);
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+static void usage(void)
+{
+  fprintf(stderr, "Usage: ./projectstat [-i interval_msec] [-n count (0 = forever)]\n"
+                  "./projectstat\n"
+                  "./projectstat -i 100\n"
+                  "./projectstat -n 1\n");
+}
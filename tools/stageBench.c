@@ -0,0 +1,531 @@
+/***********************************************************************************
+ * @author Joshua Malburg
+ * joshua.malburg@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file stageBench.c
+ * @brief offline benchmark of each pipeline stage on fixed frames
+ *
+ * Runs the code of each stage in isolation, single threaded and without the
+ * sequencer, on a fixed set of frames (synthetic, or recorded images given with
+ * -i, resized to each frame size):
+ *   ring      circular_cv_buffer put + get, on arena slots attached as in the pipeline
+ *   diff      frame_difference (gray conversion, difference, threshold)
+ *   proc      frame_process with Canny and Hough (lines + circles)
+ *   annotate  overlay_draw_text
+ *   ppm       imwrite of a PPM
+ *   video     video_encoder_submit through video_encoder_stop (encoder thread)
+ *
+ * With -x the Hough circle search of proc runs on a work-stealing executor of that
+ * many workers (as in the pipeline with -x), so its effect on proc can be measured.
+ *
+ * Each stage gets a few warm up frames, then the timed frames. Allocations are
+ * counted by wrapping the malloc family, so they include OpenCV's and the video
+ * encoder thread's. Results go to stdout as CSV, one row per stage and size in a
+ * fixed order, so runs on two commits can be compared with diff:
+ *   ./stageBench > before.csv
+ *   ./stageBench -s 1280x720 -n 500 -t diff -t proc
+ *   ./stageBench -i hands0.ppm -i hands1.ppm > recorded.csv
+ *
+ ************************************************************************************
+ */
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <time.h>
+
+/* opencv headers */
+#include <opencv2/core.hpp>     // Basic OpenCV structures (cv::Mat, Scalar)
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+/* project headers */
+#include "project.h"
+#include "frameDifference.h"
+#include "frameProcessing.h"
+#include "frameOverlay.h"
+#include "videoEncoder.h"
+#include "serviceMonitor.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define BENCH_DEFAULT_FRAMES          (200)
+#define BENCH_WARMUP_FRAMES           (5)
+#define BENCH_DISTINCT_FRAMES         (8)     /* frames cycled through by every stage */
+#define BENCH_MAX_SIZES               (8)
+#define BENCH_MAX_IMAGES              (BENCH_DISTINCT_FRAMES)
+#define BENCH_SEED                    (0x5eed)
+#define BENCH_VIDEO_RETRY_USEC        (1000)
+#define BENCH_FRAME_PERIOD_MSEC       (1000.0 / VIDEO_TIMEBASE_FPS)
+
+typedef struct {
+  int rows;
+  int cols;
+  vector<Mat> frames;                         /* RGB input frames */
+  Mat prevGray, nextGray, diffFrame, bw;      /* diff */
+  Mat work, procImg, grayImg;                 /* proc / annotate */
+  circular_cv_buffer *pRing;
+  frameArena_t ringArena;                     /* ring storage, as main attaches it */
+  uint8_t *ringFrames[CIRCULAR_BUFF_LEN];
+  Mat ringRead;                               /* kept across gets, as in difference */
+  frameOverlay_t overlay;
+  videoEncoder_t video;
+  taskExecutor_t *pExecutor;                  /* proc sub-tasks, NULL for none */
+  const char *outDir;
+  uint64_t sink;                              /* keeps results live */
+} benchCtx_t;
+
+typedef struct {
+  const char *name;
+  int (*pSetup)(benchCtx_t *pCtx);            /* untimed, may be NULL */
+  void (*pStep)(benchCtx_t *pCtx, unsigned int frame);
+  void (*pFinish)(benchCtx_t *pCtx);          /* timed, may be NULL */
+} benchStage_t;
+
+/*---------------------------------------------------------------------------------*/
+/* PRIVATE FUNCTIONS */
+static void usage(void);
+static void make_frames(benchCtx_t *pCtx, const vector<Mat> &images);
+static void run_stage(const benchStage_t *pStage, benchCtx_t *pCtx, unsigned int frames, const char *source);
+static void clean_dir(const char *dir);
+static int ring_setup(benchCtx_t *pCtx);
+static void ring_step(benchCtx_t *pCtx, unsigned int frame);
+static void ring_finish(benchCtx_t *pCtx);
+static void ring_release(benchCtx_t *pCtx);
+static int diff_setup(benchCtx_t *pCtx);
+static void diff_step(benchCtx_t *pCtx, unsigned int frame);
+static void proc_step(benchCtx_t *pCtx, unsigned int frame);
+static void annotate_step(benchCtx_t *pCtx, unsigned int frame);
+static void ppm_step(benchCtx_t *pCtx, unsigned int frame);
+static int video_setup(benchCtx_t *pCtx);
+static void video_step(benchCtx_t *pCtx, unsigned int frame);
+static void video_finish(benchCtx_t *pCtx);
+
+static const benchStage_t stages[] = {
+  {"ring",     ring_setup,  ring_step,     ring_finish},
+  {"diff",     diff_setup,  diff_step,     NULL},
+  {"proc",     NULL,        proc_step,     NULL},
+  {"annotate", NULL,        annotate_step, NULL},
+  {"ppm",      NULL,        ppm_step,      NULL},
+  {"video",    video_setup, video_step,    video_finish},
+};
+#define BENCH_STAGE_COUNT             (sizeof(stages) / sizeof(stages[0]))
+
+/*---------------------------------------------------------------------------------*/
+/* ALLOCATION COUNTING */
+/*
+ * Definitions here take precedence over libc's for the whole process (OpenCV and
+ * libstdc++ included); the real allocator is reached through its __libc_ names.
+ */
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t num, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *ptr);
+}
+
+static uint64_t allocCount = 0;
+static uint64_t allocBytes = 0;
+
+#define COUNT_ALLOC(size)             do { __atomic_fetch_add(&allocCount, 1, __ATOMIC_RELAXED); \
+                                        __atomic_fetch_add(&allocBytes, (size), __ATOMIC_RELAXED); } while(0)
+
+extern "C" void *malloc(size_t size)
+{
+  COUNT_ALLOC(size);
+  return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t num, size_t size)
+{
+  COUNT_ALLOC(num * size);
+  return __libc_calloc(num, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+  COUNT_ALLOC(size);
+  return __libc_realloc(ptr, size);
+}
+
+extern "C" void *memalign(size_t alignment, size_t size)
+{
+  COUNT_ALLOC(size);
+  return __libc_memalign(alignment, size);
+}
+
+extern "C" void *aligned_alloc(size_t alignment, size_t size)
+{
+  COUNT_ALLOC(size);
+  return __libc_memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void **pPtr, size_t alignment, size_t size)
+{
+  COUNT_ALLOC(size);
+  *pPtr = __libc_memalign(alignment, size);
+  return (*pPtr != NULL) ? 0 : ENOMEM;
+}
+
+extern "C" void free(void *ptr)
+{
+  __libc_free(ptr);
+}
+
+/*---------------------------------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+  unsigned int frames = BENCH_DEFAULT_FRAMES;
+  Size sizes[BENCH_MAX_SIZES];
+  unsigned int numSizes = 0;
+  vector<Mat> images;
+  const char *outDir = NULL;
+  const char *only[BENCH_STAGE_COUNT];
+  unsigned int numOnly = 0;
+  unsigned int workers = 0;
+  int opt;
+
+  while((opt = getopt(argc, argv, "n:s:i:o:t:x:")) != -1) {
+    switch(opt) {
+    case 'n':
+      frames = atoi(optarg);
+      if(frames == 0) {
+        usage();
+        return -1;
+      }
+      break;
+    case 's': {
+      int cols = 0, rows = 0;
+      if((numSizes == BENCH_MAX_SIZES) || (sscanf(optarg, "%dx%d", &cols, &rows) != 2) || (cols <= 0) || (rows <= 0)) {
+        usage();
+        return -1;
+      }
+      sizes[numSizes++] = Size(cols, rows);
+      break;
+    }
+    case 'i': {
+      Mat img = imread(optarg, IMREAD_COLOR);
+      if(img.empty() || (images.size() == BENCH_MAX_IMAGES)) {
+        fprintf(stderr, "couldn't use %s\n", optarg);
+        return -1;
+      }
+      images.push_back(img);
+      break;
+    }
+    case 'o':
+      outDir = optarg;
+      break;
+    case 't':
+      if(numOnly == BENCH_STAGE_COUNT) {
+        usage();
+        return -1;
+      }
+      only[numOnly++] = optarg;
+      break;
+    case 'x':
+      workers = atoi(optarg);
+      if((workers == 0) || (workers > TASK_EXECUTOR_MAX_WORKERS)) {
+        usage();
+        return -1;
+      }
+      break;
+    default:
+      usage();
+      return -1;
+    }
+  }
+  if(numSizes == 0) {
+    sizes[numSizes++] = Size(MAX_IMG_COLS, MAX_IMG_ROWS);
+    sizes[numSizes++] = Size(1280, 720);
+    sizes[numSizes++] = Size(1920, 1080);
+  }
+
+  /* outputs go to a scratch directory on the same disk as the real ones */
+  char tmpDir[] = "./stageBench.XXXXXX";
+  if(outDir == NULL) {
+    outDir = mkdtemp(tmpDir);
+    if(outDir == NULL) {
+      fprintf(stderr, "couldn't create output directory: %s\n", strerror(errno));
+      return -1;
+    }
+  }
+
+  benchCtx_t ctx;
+  ctx.outDir = outDir;
+  ctx.sink = 0;
+  ctx.pRing = NULL;
+  memset(&ctx.ringArena, 0, sizeof(ctx.ringArena));
+  memset(ctx.ringFrames, 0, sizeof(ctx.ringFrames));
+  ctx.pExecutor = NULL;
+  taskExecutor_t executor;
+  if(workers != 0) {
+    if(task_executor_create(&executor, workers, 0, NULL) != 0) {
+      fprintf(stderr, "couldn't start %u executor workers\n", workers);
+      return -1;
+    }
+    ctx.pExecutor = &executor;
+  }
+  if(overlay_init(&ctx.overlay) != 0) {
+    fprintf(stderr, "couldn't initialize overlay\n");
+    return -1;
+  }
+
+  printf("stage,source,cols,rows,frames,ns_per_frame,allocs_per_frame,alloc_bytes_per_frame,fps,mpixel_per_sec\n");
+  for(unsigned int sizeInd = 0; sizeInd < numSizes; ++sizeInd) {
+    ctx.rows = sizes[sizeInd].height;
+    ctx.cols = sizes[sizeInd].width;
+    make_frames(&ctx, images);
+    for(unsigned int stage = 0; stage < BENCH_STAGE_COUNT; ++stage) {
+      uint8_t selected = (numOnly == 0);
+      for(unsigned int ind = 0; ind < numOnly; ++ind) {
+        selected |= (strcmp(only[ind], stages[stage].name) == 0);
+      }
+      if(selected) {
+        run_stage(&stages[stage], &ctx, frames, images.empty() ? "synthetic" : "recorded");
+      }
+    }
+  }
+
+  ring_release(&ctx);
+  if(ctx.pExecutor != NULL) {
+    task_executor_destroy(ctx.pExecutor);
+  }
+  clean_dir(outDir);
+  if(outDir == tmpDir) {
+    rmdir(outDir);
+  }
+  fprintf(stderr, "sink %llu\n", (unsigned long long)ctx.sink);
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+static void usage(void)
+{
+  fprintf(stderr, "Usage: ./stageBench [-n frames] [-s WxH]... [-i image]... [-o outDir] [-t stage]... [-x workers]\n"
+                  "  stages: ring, diff, proc, annotate, ppm, video (default: all)\n"
+                  "  sizes: default 640x480, 1280x720 and 1920x1080\n"
+                  "  -x: proc sub-tasks on a work-stealing executor with that many workers\n"
+                  "./stageBench > bench.csv\n"
+                  "./stageBench -s 640x480 -n 500 -t diff -t proc\n"
+                  "./stageBench -i hands0.ppm -i hands1.ppm\n");
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * Synthetic frames are a noisy gradient with a few edges, a circle in the Hough
+ * radius range and a "hand" that moves every frame, so diff finds changes and
+ * proc has lines and circles to find. The same seed gives the same frames.
+ */
+static void make_frames(benchCtx_t *pCtx, const vector<Mat> &images)
+{
+  pCtx->frames.clear();
+  for(unsigned int ind = 0; ind < BENCH_DISTINCT_FRAMES; ++ind) {
+    Mat frame;
+    if(!images.empty()) {
+      resize(images[ind % images.size()], frame, Size(pCtx->cols, pCtx->rows));
+    } else {
+      frame.create(pCtx->rows, pCtx->cols, CV_8UC3);
+      for(int row = 0; row < pCtx->rows; ++row) {
+        frame.row(row).setTo(Scalar(64 + (row * 128) / pCtx->rows, 96, 160 - (row * 96) / pCtx->rows));
+      }
+      theRNG().state = BENCH_SEED + ind;
+      Mat noise(pCtx->rows, pCtx->cols, CV_8UC3);
+      randu(noise, Scalar(0, 0, 0), Scalar(16, 16, 16));
+      frame += noise;
+      int radius = (pCtx->rows < 560) ? 150 : 200;
+      circle(frame, Point(pCtx->cols / 2, pCtx->rows / 2), radius, Scalar(250, 250, 250), 4);
+      line(frame, Point(0, pCtx->rows / 4), Point(pCtx->cols - 1, pCtx->rows / 4), Scalar(20, 20, 20), 3);
+      line(frame, Point(pCtx->cols / 5, 0), Point(pCtx->cols / 5, pCtx->rows - 1), Scalar(20, 20, 20), 3);
+      int handX = (ind * pCtx->cols) / (BENCH_DISTINCT_FRAMES * 2);
+      rectangle(frame, Rect(handX, pCtx->rows / 2, pCtx->cols / 6, pCtx->rows / 3), Scalar(90, 140, 200), -1);
+    }
+    pCtx->frames.push_back(frame);
+  }
+}
+
+/*---------------------------------------------------------------------------------*/
+static void run_stage(const benchStage_t *pStage, benchCtx_t *pCtx, unsigned int frames, const char *source)
+{
+  if((pStage->pSetup != NULL) && (pStage->pSetup(pCtx) != 0)) {
+    fprintf(stderr, "%s setup failed at %dx%d, skipped\n", pStage->name, pCtx->cols, pCtx->rows);
+    return;
+  }
+  for(unsigned int frame = 0; frame < BENCH_WARMUP_FRAMES; ++frame) {
+    pStage->pStep(pCtx, frame);
+  }
+
+  uint64_t allocsBefore = __atomic_load_n(&allocCount, __ATOMIC_RELAXED);
+  uint64_t bytesBefore = __atomic_load_n(&allocBytes, __ATOMIC_RELAXED);
+  uint64_t startNs = monitor_now_ns();
+  for(unsigned int frame = 0; frame < frames; ++frame) {
+    pStage->pStep(pCtx, BENCH_WARMUP_FRAMES + frame);
+  }
+  if(pStage->pFinish != NULL) {
+    pStage->pFinish(pCtx);
+  }
+  uint64_t elapsedNs = monitor_now_ns() - startNs;
+  uint64_t allocs = __atomic_load_n(&allocCount, __ATOMIC_RELAXED) - allocsBefore;
+  uint64_t bytes = __atomic_load_n(&allocBytes, __ATOMIC_RELAXED) - bytesBefore;
+
+  double nsPerFrame = (double)elapsedNs / frames;
+  double fps = (elapsedNs != 0) ? (frames * 1e9) / elapsedNs : 0.0;
+  printf("%s,%s,%d,%d,%u,%.0f,%.2f,%.0f,%.2f,%.2f\n", pStage->name, source, pCtx->cols, pCtx->rows, frames, nsPerFrame,
+         (double)allocs / frames, (double)bytes / frames, fps, (fps * pCtx->rows * pCtx->cols) / 1e6);
+  fflush(stdout);
+}
+
+/*---------------------------------------------------------------------------------*/
+static void clean_dir(const char *dir)
+{
+  char path[PATH_MAX];
+  DIR *pDir = opendir(dir);
+
+  if(pDir == NULL) {
+    return;
+  }
+  struct dirent *pEntry;
+  while((pEntry = readdir(pDir)) != NULL) {
+    if((strncmp(pEntry->d_name, "bench", 5) == 0)) {
+      snprintf(path, sizeof(path), "%s/%s", dir, pEntry->d_name);
+      unlink(path);
+    }
+  }
+  closedir(pDir);
+}
+
+/*---------------------------------------------------------------------------------*/
+/* STAGES */
+static int ring_setup(benchCtx_t *pCtx)
+{
+  /* put copies into locked arena slots and get into a reused Mat, like the pipeline */
+  size_t frameLen = (size_t)pCtx->rows * pCtx->cols * 3;
+  ring_release(pCtx);
+  if(frame_arena_create(&pCtx->ringArena, frameLen, CIRCULAR_BUFF_LEN, FALSE) != 0) {
+    fprintf(stderr, "couldn't create the ring arena, ring slots come from the heap\n");
+  }
+  for(unsigned int ind = 0; ind < CIRCULAR_BUFF_LEN; ++ind) {
+    pCtx->ringFrames[ind] = (uint8_t *)frame_arena_alloc(&pCtx->ringArena, frameLen);
+    if(pCtx->ringFrames[ind] == NULL) {
+      fprintf(stderr, "couldn't allocate ring slot #%u\n", ind);
+      ring_release(pCtx);
+      return -1;
+    }
+  }
+  pCtx->pRing = new circular_cv_buffer(CIRCULAR_BUFF_LEN);
+  pCtx->pRing->attach(pCtx->ringFrames, pCtx->rows, pCtx->cols, CV_8UC3);
+  return 0;
+}
+
+static void ring_step(benchCtx_t *pCtx, unsigned int frame)
+{
+  uint64_t captureNs = 0, putNs = 0;
+
+  pCtx->pRing->put(pCtx->frames[frame % BENCH_DISTINCT_FRAMES], frame, frame);
+  pCtx->pRing->get(pCtx->ringRead, &captureNs, &putNs);
+  pCtx->sink += pCtx->ringRead.data[0] + captureNs;
+}
+
+static void ring_finish(benchCtx_t *pCtx)
+{
+  delete pCtx->pRing;
+  pCtx->pRing = NULL;
+}
+
+/* untimed: the arena of the last size is dropped by the next setup or at exit */
+static void ring_release(benchCtx_t *pCtx)
+{
+  pCtx->ringRead.release();
+  for(unsigned int ind = 0; ind < CIRCULAR_BUFF_LEN; ++ind) {
+    frame_arena_free(&pCtx->ringArena, pCtx->ringFrames[ind]);
+    pCtx->ringFrames[ind] = NULL;
+  }
+  frame_arena_destroy(&pCtx->ringArena);
+}
+
+/*---------------------------------------------------------------------------------*/
+static int diff_setup(benchCtx_t *pCtx)
+{
+  cvtColor(pCtx->frames[0], pCtx->prevGray, COLOR_RGB2GRAY);
+  return 0;
+}
+
+/* as differenceTask: the new frame becomes the previous one */
+static void diff_step(benchCtx_t *pCtx, unsigned int frame)
+{
+  pCtx->sink += frame_difference(pCtx->prevGray, pCtx->frames[frame % BENCH_DISTINCT_FRAMES], pCtx->nextGray,
+                                 pCtx->diffFrame, pCtx->bw);
+  pCtx->nextGray.copyTo(pCtx->prevGray);
+}
+
+/*---------------------------------------------------------------------------------*/
+/* the selected frame is annotated in place, so each step works on a copy */
+static void proc_step(benchCtx_t *pCtx, unsigned int frame)
+{
+  pCtx->frames[frame % BENCH_DISTINCT_FRAMES].copyTo(pCtx->work);
+  frame_process(&pCtx->overlay, pCtx->work, pCtx->procImg, pCtx->grayImg, TRUE, TRUE, TRUE, pCtx->pExecutor);
+  pCtx->sink += pCtx->work.data[0];
+}
+
+static void annotate_step(benchCtx_t *pCtx, unsigned int frame)
+{
+  pCtx->frames[frame % BENCH_DISTINCT_FRAMES].copyTo(pCtx->work);
+  overlay_draw_text(&pCtx->overlay, pCtx->work, frame * BENCH_FRAME_PERIOD_MSEC);
+  pCtx->sink += pCtx->work.data[0];
+}
+
+/*---------------------------------------------------------------------------------*/
+static void ppm_step(benchCtx_t *pCtx, unsigned int frame)
+{
+  char filename[PATH_MAX];
+
+  snprintf(filename, sizeof(filename), "%s/bench_f%u.ppm", pCtx->outDir, frame % BENCH_DISTINCT_FRAMES);
+  pCtx->sink += imwrite(filename, pCtx->frames[frame % BENCH_DISTINCT_FRAMES]);
+}
+
+/*---------------------------------------------------------------------------------*/
+static int video_setup(benchCtx_t *pCtx)
+{
+  char prefix[PATH_MAX];
+
+  snprintf(prefix, sizeof(prefix), "%s/bench_video", pCtx->outDir);
+  memset(&pCtx->video, 0, sizeof(videoEncoder_t));
+  return video_encoder_start(&pCtx->video, prefix, (size_t)pCtx->rows * pCtx->cols * 3, NULL, NULL,
+                             VIDEO_TIMEBASE_FPS);
+}
+
+/* wait for a free slot instead of dropping, so every frame is encoded */
+static void video_step(benchCtx_t *pCtx, unsigned int frame)
+{
+  const Mat &img = pCtx->frames[frame % BENCH_DISTINCT_FRAMES];
+  struct timespec retry = {0, BENCH_VIDEO_RETRY_USEC * 1000};
+
+  while(video_encoder_submit(&pCtx->video, img.data, img.type(), img.rows, img.cols, frame * BENCH_FRAME_PERIOD_MSEC) != 0) {
+    nanosleep(&retry, NULL);
+  }
+}
+
+/* everything submitted has been encoded once the encoder has stopped */
+static void video_finish(benchCtx_t *pCtx)
+{
+  video_encoder_stop(&pCtx->video);
+  pCtx->sink += pCtx->video.encodedCnt;
+}
@@ -0,0 +1,416 @@
+/***********************************************************************************
+ * @author Brian Ibeling
+ * ibelingb@colorado.edu
+ *
+ * Real-time Embedded Systems
+ * ECEN5623 - Sam Siewert
+ * @date 18Oct2026
+ * Ubuntu 18.04 LTS and RPi 3B+
+ ************************************************************************************
+ *
+ * @file traceAnalyzer.c
+ * @brief timing statistics from a binary pipeline trace (traceRing.h)
+ *
+ * Reads the trace in one streaming pass with a fixed size buffer and fixed size
+ * per-thread state / histograms, so memory doesn't grow with the length of the
+ * run. The flush thread writes each thread's events in order but interleaves
+ * threads in batches, so everything is computed per thread:
+ *  - services: start jitter (interval between job starts minus the interval
+ *    between their releases), drift of the starts from the ideal release timeline
+ *    since the first job, ACET / WCET (job start to end)
+ *  - sequencer: release jitter / drift against the base rate (-b)
+ *  - frame selection: frames acquired, changed, selected, processed and saved,
+ *    changed pixel counts and the interval between selections
+ * A trace taken with the virtual clock (-V) only gets the job counts and frame
+ * selection: its times stand still during a job, so there is no timing to report.
+ * One CSV row per job / release is written with -o, and a summary to stdout:
+ *   ./traceAnalyzer project.trace -o trace.csv > summary.txt
+ *
+ ************************************************************************************
+ */
+
+/*---------------------------------------------------------------------------------*/
+/* INCLUDES */
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+/* project headers */
+#include "traceRing.h"
+#include "frameLatency.h"
+#include "sequencer.h"
+
+/*---------------------------------------------------------------------------------*/
+/* MACROS / TYPES / CONST */
+#define READ_EVENTS                   (4096)
+#define SEQ_TRACE_THREAD              (4)     /* Thread_e::SEQ_THREAD */
+#define NSEC_TO_USEC(ns)              ((double)(ns) / 1e3)
+#define NSEC_TO_MSEC(ns)              ((double)(ns) / 1e6)
+
+/* trace thread ids are Thread_e */
+static const char *threadNames[TRACE_MAX_THREADS] = {"acq", "diff", "proc", "write", "seq", "t5", "t6", "t7"};
+
+typedef struct {
+  uint64_t count;
+  int64_t minNs;
+  int64_t maxNs;
+  double sumNs;
+  latencyHist_t absHist;                      /* |value| for percentiles */
+} signedStat_t;
+
+typedef struct {
+  uint64_t jobs;
+  uint8_t inJob;
+  uint32_t jobNum;
+  uint64_t startNs;
+  uint64_t releaseNs;
+  uint8_t haveFirst;
+  uint64_t firstStartNs;
+  uint64_t firstReleaseNs;                    /* or first tick time for the sequencer */
+  uint64_t firstTick;
+  uint64_t prevStartNs;
+  uint64_t prevReleaseNs;                     /* or previous tick for the sequencer */
+  int64_t lastDriftNs;
+  signedStat_t jitter;
+  signedStat_t drift;
+  double sumExecNs;
+  latencyHist_t execHist;
+} threadStats_t;
+
+typedef struct {
+  uint64_t acquired;
+  uint64_t changed;
+  uint64_t pixelSum;
+  uint64_t pixelMax;
+  uint64_t selected;
+  uint64_t processed;
+  uint64_t saved;
+  uint64_t prevSelectNs;
+  latencyHist_t selectInterval;
+} selectStats_t;
+
+/*---------------------------------------------------------------------------------*/
+/* PRIVATE FUNCTIONS */
+static void usage(void);
+static void stat_add(signedStat_t *pStat, int64_t valueNs);
+static void handle_job_start(threadStats_t *pThread, const traceEvent_t *pEvent);
+static void handle_job_end(threadStats_t *pThread, const traceEvent_t *pEvent, const char *name);
+static void handle_release(threadStats_t *pThread, const traceEvent_t *pEvent);
+static void handle_frame(const traceEvent_t *pEvent);
+static void print_summary(const traceFileHeader_t *pHdr, uint64_t events, uint64_t lastNs);
+static void print_timing(void);
+static void print_frames(void);
+
+/*---------------------------------------------------------------------------------*/
+/* GLOBAL VARIABLES */
+static threadStats_t threadStats[TRACE_MAX_THREADS];
+static selectStats_t selectStats;
+static uint64_t basePeriodNs = 1000000000ULL / SEQ_DEFAULT_RATE_HZ;
+static uint64_t traceStartNs = 0;
+static FILE *pCsv = NULL;
+
+/*---------------------------------------------------------------------------------*/
+
+int main(int argc, char *argv[])
+{
+  traceFileHeader_t header;
+  const char *csvName = NULL;
+  int opt;
+
+  while((opt = getopt(argc, argv, "b:o:")) != -1) {
+    switch(opt) {
+    case 'b':
+      if((atoi(optarg) <= 0) || (atoi(optarg) > SEQ_MAX_RATE_HZ)) {
+        usage();
+        return -1;
+      }
+      basePeriodNs = 1000000000ULL / atoi(optarg);
+      break;
+    case 'o':
+      csvName = optarg;
+      break;
+    default:
+      usage();
+      return -1;
+    }
+  }
+  if(optind >= argc) {
+    usage();
+    return -1;
+  }
+
+  FILE *pFile = fopen(argv[optind], "rb");
+  if(pFile == NULL) {
+    fprintf(stderr, "couldn't open %s: %s\n", argv[optind], strerror(errno));
+    return -1;
+  }
+  if((fread(&header, sizeof(traceFileHeader_t), 1, pFile) != 1) ||
+     (memcmp(header.magic, TRACE_FILE_MAGIC, sizeof(header.magic)) != 0) ||
+     (header.version != TRACE_FILE_VERSION) || (header.eventSize != sizeof(traceEvent_t))) {
+    fprintf(stderr, "%s is not a version %d trace\n", argv[optind], TRACE_FILE_VERSION);
+    fclose(pFile);
+    return -1;
+  }
+  traceStartNs = header.startNs;
+
+  if(csvName != NULL) {
+    pCsv = fopen(csvName, "w");
+    if(pCsv == NULL) {
+      fprintf(stderr, "couldn't create %s: %s\n", csvName, strerror(errno));
+      fclose(pFile);
+      return -1;
+    }
+    fprintf(pCsv, "thread,job,start_ms,release_ms,jitter_us,drift_us,exec_us\n");
+  }
+
+  memset(threadStats, 0, sizeof(threadStats));
+  memset(&selectStats, 0, sizeof(selectStats_t));
+  for(unsigned int ind = 0; ind < TRACE_MAX_THREADS; ++ind) {
+    threadStats[ind].jitter.minNs = INT64_MAX;
+    threadStats[ind].jitter.maxNs = INT64_MIN;
+    threadStats[ind].drift.minNs = INT64_MAX;
+    threadStats[ind].drift.maxNs = INT64_MIN;
+  }
+
+  /* single pass over the trace */
+  static traceEvent_t events[READ_EVENTS];
+  uint64_t total = 0;
+  uint64_t lastNs = traceStartNs;
+  size_t cnt;
+  while((cnt = fread(events, sizeof(traceEvent_t), READ_EVENTS, pFile)) > 0) {
+    for(size_t ind = 0; ind < cnt; ++ind) {
+      const traceEvent_t *pEvent = &events[ind];
+      if(pEvent->thread >= TRACE_MAX_THREADS) {
+        continue;
+      }
+      threadStats_t *pThread = &threadStats[pEvent->thread];
+      if(pEvent->timeNs > lastNs) {
+        lastNs = pEvent->timeNs;
+      }
+      switch(pEvent->eventId) {
+      case TRACE_JOB_START:
+        handle_job_start(pThread, pEvent);
+        break;
+      case TRACE_JOB_END:
+        handle_job_end(pThread, pEvent, threadNames[pEvent->thread]);
+        break;
+      case TRACE_SEQ_RELEASE:
+        handle_release(pThread, pEvent);
+        break;
+      default:
+        handle_frame(pEvent);
+        break;
+      }
+    }
+    total += cnt;
+  }
+  fclose(pFile);
+  if(pCsv != NULL) {
+    fclose(pCsv);
+  }
+
+  print_summary(&header, total, lastNs);
+  return 0;
+}
+
+/*---------------------------------------------------------------------------------*/
+static void usage(void)
+{
+  fprintf(stderr, "Usage: ./traceAnalyzer [-b baseRateHz] [-o csvFile] [trace]\n"
+                  "./traceAnalyzer project.trace\n"
+                  "./traceAnalyzer -b 120 -o trace.csv project.trace > summary.txt\n");
+}
+
+/*---------------------------------------------------------------------------------*/
+static void stat_add(signedStat_t *pStat, int64_t valueNs)
+{
+  ++pStat->count;
+  pStat->sumNs += valueNs;
+  if(valueNs < pStat->minNs) {
+    pStat->minNs = valueNs;
+  }
+  if(valueNs > pStat->maxNs) {
+    pStat->maxNs = valueNs;
+  }
+  latency_hist_record(&pStat->absHist, (valueNs < 0) ? -valueNs : valueNs);
+}
+
+/*---------------------------------------------------------------------------------*/
+static void handle_job_start(threadStats_t *pThread, const traceEvent_t *pEvent)
+{
+  pThread->inJob = 1;
+  pThread->jobNum = pEvent->frameNum;
+  pThread->startNs = pEvent->timeNs;
+  pThread->releaseNs = pEvent->arg;
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * A job is complete: jitter / drift of its start and its execution time.
+ */
+static void handle_job_end(threadStats_t *pThread, const traceEvent_t *pEvent, const char *name)
+{
+  int64_t jitterNs = 0;
+
+  if(!pThread->inJob || (pEvent->frameNum != pThread->jobNum)) {
+    return;
+  }
+  pThread->inJob = 0;
+  ++pThread->jobs;
+
+  if(!pThread->haveFirst) {
+    pThread->haveFirst = 1;
+    pThread->firstStartNs = pThread->startNs;
+    pThread->firstReleaseNs = pThread->releaseNs;
+  } else {
+    jitterNs = (int64_t)(pThread->startNs - pThread->prevStartNs) - (int64_t)(pThread->releaseNs - pThread->prevReleaseNs);
+    stat_add(&pThread->jitter, jitterNs);
+  }
+  pThread->lastDriftNs = (int64_t)(pThread->startNs - pThread->firstStartNs) -
+                         (int64_t)(pThread->releaseNs - pThread->firstReleaseNs);
+  stat_add(&pThread->drift, pThread->lastDriftNs);
+  pThread->prevStartNs = pThread->startNs;
+  pThread->prevReleaseNs = pThread->releaseNs;
+
+  pThread->sumExecNs += pEvent->arg;
+  latency_hist_record(&pThread->execHist, pEvent->arg);
+
+  if(pCsv != NULL) {
+    fprintf(pCsv, "%s,%u,%.3f,%.3f,%.1f,%.1f,%.1f\n", name, pThread->jobNum,
+            NSEC_TO_MSEC((int64_t)(pThread->startNs - traceStartNs)), NSEC_TO_MSEC((int64_t)(pThread->releaseNs - traceStartNs)),
+            NSEC_TO_USEC(jitterNs), NSEC_TO_USEC(pThread->lastDriftNs), NSEC_TO_USEC(pEvent->arg));
+  }
+}
+
+/*---------------------------------------------------------------------------------*/
+/*
+ * A sequencer release: jitter / drift against the base rate tick times.
+ */
+static void handle_release(threadStats_t *pThread, const traceEvent_t *pEvent)
+{
+  int64_t jitterNs = 0;
+  uint64_t tick = pEvent->frameNum;
+
+  ++pThread->jobs;
+  if(!pThread->haveFirst) {
+    pThread->haveFirst = 1;
+    pThread->firstStartNs = pEvent->timeNs;
+    pThread->firstTick = tick;
+  } else {
+    jitterNs = (int64_t)(pEvent->timeNs - pThread->prevStartNs) - (int64_t)((tick - pThread->prevReleaseNs) * basePeriodNs);
+    stat_add(&pThread->jitter, jitterNs);
+  }
+  pThread->lastDriftNs = (int64_t)(pEvent->timeNs - pThread->firstStartNs) -
+                         (int64_t)((tick - pThread->firstTick) * basePeriodNs);
+  stat_add(&pThread->drift, pThread->lastDriftNs);
+  pThread->prevStartNs = pEvent->timeNs;
+  pThread->prevReleaseNs = tick;
+
+  if(pCsv != NULL) {
+    fprintf(pCsv, "seq,%llu,%.3f,%.3f,%.1f,%.1f,0.0\n", (unsigned long long)tick,
+            NSEC_TO_MSEC((int64_t)(pEvent->timeNs - traceStartNs)),
+            NSEC_TO_MSEC((int64_t)(pThread->firstStartNs - traceStartNs) + (int64_t)((tick - pThread->firstTick) * basePeriodNs)),
+            NSEC_TO_USEC(jitterNs), NSEC_TO_USEC(pThread->lastDriftNs));
+  }
+}
+
+/*---------------------------------------------------------------------------------*/
+static void handle_frame(const traceEvent_t *pEvent)
+{
+  switch(pEvent->eventId) {
+  case TRACE_ACQ_INSERTED:
+    ++selectStats.acquired;
+    break;
+  case TRACE_DIFF_PIXELS:
+    ++selectStats.changed;
+    selectStats.pixelSum += pEvent->arg;
+    if(pEvent->arg > selectStats.pixelMax) {
+      selectStats.pixelMax = pEvent->arg;
+    }
+    break;
+  case TRACE_DIFF_SELECTED:
+    if((selectStats.selected != 0) && (pEvent->timeNs >= selectStats.prevSelectNs)) {
+      latency_hist_record(&selectStats.selectInterval, pEvent->timeNs - selectStats.prevSelectNs);
+    }
+    selectStats.prevSelectNs = pEvent->timeNs;
+    ++selectStats.selected;
+    break;
+  case TRACE_PROC_QUEUED:
+    ++selectStats.processed;
+    break;
+  case TRACE_WRITE_SAVED:
+    ++selectStats.saved;
+    break;
+  default:
+    break;
+  }
+}
+
+/*---------------------------------------------------------------------------------*/
+static void print_summary(const traceFileHeader_t *pHdr, uint64_t events, uint64_t lastNs)
+{
+  uint8_t isVirtual = (pHdr->flags & TRACE_FLAG_VIRTUAL_CLOCK) != 0;
+  printf("events: %llu, duration: %.3f s%s, trace overhead: %u ns/event, base rate period: %.3f ms\n",
+         (unsigned long long)events, (lastNs - pHdr->startNs) / 1e9, isVirtual ? " (virtual)" : "", pHdr->overheadNs,
+         NSEC_TO_MSEC(basePeriodNs));
+
+  if(isVirtual) {
+    printf("\nvirtual clock trace: time only moves between ticks, so jitter, drift and execution\n"
+           "times are not measured; run without -V for them\n");
+    printf("\nthread, jobs\n");
+    for(unsigned int ind = 0; ind < TRACE_MAX_THREADS; ++ind) {
+      if(threadStats[ind].jobs != 0) {
+        printf("%s, %llu\n", threadNames[ind], (unsigned long long)threadStats[ind].jobs);
+      }
+    }
+  } else {
+    print_timing();
+  }
+  print_frames();
+}
+
+/*---------------------------------------------------------------------------------*/
+static void print_timing(void)
+{
+  printf("\nthread, jobs, jitter us min, avg, p99 abs, max, drift us min, max, final, drift ppm, ACET us, p99 exec us, WCET us\n");
+  for(unsigned int ind = 0; ind < TRACE_MAX_THREADS; ++ind) {
+    const threadStats_t *pThread = &threadStats[ind];
+    if(pThread->jobs == 0) {
+      continue;
+    }
+    uint64_t spanNs = pThread->prevStartNs - pThread->firstStartNs;
+    double driftPpm = (spanNs != 0) ? ((double)pThread->lastDriftNs * 1e6) / spanNs : 0.0;
+    double jitterMin = (pThread->jitter.count != 0) ? NSEC_TO_USEC(pThread->jitter.minNs) : 0.0;
+    double jitterMax = (pThread->jitter.count != 0) ? NSEC_TO_USEC(pThread->jitter.maxNs) : 0.0;
+    double jitterAvg = (pThread->jitter.count != 0) ? NSEC_TO_USEC(pThread->jitter.sumNs / pThread->jitter.count) : 0.0;
+    printf("%s, %llu, %.1f, %.1f, %.1f, %.1f, %.1f, %.1f, %.1f, %.1f", threadNames[ind], (unsigned long long)pThread->jobs,
+           jitterMin, jitterAvg, NSEC_TO_USEC(latency_hist_percentile(&pThread->jitter.absHist, 99.0)), jitterMax,
+           NSEC_TO_USEC(pThread->drift.minNs), NSEC_TO_USEC(pThread->drift.maxNs), NSEC_TO_USEC(pThread->lastDriftNs), driftPpm);
+    if(ind == SEQ_TRACE_THREAD) {
+      printf(", -, -, -\n");
+    } else {
+      printf(", %.1f, %.1f, %.1f\n", NSEC_TO_USEC(pThread->sumExecNs / pThread->jobs),
+             NSEC_TO_USEC(latency_hist_percentile(&pThread->execHist, 99.0)), NSEC_TO_USEC(pThread->execHist.maxNs));
+    }
+  }
+}
+
+/*---------------------------------------------------------------------------------*/
+static void print_frames(void)
+{
+  printf("\nframes acquired: %llu, changed: %llu (%.1f%%), selected: %llu, processed: %llu, saved: %llu, lost: %lld\n",
+         (unsigned long long)selectStats.acquired, (unsigned long long)selectStats.changed,
+         (selectStats.acquired != 0) ? (100.0 * selectStats.changed) / selectStats.acquired : 0.0,
+         (unsigned long long)selectStats.selected, (unsigned long long)selectStats.processed,
+         (unsigned long long)selectStats.saved, (long long)(selectStats.selected - selectStats.saved));
+  printf("changed pixels avg: %.0f, max: %llu\n",
+         (selectStats.changed != 0) ? (double)selectStats.pixelSum / selectStats.changed : 0.0,
+         (unsigned long long)selectStats.pixelMax);
+  printf("selection interval ms p50: %.1f, p99: %.1f, max: %.1f\n",
+         NSEC_TO_MSEC(latency_hist_percentile(&selectStats.selectInterval, 50.0)),
+         NSEC_TO_MSEC(latency_hist_percentile(&selectStats.selectInterval, 99.0)),
+         NSEC_TO_MSEC(selectStats.selectInterval.maxNs));
+}